@@ -3,12 +3,55 @@ CONFIG += console
 CONFIG -= qt
 
 QMAKE_CFLAGS += -std=c99
+LIBS += -lpthread
 
 SOURCES += main.c \
-    yabe.c
+    yabe.c \
+    yabe_index.c \
+    yabe_columns.c \
+    yabe_query.c \
+    yabe_crc32c.c \
+    yabe_log.c \
+    yabe_lz.c \
+    yabe_block.c \
+    yabe_aio.c \
+    yabe_msg.c \
+    yabe_vector.c \
+    yabe_packed.c \
+    yabe_context.c \
+    yabe_canonical.c \
+    yabe_patch.c \
+    yabe_merge.c \
+    yabe_lazy.c \
+    yabe_blob.c \
+    yabe_batch.c \
+    yabe_ring.c \
+    yabe_archive.c
 
 HEADERS += \
     yabe.h \
+    yabe_index.h \
+    yabe_columns.h \
+    yabe_query.h \
+    yabe_crc32c.h \
+    yabe_log.h \
+    yabe_lz.h \
+    yabe_block.h \
+    yabe_aio.h \
+    yabe_msg.h \
+    yabe_endian.h \
+    yabe_vector.h \
+    yabe_packed.h \
+    yabe_context.h \
+    yabe_canonical.h \
+    yabe_patch.h \
+    yabe_merge.h \
+    yabe_lazy.h \
+    yabe_blob.h \
+    yabe_batch.h \
+    yabe_ring.h \
+    yabe_archive.h \
+    yabe_stats.h \
     PrintHex.h
 
 OTHER_FILES +=
@@ -1,7 +1,39 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
 
 #include "yabe.h"
+#include "yabe_index.h"
+#include "yabe_columns.h"
+#include "yabe_query.h"
+#include "yabe_log.h"
+#include "yabe_block.h"
+#include "yabe_aio.h"
+#include "yabe_msg.h"
+#include "yabe_endian.h"
+#include "yabe_vector.h"
+#include "yabe_packed.h"
+#include "yabe_context.h"
+#include "yabe_canonical.h"
+#include "yabe_patch.h"
+#include "yabe_merge.h"
+#include "yabe_lazy.h"
+#include "yabe_blob.h"
+#include "yabe_batch.h"
+#include "yabe_ring.h"
+#include "yabe_archive.h"
+
+/* Sum the integer items of an array, used to test parallel processing */
+static void sumItem( void* ctx, size_t index, yabe_cursor_t* item )
+{
+    int64_t value = 0;
+    (void)index;
+    if( yabe_read_integer( item, &value ) )
+        __sync_fetch_and_add( (int64_t*)ctx, value );
+}
 
 /* Sequence of some rough and minimal encoding and decoding test. */
 
@@ -155,7 +187,7 @@ int main(void)
     bool rBool = false;
     rCur.len += yabe_write_bool( &wCur, wBool );
     res = yabe_read_bool( &rCur, &rBool);
-    if( !res || wBool != rBool )
+    if( !res || wBool != rBool || (uint8_t)rCurInit.ptr[0] != 0xC9 )
     {
         printf( "Failed reading bool 'true'\n" );
         exit(1);
@@ -206,6 +238,1228 @@ int main(void)
     }
     rCur = rCurInit; wCur = wCurInit;
 
+    // Array stream of 1000 integers indexed and summed in parallel
+    rCur.len += yabe_write_array_stream( &wCur );
+    for( int i = 0; i < 1000; ++i )
+        rCur.len += yabe_write_integer( &wCur, i * 1000 );
+    rCur.len += yabe_write_end_stream( &wCur );
+    rCur.len += yabe_write_integer( &wCur, 1 );
+    yabe_index_t index;
+    res = yabe_index_build( &index, rCur.ptr, rCur.len );
+    if( res != rCur.len - 1 || index.count != 1000 )
+    {
+        printf( "Failed indexing array stream\n" );
+        exit(1);
+    }
+    int64_t sum = 0;
+    yabe_parallel_for_each( &index, 4, sumItem, &sum );
+    yabe_index_free( &index );
+    if( sum != 999LL * 1000 * 1000 / 2 )
+    {
+        printf( "Failed parallel processing of array items\n" );
+        exit(1);
+    }
+    res = yabe_skip_value( &rCur );
+    if( res != rCur.len + res - 1 )
+    {
+        printf( "Failed skipping array stream\n" );
+        exit(1);
+    }
+    rCur = rCurInit; wCur = wCurInit;
+
+    // Array of two objects shredded into columns
+    rCur.len += yabe_write_small_array( &wCur, 2 );
+    rCur.len += yabe_write_small_object( &wCur, 3 );
+    rCur.len += yabe_write_string( &wCur, 2 );
+    rCur.len += yabe_write_data( &wCur, "id", 2 );
+    rCur.len += yabe_write_integer( &wCur, 5 );
+    rCur.len += yabe_write_string( &wCur, 4 );
+    rCur.len += yabe_write_data( &wCur, "user", 4 );
+    rCur.len += yabe_write_small_object( &wCur, 2 );
+    rCur.len += yabe_write_string( &wCur, 4 );
+    rCur.len += yabe_write_data( &wCur, "name", 4 );
+    rCur.len += yabe_write_string( &wCur, 1 );
+    rCur.len += yabe_write_data( &wCur, "x", 1 );
+    rCur.len += yabe_write_string( &wCur, 2 );
+    rCur.len += yabe_write_data( &wCur, "id", 2 );
+    rCur.len += yabe_write_integer( &wCur, 7 );
+    rCur.len += yabe_write_string( &wCur, 5 );
+    rCur.len += yabe_write_data( &wCur, "price", 5 );
+    rCur.len += yabe_write_float( &wCur, 2.5 );
+    rCur.len += yabe_write_object_stream( &wCur );
+    rCur.len += yabe_write_string( &wCur, 2 );
+    rCur.len += yabe_write_data( &wCur, "id", 2 );
+    rCur.len += yabe_write_integer( &wCur, 300 );
+    rCur.len += yabe_write_end_stream( &wCur );
+    int64_t ids[2], userIds[2];
+    double prices[2];
+    uint8_t idNulls[1], userIdNulls[1], priceNulls[1];
+    yabe_column_t columns[3] = {
+        { "user.id", yabe_column_int64, userIds, userIdNulls },
+        { "price", yabe_column_double, prices, priceNulls },
+        { "id", yabe_column_int64, ids, idNulls } };
+    size_t nRows = 0;
+    res = yabe_shred( &rCur, columns, 3, 2, &nRows );
+    if( !res || !yabe_end_of_buffer( &rCur ) || nRows != 2 ||
+        ids[0] != 5 || ids[1] != 300 || (idNulls[0] & 3) != 0 ||
+        userIds[0] != 7 || (userIdNulls[0] & 3) != 2 ||
+        prices[0] != 2.5 || (priceNulls[0] & 3) != 2 )
+    {
+        printf( "Failed shredding array of objects\n" );
+        exit(1);
+    }
+
+    // Path queries on the same array of objects
+    yabe_query_t query;
+    yabe_cursor_t match;
+    rCur.ptr = buffer; rCur.len = wCur.ptr - buffer;
+    if( !yabe_query_compile( &query, "$[*].id" ) ||
+        !yabe_query_run( &query, &rCur, NULL, NULL, &nRows ) || nRows != 2 )
+    {
+        printf( "Failed running query $[*].id\n" );
+        exit(1);
+    }
+    rCur.ptr = buffer; rCur.len = wCur.ptr - buffer;
+    if( !yabe_query_compile( &query, "$[0]['user'].id" ) ||
+        !yabe_query_first( &query, &rCur, &match ) ||
+        !yabe_read_integer( &match, &rInteger ) || rInteger != 7 )
+    {
+        printf( "Failed running query $[0]['user'].id\n" );
+        exit(1);
+    }
+    if( yabe_query_compile( &query, "$.a[x]" ) || yabe_query_compile( &query, "a.b" ) )
+    {
+        printf( "Failed rejecting invalid queries\n" );
+        exit(1);
+    }
+    rCur = rCurInit; wCur = wCurInit;
+
+    // A key holding a nul byte doesn't match a shorter path
+    rCur.len += yabe_write_small_array( &wCur, 1 );
+    rCur.len += yabe_write_small_object( &wCur, 1 );
+    rCur.len += yabe_write_string( &wCur, 3 );
+    rCur.len += yabe_write_data( &wCur, "i\0d", 3 );
+    rCur.len += yabe_write_integer( &wCur, 9 );
+    yabe_column_t nulColumn = { "i", yabe_column_int64, ids, idNulls };
+    res = yabe_shred( &rCur, &nulColumn, 1, 2, &nRows );
+    if( !res || nRows != 1 || (idNulls[0] & 1) != 1 )
+    {
+        printf( "Failed shredding a key holding a nul byte\n" );
+        exit(1);
+    }
+    rCur = rCurInit; wCur = wCurInit;
+
+    // Record log with sync frames, footer and recovery of a torn tail
+    const char* logPath = "yabe_test.log";
+    yabe_log_writer_t logWriter;
+    yabe_log_reader_t logReader;
+    remove( logPath );
+    if( !yabe_log_writer_open( &logWriter, logPath, 100, 4096, false ) )
+    {
+        printf( "Failed creating record log\n" );
+        exit(1);
+    }
+    for( int i = 0; i < 2500; ++i )
+    {
+        wCur = wCurInit;
+        res = yabe_write_integer( &wCur, i * 1000 );
+        if( !yabe_log_append( &logWriter, buffer, res ) )
+        {
+            printf( "Failed appending record %d\n", i );
+            exit(1);
+        }
+    }
+    if( !yabe_log_writer_close( &logWriter ) )
+    {
+        printf( "Failed closing record log\n" );
+        exit(1);
+    }
+    FILE* logFile = fopen( logPath, "ab" );
+    fwrite( "torn", 1, 4, logFile );
+    fclose( logFile );
+    if( !yabe_log_writer_open( &logWriter, logPath, 0, 0, false ) ||
+        logWriter.nRecords != 2500 )
+    {
+        printf( "Failed reopening record log\n" );
+        exit(1);
+    }
+    wCur = wCurInit;
+    res = yabe_write_integer( &wCur, -1 );
+    yabe_log_append( &logWriter, buffer, res );
+    yabe_log_writer_close( &logWriter );
+    if( !yabe_log_reader_open( &logReader, logPath ) || logReader.nRecords != 2501 ||
+        !yabe_log_seek( &logReader, 1234 ) || !yabe_log_next( &logReader, &rCur ) ||
+        !yabe_read_integer( &rCur, &rInteger ) || rInteger != 1234000 ||
+        !yabe_log_seek( &logReader, 2500 ) || !yabe_log_next( &logReader, &rCur ) ||
+        !yabe_read_integer( &rCur, &rInteger ) || rInteger != -1 ||
+        yabe_log_next( &logReader, &rCur ) )
+    {
+        printf( "Failed reading record log\n" );
+        exit(1);
+    }
+
+    // a sync frame whose length runs into the footer stops the reader
+    char badSync[4];
+    const uint64_t badOffset = logReader.syncs[5];
+    yabe_store_le32( badSync, 0x80000000U | (uint32_t)(logReader.end - badOffset) );
+    yabe_log_reader_close( &logReader );
+    int logFd = open( logPath, O_WRONLY );
+    if( logFd < 0 || lseek( logFd, (off_t)badOffset, SEEK_SET ) < 0 ||
+        write( logFd, badSync, 4 ) != 4 || close( logFd ) ||
+        !yabe_log_reader_open( &logReader, logPath ) ||
+        !yabe_log_seek( &logReader, 499 ) || !yabe_log_next( &logReader, &rCur ) ||
+        yabe_log_next( &logReader, &rCur ) || logReader.pos > logReader.end ||
+        yabe_log_seek( &logReader, 550 ) || logReader.pos > logReader.end )
+    {
+        printf( "Failed rejecting a sync frame running into the footer\n" );
+        exit(1);
+    }
+    yabe_log_reader_close( &logReader );
+    remove( logPath );
+    rCur = rCurInit; wCur = wCurInit;
+
+    // Block compressed file read back across block boundaries
+    const char* blockPath = "yabe_test.yabz";
+    yabe_block_writer_t blockWriter;
+    yabe_block_reader_t blockReader;
+    rCur.len += yabe_write_signature( &wCur );
+    rCur.len += yabe_write_array_stream( &wCur );
+    for( int i = 0; i < 10000; ++i )
+    {
+        char item[32];
+        size_t itemLen = (size_t)sprintf( item, "item %d", i % 1000 );
+        rCur.len += yabe_write_string( &wCur, itemLen );
+        rCur.len += yabe_write_data( &wCur, item, itemLen );
+        rCur.len += yabe_write_integer( &wCur, (i * 7919) % 100000 );
+    }
+    rCur.len += yabe_write_end_stream( &wCur );
+    if( !yabe_block_writer_open( &blockWriter, blockPath, 4096 ) ||
+        yabe_block_write( &blockWriter, buffer, rCur.len ) != rCur.len ||
+        !yabe_block_writer_close( &blockWriter ) ||
+        !yabe_block_reader_open( &blockReader, blockPath ) ||
+        blockReader.nBlocks != (rCur.len + 4095) / 4096 ||
+        blockReader.mapSize >= rCur.len )
+    {
+        printf( "Failed writing block compressed file\n" );
+        exit(1);
+    }
+    yabe_cursor_t blockCur;
+    for( size_t offset = 0; offset < rCur.len; offset += 4000 )
+        if( !yabe_block_map( &blockReader, offset, 200, &blockCur ) ||
+            memcmp( blockCur.ptr, buffer + offset, blockCur.len ) )
+        {
+            printf( "Failed reading block compressed file at %u\n", (unsigned)offset );
+            exit(1);
+        }
+    yabe_block_reader_close( &blockReader );
+    remove( blockPath );
+
+    // footers whose block count wraps or whose offsets are past the index
+    char badBlocks[40] = { 'Y', 'A', 'B', 'Z', 2 };
+    memcpy( badBlocks + 8, "\xff\xff\xff\xff\xff\xff\xff\xff\0\0\0\0\2\0\0\0YABZEND", 24 );
+    bool blockOk = !yabe_block_reader_init( &blockReader, badBlocks, 32 );
+    badBlocks[4] = 16;
+    yabe_store_le64( badBlocks + 8, 1000 );
+    yabe_store_le64( badBlocks + 16, 16 );
+    yabe_store_le32( badBlocks + 24, 1 );
+    yabe_store_le32( badBlocks + 28, 16 );
+    memcpy( badBlocks + 32, "YABZEND", 8 );
+    blockOk = blockOk && yabe_block_reader_init( &blockReader, badBlocks, 40 ) &&
+        blockReader.nBlocks == 1 && !yabe_block_map( &blockReader, 0, 16, &blockCur );
+    yabe_block_reader_close( &blockReader );
+    if( !blockOk )
+    {
+        printf( "Failed rejecting invalid block compressed footers\n" );
+        exit(1);
+    }
+    rCur = rCurInit; wCur = wCurInit;
+
+    // Asynchronous writing and reading with values spanning buffers
+    const char* aioPath = "yabe_test.aio";
+    yabe_aio_writer_t aioWriter;
+    yabe_aio_reader_t aioReader;
+    if( !yabe_aio_writer_open( &aioWriter, aioPath, 4096, 3, &wCur ) )
+    {
+        printf( "Failed creating file for asynchronous writing\n" );
+        exit(1);
+    }
+    memset( wString, 'B', sizeof(wString) );
+    for( int i = 0; i < 100000; ++i )
+    {
+        const size_t strLen = i % 1000 == 0 ? sizeof(wString) : 0;
+        if( wCur.len < 16 + strLen && !yabe_aio_write_flush( &aioWriter, &wCur ) )
+        {
+            printf( "Failed asynchronous writing\n" );
+            exit(1);
+        }
+        yabe_write_integer( &wCur, i );
+        if( strLen )
+        {
+            yabe_write_string( &wCur, strLen );
+            yabe_write_data( &wCur, wString, strLen );
+        }
+    }
+    if( !yabe_aio_writer_close( &aioWriter, &wCur ) ||
+        !yabe_aio_reader_open( &aioReader, aioPath, 1000, 3 ) )
+    {
+        printf( "Failed closing or opening file for asynchronous I/O\n" );
+        exit(1);
+    }
+    yabe_cursor_t aioCur = { NULL, 0 };
+    int64_t aioCount = 0;
+    while( yabe_aio_read( &aioReader, &aioCur ) )
+    {
+        yabe_cursor_t value = aioCur;
+        yabe_string_view_t view;
+        while( yabe_skip_value( &value ) )
+        {
+            if( yabe_read_integer( &aioCur, &rInteger ) )
+            {
+                if( rInteger != aioCount++ )
+                    break;
+            }
+            else if( !yabe_read_string_view( &aioCur, &view ) || view.len != sizeof(wString) )
+                break;
+            aioCur = value;
+        }
+    }
+    yabe_aio_reader_close( &aioReader );
+    remove( aioPath );
+    if( aioCount != 100000 || aioCur.len != 0 )
+    {
+        printf( "Failed asynchronous reading\n" );
+        exit(1);
+    }
+    rCur = rCurInit; wCur = wCurInit;
+
+    // Framed messages exchanged on a non-blocking socket pair
+    int sockets[2];
+    yabe_msg_conn_t sender, receiver;
+    if( socketpair( AF_UNIX, SOCK_STREAM, 0, sockets ) ||
+        fcntl( sockets[0], F_SETFL, O_NONBLOCK ) || fcntl( sockets[1], F_SETFL, O_NONBLOCK ) ||
+        !yabe_msg_conn_init( &sender, sockets[0], 0 ) ||
+        !yabe_msg_conn_init( &receiver, sockets[1], 4096 ) )
+    {
+        printf( "Failed initializing message connections\n" );
+        exit(1);
+    }
+    size_t msgOffsets[10001];
+    msgOffsets[0] = 0;
+    for( int i = 0; i < 10000; ++i )
+    {
+        yabe_write_small_array( &wCur, 2 );
+        yabe_write_integer( &wCur, i );
+        yabe_write_string( &wCur, 5 );
+        yabe_write_data( &wCur, "hello", 5 );
+        msgOffsets[i+1] = wCur.ptr - buffer;
+        yabe_msg_send( &sender, buffer + msgOffsets[i], msgOffsets[i+1] - msgOffsets[i] );
+    }
+    long nMsgSent = 0, nMsgReceived = 0;
+    while( nMsgReceived < 10000 )
+    {
+        long res = yabe_msg_flush( &sender );
+        if( res < 0 )
+            break;
+        nMsgSent += res;
+        while( yabe_msg_recv( &receiver ) > 0 )
+            while( yabe_msg_next( &receiver, &rCur ) )
+            {
+                int8_t nbr;
+                if( !yabe_read_small_array( &rCur, &nbr ) || nbr != 2 ||
+                    !yabe_read_integer( &rCur, &rInteger ) || rInteger != nMsgReceived++ )
+                    nMsgReceived = 20000;
+            }
+        if( receiver.error )
+            break;
+    }
+    yabe_msg_conn_free( &sender );
+    yabe_msg_conn_free( &receiver );
+    close( sockets[0] );
+    close( sockets[1] );
+    if( nMsgSent != 10000 || nMsgReceived != 10000 )
+    {
+        printf( "Failed exchanging framed messages\n" );
+        exit(1);
+    }
+    rCur = rCurInit; wCur = wCurInit;
+
+    // Test exact size precomputation and unchecked writing
+    {
+        const int64_t ints[] = { 0, -32, 127, -33, 128, 32767, -32769, 2147483647LL, -2147483649LL };
+        const double flts[] = { 0., 1.5, -2., 1./3., 0.1f, 1e300, 65504. };
+        const size_t strs[] = { 0, 63, 64, 65535, 65536 };
+        size_t total = 0;
+        for( size_t i = 0; i < sizeof(ints)/sizeof(ints[0]); ++i )
+            total += yabe_sizeof_integer( ints[i] );
+        for( size_t i = 0; i < sizeof(flts)/sizeof(flts[0]); ++i )
+            total += yabe_sizeof_float( flts[i] );
+        for( size_t i = 0; i < sizeof(strs)/sizeof(strs[0]); ++i )
+            total += yabe_sizeof_string( strs[i] );
+        total += yabe_sizeof_blob( 3, 70000 );
+        char* exact = malloc( total );
+        yabe_cursor_t pCur = { exact, total };
+        for( size_t i = 0; i < sizeof(ints)/sizeof(ints[0]); ++i )
+        {
+            yabe_put_integer( &pCur, ints[i] );
+            yabe_write_integer( &wCur, ints[i] );
+        }
+        for( size_t i = 0; i < sizeof(flts)/sizeof(flts[0]); ++i )
+        {
+            yabe_put_float( &pCur, flts[i] );
+            yabe_write_float( &wCur, flts[i] );
+        }
+        for( size_t i = 0; i < sizeof(strs)/sizeof(strs[0]); ++i )
+        {
+            yabe_put_string( &pCur, strs[i] );
+            yabe_write_string( &wCur, strs[i] );
+        }
+        size_t blobStart = wCur.ptr - buffer;
+        yabe_put_blob( &pCur );
+        yabe_put_string( &pCur, 3 );
+        yabe_put_data( &pCur, "raw", 3 );
+        yabe_put_string( &pCur, 70000 );
+        memset( pCur.ptr, 'x', 70000 );
+        pCur.ptr += 70000; pCur.len -= 70000;
+        yabe_write_blob( &wCur );
+        yabe_write_string( &wCur, 3 );
+        yabe_write_data( &wCur, "raw", 3 );
+        yabe_write_string( &wCur, 70000 );
+        memset( wCur.ptr, 'x', 70000 );
+        wCur.ptr += 70000; wCur.len -= 70000;
+        rCur.len += total;
+        size_t strSize = 0;
+        rCur.ptr = buffer + blobStart + 5;
+        if( pCur.len != 0 || (size_t)(wCur.ptr - buffer) != total ||
+            memcmp( exact, buffer, total ) != 0 ||
+            buffer[blobStart + 5] != yabe_str32_tag ||
+            !yabe_read_string( &rCur, &strSize ) || strSize != 70000 )
+        {
+            printf( "Failed exact size precomputation\n" );
+            exit(1);
+        }
+        free( exact );
+    }
+    rCur = rCurInit; wCur = wCurInit;
+
+    // Test little endian fixtures at unaligned positions
+    {
+        static const unsigned char fixture[] = {
+            0xC1, 0x34, 0x12,                                       // int16 0x1234
+            0xC2, 0x78, 0x56, 0x34, 0x12,                           // int32 0x12345678
+            0xC3, 0xF0, 0xDE, 0xBC, 0x9A, 0x78, 0x56, 0x34, 0x12,   // int64
+            0xC5, 0x00, 0xBC,                                       // flt16 -1.
+            0xC6, 0x00, 0x00, 0x80, 0x49,                           // flt32 2^20
+            0xC7, 0x9A, 0x99, 0x99, 0x99, 0x99, 0x99, 0xB9, 0x3F,   // flt64 0.1
+            0xCD, 0x34, 0x12                                        // str16 0x1234
+        };
+        wCur.ptr += 1; wCur.len -= 1;    // odd address
+        char* start = wCur.ptr;
+        yabe_write_integer( &wCur, 0x1234 );
+        yabe_write_integer( &wCur, 0x12345678 );
+        yabe_write_integer( &wCur, 0x123456789ABCDEF0LL );
+        yabe_write_float( &wCur, -1. );
+        yabe_write_float( &wCur, 1048576. );
+        yabe_write_float( &wCur, 0.1 );
+        yabe_write_string( &wCur, 0x1234 );
+        if( (size_t)(wCur.ptr - start) != sizeof(fixture) ||
+            memcmp( start, fixture, sizeof(fixture) ) != 0 )
+        {
+            printf( "Failed writing little endian fixture\n" );
+            exit(1);
+        }
+        rCur.ptr = start; rCur.len = sizeof(fixture);
+        int64_t i16, i32, i64;
+        double f16, f32, f64;
+        size_t s16;
+        if( !yabe_read_integer( &rCur, &i16 ) || i16 != 0x1234 ||
+            !yabe_read_integer( &rCur, &i32 ) || i32 != 0x12345678 ||
+            !yabe_read_integer( &rCur, &i64 ) || i64 != 0x123456789ABCDEF0LL ||
+            !yabe_read_float( &rCur, &f16 ) || f16 != -1. ||
+            !yabe_read_float( &rCur, &f32 ) || f32 != 1048576. ||
+            !yabe_read_float( &rCur, &f64 ) || f64 != 0.1 ||
+            !yabe_read_string( &rCur, &s16 ) || s16 != 0x1234 )
+        {
+            printf( "Failed reading little endian fixture\n" );
+            exit(1);
+        }
+
+        // The big endian host path is the byte swapped one, run it on
+        // byte swapped copies of the fixture fields
+        bool swapOk = true;
+        const size_t fields[][2] = { {1,2}, {4,4}, {9,8}, {18,2}, {21,4}, {26,8}, {35,2} };
+        for( size_t i = 0; i < sizeof(fields)/sizeof(fields[0]); ++i )
+        {
+            const unsigned char* le = fixture + fields[i][0];
+            const size_t n = fields[i][1];
+            unsigned char be[9], out[9];
+            for( size_t j = 0; j < n; ++j )
+                be[j+1] = le[n-1-j];    // unaligned by one byte
+            if( n == 2 )
+            {
+                swapOk &= yabe_load_be16( be + 1 ) == yabe_load_le16( le );
+                yabe_store_be16( out + 1, yabe_load_le16( le ) );
+            }
+            else if( n == 4 )
+            {
+                swapOk &= yabe_load_be32( be + 1 ) == yabe_load_le32( le );
+                yabe_store_be32( out + 1, yabe_load_le32( le ) );
+            }
+            else
+            {
+                swapOk &= yabe_load_be64( be + 1 ) == yabe_load_le64( le );
+                yabe_store_be64( out + 1, yabe_load_le64( le ) );
+            }
+            swapOk &= memcmp( out + 1, be + 1, n ) == 0;
+        }
+        if( !swapOk || yabe_load_le32( fixture + 4 ) != 0x12345678 ||
+            yabe_load_le64( fixture + 9 ) != 0x123456789ABCDEF0ULL )
+        {
+            printf( "Failed byte swapped fixture\n" );
+            exit(1);
+        }
+    }
+    rCur = rCurInit; wCur = wCurInit;
+
+    // Test bulk integer encoding and decoding
+    {
+        const size_t nValues = 10003;
+        int64_t* values = malloc( nValues * sizeof(int64_t) );
+        int64_t* decoded = malloc( (nValues + 1) * sizeof(int64_t) );
+        uint64_t seed = 12345;
+        for( size_t i = 0; i < nValues; ++i )
+        {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            const int shift = (i / 100) % 4 == 0 ? 58 : (int)(seed % 64);
+            values[i] = (int64_t)seed >> shift;   // runs of small values and mixed widths
+        }
+        const size_t size = yabe_sizeof_integers( values, nValues );
+        for( size_t i = 0; i < nValues; ++i )
+            yabe_write_integer( &wCur, values[i] );
+        yabe_write_end_stream( &wCur );
+        yabe_cursor_t bulk = { buffer + size + 1, size + 1 };
+        const size_t nWritten = yabe_write_integers( &bulk, values, nValues );
+        yabe_write_end_stream( &bulk );
+        rCur.len += size + 1;
+        const size_t nRead = yabe_read_integers( &rCur, decoded, nValues + 1 );
+        yabe_cursor_t small = { buffer + 2*size + 2, 40 };
+        const size_t nSmall = yabe_write_integers( &small, values + 600, nValues - 600 );
+        if( (size_t)(wCur.ptr - buffer) != size + 1 || nWritten != nValues || bulk.len != 0 ||
+            memcmp( buffer, buffer + size + 1, size + 1 ) != 0 ||
+            nRead != nValues || memcmp( values, decoded, nValues * sizeof(int64_t) ) != 0 ||
+            rCur.len != 1 || yabe_sizeof_integers( values + 600, nSmall ) != 40 - small.len ||
+            memcmp( small.ptr - (40 - small.len), buffer + yabe_sizeof_integers( values, 600 ),
+                    40 - small.len ) != 0 )
+        {
+            printf( "Failed bulk integer encoding\n" );
+            exit(1);
+        }
+        free( values );
+        free( decoded );
+    }
+    rCur = rCurInit; wCur = wCurInit;
+
+    // Test packed integer arrays
+    {
+        const size_t nStamps = 5000;
+        int64_t* stamps = malloc( nStamps * sizeof(int64_t) );
+        int64_t* levels = malloc( nStamps * sizeof(int64_t) );
+        int64_t* decoded = malloc( nStamps * sizeof(int64_t) );
+        uint64_t seed = 42;
+        for( size_t i = 0; i < nStamps; ++i )
+        {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            stamps[i] = 1700000000000LL + (int64_t)i * 1000 + (int64_t)(seed >> 60);  // ms with jitter
+            levels[i] = (int64_t)(i / 700) * 1000000;                                  // step signal
+        }
+        size_t count = 0;
+        res = yabe_write_signature_version( &wCur, 1 );
+        res += yabe_write_delta_array( &wCur, stamps, nStamps );
+        res += yabe_write_rle_array( &wCur, levels, nStamps );
+        res += yabe_write_delta_array( &wCur, levels, 1 );
+        yabe_write_array_stream( &wCur );
+        yabe_write_integers( &wCur, stamps, 100 );
+        yabe_write_none( &wCur );
+        yabe_write_integers( &wCur, levels, 100 );
+        yabe_write_end_stream( &wCur );
+        yabe_write_small_array( &wCur, 2 );
+        yabe_write_integer( &wCur, -5 );
+        yabe_write_integer( &wCur, 1LL<<40 );
+        rCur.len += wCur.ptr - buffer;
+        const size_t deltaSize = yabe_sizeof_delta_array( stamps, nStamps );
+        const size_t rleSize = yabe_sizeof_rle_array( levels, nStamps );
+        bool packedOk = res == 5 + deltaSize + rleSize + yabe_sizeof_delta_array( levels, 1 ) &&
+            deltaSize < yabe_sizeof_integers( stamps, nStamps ) / 6 &&
+            rleSize < 128 && yabe_read_signature( &rCur ) == 5;
+        yabe_cursor_t skipCur = rCur;
+        packedOk = packedOk && yabe_skip_value( &skipCur ) == deltaSize &&
+            yabe_read_integer_array( &rCur, decoded, nStamps, &count ) == deltaSize &&
+            count == nStamps && !memcmp( decoded, stamps, nStamps * sizeof(int64_t) ) &&
+            !yabe_read_integer_array( &rCur, decoded, nStamps - 1, &count ) &&
+            yabe_read_integer_array( &rCur, decoded, nStamps, &count ) == rleSize &&
+            count == nStamps && !memcmp( decoded, levels, nStamps * sizeof(int64_t) ) &&
+            yabe_read_integer_array( &rCur, decoded, nStamps, &count ) && count == 1 && decoded[0] == 0 &&
+            yabe_read_integer_array( &rCur, decoded, nStamps, &count ) && count == 200 &&
+            !memcmp( decoded, stamps, 100 * sizeof(int64_t) ) &&
+            !memcmp( decoded + 100, levels, 100 * sizeof(int64_t) ) &&
+            yabe_read_integer_array( &rCur, decoded, 2, &count ) && count == 2 &&
+            decoded[0] == -5 && decoded[1] == 1LL<<40 && rCur.len == 0;
+        uint8_t version = 0;
+        yabe_cursor_t sigCur = { buffer, 5 };
+        packedOk = packedOk && yabe_read_signature_version( &sigCur, &version ) == 5 && version == 1;
+        wCur = wCurInit; sigCur = (yabe_cursor_t){ buffer, 5 };
+        yabe_write_signature( &wCur );
+        packedOk = packedOk && yabe_read_signature_version( &sigCur, &version ) == 5 && version == 0;
+        if( !packedOk )
+        {
+            printf( "Failed packed integer arrays\n" );
+            exit(1);
+        }
+        free( stamps );
+        free( levels );
+        free( decoded );
+    }
+    rCur = rCurInit; wCur = wCurInit;
+
+    // Test packed arrays whose few bytes stand for too many values
+    {
+        // delta array of 2^40 values of width 0, rle array of 3 * 2^31 values
+        const char deltaBomb[] = { yabe_blob_tag, YABE_PACKED_DELTA, (char)(yabe_str6_tag | 17),
+                                   0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+        char rleBomb[3 + 8 + 3 * 12] = { yabe_blob_tag, YABE_PACKED_RLE, (char)(yabe_str6_tag | 44) };
+        yabe_store_le64( rleBomb + 3, 3ULL << 31 );
+        for( int i = 0; i < 3; ++i )
+            yabe_store_le32( rleBomb + 11 + 12 * i, 1U << 31 );
+        yabe_cursor_t deltaCur = { (char*)deltaBomb, sizeof(deltaBomb) };
+        yabe_cursor_t rleCur = { rleBomb, sizeof(rleBomb) };
+        yabe_packed_iter_t iter;
+        int64_t value;
+        size_t count;
+        if( yabe_read_packed( &deltaCur, &iter ) || yabe_read_packed( &rleCur, &iter ) ||
+            yabe_read_integer_array( &deltaCur, &value, SIZE_MAX, &count ) ||
+            yabe_read_integer_array( &rleCur, &value, SIZE_MAX, &count ) ||
+            deltaCur.len != sizeof(deltaBomb) || rleCur.len != sizeof(rleBomb) )
+        {
+            printf( "Failed rejecting packed arrays of too many values\n" );
+            exit(1);
+        }
+    }
+    rCur = rCurInit; wCur = wCurInit;
+
+    // Test reusable contexts
+    {
+        yabe_context_t* ctx = yabe_context_thread();
+        size_t nMallocs = 0;
+        bool contextOk = ctx != NULL && ctx == yabe_context_thread();
+        for( int i = 0; contextOk && i < 1000; ++i )
+        {
+            // messages grow up to 4 KB, then only reuse the buffers
+            const size_t strLen = (i % 64) * 64;
+            yabe_cursor_t* out = yabe_context_begin( ctx, 256 );
+            contextOk = out != NULL;
+            while( contextOk && !(yabe_write_small_array( out, 2 ) && yabe_write_string( out, strLen ) &&
+                   yabe_write_data( out, buffer, strLen ) == strLen && yabe_write_integer( out, i )) )
+            {
+                yabe_context_reset( ctx );    // restart the message in a larger buffer
+                contextOk = yabe_context_grow( ctx );
+            }
+            yabe_cursor_t in = { ctx->out, yabe_context_size( ctx ) };
+            int8_t nbr;
+            size_t len;
+            int64_t value;
+            char* str1 = NULL;
+            contextOk = contextOk && yabe_read_small_array( &in, &nbr ) &&
+                (str1 = yabe_context_read_string( ctx, &in, &len )) && len == strLen &&
+                str1[len] == '\0' && !memcmp( str1, buffer, len ) &&
+                yabe_read_integer( &in, &value ) && value == i && in.len == 0;
+            if( i == 100 )
+                nMallocs = ctx->pool.nMallocs;
+            yabe_context_reset( ctx );
+        }
+        contextOk = contextOk && ctx->pool.nMallocs == nMallocs && ctx->outCapacity == 4096;
+
+        // the retained memory is capped
+        yabe_pool_t pool;
+        yabe_pool_init( &pool, 1000 );
+        size_t capacity;
+        void* buffers[8];
+        for( int i = 0; i < 8; ++i )
+            buffers[i] = yabe_pool_get( &pool, 300, &capacity );
+        for( int i = 0; i < 8; ++i )
+            yabe_pool_put( &pool, buffers[i], capacity );
+        contextOk = contextOk && capacity == 512 && pool.retained == 512 && pool.nMallocs == 8 &&
+            yabe_pool_get( &pool, 400, &capacity ) == buffers[0] && pool.retained == 0;
+        yabe_pool_put( &pool, buffers[0], capacity );
+        yabe_pool_free( &pool );
+        if( !contextOk )
+        {
+            printf( "Failed reusable contexts\n" );
+            exit(1);
+        }
+    }
+    rCur = rCurInit; wCur = wCurInit;
+
+#ifdef YABE_STATS
+    // Test the encoding and decoding counters
+    {
+        yabe_stats_reset();
+        const int64_t ints[] = { 1, 300, 1<<20, 1LL<<40, -5 };
+        for( size_t i = 0; i < 5; ++i )
+            rCur.len += yabe_write_integer( &wCur, ints[i] );
+        rCur.len += yabe_write_float( &wCur, 0.5 ) + yabe_write_float( &wCur, 0.1 );
+        rCur.len += yabe_write_none( &wCur ) + yabe_write_none( &wCur );
+        rCur.len += yabe_write_string( &wCur, 100 );
+        int64_t value;
+        double flt;
+        size_t len;
+        for( size_t i = 0; i < 5; ++i )
+            yabe_read_integer( &rCur, &value );
+        yabe_read_float( &rCur, &flt );
+        yabe_read_float( &rCur, &flt );
+        yabe_read_none( &rCur );
+        yabe_read_string( &rCur, &len );
+        const yabe_stats_t* stats = yabe_stats();
+        if( stats->writeInteger[0] != 2 || stats->writeInteger[1] != 1 ||
+            stats->writeInteger[2] != 1 || stats->writeInteger[3] != 1 ||
+            stats->readInteger[0] != 2 || stats->readInteger[3] != 1 ||
+            stats->writeFloat[1] != 1 || stats->writeFloat[3] != 1 ||
+            stats->readFloat[1] != 1 || stats->readFloat[3] != 1 ||
+            stats->writeString[1] != 1 || stats->readString[1] != 1 ||
+            stats->noneSkipped != 2 )
+        {
+            printf( "Failed counting encodings\n" );
+            exit(1);
+        }
+    }
+    rCur = rCurInit; wCur = wCurInit;
+#endif
+
+    // Test the canonical encoding
+    {
+        // object stream with unsorted members, none padding, an integer in a
+        // too large encoding and an array stream of one item
+        char doc[] = "\xDF\x81" "b\xCC\xC2\x05\x00\x00\x00\x82" "aa\xD7\x01\xC5\x00\x3C\xCB"
+                     "\x81" "a\xD8\xCB";
+        const char canonical[] = "\xDB\x81" "a\xD8\x82" "aa\xD2\x01\xC5\x00\x3C\x81" "b\x05";
+        char nan[] = "\xC7\x00\x00\x00\x00\x00\x00\xF8\x7F";
+        char dup[] = "\xDA\x81" "a\x01\x81" "a\x02";
+        char* out = buffer + 1024;
+        yabe_cursor_t in = { doc, sizeof(doc) - 1 }, w = { out, 256 };
+        bool canonicalOk = !yabe_is_canonical( &in ) &&
+            yabe_canonicalize( &in, &w ) == sizeof(canonical) - 1 && in.len == 0 &&
+            !memcmp( out, canonical, sizeof(canonical) - 1 );
+
+        // canonical values are copied, packed arrays become plain arrays
+        yabe_cursor_t c = { out, sizeof(canonical) - 1 };
+        canonicalOk = canonicalOk && yabe_is_canonical( &c ) == sizeof(canonical) - 1 &&
+            yabe_canonicalize( &c, &w ) == sizeof(canonical) - 1 &&
+            !memcmp( out + sizeof(canonical) - 1, canonical, sizeof(canonical) - 1 );
+        const int64_t run[3] = { 7, 7, 7 };
+        rCur.len += yabe_write_rle_array( &wCur, run, 3 );
+        w = (yabe_cursor_t){ out, 256 };
+        canonicalOk = canonicalOk && yabe_canonicalize( &rCur, &w ) == 4 &&
+            !memcmp( out, "\xD3\x07\x07\x07", 4 );
+
+        // NaN has a single encoding, duplicate members have none
+        in = (yabe_cursor_t){ nan, sizeof(nan) - 1 };
+        w = (yabe_cursor_t){ out, 256 };
+        canonicalOk = canonicalOk && yabe_canonicalize( &in, &w ) == 3 &&
+            !memcmp( out, "\xC5\x00\x7D", 3 );
+        in = (yabe_cursor_t){ dup, sizeof(dup) - 1 };
+        canonicalOk = canonicalOk && !yabe_canonicalize( &in, &w ) && in.ptr == dup;
+        if( !canonicalOk )
+        {
+            printf( "Failed canonical encoding\n" );
+            exit(1);
+        }
+    }
+    rCur = rCurInit; wCur = wCurInit;
+
+    // Test the hashing and comparison of encoded values
+    {
+        // the same object in two encodings, and a different one
+        char a[] = "\xDA\x81" "x\xD3\x07\x07\x07\x81" "y\xC7\x00\x00\x00\x00\x00\x00\xF8\x7F";
+        char b[] = "\xDF\x81" "y\xC5\x00\x7D\x81" "x\xD7\xC1\x07\x00\xCC\x07\x07\xCB\xCB";
+        char c[] = "\xDA\x81" "x\xD3\x07\x07\x08\x81" "y\xC5\x00\x7D";
+        yabe_cursor_t ca = { a, sizeof(a) - 1 }, cb = { b, sizeof(b) - 1 }, cc = { c, sizeof(c) - 1 };
+        uint64_t ha = 0, hb = 1, hc = 2, hp = 3;
+        bool hashOk = yabe_equal_values( &ca, &cb ) && !yabe_equal_values( &ca, &cc ) &&
+            yabe_hash_value( &ca, &ha ) == sizeof(a) - 1 && ca.len == 0 &&
+            yabe_hash_value( &cb, &hb ) && yabe_hash_value( &cc, &hc ) && ha == hb && ha != hc;
+
+        // a packed array equals the plain array of its values
+        const int64_t run[3] = { 7, 7, 7 };
+        rCur.len += yabe_write_rle_array( &wCur, run, 3 );
+        yabe_cursor_t plain = { a + 3, 4 };
+        hashOk = hashOk && yabe_equal_values( &rCur, &plain ) &&
+            yabe_hash_value( &rCur, &hp ) && yabe_hash_value( &plain, &hc ) && hp == hc;
+
+        // integers and floats are different values
+        char one[] = "\x01\xC5\x00\x3C";
+        yabe_cursor_t i1 = { one, 1 }, f1 = { one + 1, 3 };
+        hashOk = hashOk && !yabe_equal_values( &i1, &f1 ) &&
+            yabe_hash_value( &i1, &ha ) && yabe_hash_value( &f1, &hb ) && ha != hb;
+
+        // a rle array of 2^32 values in 35 bytes is not expanded
+        char rleMax[3 + 8 + 2 * 12] = { yabe_blob_tag, YABE_PACKED_RLE, (char)(yabe_str6_tag | 32) };
+        yabe_store_le64( rleMax + 3, 1ULL << 32 );
+        for( int i = 0; i < 2; ++i )
+            yabe_store_le32( rleMax + 11 + 12 * i, 1U << 31 );
+        yabe_cursor_t maxCur = { rleMax, sizeof(rleMax) }, maxCopy = maxCur;
+        hashOk = hashOk && !yabe_hash_value( &maxCur, &ha ) && !yabe_equal_values( &maxCur, &maxCopy ) &&
+            !yabe_canonicalize( &maxCur, &wCur ) && maxCur.len == sizeof(rleMax);
+        if( !hashOk )
+        {
+            printf( "Failed hashing and comparing values\n" );
+            exit(1);
+        }
+    }
+    rCur = rCurInit; wCur = wCurInit;
+
+    // Test the patching of values in place and by splicing
+    {
+        // { "a" : [ 1, "xyz" ], "b" : 5 }
+        char doc[] = "\xDA\x81" "a\xD2\x01\x83" "xyz\x81" "b\x05";
+        const yabe_cursor_t cDoc = { doc, sizeof(doc) - 1 };
+        yabe_query_t qItem, qArray, qFirst, qB;
+        yabe_cursor_t ok = { "\x82" "ok", 3 }, abc = { "\x83" "abc", 4 };
+        yabe_cursor_t match;
+        size_t padding = 0;
+        bool patchOk = yabe_query_compile( &qItem, "$.a[1]" ) &&
+            yabe_query_compile( &qArray, "$.a" ) && yabe_query_compile( &qFirst, "$.a[0]" ) &&
+            yabe_query_compile( &qB, "$.b" ) &&
+            yabe_patch_in_place( &cDoc, &qItem, &ok ) == 4 &&
+            !memcmp( doc, "\xDA\x81" "a\xD2\x01\xCC\x82" "ok\x81" "b\x05", cDoc.len ) &&
+            yabe_query_locate( &qItem, &cDoc, &match, &padding ) && padding == 1 &&
+            match.len == 3 && yabe_patch_in_place( &cDoc, &qItem, &abc ) == 4 &&
+            !yabe_patch_in_place( &cDoc, &qB, &abc );
+
+        // larger values are spliced, values inside them can't be patched
+        yabe_rope_t rope;
+        yabe_cursor_t hello = { "\x85" "hello", 6 }, two = { "\x02", 1 };
+        yabe_cursor_t array = { "\xD6\x01\x02\x03\x04\x05\x06", 7 }, bye = { "\x83" "bye", 4 };
+        patchOk = patchOk && yabe_rope_init( &rope, &cDoc ) &&
+            yabe_rope_patch( &rope, &qB, &hello ) == 6 && rope.count == 2 &&
+            yabe_rope_patch( &rope, &qFirst, &two ) == 1 && rope.count == 2 &&
+            yabe_rope_patch( &rope, &qB, &bye ) == 4 && rope.count == 2 &&
+            yabe_rope_patch( &rope, &qArray, &array ) == 7 && rope.count == 4 &&
+            !yabe_rope_patch( &rope, &qFirst, &two ) && rope.len == cDoc.len + 6;
+        const char expected[] = "\xDA\x81" "a\xD6\x01\x02\x03\x04\x05\x06\x81" "b\xCC\xCC\x83" "bye";
+        patchOk = patchOk && yabe_rope_write( &rope, &wCur ) == sizeof(expected) - 1 &&
+            !memcmp( wCurInit.ptr, expected, sizeof(expected) - 1 );
+
+        int fds[2];
+        char out[32];
+        patchOk = patchOk && !pipe( fds ) && yabe_rope_writev( &rope, fds[1] ) &&
+            read( fds[0], out, sizeof(out) ) == sizeof(expected) - 1 &&
+            !memcmp( out, expected, sizeof(expected) - 1 );
+        close( fds[0] );
+        close( fds[1] );
+        yabe_rope_free( &rope );
+        if( !patchOk )
+        {
+            printf( "Failed patching values\n" );
+            exit(1);
+        }
+    }
+    rCur = rCurInit; wCur = wCurInit;
+
+    // Test the merge patches
+    {
+        // { "a" : 1, "b" : [ 1, 2 ], "c" : { "d" : "x", "e" : true } } and
+        // { "g" : 5, "c" : { "d" : "y" }, "a" : 1, "b" : [ 1, 2, 3 ] }
+        char a[] = "\xDB\x81" "a\x01\x81" "b\xD2\x01\x02\x81" "c\xDA\x81" "d\x81" "x\x81" "e\xC9";
+        char b[] = "\xDC\x81" "g\x05\x81" "c\xD9\x81" "d\x81" "y\x81" "a\x01\x81" "b\xD3\x01\x02\x03";
+        char r[] = "\xDB\x81" "c\xDA\x81" "e\xC9\x81" "d\x81" "x\x81" "a\x01\x81" "b\xD2\x01\x02";
+        const char patch[] = "\xDB\x81" "b\xD3\x01\x02\x03\x81" "c\xDA\x81" "d\x81" "y\x81" "e\xC0\x81" "g\x05";
+        const yabe_cursor_t ca = { a, sizeof(a) - 1 }, cb = { b, sizeof(b) - 1 }, cr = { r, sizeof(r) - 1 };
+        yabe_cursor_t cp = { wCurInit.ptr, 0 };
+        bool mergeOk = (cp.len = yabe_merge_diff( &ca, &cb, &wCur )) == sizeof(patch) - 1 &&
+            !memcmp( cp.ptr, patch, cp.len );
+        yabe_cursor_t merged = { wCur.ptr, 0 };
+        mergeOk = mergeOk && (merged.len = yabe_merge_apply( &ca, &cp, &wCur )) &&
+            yabe_equal_values( &merged, &cb );
+
+        // equal objects differ by an empty patch, null members can't be set
+        char* const empty = wCur.ptr;
+        char n[] = "\xD9\x81" "a\xC0";
+        const yabe_cursor_t cn = { n, sizeof(n) - 1 };
+        mergeOk = mergeOk && yabe_merge_diff( &ca, &cr, &wCur ) == 1 && *empty == (char)0xD8 &&
+            !yabe_merge_diff( &ca, &cn, &wCur ) && wCur.ptr == empty + 1;
+        if( !mergeOk )
+        {
+            printf( "Failed diffing and merging values\n" );
+            exit(1);
+        }
+    }
+    rCur = rCurInit; wCur = wCurInit;
+
+    // Test the lazy access to values
+    {
+        // { "a" : 0, "b" : 1, ... "g" : 6, "h" : [ "x", 2.5, 7, ... ] }
+        char doc[] = "\xDF\x81" "a\x00\x81" "b\x01\x81" "c\x02\x81" "d\x03\x81" "e\x04\x81"
+                     "f\x05\x81" "g\x06\x81" "h\xD7\x81" "x\xC5\x00\x41\x07\xCC\x08\xCB\xCB";
+        const yabe_cursor_t cDoc = { doc, sizeof(doc) - 1 };
+        yabe_lazy_slot_t slots[64];
+        yabe_lazy_cache_t cache;
+        yabe_lazy_cache_init( &cache, slots, 64 );
+        yabe_lazy_t root, v, h;
+        int64_t code = 0;
+        double flt = 0;
+        yabe_string_view_t view = { NULL, 0 };
+        bool lazyOk = yabe_lazy_init( &root, &cDoc );
+        for( int pass = 0; pass < 2 && lazyOk; ++pass )
+        {
+            // the second pass finds the values in the cache
+            yabe_lazy_cache_t* c = &cache;
+            lazyOk = yabe_lazy_get( &root, c, "f", 1, &v ) && yabe_lazy_as_int( &v, &code ) &&
+                code == 5 && yabe_lazy_get( &root, c, "b", 1, &v ) &&
+                yabe_lazy_as_double( &v, &flt ) && flt == 1.0 &&
+                !yabe_lazy_get( &root, c, "z", 1, &v ) && !yabe_lazy_get( &root, c, "aa", 2, &v ) &&
+                yabe_lazy_get( &root, c, "h", 1, &h ) && !yabe_lazy_get( &h, c, "a", 1, &v ) &&
+                yabe_lazy_at( &h, c, 3, &v ) && yabe_lazy_as_int( &v, &code ) && code == 8 &&
+                yabe_lazy_at( &h, c, 0, &v ) && yabe_lazy_as_string_view( &v, &view ) &&
+                view.len == 1 && view.ptr[0] == 'x' && !yabe_lazy_as_int( &v, &code ) &&
+                yabe_lazy_at( &h, c, 1, &v ) && yabe_lazy_as_double( &v, &flt ) && flt == 2.5 &&
+                !yabe_lazy_at( &h, c, 4, &v ) && !yabe_lazy_at( &root, c, 0, &v ) &&
+                yabe_lazy_at( &h, NULL, 2, &v ) && yabe_lazy_as_int( &v, &code ) && code == 7;
+        }
+        yabe_lazy_cache_reset( &cache );
+        lazyOk = lazyOk && cache.evictions == 0 && !slots[0].container &&
+            yabe_lazy_get( &root, NULL, "a", 1, &v ) && yabe_lazy_as_int( &v, &code ) && code == 0;
+        if( !lazyOk )
+        {
+            printf( "Failed accessing values lazily\n" );
+            exit(1);
+        }
+    }
+    rCur = rCurInit; wCur = wCurInit;
+
+    // Test streaming blobs through file descriptors
+    {
+        const char* srcPath = "yabe_test.src";
+        const char* blobPath = "yabe_test.blob";
+        const char* outPath = "yabe_test.out";
+        static char data[200000], check[200000];
+        for( size_t i = 0; i < sizeof(data); ++i )
+            data[i] = (char)(i * 131 + (i >> 9));
+        int src = open( srcPath, O_RDWR | O_CREAT | O_TRUNC, 0644 );
+        int fd = open( blobPath, O_RDWR | O_CREAT | O_TRUNC, 0644 );
+        int out = open( outPath, O_RDWR | O_CREAT | O_TRUNC, 0644 );
+        int fds[2];
+        bool blobOk = src >= 0 && fd >= 0 && out >= 0 && pipe( fds ) == 0 &&
+            write( src, data + 1000, sizeof(data) - 1000 ) == (ssize_t)(sizeof(data) - 1000) &&
+            lseek( src, 0, SEEK_SET ) == 0 && write( fd, "\xC0", 1 ) == 1;
+
+        // unknown size set at the end, known size checked
+        yabe_blob_writer_t writer;
+        blobOk = blobOk && yabe_blob_writer_begin( &writer, fd, "video/mp4", 9, YABE_BLOB_UNKNOWN_SIZE ) &&
+            yabe_blob_write( &writer, data, 1000 ) == 1000 &&
+            yabe_blob_write_fd( &writer, src, YABE_BLOB_UNKNOWN_SIZE ) == sizeof(data) - 1000 &&
+            yabe_blob_writer_end( &writer ) && writer.size == sizeof(data);
+        blobOk = blobOk && yabe_blob_writer_begin( &writer, fd, "text/plain", 10, 5 ) &&
+            yabe_blob_write( &writer, "hello!", 6 ) == 0 && !yabe_blob_writer_end( &writer ) &&
+            yabe_blob_write( &writer, "hello", 5 ) == 5 && yabe_blob_writer_end( &writer ) &&
+            write( fd, "\x07", 1 ) == 1;
+
+        // the file holds standard values
+        yabe_cursor_t c;
+        yabe_string_view_t mime, bytes;
+        static char file[sizeof(data) + 64];
+        c.ptr = file;
+        blobOk = blobOk && lseek( fd, 0, SEEK_SET ) == 0 &&
+            (c.len = (size_t)read( fd, file, sizeof(file) )) == 1 + 1 + 1 + 9 + 9 + sizeof(data) + 1 + 1 + 10 + 1 + 5 + 1 &&
+            yabe_read_null( &c ) && yabe_read_blob( &c ) && yabe_read_string_view( &c, &mime ) &&
+            mime.len == 9 && !memcmp( mime.ptr, "video/mp4", 9 ) && yabe_read_string_view( &c, &bytes ) &&
+            bytes.len == sizeof(data) && !memcmp( bytes.ptr, data, sizeof(data) ) &&
+            yabe_skip_value( &c ) && yabe_peek_tag( &c ) == 7;
+
+        // chunks, then a transfer to a file and to a pipe
+        yabe_blob_reader_t reader;
+        size_t n = 0;
+        blobOk = blobOk && lseek( fd, 1, SEEK_SET ) == 1 && yabe_blob_reader_begin( &reader, fd ) &&
+            reader.mimeLen == 9 && !memcmp( reader.mime, "video/mp4", 9 ) && reader.size == sizeof(data);
+        while( blobOk && n < 3000 )
+            n += yabe_blob_read( &reader, check + n, 700 );
+        blobOk = blobOk && n == 3500 && !memcmp( check, data, n ) &&
+            yabe_blob_read_fd( &reader, out, YABE_BLOB_UNKNOWN_SIZE ) == sizeof(data) - n && reader.left == 0 &&
+            yabe_blob_read( &reader, check, 1 ) == 0 && lseek( out, 0, SEEK_SET ) == 0 &&
+            read( out, check, sizeof(data) ) == (ssize_t)(sizeof(data) - n) &&
+            !memcmp( check, data + n, sizeof(data) - n );
+        blobOk = blobOk && yabe_blob_reader_begin( &reader, fd ) && reader.size == 5 &&
+            yabe_blob_read_fd( &reader, fds[1], 100 ) == 5 && read( fds[0], check, 100 ) == 5 &&
+            !memcmp( check, "hello", 5 ) && read( fd, check, 2 ) == 1 && check[0] == 7 &&
+            !yabe_blob_reader_begin( &reader, fd );
+        if( src >= 0 )
+            close( src );
+        if( fd >= 0 )
+            close( fd );
+        if( out >= 0 )
+            close( out );
+        if( blobOk )
+        {
+            close( fds[0] );
+            close( fds[1] );
+        }
+        remove( srcPath );
+        remove( blobPath );
+        remove( outPath );
+        if( !blobOk )
+        {
+            printf( "Failed streaming blobs\n" );
+            exit(1);
+        }
+    }
+    rCur = rCurInit; wCur = wCurInit;
+
+    // Test batches of messages
+    {
+        // messages written with the put functions, copied, and rolled back
+        yabe_batch_writer_t batch;
+        bool batchOk = yabe_batch_begin( &batch, &wCur );
+        for( int64_t i = 0; batchOk && i < 100; ++i )
+        {
+            batchOk = yabe_batch_reserve( &batch, 32 );
+            yabe_put_small_object( &batch.cursor, 1 );
+            yabe_put_string( &batch.cursor, 2 );
+            yabe_put_data( &batch.cursor, "id", 2 );
+            yabe_put_integer( &batch.cursor, i * 1000 );
+            batchOk = batchOk && yabe_batch_commit( &batch );
+        }
+        batchOk = batchOk && !yabe_batch_commit( &batch ) && yabe_write_integer( &batch.cursor, 5 ) &&
+            yabe_batch_add( &batch, "\xC0", 1 ) && !yabe_batch_add( &batch, "", 0 ) &&
+            yabe_write_string( &batch.cursor, 3 ) && batch.count == 101;
+        yabe_batch_rollback( &batch );
+        batchOk = batchOk && yabe_write_integer( &batch.cursor, 7 ) && yabe_batch_commit( &batch ) &&
+            yabe_write_null( &batch.cursor );
+        const size_t size = yabe_batch_end( &batch, &wCur );
+        batchOk = batchOk && size && wCur.ptr == buffer + size && wCur.len == bufLen - size &&
+            !memcmp( buffer + size - 4, "YBAT", 4 ) && yabe_load_le32( buffer + size - 8 ) == 102;
+
+        // any message is read in constant time
+        yabe_batch_reader_t reader;
+        yabe_cursor_t msg;
+        int64_t value;
+        yabe_string_view_t key;
+        int8_t nbr;
+        batchOk = batchOk && yabe_batch_open( &reader, buffer, size, false ) &&
+            yabe_batch_open( &reader, buffer, size, true ) && reader.count == 102;
+        for( size_t i = 0; batchOk && i < 100; i += 33 )
+        {
+            yabe_batch_message( &reader, i, &msg );
+            batchOk = yabe_read_small_object( &msg, &nbr ) && nbr == 1 &&
+                yabe_read_string_view( &msg, &key ) && key.len == 2 && !memcmp( key.ptr, "id", 2 ) &&
+                yabe_read_integer( &msg, &value ) && value == (int64_t)i * 1000 && msg.len == 0;
+        }
+        if( batchOk )
+        {
+            yabe_batch_message( &reader, 100, &msg );
+            batchOk = yabe_read_null( &msg ) && msg.len == 0;
+            yabe_batch_message( &reader, 101, &msg );
+            batchOk = batchOk && yabe_read_integer( &msg, &value ) && value == 7 && msg.len == 0;
+        }
+
+        // an empty batch, then invalid ones
+        static char empty[32];
+        yabe_cursor_t c = { empty, sizeof(empty) };
+        batchOk = batchOk && yabe_batch_begin( &batch, &c ) && yabe_batch_end( &batch, &c ) == 13 &&
+            yabe_batch_open( &reader, empty, 13, true ) && reader.count == 0 &&
+            (c.ptr = empty, c.len = 16, !yabe_batch_begin( &batch, &c ));
+        batchOk = batchOk && !yabe_batch_open( &reader, buffer, size - 1, false ) &&
+            !yabe_batch_open( &reader, buffer + 1, size - 1, false );
+        yabe_store_le32( buffer + size - 8, 101 );
+        batchOk = batchOk && !yabe_batch_open( &reader, buffer, size, false );
+        yabe_store_le32( buffer + size - 8, 102 );
+        char* table = buffer + size - 8 - 102 * 4;
+        const uint32_t end = yabe_load_le32( table + 50 * 4 );
+        yabe_store_le32( table + 50 * 4, yabe_load_le32( table + 49 * 4 ) );
+        batchOk = batchOk && !yabe_batch_open( &reader, buffer, size, false );
+        yabe_store_le32( table + 50 * 4, end );
+        buffer[5] = (char)0xC3;
+        batchOk = batchOk && yabe_batch_open( &reader, buffer, size, false ) &&
+            !yabe_batch_open( &reader, buffer, size, true );
+        if( !batchOk )
+        {
+            printf( "Failed batching messages\n" );
+            exit(1);
+        }
+    }
+    rCur = rCurInit; wCur = wCurInit;
+
+    // Test the ring buffer of messages
+    {
+        // slots reserved until the ring is full and committed out of order
+        yabe_ring_t ring, other;
+        yabe_ring_slot_t slots[4], slot;
+        int64_t value;
+        bool ringOk = yabe_ring_create( &ring, 3, 40, false ) && ring.mask == 3 && ring.slotSize == 64;
+        for( int i = 0; ringOk && i < 4; ++i )
+            ringOk = yabe_ring_reserve( &ring, &slots[i] ) && slots[i].cursor.len == 48 &&
+                (i == 2 || yabe_write_integer( &slots[i].cursor, 1000 + i ));
+        ringOk = ringOk && !yabe_ring_reserve( &ring, &slot ) && !yabe_ring_peek( &ring, &slot );
+        if( ringOk )
+        {
+            yabe_ring_commit( &ring, &slots[1] );
+            yabe_ring_commit( &ring, &slots[2] );
+            ringOk = !yabe_ring_peek( &ring, &slot );
+            yabe_ring_commit( &ring, &slots[0] );
+            yabe_ring_commit( &ring, &slots[3] );
+        }
+
+        // messages read in order through another mapping, the empty one skipped
+        ringOk = ringOk && yabe_ring_attach( &other, dup( ring.fd ) ) && other.map != ring.map;
+        for( int i = 0; ringOk && i < 4; i += 1 + (i == 1) )
+        {
+            ringOk = yabe_ring_peek( &other, &slot ) && yabe_read_integer( &slot.cursor, &value ) &&
+                value == 1000 + i && slot.cursor.len == 0;
+            yabe_ring_release( &other, &slot );
+            ringOk = ringOk && (i != 0 || (yabe_ring_reserve( &ring, &slots[0] ) &&
+                                            yabe_write_integer( &slots[0].cursor, 1000 ) &&
+                                            !yabe_ring_reserve( &ring, &slot )));
+        }
+        ringOk = ringOk && !yabe_ring_peek( &ring, &slot );
+        if( ringOk )
+        {
+            yabe_ring_commit( &ring, &slots[0] );
+            ringOk = yabe_ring_peek( &ring, &slot ) && slot.cursor.len == 3 && slot.pos == 4 &&
+                yabe_read_integer( &slot.cursor, &value ) && value == 1000;
+            yabe_ring_release( &ring, &slot );
+
+            // a slot whose length exceeds the slot is skipped
+            const uint32_t badLen = 49;
+            ringOk = ringOk && yabe_ring_reserve( &ring, &slots[1] ) && yabe_write_integer( &slots[1].cursor, 1001 ) &&
+                yabe_ring_reserve( &ring, &slots[2] ) && yabe_write_integer( &slots[2].cursor, 1002 );
+            yabe_ring_commit( &ring, &slots[1] );
+            yabe_ring_commit( &ring, &slots[2] );
+            memcpy( slots[1].data - YABE_RING_SLOT_HEADER + 8, &badLen, sizeof(badLen) );
+            ringOk = ringOk && yabe_ring_peek( &other, &slot ) && slot.pos == 6 &&
+                yabe_read_integer( &slot.cursor, &value ) && value == 1002;
+            yabe_ring_release( &other, &slot );
+            ringOk = ringOk && !yabe_ring_peek( &ring, &slot );
+            yabe_ring_close( &other );
+        }
+        yabe_ring_close( &ring );
+
+        // producer processes writing concurrently, each in order
+        enum { producers = 3, messages = 5000 };
+        int next[producers] = { 0 };
+        ringOk = ringOk && yabe_ring_create( &ring, 16, 32, true );
+        for( int p = 0; ringOk && p < producers; ++p )
+        {
+            const pid_t pid = fork();
+            if( pid == 0 )
+            {
+                bool childOk = yabe_ring_attach( &other, dup( ring.fd ) );
+                for( int i = 0; childOk && i < messages; ++i )
+                {
+                    while( !yabe_ring_reserve( &other, &slot ) )
+                        ;
+                    childOk = yabe_write_small_array( &slot.cursor, 2 ) && yabe_write_integer( &slot.cursor, p ) &&
+                        yabe_write_integer( &slot.cursor, i );
+                    yabe_ring_commit( &other, &slot );
+                }
+                _exit( childOk ? 0 : 1 );
+            }
+            ringOk = pid > 0;
+        }
+        int8_t nbr;
+        int64_t p;
+        for( int n = 0; ringOk && n < producers * messages; ++n )
+        {
+            while( !yabe_ring_peek( &ring, &slot ) )
+                ;
+            ringOk = yabe_read_small_array( &slot.cursor, &nbr ) && nbr == 2 && yabe_read_integer( &slot.cursor, &p ) &&
+                p >= 0 && p < producers && yabe_read_integer( &slot.cursor, &value ) && value == next[p]++;
+            yabe_ring_release( &ring, &slot );
+        }
+        for( int status; wait( &status ) > 0; )
+            ringOk = ringOk && WIFEXITED( status ) && WEXITSTATUS( status ) == 0;
+        yabe_ring_close( &ring );
+        if( !ringOk )
+        {
+            printf( "Failed passing messages through a ring\n" );
+            exit(1);
+        }
+    }
+    rCur = rCurInit; wCur = wCurInit;
+
+    // Test the archives of named documents
+    {
+        const char* archivePath = "yabe_test.yarc";
+        char name[32], doc[64];
+        yabe_archive_writer_t writer;
+        bool archiveOk = yabe_archive_writer_open( &writer, archivePath );
+        for( int i = 0; archiveOk && i < 1000; ++i )
+        {
+            yabe_cursor_t c = { doc, sizeof(doc) };
+            const int nameLen = sprintf( name, "doc%d.yabe", i );
+            archiveOk = yabe_write_small_array( &c, 2 ) && yabe_write_integer( &c, i * 7 ) &&
+                yabe_write_string( &c, (size_t)nameLen ) && yabe_write_data( &c, name, nameLen ) &&
+                yabe_archive_add( &writer, name, nameLen, doc, c.ptr - doc );
+        }
+        archiveOk = archiveOk && yabe_archive_add( &writer, "", 0, "\x07", 1 ) &&
+            yabe_archive_writer_close( &writer );
+
+        // documents found by name, aligned, and the file is a YABE stream
+        yabe_archive_reader_t reader;
+        yabe_cursor_t c, found;
+        yabe_string_view_t view;
+        int8_t nbr;
+        int64_t value;
+        archiveOk = archiveOk && yabe_archive_reader_open( &reader, archivePath ) && reader.count == 1001;
+        for( int i = 0; archiveOk && i < 1000; i += 37 )
+        {
+            const int nameLen = sprintf( name, "doc%d.yabe", i );
+            archiveOk = yabe_archive_find( &reader, name, nameLen, &c ) &&
+                (c.ptr - reader.data) % YABE_ARCHIVE_ALIGN == 0 && yabe_read_small_array( &c, &nbr ) &&
+                yabe_read_integer( &c, &value ) && value == i * 7 && yabe_read_string_view( &c, &view ) &&
+                view.len == (size_t)nameLen && !memcmp( view.ptr, name, nameLen ) && c.len == 0;
+        }
+        archiveOk = archiveOk && !yabe_archive_find( &reader, "doc1000.yabe", 12, &c ) &&
+            !yabe_archive_find( &reader, "doc1.yab", 8, &c ) && yabe_archive_find( &reader, "", 0, &c ) &&
+            c.len == 1 && *c.ptr == 7;
+        size_t values = 0, n = 0;
+        for( size_t i = 0; archiveOk && i < reader.count; ++i )
+        {
+            yabe_archive_entry( &reader, i, &view, &c );
+            n += yabe_archive_find( &reader, view.ptr, view.len, &found ) && found.ptr == c.ptr;
+        }
+        c.ptr = reader.data;
+        c.len = reader.size;
+        archiveOk = archiveOk && n == 1001 && yabe_read_signature( &c ) == 5;
+        while( archiveOk && !yabe_end_of_buffer( &c ) && yabe_skip_value( &c ) )
+            ++values;
+        archiveOk = archiveOk && values == 1001 + 3 && yabe_end_of_buffer( &c );
+
+        // invalid archives
+        static char copy[1 << 17];
+        const size_t size = reader.size;
+        archiveOk = archiveOk && size <= sizeof(copy);
+        if( archiveOk )
+        {
+            memcpy( copy, reader.data, size );
+            yabe_archive_reader_close( &reader );
+            yabe_archive_reader_t other;
+            archiveOk = yabe_archive_reader_init( &other, copy, size ) && !other.mapped &&
+                !yabe_archive_reader_init( &other, copy, size - 1 );
+            copy[size - 10]++;
+            archiveOk = archiveOk && !yabe_archive_reader_init( &other, copy, size );
+            copy[size - 10]--;
+            const size_t names = (size_t)(other.names - copy);
+            copy[names]++;
+            archiveOk = archiveOk && !yabe_archive_reader_init( &other, copy, size );
+        }
+        archiveOk = archiveOk && yabe_archive_writer_open( &writer, archivePath ) &&
+            yabe_archive_add( &writer, "a", 1, "\x01", 1 ) && yabe_archive_add( &writer, "a", 1, "\x02", 1 ) &&
+            !yabe_archive_writer_close( &writer );
+        remove( archivePath );
+        if( !archiveOk )
+        {
+            printf( "Failed archiving named documents\n" );
+            exit(1);
+        }
+    }
+    rCur = rCurInit; wCur = wCurInit;
+
     /* All other functions and encoding should work as expected */
 
     printf("Done!\n");
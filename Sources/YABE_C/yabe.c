@@ -1,73 +1,97 @@
 #include "yabe.h"
+#include "yabe_endian.h"
+
+#ifdef YABE_STATS
+__thread yabe_stats_t yabe_thread_stats;
+
+/* Return the counters of the calling thread */
+yabe_stats_t* yabe_stats( void ) { return &yabe_thread_stats; }
+#endif
 
 
 /* Low level buffer writing operation. Note : cursor->len left unchanged */
-inline void yabe_poke_int8( yabe_cursor_t* cursor, int8_t val )
-    {  *((int8_t*)cursor->ptr) = val; cursor->ptr += sizeof(int8_t); }
+static inline void yabe_poke_int8( yabe_cursor_t* cursor, int8_t val )
+    { *cursor->ptr = (char)val; cursor->ptr += sizeof(int8_t); }
 
-inline void yabe_poke_int16( yabe_cursor_t* cursor, int16_t val )
-    { *((int16_t*)cursor->ptr) = val; cursor->ptr += sizeof(int16_t); }
+static inline void yabe_poke_int16( yabe_cursor_t* cursor, int16_t val )
+    { yabe_store_le16( cursor->ptr, (uint16_t)val ); cursor->ptr += sizeof(int16_t); }
 
-inline void yabe_poke_int32( yabe_cursor_t* cursor, int32_t val )
-    { *((int32_t*)cursor->ptr) = val; cursor->ptr += sizeof(int32_t); }
+static inline void yabe_poke_int32( yabe_cursor_t* cursor, int32_t val )
+    { yabe_store_le32( cursor->ptr, (uint32_t)val ); cursor->ptr += sizeof(int32_t); }
 
-inline void yabe_poke_int64( yabe_cursor_t* cursor, int64_t val )
-    { *((int64_t*)cursor->ptr) = val; cursor->ptr += sizeof(int64_t); }
+static inline void yabe_poke_int64( yabe_cursor_t* cursor, int64_t val )
+    { yabe_store_le64( cursor->ptr, (uint64_t)val ); cursor->ptr += sizeof(int64_t); }
 
-inline void yabe_poke_uint16( yabe_cursor_t* cursor, uint16_t val )
-    { *((uint16_t*)cursor->ptr) = val; cursor->ptr += sizeof(int16_t); }
+static inline void yabe_poke_uint16( yabe_cursor_t* cursor, uint16_t val )
+    { yabe_store_le16( cursor->ptr, val ); cursor->ptr += sizeof(uint16_t); }
 
-inline void yabe_poke_uint32( yabe_cursor_t* cursor, uint32_t val )
-    { *((uint32_t*)cursor->ptr) = val; cursor->ptr += sizeof(uint32_t); }
+static inline void yabe_poke_uint32( yabe_cursor_t* cursor, uint32_t val )
+    { yabe_store_le32( cursor->ptr, val ); cursor->ptr += sizeof(uint32_t); }
 
-inline void yabe_poke_uint64( yabe_cursor_t* cursor, uint64_t val )
-    { *((uint64_t*)cursor->ptr) = val;  cursor->ptr += sizeof(uint64_t); }
+static inline void yabe_poke_uint64( yabe_cursor_t* cursor, uint64_t val )
+    { yabe_store_le64( cursor->ptr, val ); cursor->ptr += sizeof(uint64_t); }
 
 
-/* Return true if could write integer into buffer,
-   otherwise return the number bytes written */
-size_t yabe_write_integer( yabe_cursor_t* cursor, int64_t val )
+/* Return the number of bytes of the integer value encoding */
+size_t yabe_sizeof_integer( int64_t val )
 {
     if( val >= -32 && val <= 127 )
-    {
-        if( cursor->len == 0 )
-            return 0;
-        yabe_poke_int8( cursor, (int8_t)val);
-        cursor->len -= sizeof(int8_t);
         return sizeof(int8_t);
-    }
     if( val >= -32768 && val <= 32767 )
+        return sizeof(int8_t) + sizeof(int16_t);
+    if( val >= -2147483648LL && val <= 2147483647LL )
+        return sizeof(int8_t) + sizeof(int32_t);
+    return sizeof(int8_t) + sizeof(int64_t);
+}
+
+
+/* Write the integer value in its len bytes encoding */
+static inline size_t yabe_put_integer_len( yabe_cursor_t* cursor, int64_t val, size_t len )
+{
+    switch( len )
     {
-        const size_t len = sizeof(int8_t) + sizeof(int16_t);
-        if( cursor->len < len )
-            return 0;
+    case sizeof(int8_t):
+        yabe_poke_int8( cursor, (int8_t)val);
+        break;
+    case sizeof(int8_t) + sizeof(int16_t):
         yabe_poke_int8( cursor, yabe_int16_tag);
         yabe_poke_int16( cursor, (int16_t)val);
-        cursor->len -= len;
-        return len;
-    }
-    if( val >= -2147483648LL && val <= 2147483647LL )
-    {
-        const size_t len = sizeof(int8_t) + sizeof(int32_t);
-        if( cursor->len < len )
-            return 0;
+        break;
+    case sizeof(int8_t) + sizeof(int32_t):
         yabe_poke_int8( cursor, yabe_int32_tag);
         yabe_poke_int32( cursor, (int32_t)val);
-        cursor->len -= len;
-        return len;
+        break;
+    default:
+        yabe_poke_int8( cursor, yabe_int64_tag);
+        yabe_poke_int64( cursor, val);
     }
-    const size_t len = sizeof(int8_t) + sizeof(int64_t);
-    if( cursor->len < len )
-        return 0;
-    yabe_poke_int8( cursor, yabe_int64_tag);
-    yabe_poke_int64( cursor, val);
     cursor->len -= len;
+    YABE_STATS_ADD( writeInteger[YABE_STATS_WIDTH( len )], 1 );
     return len;
 }
 
-/* Return 0 if could write a floating point value at cursor position,
+
+/* Write the integer value without checking the buffer space */
+size_t yabe_put_integer( yabe_cursor_t* cursor, int64_t val )
+{
+    return yabe_put_integer_len( cursor, val, yabe_sizeof_integer( val ) );
+}
+
+
+/* Return 0 if could not write integer into buffer,
    otherwise return the number bytes written */
-size_t yabe_write_float( yabe_cursor_t* cursor, double val )
+size_t yabe_write_integer( yabe_cursor_t* cursor, int64_t val )
+{
+    const size_t len = yabe_sizeof_integer( val );
+    if( cursor->len < len )
+        return 0;
+    return yabe_put_integer_len( cursor, val, len );
+}
+
+
+/* Return the tag of the smallest encoding of the floating point value and
+   set bits to the value bits in this encoding */
+static int8_t yabe_float_encoding( double val, uint64_t* bits )
 {
     // 16bit float e=5bits m=10bits e=(-14..15)+15
     // 32bit float e=8bits m=23bits e=(-126..127)+127
@@ -77,19 +101,11 @@ size_t yabe_write_float( yabe_cursor_t* cursor, double val )
     const int64_t EXPONENT_BITS = 0x7FFULL<<52;
 
     // get float value as int64 value
-    double* vPtr = &val;
-    int64_t dr = *((int64_t*)vPtr);
+    int64_t dr = (int64_t)yabe_double_bits( val );
 
     // if value is 0., write flt0 tag
     if( (dr & 0x7FFFFFFFFFFFFFFFULL) == 0 )
-    {
-        const size_t len = sizeof(int8_t);
-        if( cursor->len < len )
-            return 0;
-        yabe_poke_int8( cursor, yabe_flt0_tag);
-        cursor->len -= len;
-        return len;
-    }
+        return yabe_flt0_tag;
 
     // get exponent bits from int64 value and clear sign bit
     int64_t de = dr & EXPONENT_BITS;
@@ -97,23 +113,14 @@ size_t yabe_write_float( yabe_cursor_t* cursor, double val )
     // if value is infinity or NaN (exponent has all bit set), write as flt16
     if( de == EXPONENT_BITS )
     {
-        const size_t len = sizeof(int8_t) + sizeof(int16_t);
-        if( cursor->len < len )
-            return 0;
-
         // if mantissa is not 0, write NaN, else write signed infinity
-        uint16_t hr;
         if( dr & 0xFFFFFFFFFFFFFLL )
-            hr = 0x7D00; // normalized NaN
+            *bits = 0x7D00; // normalized NaN
         else if( dr < 0 )
-            hr = 0xFC00; // - infinity
+            *bits = 0xFC00; // - infinity
         else
-            hr = 0x7C00; // + infinity
-
-        yabe_poke_int8( cursor, yabe_flt16_tag);
-        yabe_poke_uint16( cursor, hr );
-        cursor->len -= len;
-        return len;
+            *bits = 0x7C00; // + infinity
+        return yabe_flt16_tag;
     }
 
     // Get exponent value
@@ -122,10 +129,6 @@ size_t yabe_write_float( yabe_cursor_t* cursor, double val )
     // if value fits in flt16, write it as flt16
     if( he >= -14 && he <= 15 && (dr & 0x3FFFFFFFFFFLL) == 0 )
     {
-        const size_t len = sizeof(int8_t) + sizeof(int16_t);
-        if( cursor->len < len )
-            return 0;
-
         // initialize output value v with exponent bits
         uint16_t hr = (uint16_t)(he + 15) << 10;
 
@@ -135,21 +138,13 @@ size_t yabe_write_float( yabe_cursor_t* cursor, double val )
 
         // set mantissa bits
         hr |= ((uint16_t)(dr>>(52-10)))&0x3FF;
-
-        // write 16bit float value
-        yabe_poke_int8( cursor, yabe_flt16_tag);
-        yabe_poke_uint16( cursor, hr );
-        cursor->len -= len;
-        return len;
+        *bits = hr;
+        return yabe_flt16_tag;
     }
 
     // if value fit in flt32, write it as flt32
     if( he >=-126 && he <= 127 && (dr & 0x1FFFFFFFLL) == 0 )
     {
-        const size_t len = sizeof(int8_t) + sizeof(int32_t);
-        if( cursor->len < len )
-            return 0;
-
         // initialize output value v with exponent bits
         uint32_t fr = (uint32_t)(he + 127) << 23;
 
@@ -159,71 +154,125 @@ size_t yabe_write_float( yabe_cursor_t* cursor, double val )
 
         // set mantissa bits
         fr |= ((uint32_t)(dr>>29))&0x7FFFFF;
+        *bits = fr;
+        return yabe_flt32_tag;
+    }
 
-        // write 32bit float value
-        yabe_poke_int8( cursor, yabe_flt32_tag);
-        yabe_poke_uint32( cursor, fr );
-        cursor->len -= len;
-        return len;
+    *bits = (uint64_t)dr;
+    return yabe_flt64_tag;
+}
+
+
+/* Return the number of bytes of an encoding given its float tag */
+static size_t yabe_float_tag_size( int8_t tag )
+{
+    switch( tag )
+    {
+    case yabe_flt0_tag:  return sizeof(int8_t);
+    case yabe_flt16_tag: return sizeof(int8_t) + sizeof(int16_t);
+    case yabe_flt32_tag: return sizeof(int8_t) + sizeof(int32_t);
+    default:             return sizeof(int8_t) + sizeof(int64_t);
     }
+}
 
-    const size_t len = sizeof(int8_t) + sizeof(int64_t);
-    if( cursor->len < len )
-        return 0;
 
-    // write 64bit float value
-    yabe_poke_int8( cursor, yabe_flt64_tag);
-    yabe_poke_int64( cursor, dr );
+/* Return the number of bytes of the floating point value encoding */
+size_t yabe_sizeof_float( double val )
+{
+    uint64_t bits;
+    return yabe_float_tag_size( yabe_float_encoding( val, &bits ) );
+}
+
+
+/* Write the floating point value bits in the len bytes encoding of tag */
+static inline size_t yabe_put_float_bits( yabe_cursor_t* cursor, int8_t tag, uint64_t bits,
+                                          size_t len )
+{
+    yabe_poke_int8( cursor, tag );
+    if( tag == yabe_flt16_tag )
+        yabe_poke_uint16( cursor, (uint16_t)bits );
+    else if( tag == yabe_flt32_tag )
+        yabe_poke_uint32( cursor, (uint32_t)bits );
+    else if( tag == yabe_flt64_tag )
+        yabe_poke_uint64( cursor, bits );
     cursor->len -= len;
+    YABE_STATS_ADD( writeFloat[YABE_STATS_WIDTH( len )], 1 );
     return len;
 }
 
-/* Return 0 if could write the utf8 string size at cursor position,
-   otherwise return the number of missing bytes in buffer */
-size_t yabe_write_string( yabe_cursor_t* cursor, size_t strLen )
+
+/* Write the floating point value without checking the buffer space */
+size_t yabe_put_float( yabe_cursor_t* cursor, double val )
 {
-    if( strLen < 64 )
-    {
-        const size_t len = sizeof(int8_t);
-        if( cursor->len < len )
-            return 0;
-        yabe_poke_int8( cursor, yabe_str6_tag | (uint8_t)strLen );
-        cursor->len -= len;
-        return len;
-    }
+    uint64_t bits = 0;
+    const int8_t tag = yabe_float_encoding( val, &bits );
+    return yabe_put_float_bits( cursor, tag, bits, yabe_float_tag_size( tag ) );
+}
 
+
+/* Return 0 if could not write a floating point value at cursor position,
+   otherwise return the number bytes written */
+size_t yabe_write_float( yabe_cursor_t* cursor, double val )
+{
+    uint64_t bits = 0;
+    const int8_t tag = yabe_float_encoding( val, &bits );
+    const size_t len = yabe_float_tag_size( tag );
+    if( cursor->len < len )
+        return 0;
+    return yabe_put_float_bits( cursor, tag, bits, len );
+}
+
+
+/* Return the number of bytes of the string tag and size encoding */
+size_t yabe_sizeof_string( size_t strLen )
+{
+    if( strLen < 64 )
+        return sizeof(int8_t);
     if( strLen < 65536 )
-    {
-        const size_t len = sizeof(int8_t) + sizeof(int16_t);
-        if( cursor->len < len )
-            return 0;
-        yabe_poke_int8( cursor, yabe_str16_tag );
-        yabe_poke_uint16( cursor, (uint16_t)strLen );
-        cursor->len -= len;
-        return len;
-    }
+        return sizeof(int8_t) + sizeof(uint16_t);
+    if( (uint64_t)strLen < (0x1ULL<<32) )
+        return sizeof(int8_t) + sizeof(uint32_t);
+    return sizeof(int8_t) + sizeof(uint64_t);
+}
+
 
-    if( strLen < (0x1ULL<<32) )
+/* Write the string tag and size without checking the buffer space */
+size_t yabe_put_string( yabe_cursor_t* cursor, size_t strLen )
+{
+    const size_t len = yabe_sizeof_string( strLen );
+    switch( len )
     {
-        const size_t len = sizeof(int8_t) + sizeof(int32_t);
-        if( cursor->len < len )
-            return 0;
+    case sizeof(int8_t):
+        yabe_poke_int8( cursor, yabe_str6_tag | (uint8_t)strLen );
+        break;
+    case sizeof(int8_t) + sizeof(uint16_t):
         yabe_poke_int8( cursor, yabe_str16_tag );
+        yabe_poke_uint16( cursor, (uint16_t)strLen );
+        break;
+    case sizeof(int8_t) + sizeof(uint32_t):
+        yabe_poke_int8( cursor, yabe_str32_tag );
         yabe_poke_uint32( cursor, (uint32_t)strLen );
-        cursor->len -= len;
-        return len;
+        break;
+    default:
+        yabe_poke_int8( cursor, yabe_str64_tag );
+        yabe_poke_uint64( cursor, (uint64_t)strLen );
     }
-
-    const size_t len = sizeof(int8_t) + sizeof(int64_t);
-    if( cursor->len < len )
-        return 0;
-    yabe_poke_int8( cursor, yabe_str16_tag );
-    yabe_poke_uint64( cursor, (uint64_t)strLen );
     cursor->len -= len;
+    YABE_STATS_ADD( writeString[YABE_STATS_WIDTH( len )], 1 );
     return len;
 }
 
 
+/* Return 0 if could not write the utf8 string size at cursor position,
+   otherwise return the number of bytes written */
+size_t yabe_write_string( yabe_cursor_t* cursor, size_t strLen )
+{
+    if( cursor->len < yabe_sizeof_string( strLen ) )
+        return 0;
+    return yabe_put_string( cursor, strLen );
+}
+
+
 /* Try reading a value as an integer and return the number of byte read */
 size_t yabe_read_integer( yabe_cursor_t* cursor, int64_t* value )
 {
@@ -231,6 +280,7 @@ size_t yabe_read_integer( yabe_cursor_t* cursor, int64_t* value )
     if( tag >= -32 )
     {
         *value = tag;
+        YABE_STATS_ADD( readInteger[0], 1 );
         return yabe_skip_tag( cursor );
     }
     if( tag == yabe_int16_tag )
@@ -239,9 +289,10 @@ size_t yabe_read_integer( yabe_cursor_t* cursor, int64_t* value )
         if( cursor->len < len )
             return 0;
         cursor->ptr += sizeof(int8_t);
-        *value = *((int16_t*)cursor->ptr);
+        *value = (int16_t)yabe_load_le16( cursor->ptr );
         cursor->ptr += sizeof(int16_t);
         cursor->len -= len;
+        YABE_STATS_ADD( readInteger[YABE_STATS_WIDTH( len )], 1 );
         return len;
     }
     if( tag == yabe_int32_tag )
@@ -250,9 +301,10 @@ size_t yabe_read_integer( yabe_cursor_t* cursor, int64_t* value )
         if( cursor->len < len )
             return 0;
         cursor->ptr += sizeof(int8_t);
-        *value = *((int32_t*)cursor->ptr);
+        *value = (int32_t)yabe_load_le32( cursor->ptr );
         cursor->ptr += sizeof(int32_t);
         cursor->len -= len;
+        YABE_STATS_ADD( readInteger[YABE_STATS_WIDTH( len )], 1 );
         return len;
     }
     if( tag == yabe_int64_tag )
@@ -261,9 +313,10 @@ size_t yabe_read_integer( yabe_cursor_t* cursor, int64_t* value )
         if( cursor->len < len )
             return 0;
         cursor->ptr += sizeof(int8_t);
-        *value = *((int64_t*)cursor->ptr);
+        *value = (int64_t)yabe_load_le64( cursor->ptr );
         cursor->ptr += sizeof(int64_t);
         cursor->len -= len;
+        YABE_STATS_ADD( readInteger[YABE_STATS_WIDTH( len )], 1 );
         return len;
     }
     return 0;
@@ -282,6 +335,7 @@ size_t yabe_read_float( yabe_cursor_t* cursor, double* value )
         cursor->ptr += sizeof(int8_t);
         *value = 0.;
         cursor->len -= len;
+        YABE_STATS_ADD( readFloat[YABE_STATS_WIDTH( len )], 1 );
         return len;
     }
     if( tag == yabe_flt16_tag )
@@ -290,7 +344,7 @@ size_t yabe_read_float( yabe_cursor_t* cursor, double* value )
         if( cursor->len < len )
             return 0;
         cursor->ptr += sizeof(int8_t);
-        uint16_t hr = *((uint16_t*)cursor->ptr);
+        uint16_t hr = yabe_load_le16( cursor->ptr );
         cursor->ptr += sizeof(uint16_t);
         int16_t he = hr&0x7C00;             // get exponent bits of half float
         uint64_t dr;
@@ -307,13 +361,12 @@ size_t yabe_read_float( yabe_cursor_t* cursor, double* value )
         {
             dr = (he >> 10)-15+1023;          // set value exponent bits
             dr <<= 52;
-            if( hr & 0x8000 ) dr |= (1LL<<63); // set value sign bit
+            if( hr & 0x8000 ) dr |= (1ULL<<63); // set value sign bit
             dr |= ((uint64_t)(hr & 0x3FF)) << (52-10);     // set value mantissa
         }
-        // get float value as int64 value
-        uint64_t* rPtr = &dr;
-        *value = *((double*)(rPtr));              // assign value as double float
+        *value = yabe_double_from_bits( dr );     // assign value as double float
         cursor->len -= len;
+        YABE_STATS_ADD( readFloat[YABE_STATS_WIDTH( len )], 1 );
         return len;
     }
     if( tag == yabe_flt32_tag )
@@ -322,9 +375,10 @@ size_t yabe_read_float( yabe_cursor_t* cursor, double* value )
         if( cursor->len < len )
             return 0;
         cursor->ptr += sizeof(int8_t);
-        *value = *((float*)cursor->ptr);
+        *value = yabe_float_from_bits( yabe_load_le32( cursor->ptr ) );
         cursor->ptr += sizeof(uint32_t);
         cursor->len -= len;
+        YABE_STATS_ADD( readFloat[YABE_STATS_WIDTH( len )], 1 );
         return len;
     }
     if( tag == yabe_flt64_tag )
@@ -333,9 +387,10 @@ size_t yabe_read_float( yabe_cursor_t* cursor, double* value )
         if( cursor->len < len )
             return 0;
         cursor->ptr += sizeof(int8_t);
-        *value = *((double*)cursor->ptr);
+        *value = yabe_double_from_bits( yabe_load_le64( cursor->ptr ) );
         cursor->ptr += sizeof(uint64_t);
         cursor->len -= len;
+        YABE_STATS_ADD( readFloat[YABE_STATS_WIDTH( len )], 1 );
         return len;
     }
     return 0;
@@ -353,6 +408,7 @@ size_t yabe_read_string( yabe_cursor_t* cursor, size_t* length )
         cursor->ptr += sizeof(int8_t);
         *length = tag & (int8_t)0x3F;
         cursor->len -= len;
+        YABE_STATS_ADD( readString[YABE_STATS_WIDTH( len )], 1 );
         return len;
     }
     if( tag == yabe_str16_tag )
@@ -361,9 +417,10 @@ size_t yabe_read_string( yabe_cursor_t* cursor, size_t* length )
         if( cursor->len < len )
             return 0;
         cursor->ptr += sizeof(int8_t);
-        *length = *((uint16_t*)cursor->ptr);
+        *length = yabe_load_le16( cursor->ptr );
         cursor->ptr += sizeof(uint16_t);
         cursor->len -= len;
+        YABE_STATS_ADD( readString[YABE_STATS_WIDTH( len )], 1 );
         return len;
     }
     if( tag == yabe_str32_tag )
@@ -372,9 +429,10 @@ size_t yabe_read_string( yabe_cursor_t* cursor, size_t* length )
         if( cursor->len < len )
             return 0;
         cursor->ptr += sizeof(int8_t);
-        *length = *((uint32_t*)cursor->ptr);
+        *length = yabe_load_le32( cursor->ptr );
         cursor->ptr += sizeof(uint32_t);
         cursor->len -= len;
+        YABE_STATS_ADD( readString[YABE_STATS_WIDTH( len )], 1 );
         return len;
     }
     else if( tag == yabe_str64_tag )
@@ -383,11 +441,113 @@ size_t yabe_read_string( yabe_cursor_t* cursor, size_t* length )
         if( cursor->len < len )
             return 0;
         cursor->ptr += sizeof(int8_t);
-        *length = *((uint64_t*)cursor->ptr);
+        *length = yabe_load_le64( cursor->ptr );
         cursor->ptr += sizeof(uint64_t);
         cursor->len -= len;
+        YABE_STATS_ADD( readString[YABE_STATS_WIDTH( len )], 1 );
         return len;
     }
     return 0;
 }
 
+
+
+/* Return the pointer past the value starting at p, or NULL if the value
+   is truncated, invalid or nested too deep */
+static const char* yabe_skip( const char* p, const char* end, unsigned depth )
+{
+    if( depth > YABE_MAX_DEPTH )
+        return NULL;
+
+    // skip none values preceding the value
+    const char* const start = p;
+    while( p < end && *((int8_t*)p) == yabe_none_tag )
+        ++p;
+    YABE_STATS_ADD( noneSkipped, p - start );
+    if( p == end )
+        return NULL;
+
+    const uint8_t tag = (uint8_t)*p++;
+    uint64_t len = 0;
+    size_t nbr = 0;
+
+    if( tag < 0x80 || tag >= 0xE0 )
+        return p;
+    if( tag < 0xC0 )
+        len = tag & 0x3F;
+    else switch( tag )
+    {
+    case 0xC0: case 0xC4: case 0xC8: case 0xC9:
+        return p;
+    case 0xC1: case 0xC5:
+        return ( end - p < 2 ) ? NULL : p + 2;
+    case 0xC2: case 0xC6:
+        return ( end - p < 4 ) ? NULL : p + 4;
+    case 0xC3: case 0xC7:
+        return ( end - p < 8 ) ? NULL : p + 8;
+    case 0xCA:
+        // blob : mime type string followed by a data string
+        if( !(p = yabe_skip( p, end, depth + 1 )) )
+            return NULL;
+        return yabe_skip( p, end, depth + 1 );
+    case 0xCD: case 0xCE: case 0xCF:
+    {
+        const size_t lenSize = (size_t)1 << (tag - 0xCC);
+        if( (size_t)(end - p) < lenSize )
+            return NULL;
+        if( lenSize == 2 ) len = yabe_load_le16( p );
+        else if( lenSize == 4 ) len = yabe_load_le32( p );
+        else len = yabe_load_le64( p );
+        p += lenSize;
+        break;
+    }
+    case 0xD7: case 0xDF:
+        // array or object stream : values until the ends tag
+        YABE_STATS_ADD( containers, 1 );
+        YABE_STATS_ADD( containerDepth, depth );
+        for(;;)
+        {
+            while( p < end && *((int8_t*)p) == yabe_none_tag )
+            {
+                ++p;
+                YABE_STATS_ADD( noneSkipped, 1 );
+            }
+            if( p == end )
+                return NULL;
+            if( *((int8_t*)p) == yabe_ends_tag )
+                return p + 1;
+            if( !(p = yabe_skip( p, end, depth + 1 )) )
+                return NULL;
+        }
+    default:
+        if( tag >= 0xD0 )
+        {
+            // small array or object : number of items is in the tag
+            YABE_STATS_ADD( containers, 1 );
+            YABE_STATS_ADD( containerDepth, depth );
+            nbr = (tag & 7) << (tag >= 0xD8);
+            while( nbr-- )
+                if( !(p = yabe_skip( p, end, depth + 1 )) )
+                    return NULL;
+            return p;
+        }
+        return NULL; // ends tag where a value is expected
+    }
+    if( len > (uint64_t)(end - p) )
+        return NULL;
+    return p + len;
+}
+
+
+/* Skip the value at cursor position and return the number of bytes skipped */
+size_t yabe_skip_value( yabe_cursor_t* cursor )
+{
+    const char* end = cursor->ptr + cursor->len;
+    const char* p = yabe_skip( cursor->ptr, end, 0 );
+    if( !p )
+        return 0;
+    const size_t len = p - cursor->ptr;
+    cursor->ptr += len;
+    cursor->len -= len;
+    return len;
+}
@@ -1,9 +1,18 @@
+#ifndef YABE_H
+#define YABE_H
+
 #include <stdint.h>
 #include <ctype.h>
 #include <string.h>
 #include <assert.h>
 #include <stdbool.h>
 
+#include "yabe_stats.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /**
    \mainpage Low level C calls to write and read YABE encoded data
 
@@ -134,6 +143,13 @@
    the fifth byte is the version number of the encoding. This short
    specification describes the encoding version 0.
 
+   Version 1 adds the packed integer arrays of yabe_packed.h. They are encoded
+   as a blob tag followed by an integer extension code instead of a mime type
+   string, and a string holding the packed values. Data using them must start
+   with a version 1 signature written by yabe_write_signature_version(), the
+   readers get the version with yabe_read_signature_version() and reject
+   packed arrays in version 0 data.
+
    \remarks The size of a YABE encoded data block must be determined by the
             context.
 
@@ -329,8 +345,8 @@ typedef char yabe_tag_t;
 #define yabe_flt16_tag   ((int8_t)-59)
 #define yabe_flt32_tag   ((int8_t)-58)
 #define yabe_flt64_tag   ((int8_t)-57)
-#define yabe_true_tag    ((int8_t)-56)
-#define yabe_false_tag   ((int8_t)-55)
+#define yabe_false_tag   ((int8_t)-56)
+#define yabe_true_tag    ((int8_t)-55)
 #define yabe_blob_tag    ((int8_t)-54)
 #define yabe_ends_tag    ((int8_t)-53)
 #define yabe_none_tag    ((int8_t)-52)
@@ -342,6 +358,12 @@ typedef char yabe_tag_t;
 #define yabe_sobject_tag ((int8_t)-40)
 #define yabe_objects_tag ((int8_t)-33)
 
+/* Maximum nesting level of arrays and objects accepted when skipping values */
+#define YABE_MAX_DEPTH   64
+
+/* Highest encoding version accepted by yabe_read_signature() */
+#define YABE_VERSION     1
+
 // ----------------------------------------------------------------
 //
 //                YABE reading functions
@@ -564,6 +586,263 @@ static inline size_t yabe_write_signature( yabe_cursor_t* cursor )
     { return (cursor->len < 5) ? 0 : yabe_write_data( cursor, "YABE\0", 5 ); }
 
 
+/**
+ * \brief Tries writing the yabe signature ['Y','A','B','E', version] and
+ *  returns the number of bytes written
+ *
+ * \param[in,out] cursor Pointer on buffer info where to write value,
+ *                       update it if the value could be written
+ * \param version Encoding version, 1 if the data uses extensions
+ * \return the number of bytes written, \e fail : 0, \e success : 5
+ */
+static inline size_t yabe_write_signature_version( yabe_cursor_t* cursor, uint8_t version )
+{
+    if( cursor->len < 5 || version > YABE_VERSION )
+        return 0;
+    memcpy( cursor->ptr, "YABE", 4 );
+    cursor->ptr[4] = (char)version;
+    cursor->ptr += 5;
+    cursor->len -= 5;
+    return 5;
+}
+
+
+
+// ----------------------------------------------------------------
+//
+//           YABE size and unchecked writing functions
+//
+// ----------------------------------------------------------------
+
+/*
+ * The yabe_sizeof_*() functions return the exact number of bytes the
+ * corresponding yabe_write_*() function writes. Summing them gives the size
+ * of a whole document, which can then be encoded in a single buffer with
+ * the yabe_put_*() functions. These don't test the remaining buffer space
+ * and the caller must guarantee it. The cursor is updated as with
+ * yabe_write_*().
+ */
+
+
+/**
+ * \brief Return the number of bytes of the integer value encoding
+ *
+ * \param value 64bit integer value
+ * \return the number of bytes yabe_write_integer() writes : 1, 3, 5 or 9
+ */
+size_t yabe_sizeof_integer( int64_t value );
+
+
+/**
+ * \brief Return the number of bytes of the double float value encoding
+ *
+ * \param value 64bit floating point value
+ * \return the number of bytes yabe_write_float() writes : 1, 3, 5 or 9
+ */
+size_t yabe_sizeof_float( double value );
+
+
+/**
+ * \brief Return the number of bytes of the string tag and byte size encoding
+ *
+ * The string bytes are not included, a complete string value has
+ * yabe_sizeof_string( byteSize ) + byteSize bytes.
+ *
+ * \param byteSize byte length of the utf8 encoded string
+ * \return the number of bytes yabe_write_string() writes : 1, 3, 5 or 9
+ */
+size_t yabe_sizeof_string( size_t byteSize );
+
+
+/**
+ * \brief Return the number of bytes of a complete blob value
+ *
+ * \param mimeSize byte length of the mime type string
+ * \param dataSize byte length of the blob data
+ * \return the number of bytes of the blob tag and its two strings
+ */
+static inline size_t yabe_sizeof_blob( size_t mimeSize, size_t dataSize )
+    { return 1 + yabe_sizeof_string( mimeSize ) + mimeSize +
+                 yabe_sizeof_string( dataSize ) + dataSize; }
+
+
+/// @cond DEV
+/**
+ * \brief Writes a tag value without checking the buffer space
+ *
+ * \param[in,out] cursor Pointer on buffer info where to write value
+ * \param tag Tag value to write at cursor position
+ * \return the number of bytes written : 1
+ */
+static inline size_t yabe_put_tag( yabe_cursor_t* cursor, int8_t tag )
+{
+    assert( cursor->len != 0 );
+    *((int8_t*)cursor->ptr) = tag;
+    ++cursor->ptr;
+    --cursor->len;
+    return 1;
+}
+/// @endcond
+
+
+/**
+ * \brief Writes a \e none value without checking the buffer space
+ *
+ * \param[in,out] cursor Pointer on buffer info where to write value
+ * \return the number of bytes written : 1
+ */
+static inline size_t yabe_put_none( yabe_cursor_t* cursor )
+    { return yabe_put_tag( cursor, yabe_none_tag ); }
+
+
+/**
+ * \brief Writes a \e null value without checking the buffer space
+ *
+ * \param[in,out] cursor Pointer on buffer info where to write value
+ * \return the number of bytes written : 1
+ */
+static inline size_t yabe_put_null( yabe_cursor_t* cursor )
+    { return yabe_put_tag( cursor, yabe_null_tag ); }
+
+
+/**
+ * \brief Writes the boolean value without checking the buffer space
+ *
+ * \param[in,out] cursor Pointer on buffer info where to write value
+ * \param value Boolean value to write at cursor position
+ * \return the number of bytes written : 1
+ */
+static inline size_t yabe_put_bool( yabe_cursor_t* cursor, bool value )
+    { return yabe_put_tag( cursor, value?yabe_true_tag:yabe_false_tag ); }
+
+
+/**
+ * \brief Writes the integer value without checking the buffer space
+ *
+ * \param[in,out] cursor Pointer on buffer info where to write value, it
+ *                       must have at least yabe_sizeof_integer() bytes
+ * \param value 64bit integer value to write at cursor position
+ * \return the number of bytes written : 1, 3, 5 or 9
+ */
+size_t yabe_put_integer( yabe_cursor_t* cursor, int64_t value );
+
+
+/**
+ * \brief Writes the double float value without checking the buffer space
+ *
+ * \param[in,out] cursor Pointer on buffer info where to write value, it
+ *                       must have at least yabe_sizeof_float() bytes
+ * \param value 64bit floating point value to write at cursor position
+ * \return the number of bytes written : 1, 3, 5 or 9
+ */
+size_t yabe_put_float( yabe_cursor_t* cursor, double value );
+
+
+/**
+ * \brief Writes the string tag and its byte size without checking the
+ *  buffer space
+ *
+ * \param[in,out] cursor Pointer on buffer info where to write value, it
+ *                       must have at least yabe_sizeof_string() bytes
+ * \param byteSize byte length of the utf8 encoded string
+ * \return the number of bytes written : 1, 3, 5 or 9
+ */
+size_t yabe_put_string( yabe_cursor_t* cursor, size_t byteSize );
+
+
+/**
+ * \brief Writes all the bytes of the sequence without checking the buffer
+ *  space
+ *
+ * \param[in,out] cursor Pointer on buffer info where to write value, it
+ *                       must have at least \e size bytes
+ * \param data Pointer on the bytes to write at cursor position
+ * \param size Number of bytes to write at cursor position
+ * \return the number of bytes written : \e size
+ */
+static inline size_t yabe_put_data( yabe_cursor_t* cursor, const void* data, size_t size )
+{
+    assert( cursor->len >= size );
+    memcpy( cursor->ptr, data, size );
+    cursor->ptr += size;
+    cursor->len -= size;
+    return size;
+}
+
+
+/**
+ * \brief Writes a blob tag without checking the buffer space
+ *
+ * \param[in,out] cursor Pointer on buffer info where to write value
+ * \return the number of bytes written : 1
+ */
+static inline size_t yabe_put_blob( yabe_cursor_t* cursor )
+    { return yabe_put_tag( cursor, yabe_blob_tag ); }
+
+
+/**
+ * \brief Writes a small array tag without checking the buffer space
+ *
+ * \param[in,out] cursor Pointer on buffer info where to write value
+ * \param nbr Number of values in array : 0<= nbr <= 6
+ * \return the number of bytes written : 1
+ */
+static inline size_t yabe_put_small_array( yabe_cursor_t* cursor, size_t nbr )
+    { assert( nbr <= 6 ); return yabe_put_tag( cursor, yabe_sarray_tag|nbr ); }
+
+
+/**
+ * \brief Writes an array stream tag without checking the buffer space
+ *
+ * \param[in,out] cursor Pointer on buffer info where to write value
+ * \return the number of bytes written : 1
+ */
+static inline size_t yabe_put_array_stream( yabe_cursor_t* cursor )
+    { return yabe_put_tag( cursor, yabe_arrays_tag ); }
+
+
+/**
+ * \brief Writes a small object tag without checking the buffer space
+ *
+ * \param[in,out] cursor Pointer on buffer info where to write value
+ * \param nbr Number of identfier, values pairs in object : 0<= nbr <= 6
+ * \return the number of bytes written : 1
+ */
+static inline size_t yabe_put_small_object( yabe_cursor_t* cursor, size_t nbr )
+    { assert( nbr <= 6 ); return yabe_put_tag( cursor, yabe_sobject_tag|nbr ); }
+
+
+/**
+ * \brief Writes an object stream tag without checking the buffer space
+ *
+ * \param[in,out] cursor Pointer on buffer info where to write value
+ * \return the number of bytes written : 1
+ */
+static inline size_t yabe_put_object_stream( yabe_cursor_t* cursor )
+    { return yabe_put_tag( cursor, yabe_objects_tag ); }
+
+
+/**
+ * \brief Writes the end stream tag without checking the buffer space
+ *
+ * \param[in,out] cursor Pointer on buffer info where to write value
+ * \return the number of bytes written : 1
+ */
+static inline size_t yabe_put_end_stream( yabe_cursor_t* cursor )
+    { return yabe_put_tag( cursor, yabe_ends_tag ); }
+
+
+/**
+ * \brief Writes the yabe signature ['Y','A','B','E', 0] without checking the
+ *  buffer space
+ *
+ * \param[in,out] cursor Pointer on buffer info where to write value
+ * \return the number of bytes written : 5
+ */
+static inline size_t yabe_put_signature( yabe_cursor_t* cursor )
+    { return yabe_put_data( cursor, "YABE\0", 5 ); }
+
+
 
 // ----------------------------------------------------------------
 //
@@ -593,7 +872,7 @@ static inline bool yabe_end_of_buffer( const yabe_cursor_t* cursor )
  *                       is updated if the read operation succeeds
  * \return the tag value at the current cursor position
  */
-static inline uint8_t yabe_peek_tag( const yabe_cursor_t* cursor )
+static inline int8_t yabe_peek_tag( const yabe_cursor_t* cursor )
 {
     assert( cursor && cursor->ptr && cursor->len );
     return *((int8_t*)cursor->ptr);
@@ -650,6 +929,7 @@ static inline size_t yabe_read_none( yabe_cursor_t* cursor )
         cursor->len -= sizeof(int8_t);
         ++count;
     }
+    YABE_STATS_ADD( noneSkipped, count );
     return count;
 }
 
@@ -738,6 +1018,45 @@ size_t yabe_read_float( yabe_cursor_t* cursor, double* value );
 size_t yabe_read_string( yabe_cursor_t* cursor, size_t* length );
 
 
+/**
+ * \brief View on the bytes of a string stored in a YABE encoded buffer
+ */
+typedef struct yabe_string_view_t
+{
+    const char* ptr;  ///< Pointer on the first byte of the string
+    size_t len;       ///< Number of bytes of the string
+} yabe_string_view_t;
+
+
+/**
+ * \brief Try reading the value as a string without copying its bytes and
+ *  returns the number of byte read
+ *
+ * Requires the cursor is not at the end of buffer when the function is called.
+ *
+ * Unlike yabe_read_string(), the string bytes are read too. The view points
+ * into the buffer and is thus only valid as long as the buffer is.
+ *
+ * \param[in,out] cursor Pointer on buffer where to try reading, the cursor
+ *                       is updated if the read operation succeeds
+ * \param[out] view the string bytes if the value is a complete string,
+ *                  otherwise the view is left unchanged
+ * \return the number of bytes read, \e fail : 0
+ */
+static inline size_t yabe_read_string_view( yabe_cursor_t* cursor, yabe_string_view_t* view )
+{
+    yabe_cursor_t c = *cursor;
+    size_t len, res = yabe_read_string( &c, &len );
+    if( !res || len > c.len )
+        return 0;
+    view->ptr = c.ptr;
+    view->len = len;
+    cursor->ptr = c.ptr + len;
+    cursor->len = c.len - len;
+    return res + len;
+}
+
+
 /**
  * \brief Try reading the requested number of data bytes at the cursor position
  *  and returns the number of bytes effectively read
@@ -824,7 +1143,7 @@ static inline size_t yabe_read_small_array( yabe_cursor_t* cursor, int8_t *numbe
 static inline size_t yabe_read_small_object( yabe_cursor_t* cursor, int8_t *number )
 {
     int8_t tag = yabe_peek_tag( cursor );
-    if( (tag&(uint8_t)(-8)) != yabe_sobject_tag || tag == yabe_objects_tag )
+    if( (tag&~(uint8_t)7) != yabe_sobject_tag || tag == yabe_objects_tag )
         return 0;
     *number = tag & (uint8_t)7;
     return yabe_skip_tag( cursor );
@@ -882,20 +1201,40 @@ static inline size_t yabe_read_end_stream( yabe_cursor_t* cursor )
 
 
 /**
- * \brief Try reading the yabe signature ['Y','A','B','E', 0]
+ * \brief Skip the value at cursor position, including all the values it
+ *  contains, and returns the number of bytes skipped
+ *
+ * \e None values preceding the value are skipped too. Nothing is decoded, the
+ * tags and lengths are only used to locate the end of the value. This is the
+ * building block of the structural pass used to index large documents.
+ *
+ * \param[in,out] cursor Pointer on buffer where to skip a value, the cursor
+ *                       is updated only if the whole value could be skipped
+ * \return the number of bytes skipped, \e fail : 0 if the value is truncated,
+ *         invalid, or nested deeper than YABE_MAX_DEPTH
+ */
+size_t yabe_skip_value( yabe_cursor_t* cursor );
+
+
+/**
+ * \brief Try reading the yabe signature ['Y','A','B','E', version] and its
+ *  version
  *
  * It requires there are at least 5 bytes to read in the buffer.
- * Reads the first 4 bytes if they match, read also the version if it matches.
+ * Reads the first 4 bytes if they match, read also the version if it is not
+ * greater than YABE_VERSION.
  *
  * \param[in,out] cursor Pointer on buffer where to try reading, the cursor
  *                       is updated if the read operation succeeds
+ * \param[out] version Version of the encoding, set if the signature matches
  * \return the number of bytes read, \e fail : 0, \e bad version : 4, \e success : 5
  */
-static inline size_t yabe_read_signature( yabe_cursor_t* cursor )
+static inline size_t yabe_read_signature_version( yabe_cursor_t* cursor, uint8_t* version )
 {
     if( cursor->len < 5 || memcmp( cursor->ptr, "YABE", 4 ) )
         return 0;
-    if( cursor->ptr[4] != 0 )
+    *version = (uint8_t)cursor->ptr[4];
+    if( *version > YABE_VERSION )
     {
         cursor->ptr += 4;
         cursor->len -= 4;
@@ -907,5 +1246,23 @@ static inline size_t yabe_read_signature( yabe_cursor_t* cursor )
 }
 
 
+/**
+ * \brief Try reading the yabe signature ['Y','A','B','E', version]
+ *
+ * Same as yabe_read_signature_version() when the version doesn't matter.
+ *
+ * \param[in,out] cursor Pointer on buffer where to try reading, the cursor
+ *                       is updated if the read operation succeeds
+ * \return the number of bytes read, \e fail : 0, \e bad version : 4, \e success : 5
+ */
+static inline size_t yabe_read_signature( yabe_cursor_t* cursor )
+{
+    uint8_t version;
+    return yabe_read_signature_version( cursor, &version );
+}
 
+#ifdef __cplusplus
+}
+#endif
 
+#endif // YABE_H
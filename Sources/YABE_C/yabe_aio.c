@@ -0,0 +1,579 @@
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#if defined(__linux__) && defined(__NR_io_uring_setup) && !defined(YABE_AIO_NO_URING)
+#  include <linux/io_uring.h>
+#  define YABE_AIO_URING
+#endif
+
+#include "yabe_aio.h"
+
+
+/* Bytes that can be carried from the previous buffer without a copy into
+   the joined buffer */
+#define YABE_AIO_CARRY 4096
+
+/* States of the reader buffers */
+enum { yabe_aio_idle, yabe_aio_pending, yabe_aio_read_done, yabe_aio_used };
+
+
+/* Request processed by the helper thread */
+typedef struct yabe_aio_request_t
+{
+    bool write;
+    int fd;
+    char* data;
+    size_t len;
+    uint64_t offset;
+    ssize_t res;
+} yabe_aio_request_t;
+
+
+struct yabe_aio_t
+{
+    unsigned depth;
+    bool ring;                       // true if io_uring is used
+
+#ifdef YABE_AIO_URING
+    // io_uring submission and completion rings
+    int ringFd;
+    unsigned *sqTail, *sqMask, *sqArray;
+    unsigned *cqHead, *cqTail, *cqMask;
+    struct io_uring_sqe* sqes;
+    struct io_uring_cqe* cqes;
+    void* sqMap;
+    void* cqMap;
+    size_t sqMapSize, cqMapSize, sqesSize;
+    struct iovec* iovs;              // one per tag
+#endif
+
+    // helper thread and its request queues, indexed by tag
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    yabe_aio_request_t* requests;
+    unsigned* queue;                 // tags of the submitted requests
+    unsigned* done;                  // tags of the completed requests
+    unsigned queueHead, queueTail, doneHead, doneTail;
+    bool stop;
+};
+
+
+#ifdef YABE_AIO_URING
+/* Set up an io_uring with depth entries, return false if not available */
+static bool yabe_aio_ring_init( yabe_aio_t* aio )
+{
+    struct io_uring_params params;
+    memset( &params, 0, sizeof(params) );
+    aio->ringFd = (int)syscall( __NR_io_uring_setup, aio->depth, &params );
+    if( aio->ringFd < 0 )
+        return false;
+
+    aio->sqMapSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    aio->cqMapSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    aio->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    if( params.features & IORING_FEAT_SINGLE_MMAP )
+    {
+        if( aio->cqMapSize > aio->sqMapSize )
+            aio->sqMapSize = aio->cqMapSize;
+        aio->cqMapSize = 0;
+    }
+    aio->sqMap = mmap( NULL, aio->sqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED,
+                       aio->ringFd, IORING_OFF_SQ_RING );
+    aio->cqMap = aio->cqMapSize == 0 ? aio->sqMap :
+        mmap( NULL, aio->cqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED,
+              aio->ringFd, IORING_OFF_CQ_RING );
+    aio->sqes = mmap( NULL, aio->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED,
+                      aio->ringFd, IORING_OFF_SQES );
+    aio->iovs = calloc( aio->depth, sizeof(struct iovec) );
+    if( aio->sqMap == MAP_FAILED || aio->cqMap == MAP_FAILED ||
+        aio->sqes == MAP_FAILED || !aio->iovs )
+    {
+        if( aio->sqes != MAP_FAILED )
+            munmap( aio->sqes, aio->sqesSize );
+        if( aio->cqMapSize && aio->cqMap != MAP_FAILED )
+            munmap( aio->cqMap, aio->cqMapSize );
+        if( aio->sqMap != MAP_FAILED )
+            munmap( aio->sqMap, aio->sqMapSize );
+        free( aio->iovs );
+        close( aio->ringFd );
+        return false;
+    }
+
+    char* sq = aio->sqMap;
+    char* cq = aio->cqMap;
+    aio->sqTail = (unsigned*)(sq + params.sq_off.tail);
+    aio->sqMask = (unsigned*)(sq + params.sq_off.ring_mask);
+    aio->sqArray = (unsigned*)(sq + params.sq_off.array);
+    aio->cqHead = (unsigned*)(cq + params.cq_off.head);
+    aio->cqTail = (unsigned*)(cq + params.cq_off.tail);
+    aio->cqMask = (unsigned*)(cq + params.cq_off.ring_mask);
+    aio->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+    return true;
+}
+
+
+/* Submit a read or write to the io_uring */
+static bool yabe_aio_ring_submit( yabe_aio_t* aio, const yabe_aio_request_t* request,
+                                  unsigned tag )
+{
+    const unsigned tail = *aio->sqTail;
+    const unsigned index = tail & *aio->sqMask;
+    struct io_uring_sqe* sqe = &aio->sqes[index];
+    aio->iovs[tag].iov_base = request->data;
+    aio->iovs[tag].iov_len = request->len;
+    memset( sqe, 0, sizeof(*sqe) );
+    sqe->opcode = request->write ? IORING_OP_WRITEV : IORING_OP_READV;
+    sqe->fd = request->fd;
+    sqe->addr = (uintptr_t)&aio->iovs[tag];
+    sqe->len = 1;
+    sqe->off = request->offset;
+    sqe->user_data = tag;
+    aio->sqArray[index] = index;
+    __atomic_store_n( aio->sqTail, tail + 1, __ATOMIC_RELEASE );
+    while( syscall( __NR_io_uring_enter, aio->ringFd, 1, 0, 0, NULL, 0 ) < 0 )
+        if( errno != EINTR )
+            return false;
+    return true;
+}
+
+
+/* Wait for a completion of the io_uring */
+static bool yabe_aio_ring_wait( yabe_aio_t* aio, unsigned* tag, ssize_t* res )
+{
+    const unsigned head = *aio->cqHead;
+    while( head == __atomic_load_n( aio->cqTail, __ATOMIC_ACQUIRE ) )
+        if( syscall( __NR_io_uring_enter, aio->ringFd, 0, 1, IORING_ENTER_GETEVENTS,
+                     NULL, 0 ) < 0 && errno != EINTR )
+            return false;
+    const struct io_uring_cqe* cqe = &aio->cqes[head & *aio->cqMask];
+    *tag = (unsigned)cqe->user_data;
+    *res = cqe->res;
+    __atomic_store_n( aio->cqHead, head + 1, __ATOMIC_RELEASE );
+    return true;
+}
+
+
+/* Release the io_uring */
+static void yabe_aio_ring_free( yabe_aio_t* aio )
+{
+    munmap( aio->sqes, aio->sqesSize );
+    if( aio->cqMapSize )
+        munmap( aio->cqMap, aio->cqMapSize );
+    munmap( aio->sqMap, aio->sqMapSize );
+    free( aio->iovs );
+    close( aio->ringFd );
+}
+#endif
+
+
+/* Helper thread performing the submitted requests in order */
+static void* yabe_aio_thread( void* arg )
+{
+    yabe_aio_t* aio = arg;
+    pthread_mutex_lock( &aio->lock );
+    for(;;)
+    {
+        while( aio->queueHead == aio->queueTail && !aio->stop )
+            pthread_cond_wait( &aio->cond, &aio->lock );
+        if( aio->queueHead == aio->queueTail )
+            break;
+        const unsigned tag = aio->queue[aio->queueHead++ % aio->depth];
+        yabe_aio_request_t* request = &aio->requests[tag];
+        pthread_mutex_unlock( &aio->lock );
+
+        ssize_t res;
+        do
+            res = request->write ?
+                pwrite( request->fd, request->data, request->len, (off_t)request->offset ) :
+                pread( request->fd, request->data, request->len, (off_t)request->offset );
+        while( res < 0 && errno == EINTR );
+
+        pthread_mutex_lock( &aio->lock );
+        request->res = res < 0 ? -errno : res;
+        aio->done[aio->doneTail++ % aio->depth] = tag;
+        pthread_cond_broadcast( &aio->cond );
+    }
+    pthread_mutex_unlock( &aio->lock );
+    return NULL;
+}
+
+
+/* Create the I/O backend for depth requests in flight */
+static yabe_aio_t* yabe_aio_create( unsigned depth )
+{
+    yabe_aio_t* aio = calloc( 1, sizeof(yabe_aio_t) );
+    if( !aio )
+        return NULL;
+    aio->depth = depth;
+    aio->requests = calloc( depth, sizeof(yabe_aio_request_t) );
+    if( !aio->requests )
+    {
+        free( aio );
+        return NULL;
+    }
+#ifdef YABE_AIO_URING
+    if( (aio->ring = yabe_aio_ring_init( aio )) )
+        return aio;
+#endif
+    aio->queue = malloc( depth * sizeof(unsigned) );
+    aio->done = malloc( depth * sizeof(unsigned) );
+    if( !aio->queue || !aio->done || pthread_mutex_init( &aio->lock, NULL ) )
+    {
+        free( aio->queue ); free( aio->done ); free( aio->requests ); free( aio );
+        return NULL;
+    }
+    if( pthread_cond_init( &aio->cond, NULL ) )
+    {
+        pthread_mutex_destroy( &aio->lock );
+        free( aio->queue ); free( aio->done ); free( aio->requests ); free( aio );
+        return NULL;
+    }
+    if( pthread_create( &aio->thread, NULL, yabe_aio_thread, aio ) )
+    {
+        pthread_cond_destroy( &aio->cond );
+        pthread_mutex_destroy( &aio->lock );
+        free( aio->queue ); free( aio->done ); free( aio->requests ); free( aio );
+        return NULL;
+    }
+    return aio;
+}
+
+
+/* Submit a read or write identified by tag, at most depth may be in flight */
+static bool yabe_aio_submit( yabe_aio_t* aio, bool write, int fd, char* data,
+                             size_t len, uint64_t offset, unsigned tag )
+{
+    yabe_aio_request_t request = { write, fd, data, len, offset, 0 };
+#ifdef YABE_AIO_URING
+    if( aio->ring )
+        return yabe_aio_ring_submit( aio, &request, tag );
+#endif
+    pthread_mutex_lock( &aio->lock );
+    aio->requests[tag] = request;
+    aio->queue[aio->queueTail++ % aio->depth] = tag;
+    pthread_cond_broadcast( &aio->cond );
+    pthread_mutex_unlock( &aio->lock );
+    return true;
+}
+
+
+/* Wait for the completion of a request, return its tag and result */
+static bool yabe_aio_wait( yabe_aio_t* aio, unsigned* tag, ssize_t* res )
+{
+#ifdef YABE_AIO_URING
+    if( aio->ring )
+        return yabe_aio_ring_wait( aio, tag, res );
+#endif
+    pthread_mutex_lock( &aio->lock );
+    while( aio->doneHead == aio->doneTail )
+        pthread_cond_wait( &aio->cond, &aio->lock );
+    *tag = aio->done[aio->doneHead++ % aio->depth];
+    *res = aio->requests[*tag].res;
+    pthread_mutex_unlock( &aio->lock );
+    return true;
+}
+
+
+/* Release the I/O backend, no request may be in flight */
+static void yabe_aio_destroy( yabe_aio_t* aio )
+{
+    if( !aio )
+        return;
+#ifdef YABE_AIO_URING
+    if( aio->ring )
+    {
+        yabe_aio_ring_free( aio );
+        free( aio->requests );
+        free( aio );
+        return;
+    }
+#endif
+    pthread_mutex_lock( &aio->lock );
+    aio->stop = true;
+    pthread_cond_broadcast( &aio->cond );
+    pthread_mutex_unlock( &aio->lock );
+    pthread_join( aio->thread, NULL );
+    pthread_cond_destroy( &aio->cond );
+    pthread_mutex_destroy( &aio->lock );
+    free( aio->queue );
+    free( aio->done );
+    free( aio->requests );
+    free( aio );
+}
+
+
+/* Submit the read of the next part of the file into buffer i, if any */
+static bool yabe_aio_read_submit( yabe_aio_reader_t* reader, unsigned i )
+{
+    if( reader->offset >= reader->fileSize )
+    {
+        reader->states[i] = yabe_aio_idle;
+        return true;
+    }
+    size_t len = reader->bufferSize;
+    if( len > reader->fileSize - reader->offset )
+        len = reader->fileSize - reader->offset;
+    reader->lengths[i] = len;
+    reader->states[i] = yabe_aio_pending;
+    if( !yabe_aio_submit( reader->aio, false, reader->fd, reader->buffers[i] + YABE_AIO_CARRY,
+                          len, reader->offset, i ) )
+    {
+        reader->states[i] = yabe_aio_idle;
+        return false;
+    }
+    reader->offset += len;
+    return true;
+}
+
+
+/* Release the reader resources, the reads must have completed */
+static void yabe_aio_reader_free( yabe_aio_reader_t* reader )
+{
+    yabe_aio_destroy( reader->aio );
+    if( reader->buffers )
+        for( unsigned i = 0; i < reader->depth; ++i )
+            free( reader->buffers[i] );
+    free( reader->buffers );
+    free( reader->lengths );
+    free( reader->states );
+    free( reader->joined );
+    if( reader->fd >= 0 )
+        close( reader->fd );
+    memset( reader, 0, sizeof(*reader) );
+    reader->fd = -1;
+}
+
+
+/* Open a file for asynchronous reading and submit the first reads */
+bool yabe_aio_reader_open( yabe_aio_reader_t* reader, const char* path,
+                           size_t bufferSize, unsigned depth )
+{
+    memset( reader, 0, sizeof(*reader) );
+    reader->bufferSize = bufferSize ? bufferSize : YABE_AIO_BUFFER_SIZE;
+    reader->depth = depth < 2 ? (depth ? 2 : YABE_AIO_DEPTH) : depth;
+    reader->fd = open( path, O_RDONLY );
+    struct stat st;
+    if( reader->fd < 0 || fstat( reader->fd, &st ) )
+    {
+        yabe_aio_reader_free( reader );
+        return false;
+    }
+    reader->fileSize = (uint64_t)st.st_size;
+    reader->buffers = calloc( reader->depth, sizeof(char*) );
+    reader->lengths = calloc( reader->depth, sizeof(size_t) );
+    reader->states = calloc( reader->depth, sizeof(int) );
+    reader->aio = yabe_aio_create( reader->depth );
+    bool ok = reader->buffers && reader->lengths && reader->states && reader->aio;
+    for( unsigned i = 0; ok && i < reader->depth; ++i )
+        ok = (reader->buffers[i] = malloc( YABE_AIO_CARRY + reader->bufferSize )) != NULL;
+    for( unsigned i = 0; ok && i < reader->depth; ++i )
+        ok = yabe_aio_read_submit( reader, i );
+    if( !ok )
+    {
+        yabe_aio_reader_close( reader );
+        return false;
+    }
+    return true;
+}
+
+
+/* Wait for the next buffer of the file and returns its number of bytes */
+size_t yabe_aio_read( yabe_aio_reader_t* reader, yabe_cursor_t* cursor )
+{
+    const unsigned i = reader->next;
+    const unsigned prev = (i + reader->depth - 1) % reader->depth;
+    if( reader->error || reader->states[i] == yabe_aio_idle )
+        return 0;
+
+    // wait for the read of buffer i, completions may come in any order
+    while( reader->states[i] == yabe_aio_pending )
+    {
+        // tag is left unset when the wait itself fails
+        unsigned tag = UINT_MAX;
+        ssize_t res;
+        if( !yabe_aio_wait( reader->aio, &tag, &res ) || tag >= reader->depth ||
+            res != (ssize_t)reader->lengths[tag] )
+        {
+            if( tag < reader->depth )
+                reader->states[tag] = yabe_aio_idle;
+            reader->error = true;
+            return 0;
+        }
+        reader->states[tag] = yabe_aio_read_done;
+    }
+
+    // put the carried bytes just before the new bytes
+    const size_t len = reader->lengths[i];
+    const size_t carried = cursor->len;
+    char* data = reader->buffers[i] + YABE_AIO_CARRY;
+    if( carried <= YABE_AIO_CARRY )
+    {
+        if( carried )
+            memcpy( data - carried, cursor->ptr, carried );
+        cursor->ptr = data - carried;
+    }
+    else
+    {
+        const bool inJoined = cursor->ptr >= reader->joined &&
+                              cursor->ptr < reader->joined + reader->joinedSize;
+        if( inJoined )
+            memmove( reader->joined, cursor->ptr, carried );
+        if( carried + len > reader->joinedSize )
+        {
+            char* joined = realloc( reader->joined, carried + len );
+            if( !joined )
+            {
+                reader->error = true;
+                return 0;
+            }
+            reader->joined = joined;
+            reader->joinedSize = carried + len;
+        }
+        if( !inJoined )
+            memcpy( reader->joined, cursor->ptr, carried );
+        memcpy( reader->joined + carried, data, len );
+        cursor->ptr = reader->joined;
+    }
+    cursor->len = carried + len;
+
+    // the previous buffer is no longer referenced, reuse it for a new read
+    if( reader->states[prev] == yabe_aio_used && !yabe_aio_read_submit( reader, prev ) )
+        reader->error = true;
+    reader->states[i] = yabe_aio_used;
+    reader->next = (i + 1) % reader->depth;
+    return len;
+}
+
+
+/* Wait for the pending reads and release the reader resources */
+void yabe_aio_reader_close( yabe_aio_reader_t* reader )
+{
+    if( reader->aio && reader->states )
+        for( unsigned i = 0; i < reader->depth; ++i )
+            while( reader->states[i] == yabe_aio_pending )
+            {
+                unsigned tag;
+                ssize_t res;
+                if( !yabe_aio_wait( reader->aio, &tag, &res ) )
+                    break;
+                if( tag < reader->depth )
+                    reader->states[tag] = yabe_aio_read_done;
+            }
+    yabe_aio_reader_free( reader );
+}
+
+
+/* Wait for one write to complete */
+static bool yabe_aio_write_wait( yabe_aio_writer_t* writer )
+{
+    unsigned tag;
+    ssize_t res;
+    if( !yabe_aio_wait( writer->aio, &tag, &res ) || tag >= writer->depth )
+    {
+        // the backend is unusable, give up on the writes in flight
+        writer->inFlight = 0;
+        writer->error = true;
+        return false;
+    }
+    if( res != (ssize_t)writer->lengths[tag] )
+        writer->error = true;
+    writer->lengths[tag] = 0;
+    --writer->inFlight;
+    return !writer->error;
+}
+
+
+/* Release the writer resources, the writes must have completed */
+static void yabe_aio_writer_free( yabe_aio_writer_t* writer )
+{
+    yabe_aio_destroy( writer->aio );
+    if( writer->buffers )
+        for( unsigned i = 0; i < writer->depth; ++i )
+            free( writer->buffers[i] );
+    free( writer->buffers );
+    free( writer->lengths );
+    memset( writer, 0, sizeof(*writer) );
+    writer->fd = -1;
+}
+
+
+/* Create a file for asynchronous writing */
+bool yabe_aio_writer_open( yabe_aio_writer_t* writer, const char* path,
+                           size_t bufferSize, unsigned depth, yabe_cursor_t* cursor )
+{
+    memset( writer, 0, sizeof(*writer) );
+    writer->bufferSize = bufferSize ? bufferSize : YABE_AIO_BUFFER_SIZE;
+    writer->depth = depth < 2 ? (depth ? 2 : YABE_AIO_DEPTH) : depth;
+    writer->fd = open( path, O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+    writer->buffers = calloc( writer->depth, sizeof(char*) );
+    writer->lengths = calloc( writer->depth, sizeof(size_t) );
+    writer->aio = yabe_aio_create( writer->depth );
+    bool ok = writer->fd >= 0 && writer->buffers && writer->lengths && writer->aio;
+    for( unsigned i = 0; ok && i < writer->depth; ++i )
+        ok = (writer->buffers[i] = malloc( writer->bufferSize )) != NULL;
+    if( !ok )
+    {
+        if( writer->fd >= 0 )
+            close( writer->fd );
+        yabe_aio_writer_free( writer );
+        return false;
+    }
+    cursor->ptr = writer->buffers[0];
+    cursor->len = writer->bufferSize;
+    return true;
+}
+
+
+/* Submit the bytes written in the current buffer and reset the cursor */
+bool yabe_aio_write_flush( yabe_aio_writer_t* writer, yabe_cursor_t* cursor )
+{
+    const unsigned i = writer->next;
+    const size_t len = cursor->ptr - writer->buffers[i];
+    if( writer->error )
+        return false;
+    if( len == 0 )
+        return true;
+
+    writer->lengths[i] = len;
+    if( !yabe_aio_submit( writer->aio, true, writer->fd, writer->buffers[i], len,
+                          writer->offset, i ) )
+    {
+        writer->lengths[i] = 0;
+        writer->error = true;
+        return false;
+    }
+    writer->offset += len;
+    ++writer->inFlight;
+    writer->next = (i + 1) % writer->depth;
+
+    // wait until the next buffer is free
+    while( writer->lengths[writer->next] )
+        if( !yabe_aio_write_wait( writer ) )
+            return false;
+    cursor->ptr = writer->buffers[writer->next];
+    cursor->len = writer->bufferSize;
+    return true;
+}
+
+
+/* Submit the last bytes, wait for all writes and close the file */
+bool yabe_aio_writer_close( yabe_aio_writer_t* writer, yabe_cursor_t* cursor )
+{
+    yabe_aio_write_flush( writer, cursor );
+    while( writer->inFlight )
+        yabe_aio_write_wait( writer );
+    bool ok = !writer->error;
+    ok = !close( writer->fd ) && ok;
+    yabe_aio_writer_free( writer );
+    return ok;
+}
@@ -0,0 +1,182 @@
+#ifndef YABE_AIO_H
+#define YABE_AIO_H
+
+#include "yabe.h"
+
+/**
+   \page aio_page Asynchronous file reading and writing
+
+   Reading a file into a buffer and decoding it afterward leaves the
+   processor idle during the read and the disk idle during the decoding. The
+   asynchronous reader and writer keep several buffers in flight so that the
+   decoding or encoding of one buffer overlaps the reading or writing of the
+   next ones.
+
+   The reads and writes are submitted through io_uring when the kernel
+   provides it, otherwise a helper thread performs them with pread() and
+   pwrite(). Defining YABE_AIO_NO_URING when compiling yabe_aio.c always
+   selects the helper thread.
+
+   The reader hands out the file content buffer by buffer in order. Since a
+   value may span two buffers, the cursor given to yabe_aio_read() holds the
+   bytes left undecoded in the previous buffer and it is updated to cover
+   these bytes followed by the content of the next buffer.
+
+   \code
+    yabe_aio_reader_t reader;
+    yabe_cursor_t rCur = { NULL, 0 };
+    if( !yabe_aio_reader_open( &reader, path, 0, 0 ) ) { ... }
+    while( yabe_aio_read( &reader, &rCur ) )
+    {
+        yabe_cursor_t value = rCur;
+        while( yabe_skip_value( &value ) )
+        {
+            ... decode the value at rCur ...
+            rCur = value;
+        }
+    }
+    yabe_aio_reader_close( &reader );
+   \endcode
+
+   The writer gives a writing cursor on a free buffer. When a writing
+   function fails because the buffer is full, yabe_aio_write_flush()
+   submits the filled bytes and resets the cursor on the next free buffer.
+
+   \code
+    yabe_aio_writer_t writer;
+    yabe_cursor_t wCur;
+    if( !yabe_aio_writer_open( &writer, path, 0, 0, &wCur ) ) { ... }
+    while( ... )
+        if( !yabe_write_integer( &wCur, value ) )
+        {
+            if( !yabe_aio_write_flush( &writer, &wCur ) ) { ... }
+            yabe_write_integer( &wCur, value );
+        }
+    yabe_aio_writer_close( &writer, &wCur );
+   \endcode
+*/
+
+/// Default number of bytes per buffer
+#define YABE_AIO_BUFFER_SIZE (256*1024)
+
+/// Default number of buffers in flight
+#define YABE_AIO_DEPTH 4
+
+/// @cond DEV
+/* I/O backend, io_uring or helper thread */
+typedef struct yabe_aio_t yabe_aio_t;
+/// @endcond
+
+/**
+ * \brief File opened for asynchronous reading
+ */
+typedef struct yabe_aio_reader_t
+{
+    yabe_aio_t* aio;      ///< I/O backend
+    int fd;               ///< File descriptor of the file
+    uint64_t fileSize;    ///< Number of bytes of the file
+    uint64_t offset;      ///< Offset of the next read to submit
+    size_t bufferSize;    ///< Number of bytes per buffer
+    unsigned depth;       ///< Number of buffers
+    unsigned next;        ///< Index of the next buffer to hand out
+    char** buffers;       ///< Buffers with room for carried bytes before them
+    size_t* lengths;      ///< Number of bytes requested or read in each buffer
+    int* states;          ///< State of each buffer : idle, pending, read or used
+    char* joined;         ///< Buffer holding carried bytes too big for the room
+    size_t joinedSize;    ///< Number of allocated bytes for joined
+    bool error;           ///< Set if a read failed
+} yabe_aio_reader_t;
+
+
+/**
+ * \brief File opened for asynchronous writing
+ */
+typedef struct yabe_aio_writer_t
+{
+    yabe_aio_t* aio;      ///< I/O backend
+    int fd;               ///< File descriptor of the file
+    uint64_t offset;      ///< Offset of the next write to submit
+    size_t bufferSize;    ///< Number of bytes per buffer
+    unsigned depth;       ///< Number of buffers
+    unsigned next;        ///< Index of the buffer being filled
+    unsigned inFlight;    ///< Number of buffers being written
+    char** buffers;       ///< Buffers
+    size_t* lengths;      ///< Number of bytes being written, 0 if free
+    bool error;           ///< Set if a write failed
+} yabe_aio_writer_t;
+
+
+/**
+ * \brief Open a file for asynchronous reading and submit the first reads
+ *
+ * \param[out] reader Reader to initialize
+ * \param path Path of the file
+ * \param bufferSize Number of bytes per buffer, 0 selects YABE_AIO_BUFFER_SIZE
+ * \param depth Number of buffers, at least 2, 0 selects YABE_AIO_DEPTH
+ * \return true if the file could be opened, false otherwise
+ */
+bool yabe_aio_reader_open( yabe_aio_reader_t* reader, const char* path,
+                           size_t bufferSize, unsigned depth );
+
+
+/**
+ * \brief Wait for the next buffer of the file and returns its number of bytes
+ *
+ * On entry the cursor holds the bytes left undecoded in the previous buffer,
+ * or is empty. On return it covers these bytes followed by the content of
+ * the next buffer. The buffer of the previous call is then reused for a new
+ * read.
+ *
+ * \param[in,out] reader Reader opened by yabe_aio_reader_open()
+ * \param[in,out] cursor Reading cursor on the undecoded bytes
+ * \return the number of new bytes, \e fail : 0 at the end of file or on
+ *         error, in which case reader->error is set
+ */
+size_t yabe_aio_read( yabe_aio_reader_t* reader, yabe_cursor_t* cursor );
+
+
+/**
+ * \brief Wait for the pending reads and release the reader resources
+ *
+ * \param[in,out] reader Reader opened by yabe_aio_reader_open()
+ */
+void yabe_aio_reader_close( yabe_aio_reader_t* reader );
+
+
+/**
+ * \brief Create a file for asynchronous writing
+ *
+ * \param[out] writer Writer to initialize
+ * \param path Path of the file to create or truncate
+ * \param bufferSize Number of bytes per buffer, 0 selects YABE_AIO_BUFFER_SIZE
+ * \param depth Number of buffers, at least 2, 0 selects YABE_AIO_DEPTH
+ * \param[out] cursor Writing cursor on the first buffer
+ * \return true if the file could be created, false otherwise
+ */
+bool yabe_aio_writer_open( yabe_aio_writer_t* writer, const char* path,
+                           size_t bufferSize, unsigned depth, yabe_cursor_t* cursor );
+
+
+/**
+ * \brief Submit the bytes written in the current buffer and reset the cursor
+ *  on the next free buffer
+ *
+ * Waits for a write to complete if all buffers are in flight.
+ *
+ * \param[in,out] writer Writer opened by yabe_aio_writer_open()
+ * \param[in,out] cursor Writing cursor returned by the previous call
+ * \return true if the bytes could be submitted, false on write error
+ */
+bool yabe_aio_write_flush( yabe_aio_writer_t* writer, yabe_cursor_t* cursor );
+
+
+/**
+ * \brief Submit the last bytes, wait for all writes and close the file
+ *
+ * \param[in,out] writer Writer opened by yabe_aio_writer_open()
+ * \param[in,out] cursor Writing cursor returned by the previous call
+ * \return true if all bytes were written, false otherwise
+ */
+bool yabe_aio_writer_close( yabe_aio_writer_t* writer, yabe_cursor_t* cursor );
+
+#endif // YABE_AIO_H
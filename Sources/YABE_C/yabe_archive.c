@@ -0,0 +1,346 @@
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#include "yabe_archive.h"
+#include "yabe_endian.h"
+
+
+/* Mime type of the directory blob */
+static const char yabe_archive_mime[] = "application/x-yabe-archive";
+
+/* Number of bytes of a directory entry */
+#define YABE_ARCHIVE_ENTRY 32
+
+/* Number of bytes of the trailer : the directory offset as an int64 and the
+   magic string */
+#define YABE_ARCHIVE_TRAILER 14
+
+/* Magic string ending an archive */
+static const char yabe_archive_magic[5] = { (char)0x84, 'Y', 'A', 'R', 'C' };
+
+
+/* 64 bit FNV-1a hash of a document name */
+static uint64_t yabe_archive_hash( const char* name, size_t len )
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for( size_t i = 0; i < len; ++i )
+        h = (h ^ (uint8_t)name[i]) * 0x100000001b3ULL;
+    return h;
+}
+
+
+/* Write the bytes followed by pad none values to fd at its current offset */
+static bool yabe_archive_write( int fd, const void* data, size_t size, size_t pad )
+{
+    char nones[YABE_ARCHIVE_ALIGN];
+    memset( nones, yabe_none_tag, pad );
+    struct iovec iov[2] = { { (void*)data, size }, { (void*)nones, pad } };
+    int n = 2, i = 0;
+    while( i < n )
+    {
+        ssize_t res = writev( fd, iov + i, n - i );
+        if( res < 0 && errno == EINTR )
+            continue;
+        if( res <= 0 )
+            return false;
+        for( ; i < n && (size_t)res >= iov[i].iov_len; ++i )
+            res -= iov[i].iov_len;
+        if( i < n )
+        {
+            iov[i].iov_base = (char*)iov[i].iov_base + res;
+            iov[i].iov_len -= res;
+        }
+    }
+    return true;
+}
+
+
+/* Number of none bytes moving offset to the next document boundary */
+static inline size_t yabe_archive_pad( uint64_t offset )
+{
+    return (size_t)(-offset & (YABE_ARCHIVE_ALIGN - 1));
+}
+
+
+/* Create or truncate an archive file and write its signature */
+bool yabe_archive_writer_open( yabe_archive_writer_t* writer, const char* path )
+{
+    memset( writer, 0, sizeof(*writer) );
+    writer->fd = open( path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644 );
+    if( writer->fd < 0 )
+        return false;
+    char signature[5];
+    yabe_cursor_t c = { signature, sizeof(signature) };
+    yabe_write_signature_version( &c, YABE_VERSION );
+    if( !yabe_archive_write( writer->fd, signature, sizeof(signature),
+                             yabe_archive_pad( sizeof(signature) ) ) )
+    {
+        close( writer->fd );
+        writer->fd = -1;
+        return false;
+    }
+    writer->offset = YABE_ARCHIVE_ALIGN;
+    return true;
+}
+
+
+/* Append an encoded document to the archive */
+bool yabe_archive_add( yabe_archive_writer_t* writer, const char* name, size_t nameLen,
+                       const void* data, size_t size )
+{
+    if( writer->error || nameLen > UINT32_MAX - writer->namesLen )
+        return false;
+    if( writer->count == writer->capacity )
+    {
+        size_t capacity = writer->capacity ? 2 * writer->capacity : 256;
+        yabe_archive_entry_t* entries = realloc( writer->entries, capacity * sizeof(yabe_archive_entry_t) );
+        if( !entries )
+            return false;
+        writer->entries = entries;
+        writer->capacity = capacity;
+    }
+    if( nameLen > writer->namesCapacity - writer->namesLen )
+    {
+        size_t capacity = writer->namesCapacity ? 2 * writer->namesCapacity : 4096;
+        while( capacity - writer->namesLen < nameLen )
+            capacity *= 2;
+        char* names = realloc( writer->names, capacity );
+        if( !names )
+            return false;
+        writer->names = names;
+        writer->namesCapacity = capacity;
+    }
+
+    const size_t pad = yabe_archive_pad( size );
+    if( !yabe_archive_write( writer->fd, data, size, pad ) )
+    {
+        writer->error = true;
+        return false;
+    }
+    yabe_archive_entry_t* e = &writer->entries[writer->count++];
+    e->hash = yabe_archive_hash( name, nameLen );
+    e->offset = writer->offset;
+    e->size = size;
+    e->nameOffset = (uint32_t)writer->namesLen;
+    e->nameLen = (uint32_t)nameLen;
+    if( nameLen )
+        memcpy( writer->names + writer->namesLen, name, nameLen );
+    writer->namesLen += nameLen;
+    writer->offset += size + pad;
+    return true;
+}
+
+
+/* Compare the entries by hash, then by name */
+static int yabe_archive_compare( const yabe_archive_entry_t* a, const yabe_archive_entry_t* b,
+                                 const char* namesA, const char* namesB )
+{
+    if( a->hash != b->hash )
+        return a->hash < b->hash ? -1 : 1;
+    const size_t len = a->nameLen < b->nameLen ? a->nameLen : b->nameLen;
+    int res = memcmp( namesA + a->nameOffset, namesB + b->nameOffset, len );
+    return res ? res : (a->nameLen > b->nameLen) - (a->nameLen < b->nameLen);
+}
+
+
+/* Compare the entries for qsort_r(), names is the writer names */
+static int yabe_archive_sort( const void* a, const void* b, void* names )
+{
+    return yabe_archive_compare( a, b, names, names );
+}
+
+
+/* Write the directory, close the file and release the writer resources */
+bool yabe_archive_writer_close( yabe_archive_writer_t* writer )
+{
+    bool ok = !writer->error;
+    if( writer->count )
+        qsort_r( writer->entries, writer->count, sizeof(yabe_archive_entry_t), yabe_archive_sort,
+                 writer->names );
+    for( size_t i = 1; ok && i < writer->count; ++i )
+        ok = yabe_archive_sort( &writer->entries[i - 1], &writer->entries[i], writer->names ) != 0;
+
+    // the directory blob holds the entries, then the names in the same order
+    const size_t tableSize = 8 + writer->count * YABE_ARCHIVE_ENTRY + writer->namesLen;
+    const size_t headerSize = 1 + 1 + sizeof(yabe_archive_mime) - 1 + 9;
+    char* dir = ok ? malloc( headerSize + tableSize + YABE_ARCHIVE_TRAILER ) : NULL;
+    if( dir )
+    {
+        yabe_cursor_t c = { dir, headerSize + tableSize + YABE_ARCHIVE_TRAILER };
+        yabe_write_blob( &c );
+        yabe_write_string( &c, sizeof(yabe_archive_mime) - 1 );
+        yabe_write_data( &c, yabe_archive_mime, sizeof(yabe_archive_mime) - 1 );
+        yabe_write_string( &c, tableSize );
+        yabe_store_le64( c.ptr, writer->count );
+        char* p = c.ptr + 8;
+        char* names = p + writer->count * YABE_ARCHIVE_ENTRY;
+        uint32_t nameOffset = 0;
+        for( size_t i = 0; i < writer->count; ++i, p += YABE_ARCHIVE_ENTRY )
+        {
+            const yabe_archive_entry_t* e = &writer->entries[i];
+            yabe_store_le64( p, e->hash );
+            yabe_store_le64( p + 8, e->offset );
+            yabe_store_le64( p + 16, e->size );
+            yabe_store_le32( p + 24, nameOffset );
+            yabe_store_le32( p + 28, e->nameLen );
+            if( e->nameLen )
+                memcpy( names + nameOffset, writer->names + e->nameOffset, e->nameLen );
+            nameOffset += e->nameLen;
+        }
+        p = names + writer->namesLen;
+        *p = (char)yabe_int64_tag;
+        yabe_store_le64( p + 1, writer->offset );
+        memcpy( p + 9, yabe_archive_magic, sizeof(yabe_archive_magic) );
+        p += YABE_ARCHIVE_TRAILER;
+        ok = yabe_archive_write( writer->fd, dir, p - dir, 0 );
+        free( dir );
+    }
+    else
+        ok = false;
+
+    ok = !close( writer->fd ) && ok;
+    free( writer->entries );
+    free( writer->names );
+    memset( writer, 0, sizeof(*writer) );
+    writer->fd = -1;
+    return ok;
+}
+
+
+/* Map an archive file in memory and check its directory */
+bool yabe_archive_reader_open( yabe_archive_reader_t* reader, const char* path )
+{
+    int fd = open( path, O_RDONLY | O_CLOEXEC );
+    if( fd < 0 )
+        return false;
+    struct stat st;
+    void* map = MAP_FAILED;
+    if( !fstat( fd, &st ) && st.st_size > 0 && (uint64_t)st.st_size <= SIZE_MAX )
+        map = mmap( NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+    close( fd );
+    if( map == MAP_FAILED )
+        return false;
+    if( !yabe_archive_reader_init( reader, map, (size_t)st.st_size ) )
+    {
+        munmap( map, (size_t)st.st_size );
+        return false;
+    }
+    reader->mapped = true;
+    return true;
+}
+
+
+/* Check the directory of an archive in memory */
+bool yabe_archive_reader_init( yabe_archive_reader_t* reader, char* data, size_t size )
+{
+    yabe_cursor_t c = { data, size };
+    if( size < 5 + YABE_ARCHIVE_TRAILER || yabe_read_signature( &c ) != 5 ||
+        memcmp( data + size - sizeof(yabe_archive_magic), yabe_archive_magic, sizeof(yabe_archive_magic) ) ||
+        (int8_t)data[size - YABE_ARCHIVE_TRAILER] != yabe_int64_tag )
+        return false;
+    const uint64_t dirOffset = yabe_load_le64( data + size - YABE_ARCHIVE_TRAILER + 1 );
+    if( dirOffset < 5 || dirOffset >= size - YABE_ARCHIVE_TRAILER )
+        return false;
+
+    // the directory blob ends at the trailer
+    yabe_string_view_t mime, table;
+    c.ptr = data + dirOffset;
+    c.len = size - YABE_ARCHIVE_TRAILER - dirOffset;
+    if( !yabe_read_blob( &c ) || yabe_end_of_buffer( &c ) || !yabe_read_string_view( &c, &mime ) ||
+        mime.len != sizeof(yabe_archive_mime) - 1 || memcmp( mime.ptr, yabe_archive_mime, mime.len ) ||
+        yabe_end_of_buffer( &c ) || !yabe_read_string_view( &c, &table ) || c.len ||
+        table.len < 8 )
+        return false;
+    const uint64_t count = yabe_load_le64( table.ptr );
+    if( count > (table.len - 8) / YABE_ARCHIVE_ENTRY )
+        return false;
+    reader->data = data;
+    reader->size = size;
+    reader->table = table.ptr + 8;
+    reader->count = (size_t)count;
+    reader->names = reader->table + count * YABE_ARCHIVE_ENTRY;
+    reader->namesLen = table.len - 8 - count * YABE_ARCHIVE_ENTRY;
+    reader->mapped = false;
+
+    // the documents are before the directory, the names in the table, and
+    // the entries sorted with unique names
+    yabe_archive_entry_t prev = { 0, 0, 0, 0, 0 };
+    for( size_t i = 0; i < count; ++i )
+    {
+        const char* p = reader->table + i * YABE_ARCHIVE_ENTRY;
+        yabe_archive_entry_t e =
+        {
+            yabe_load_le64( p ), yabe_load_le64( p + 8 ), yabe_load_le64( p + 16 ),
+            yabe_load_le32( p + 24 ), yabe_load_le32( p + 28 )
+        };
+        if( e.offset < 5 || e.offset > dirOffset || e.size > dirOffset - e.offset ||
+            e.nameOffset > reader->namesLen || e.nameLen > reader->namesLen - e.nameOffset ||
+            yabe_archive_hash( reader->names + e.nameOffset, e.nameLen ) != e.hash ||
+            (i && yabe_archive_compare( &prev, &e, reader->names, reader->names ) >= 0) )
+            return false;
+        prev = e;
+    }
+    return true;
+}
+
+
+/* Unmap the archive if it was mapped by yabe_archive_reader_open() */
+void yabe_archive_reader_close( yabe_archive_reader_t* reader )
+{
+    if( reader->mapped )
+        munmap( reader->data, reader->size );
+    reader->data = NULL;
+    reader->count = 0;
+    reader->mapped = false;
+}
+
+
+/* Look up a document by name */
+bool yabe_archive_find( const yabe_archive_reader_t* reader, const char* name, size_t nameLen,
+                        yabe_cursor_t* doc )
+{
+    const uint64_t hash = yabe_archive_hash( name, nameLen );
+
+    // first entry of the hash, then the entries with the same hash
+    size_t lo = 0, hi = reader->count;
+    while( lo < hi )
+    {
+        const size_t mid = lo + (hi - lo) / 2;
+        if( yabe_load_le64( reader->table + mid * YABE_ARCHIVE_ENTRY ) < hash )
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    for( const char* p = reader->table + lo * YABE_ARCHIVE_ENTRY;
+         lo < reader->count && yabe_load_le64( p ) == hash; ++lo, p += YABE_ARCHIVE_ENTRY )
+    {
+        if( yabe_load_le32( p + 28 ) == nameLen &&
+            !memcmp( reader->names + yabe_load_le32( p + 24 ), name, nameLen ) )
+        {
+            doc->ptr = reader->data + yabe_load_le64( p + 8 );
+            doc->len = (size_t)yabe_load_le64( p + 16 );
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/* Return the name and the bytes of a document of the directory */
+void yabe_archive_entry( const yabe_archive_reader_t* reader, size_t index,
+                         yabe_string_view_t* name, yabe_cursor_t* doc )
+{
+    assert( index < reader->count );
+    const char* p = reader->table + index * YABE_ARCHIVE_ENTRY;
+    name->ptr = reader->names + yabe_load_le32( p + 24 );
+    name->len = yabe_load_le32( p + 28 );
+    doc->ptr = reader->data + yabe_load_le64( p + 8 );
+    doc->len = (size_t)yabe_load_le64( p + 16 );
+}
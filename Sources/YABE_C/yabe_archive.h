@@ -0,0 +1,190 @@
+#ifndef YABE_ARCHIVE_H
+#define YABE_ARCHIVE_H
+
+#include "yabe.h"
+
+/**
+   \page archive_page Archives of named documents
+
+   Storing many small documents in as many files costs an open, a read and
+   a close for each of them. An archive stores the documents in a single
+   file, with a directory of their names at the end :
+
+   \verbatim
+      archive   : [signature] [document]* [directory] [C3 offset64] [84 'Y' 'A' 'R' 'C']
+      directory : [blob] ["application/x-yabe-archive"] [str64 table]
+      table     : [count64] [entry]* [names]
+      entry     : [hash64] [offset64] [size64] [nameOffset32] [nameLen32]
+    \endverbatim
+
+   The archive is itself a valid YABE stream : the documents are YABE values
+   starting on 64 byte boundaries, the bytes between them are \e none
+   values, the directory is a blob and the trailer an integer, the offset
+   of the directory blob, followed by a 4 bytes string.
+
+   The fields of the table are little endian. The document offsets are
+   relative to the start of the archive, the name offsets to the start of
+   the names. The entries are sorted by the 64 bit FNV-1a hash of the name,
+   then by name, and the names are unique.
+
+   The reader maps the archive in memory. Opening a document is a binary
+   search of the hash of its name in the directory, which returns a cursor
+   on its bytes in the mapping. The documents themselves are not checked.
+
+   \code
+    yabe_archive_writer_t writer;
+    if( !yabe_archive_writer_open( &writer, path ) ) { ... }
+    for( ... )
+        yabe_archive_add( &writer, name, nameLen, wCurInit.ptr, wCur.ptr - wCurInit.ptr );
+    if( !yabe_archive_writer_close( &writer ) ) { ... }
+
+    yabe_archive_reader_t reader;
+    yabe_cursor_t doc;
+    if( !yabe_archive_reader_open( &reader, path ) ) { ... }
+    if( yabe_archive_find( &reader, "config", 6, &doc ) )
+        ... decode doc ...
+    yabe_archive_reader_close( &reader );
+   \endcode
+*/
+
+/// Alignment of the documents in an archive
+#define YABE_ARCHIVE_ALIGN 64
+
+
+/**
+ * \brief Directory entry of a document being written
+ */
+typedef struct yabe_archive_entry_t
+{
+    uint64_t hash;              ///< Hash of the document name
+    uint64_t offset;            ///< Offset of the document in the archive
+    uint64_t size;              ///< Number of bytes of the document
+    uint32_t nameOffset;        ///< Offset of the name in the names
+    uint32_t nameLen;           ///< Number of bytes of the name
+} yabe_archive_entry_t;
+
+
+/**
+ * \brief Archive being written
+ */
+typedef struct yabe_archive_writer_t
+{
+    int fd;                         ///< File descriptor of the archive
+    uint64_t offset;                ///< Number of bytes written
+    yabe_archive_entry_t* entries;  ///< Entries of the added documents
+    size_t count;                   ///< Number of added documents
+    size_t capacity;                ///< Number of allocated entries
+    char* names;                    ///< Names of the added documents
+    size_t namesLen;                ///< Number of bytes of the names
+    size_t namesCapacity;           ///< Number of allocated bytes for names
+    bool error;                     ///< Set if a write or an allocation failed
+} yabe_archive_writer_t;
+
+
+/**
+ * \brief Archive being read
+ */
+typedef struct yabe_archive_reader_t
+{
+    char* data;                 ///< Start of the archive
+    size_t size;                ///< Number of bytes of the archive
+    const char* table;          ///< First directory entry
+    const char* names;          ///< Names of the directory
+    size_t namesLen;            ///< Number of bytes of the names
+    size_t count;               ///< Number of documents
+    bool mapped;                ///< True if the archive is mapped by the reader
+} yabe_archive_reader_t;
+
+
+/**
+ * \brief Create or truncate an archive file and write its signature
+ *
+ * \param[out] writer Pointer on the archive writer to initialize
+ * \param path Path of the archive file
+ * \return true if the file was created, false on error
+ */
+bool yabe_archive_writer_open( yabe_archive_writer_t* writer, const char* path );
+
+
+/**
+ * \brief Append an encoded document to the archive
+ *
+ * \param[in,out] writer Pointer on the archive writer
+ * \param name Pointer on the bytes of the document name
+ * \param nameLen Number of bytes of the name
+ * \param data Pointer on the encoded document, a single YABE value
+ * \param size Number of bytes of the document
+ * \return true if the document was written, false on error
+ */
+bool yabe_archive_add( yabe_archive_writer_t* writer, const char* name, size_t nameLen,
+                       const void* data, size_t size );
+
+
+/**
+ * \brief Write the directory, close the file and release the writer
+ *  resources
+ *
+ * \param[in,out] writer Pointer on the archive writer
+ * \return true if the archive is complete, false on error or if two
+ *         documents have the same name
+ */
+bool yabe_archive_writer_close( yabe_archive_writer_t* writer );
+
+
+/**
+ * \brief Map an archive file in memory and check its directory
+ *
+ * \param[out] reader Pointer on the archive reader to initialize
+ * \param path Path of the archive file
+ * \return true if the archive could be opened, false on error or if the
+ *         file is not a valid archive
+ */
+bool yabe_archive_reader_open( yabe_archive_reader_t* reader, const char* path );
+
+
+/**
+ * \brief Check the directory of an archive in memory
+ *
+ * \param[out] reader Pointer on the archive reader to initialize
+ * \param data Pointer on the archive, it must outlive the reader
+ * \param size Number of bytes of the archive
+ * \return true if the archive is valid, false otherwise
+ */
+bool yabe_archive_reader_init( yabe_archive_reader_t* reader, char* data, size_t size );
+
+
+/**
+ * \brief Unmap the archive if it was mapped by yabe_archive_reader_open()
+ *
+ * \param[in,out] reader Pointer on the archive reader
+ */
+void yabe_archive_reader_close( yabe_archive_reader_t* reader );
+
+
+/**
+ * \brief Look up a document by name
+ *
+ * \param[in] reader Pointer on the archive reader
+ * \param name Pointer on the bytes of the document name
+ * \param nameLen Number of bytes of the name
+ * \param[out] doc Cursor on the document bytes if it is found. The bytes
+ *                 of a mapped archive are read only
+ * \return true if the document is found, false otherwise
+ */
+bool yabe_archive_find( const yabe_archive_reader_t* reader, const char* name, size_t nameLen,
+                        yabe_cursor_t* doc );
+
+
+/**
+ * \brief Return the name and the bytes of a document of the directory
+ *
+ * \param[in] reader Pointer on the archive reader
+ * \param index Index of the document in the directory, less than the number
+ *              of documents
+ * \param[out] name Name of the document
+ * \param[out] doc Cursor on the document bytes
+ */
+void yabe_archive_entry( const yabe_archive_reader_t* reader, size_t index,
+                         yabe_string_view_t* name, yabe_cursor_t* doc );
+
+#endif // YABE_ARCHIVE_H
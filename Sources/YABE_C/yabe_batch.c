@@ -0,0 +1,131 @@
+#include "yabe_batch.h"
+
+/* Magic bytes ending a batch */
+static const char yabe_batch_magic[4] = { 'Y', 'B', 'A', 'T' };
+
+
+/* Start a batch at cursor position */
+bool yabe_batch_begin( yabe_batch_writer_t* batch, const yabe_cursor_t* cursor )
+{
+    // the offsets are 32 bit, the batch can't use more than 4 GB
+    const size_t len = cursor->len < UINT32_MAX ? cursor->len : UINT32_MAX;
+    if( len < YABE_BATCH_SIGNATURE + sizeof(uint32_t) + YABE_BATCH_TRAILER )
+        return false;
+    yabe_cursor_t c = { cursor->ptr, len };
+    yabe_write_signature_version( &c, YABE_VERSION );
+    batch->start = cursor->ptr;
+    batch->end = cursor->ptr + len;
+    batch->last = c.ptr;
+    batch->count = 0;
+    batch->cursor.ptr = c.ptr;
+    batch->cursor.len = c.len - sizeof(uint32_t) - YABE_BATCH_TRAILER;
+    return true;
+}
+
+
+/* Complete the message written since the last commit */
+bool yabe_batch_commit( yabe_batch_writer_t* batch )
+{
+    if( batch->cursor.ptr == batch->last )
+        return false;
+    ++batch->count;
+    yabe_store_le32( batch->end - batch->count * sizeof(uint32_t),
+                     (uint32_t)(batch->cursor.ptr - batch->start) );
+    batch->last = batch->cursor.ptr;
+
+    // space of the offset of the next message
+    batch->cursor.len = (batch->cursor.len >= sizeof(uint32_t)) ? batch->cursor.len - sizeof(uint32_t) : 0;
+    return true;
+}
+
+
+/* Discard the bytes written since the last commit */
+void yabe_batch_rollback( yabe_batch_writer_t* batch )
+{
+    batch->cursor.len += batch->cursor.ptr - batch->last;
+    batch->cursor.ptr = batch->last;
+}
+
+
+/* Copy an encoded message into the batch */
+bool yabe_batch_add( yabe_batch_writer_t* batch, const void* data, size_t size )
+{
+    yabe_batch_rollback( batch );
+    if( !size || size > batch->cursor.len )
+        return false;
+    memcpy( batch->cursor.ptr, data, size );
+    batch->cursor.ptr += size;
+    batch->cursor.len -= size;
+    return yabe_batch_commit( batch );
+}
+
+
+/* Complete the batch and return its number of bytes */
+size_t yabe_batch_end( yabe_batch_writer_t* batch, yabe_cursor_t* cursor )
+{
+    yabe_batch_rollback( batch );
+
+    // the offsets are stored in reverse order before the end of the buffer
+    const size_t tableSize = batch->count * sizeof(uint32_t);
+    char* table = batch->last;
+    memmove( table, batch->end - tableSize, tableSize );
+    for( size_t i = 0, j = batch->count; i + 1 < j; ++i, --j )
+    {
+        uint32_t tmp;
+        memcpy( &tmp, table + i * sizeof(uint32_t), sizeof(uint32_t) );
+        memcpy( table + i * sizeof(uint32_t), table + (j - 1) * sizeof(uint32_t), sizeof(uint32_t) );
+        memcpy( table + (j - 1) * sizeof(uint32_t), &tmp, sizeof(uint32_t) );
+    }
+    yabe_store_le32( table + tableSize, (uint32_t)batch->count );
+    memcpy( table + tableSize + sizeof(uint32_t), yabe_batch_magic, sizeof(yabe_batch_magic) );
+
+    const size_t size = (table + tableSize + YABE_BATCH_TRAILER) - batch->start;
+    cursor->ptr += size;
+    cursor->len -= size;
+    batch->cursor.len = 0;
+    return size;
+}
+
+
+/* Check a batch and initialize a reader on its messages */
+bool yabe_batch_open( yabe_batch_reader_t* reader, char* data, size_t size, bool checkValues )
+{
+    yabe_cursor_t c = { data, size };
+    if( size < YABE_BATCH_SIGNATURE + YABE_BATCH_TRAILER || size > UINT32_MAX ||
+        yabe_read_signature( &c ) != YABE_BATCH_SIGNATURE ||
+        memcmp( data + size - sizeof(yabe_batch_magic), yabe_batch_magic, sizeof(yabe_batch_magic) ) )
+        return false;
+    const size_t count = yabe_load_le32( data + size - YABE_BATCH_TRAILER );
+    if( count > (size - YABE_BATCH_SIGNATURE - YABE_BATCH_TRAILER) / sizeof(uint32_t) )
+        return false;
+    const size_t messagesEnd = size - YABE_BATCH_TRAILER - count * sizeof(uint32_t);
+    const char* table = data + messagesEnd;
+
+    // the offsets increase up to the end of the messages, checked without
+    // branch so that the loop is vectorized
+    if( count ? (yabe_load_le32( table ) <= YABE_BATCH_SIGNATURE ||
+                 yabe_load_le32( table + (count - 1) * sizeof(uint32_t) ) != messagesEnd)
+              : messagesEnd != YABE_BATCH_SIGNATURE )
+        return false;
+    uint32_t bad = 0;
+    for( size_t i = 1; i < count; ++i )
+        bad |= yabe_load_le32( table + i * sizeof(uint32_t) ) <=
+               yabe_load_le32( table + (i - 1) * sizeof(uint32_t) );
+    if( bad )
+        return false;
+
+    reader->data = data;
+    reader->table = table;
+    reader->count = count;
+    if( checkValues )
+    {
+        for( size_t i = 0; i < count; ++i )
+        {
+            yabe_batch_message( reader, i, &c );
+            if( !yabe_skip_value( &c ) || c.len )
+                return false;
+        }
+    }
+    return true;
+}
+
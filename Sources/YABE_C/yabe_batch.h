@@ -0,0 +1,191 @@
+#ifndef YABE_BATCH_H
+#define YABE_BATCH_H
+
+#include "yabe.h"
+#include "yabe_endian.h"
+
+/**
+   \page batch_page Batches of messages
+
+   Encoding many small messages one by one costs a signature, a cursor setup
+   and a capacity check per written value for each message. A batch holds
+   many messages after a single signature, followed by a table of their end
+   offsets :
+
+   \verbatim
+      batch   : [signature] [message]* [end32]* [count32] ['Y','B','A','T']
+    \endverbatim
+
+   A message is a YABE encoded value, possibly preceded by \e none values.
+   The end offsets and the count are little endian 32 bit integers, the end
+   offsets are relative to the start of the batch. A message starts where
+   the previous one ends, the first one after the signature. A batch is
+   therefore limited to 4 GB.
+
+   The batch writer stores the end offsets at the end of the output buffer
+   while the messages are written, and moves them after the last message
+   when the batch is complete. Messages are written with the yabe_write_
+   functions on the cursor of the writer, or with the yabe_put_ functions
+   after a single yabe_batch_reserve() of the message size bound.
+
+   The batch reader checks the signature and the offset table in a single
+   branch free pass, then returns a cursor on any message in constant time.
+   The messages themselves are validated only on request.
+
+   \code
+    yabe_batch_writer_t batch;
+    if( !yabe_batch_begin( &batch, &wCur ) ) { ... }
+    for( ... )
+    {
+        if( !yabe_batch_reserve( &batch, 32 ) ) { ... batch full ... }
+        yabe_put_small_object( &batch.cursor, 1 );
+        ...
+        yabe_batch_commit( &batch );
+    }
+    size_t size = yabe_batch_end( &batch, &wCur );
+
+    yabe_batch_reader_t reader;
+    yabe_cursor_t msg;
+    if( !yabe_batch_open( &reader, data, size, false ) ) { ... }
+    for( size_t i = 0; i < reader.count; ++i )
+    {
+        yabe_batch_message( &reader, i, &msg );
+        ... decode msg ...
+    }
+   \endcode
+*/
+
+/// Number of bytes of the batch trailer : the count and the magic bytes
+#define YABE_BATCH_TRAILER 8
+
+/// Number of bytes of the batch signature
+#define YABE_BATCH_SIGNATURE 5
+
+
+/**
+ * \brief Batch being written
+ */
+typedef struct yabe_batch_writer_t
+{
+    yabe_cursor_t cursor;   ///< Where to write the next message, its length
+                            ///< excludes the space of the offset table
+    char* start;            ///< Start of the batch, at its signature
+    char* end;              ///< End of the output buffer, the offsets are
+                            ///< stored before it in reverse order
+    char* last;             ///< End of the last committed message
+    size_t count;           ///< Number of committed messages
+} yabe_batch_writer_t;
+
+
+/**
+ * \brief Batch being read
+ */
+typedef struct yabe_batch_reader_t
+{
+    char* data;             ///< Start of the batch
+    const char* table;      ///< Table of the message end offsets
+    size_t count;           ///< Number of messages
+} yabe_batch_reader_t;
+
+
+/**
+ * \brief Start a batch at cursor position
+ *
+ * The remaining space of the cursor is used by the batch until
+ * yabe_batch_end() is called. The signature is a version 1 signature.
+ *
+ * \param[out] batch Pointer on the batch writer to initialize
+ * \param cursor Pointer on buffer info where to write the batch, left
+ *               unchanged
+ * \return true if the batch is started, false if cursor is too small
+ */
+bool yabe_batch_begin( yabe_batch_writer_t* batch, const yabe_cursor_t* cursor );
+
+
+/**
+ * \brief Check that a message of the given size can be written
+ *
+ * \param[in] batch Pointer on the batch writer
+ * \param size Upper bound of the size of the message being written
+ * \return true if the message can be written with the yabe_put_ functions,
+ *         false if the batch is full
+ */
+static inline bool yabe_batch_reserve( const yabe_batch_writer_t* batch, size_t size )
+    { return size <= batch->cursor.len; }
+
+
+/**
+ * \brief Complete the message written since the last commit
+ *
+ * \param[in,out] batch Pointer on the batch writer
+ * \return true if the message is added to the batch, false if no byte was
+ *         written since the last commit
+ */
+bool yabe_batch_commit( yabe_batch_writer_t* batch );
+
+
+/**
+ * \brief Discard the bytes written since the last commit
+ *
+ * \param[in,out] batch Pointer on the batch writer
+ */
+void yabe_batch_rollback( yabe_batch_writer_t* batch );
+
+
+/**
+ * \brief Copy an encoded message into the batch
+ *
+ * Bytes written since the last commit are discarded.
+ *
+ * \param[in,out] batch Pointer on the batch writer
+ * \param data Pointer on the encoded message
+ * \param size Number of bytes of the message
+ * \return true if the message is added to the batch, false if it is empty
+ *         or the batch is full
+ */
+bool yabe_batch_add( yabe_batch_writer_t* batch, const void* data, size_t size );
+
+
+/**
+ * \brief Complete the batch and return its number of bytes
+ *
+ * Bytes written since the last commit are discarded.
+ *
+ * \param[in,out] batch Pointer on the batch writer, it can't be used after
+ * \param[in,out] cursor Pointer on the buffer info given to
+ *                       yabe_batch_begin(), updated past the batch
+ * \return the number of bytes of the batch
+ */
+size_t yabe_batch_end( yabe_batch_writer_t* batch, yabe_cursor_t* cursor );
+
+
+/**
+ * \brief Check a batch and initialize a reader on its messages
+ *
+ * \param[out] reader Pointer on the batch reader to initialize
+ * \param data Pointer on the batch
+ * \param size Number of bytes of the batch
+ * \param checkValues If true, check also that each message is a single
+ *                    valid value, as yabe_skip_value() does
+ * \return true if the batch is valid, false otherwise
+ */
+bool yabe_batch_open( yabe_batch_reader_t* reader, char* data, size_t size, bool checkValues );
+
+
+/**
+ * \brief Return a cursor on a message of the batch
+ *
+ * \param[in] reader Pointer on the batch reader
+ * \param index Index of the message, less than the number of messages
+ * \param[out] msg Cursor on the bytes of the message
+ */
+static inline void yabe_batch_message( const yabe_batch_reader_t* reader, size_t index, yabe_cursor_t* msg )
+{
+    assert( index < reader->count );
+    const size_t start = index ? yabe_load_le32( reader->table + (index - 1) * sizeof(uint32_t) )
+                               : YABE_BATCH_SIGNATURE;
+    msg->ptr = reader->data + start;
+    msg->len = yabe_load_le32( reader->table + index * sizeof(uint32_t) ) - start;
+}
+
+#endif // YABE_BATCH_H
@@ -0,0 +1,280 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+
+#include "yabe_blob.h"
+#include "yabe_endian.h"
+
+
+/* Size of the buffer used when the kernel can't transfer the data */
+#define YABE_BLOB_CHUNK 65536
+
+/* Maximum number of bytes transferred by a system call */
+#define YABE_BLOB_MAX_CALL 0x40000000
+
+
+/* Ways to transfer data between file descriptors, tried in order */
+enum { YABE_BLOB_COPY_RANGE, YABE_BLOB_SENDFILE, YABE_BLOB_SPLICE, YABE_BLOB_BUFFER };
+
+
+/* Write all the bytes to fd at its current offset */
+static bool yabe_blob_write_all( int fd, const void* data, size_t size )
+{
+    const char* p = data;
+    while( size )
+    {
+        ssize_t res = write( fd, p, size );
+        if( res < 0 && errno == EINTR )
+            continue;
+        if( res <= 0 )
+            return false;
+        p += res; size -= res;
+    }
+    return true;
+}
+
+
+/* Read all the bytes from fd at its current offset */
+static bool yabe_blob_read_all( int fd, void* data, size_t size )
+{
+    char* p = data;
+    while( size )
+    {
+        ssize_t res = read( fd, p, size );
+        if( res < 0 && errno == EINTR )
+            continue;
+        if( res <= 0 )
+            return false;
+        p += res; size -= res;
+    }
+    return true;
+}
+
+
+/* Return true if the transfer method is not supported for these file
+   descriptors and the next one must be tried */
+static bool yabe_blob_unsupported( int err )
+{
+    return err == EINVAL || err == EXDEV || err == ENOSYS || err == EOPNOTSUPP ||
+           err == ESPIPE || err == EBADF;
+}
+
+
+/* Read a chunk from src and write it to dst, return the number of bytes
+   transferred, 0 at the end of src and -1 on error */
+static ssize_t yabe_blob_copy_buffer( int dst, int src, size_t len )
+{
+    char buf[YABE_BLOB_CHUNK];
+    ssize_t res;
+    do
+        res = read( src, buf, len < sizeof(buf) ? len : sizeof(buf) );
+    while( res < 0 && errno == EINTR );
+    if( res > 0 && !yabe_blob_write_all( dst, buf, (size_t)res ) )
+        return -1;
+    return res;
+}
+
+
+/* Transfer up to len bytes from src to dst at their current offsets and
+   return the number of bytes transferred, fewer at the end of src */
+static uint64_t yabe_blob_copy( int dst, int src, uint64_t len )
+{
+    int method = YABE_BLOB_COPY_RANGE;
+    uint64_t copied = 0;
+    while( copied < len )
+    {
+        const size_t n = len - copied < YABE_BLOB_MAX_CALL ? (size_t)(len - copied)
+                                                           : YABE_BLOB_MAX_CALL;
+        ssize_t res;
+        switch( method )
+        {
+        case YABE_BLOB_COPY_RANGE: res = copy_file_range( src, NULL, dst, NULL, n, 0 ); break;
+        case YABE_BLOB_SENDFILE:   res = sendfile( dst, src, NULL, n ); break;
+        case YABE_BLOB_SPLICE:     res = splice( src, NULL, dst, NULL, n, SPLICE_F_MOVE ); break;
+        default:                   res = yabe_blob_copy_buffer( dst, src, n ); break;
+        }
+        if( res < 0 && errno == EINTR )
+            continue;
+        if( res < 0 && method != YABE_BLOB_BUFFER && yabe_blob_unsupported( errno ) )
+        {
+            ++method;
+            continue;
+        }
+        if( res < 0 )
+            return YABE_BLOB_ERROR;
+        if( res == 0 )
+            break;
+        copied += (uint64_t)res;
+    }
+    return copied;
+}
+
+
+/* Write the blob header at the current offset of the file descriptor */
+bool yabe_blob_writer_begin( yabe_blob_writer_t* writer, int fd, const char* mime,
+                             size_t mimeLen, uint64_t size )
+{
+    char buf[2 * (sizeof(int8_t) + sizeof(uint64_t))];
+    yabe_cursor_t c = { buf, sizeof(buf) };
+    if( !yabe_write_blob( &c ) || !yabe_write_string( &c, mimeLen ) ||
+        !yabe_blob_write_all( fd, buf, c.ptr - buf ) ||
+        !yabe_blob_write_all( fd, mime, mimeLen ) )
+        return false;
+
+    // the data size is written with 8 bytes when it is set by
+    // yabe_blob_writer_end() at the offset of the string
+    c.ptr = buf; c.len = sizeof(buf);
+    writer->sizeOffset = 0;
+    if( size == YABE_BLOB_UNKNOWN_SIZE )
+    {
+        const off_t offset = lseek( fd, 0, SEEK_CUR );
+        const int flags = fcntl( fd, F_GETFL );
+        if( offset < 0 || flags < 0 || (flags & O_APPEND) )
+            return false;
+        writer->sizeOffset = (uint64_t)offset + sizeof(int8_t);
+        yabe_write_tag( &c, yabe_str64_tag );
+        yabe_store_le64( c.ptr, 0 );
+        c.ptr += sizeof(uint64_t);
+    }
+    else if( size > SIZE_MAX || !yabe_write_string( &c, (size_t)size ) )
+        return false;
+    if( !yabe_blob_write_all( fd, buf, c.ptr - buf ) )
+        return false;
+    writer->fd = fd;
+    writer->size = size;
+    writer->written = 0;
+    return true;
+}
+
+
+/* Write a chunk of data and return the number of bytes written */
+size_t yabe_blob_write( yabe_blob_writer_t* writer, const void* data, size_t len )
+{
+    if( (writer->size != YABE_BLOB_UNKNOWN_SIZE && len > writer->size - writer->written) ||
+        !yabe_blob_write_all( writer->fd, data, len ) )
+        return 0;
+    writer->written += len;
+    return len;
+}
+
+
+/* Copy data from a file descriptor and return the number of bytes copied */
+uint64_t yabe_blob_write_fd( yabe_blob_writer_t* writer, int src, uint64_t len )
+{
+    if( writer->size != YABE_BLOB_UNKNOWN_SIZE )
+    {
+        if( len == YABE_BLOB_UNKNOWN_SIZE )
+            len = writer->size - writer->written;
+        else if( len > writer->size - writer->written )
+            return YABE_BLOB_ERROR;
+    }
+    const uint64_t copied = yabe_blob_copy( writer->fd, src, len );
+    if( copied != YABE_BLOB_ERROR )
+        writer->written += copied;
+    return copied;
+}
+
+
+/* Complete the blob, setting its data size if it was unknown */
+bool yabe_blob_writer_end( yabe_blob_writer_t* writer )
+{
+    if( writer->size != YABE_BLOB_UNKNOWN_SIZE )
+        return writer->written == writer->size;
+    char buf[sizeof(uint64_t)];
+    yabe_store_le64( buf, writer->written );
+    size_t size = sizeof(buf);
+    off_t offset = (off_t)writer->sizeOffset;
+    const char* p = buf;
+    while( size )
+    {
+        ssize_t res = pwrite( writer->fd, p, size, offset );
+        if( res < 0 && errno == EINTR )
+            continue;
+        if( res <= 0 )
+            return false;
+        p += res; size -= res; offset += res;
+    }
+    writer->size = writer->written;
+    return true;
+}
+
+
+/* Read the header of a string from fd and return its length */
+static bool yabe_blob_read_string( int fd, uint64_t* length )
+{
+    char buf[sizeof(int8_t) + sizeof(uint64_t)];
+    if( !yabe_blob_read_all( fd, buf, sizeof(int8_t) ) )
+        return false;
+    const int8_t tag = (int8_t)buf[0];
+    size_t len = 0;
+    if( (tag & ((int8_t)-64)) == yabe_str6_tag )
+        len = 0;
+    else if( tag == yabe_str16_tag )
+        len = sizeof(uint16_t);
+    else if( tag == yabe_str32_tag )
+        len = sizeof(uint32_t);
+    else if( tag == yabe_str64_tag )
+        len = sizeof(uint64_t);
+    else
+        return false;
+    if( !yabe_blob_read_all( fd, buf + 1, len ) )
+        return false;
+    yabe_cursor_t c = { buf, sizeof(int8_t) + len };
+    size_t strLen;
+    if( !yabe_read_string( &c, &strLen ) )
+        return false;
+    *length = strLen;
+    return true;
+}
+
+
+/* Read the blob header at the current offset of the file descriptor */
+bool yabe_blob_reader_begin( yabe_blob_reader_t* reader, int fd )
+{
+    char tag;
+    do
+        if( !yabe_blob_read_all( fd, &tag, sizeof(tag) ) )
+            return false;
+    while( (int8_t)tag == yabe_none_tag );
+    uint64_t mimeLen, size;
+    if( (int8_t)tag != yabe_blob_tag || !yabe_blob_read_string( fd, &mimeLen ) ||
+        mimeLen > YABE_BLOB_MIME_MAX ||
+        !yabe_blob_read_all( fd, reader->mime, (size_t)mimeLen ) ||
+        !yabe_blob_read_string( fd, &size ) )
+        return false;
+    reader->fd = fd;
+    reader->mimeLen = (size_t)mimeLen;
+    reader->size = reader->left = size;
+    return true;
+}
+
+
+/* Read a chunk of data and return the number of bytes read */
+size_t yabe_blob_read( yabe_blob_reader_t* reader, void* data, size_t len )
+{
+    if( len > reader->left )
+        len = (size_t)reader->left;
+    ssize_t res;
+    do
+        res = len ? read( reader->fd, data, len ) : 0;
+    while( res < 0 && errno == EINTR );
+    if( res <= 0 )
+        return 0;
+    reader->left -= (uint64_t)res;
+    return (size_t)res;
+}
+
+
+/* Transfer data to a file descriptor and return the number of bytes
+   transferred */
+uint64_t yabe_blob_read_fd( yabe_blob_reader_t* reader, int dst, uint64_t len )
+{
+    const uint64_t copied = yabe_blob_copy( dst, reader->fd, len < reader->left ? len : reader->left );
+    if( copied != YABE_BLOB_ERROR )
+        reader->left -= copied;
+    return copied;
+}
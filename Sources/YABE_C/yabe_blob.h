@@ -0,0 +1,178 @@
+#ifndef YABE_BLOB_H
+#define YABE_BLOB_H
+
+#include "yabe.h"
+
+/**
+   \page blob_page Streaming large blobs
+
+   yabe_write_blob() is followed by the mime type and the data strings, and
+   the data size is written before the data. A blob of several gigabytes,
+   a video for example, is thus written in one piece from memory. The blob
+   writer and reader stream the data of a blob through a file descriptor
+   instead :
+
+    <ul>
+    <li> the writer writes the blob tag and mime type, then the data as a
+         str64 string. When the data size is unknown, the size is written
+         as 0 and set by yabe_blob_writer_end() once the data is written,
+         which requires a regular file. Data is given by chunks from memory
+         or copied from another file descriptor ;
+    <li> the reader reads the blob header and hands out the data by chunks,
+         or transfers it to another file descriptor.
+    </ul>
+
+   Transfers between file descriptors don't pass through user space : they
+   use copy_file_range() between regular files, sendfile() from a regular
+   file and splice() from or to a pipe. When the kernel refuses them, the
+   data is read and written through a buffer.
+
+   The blob is written and read at the current file offset. Values before
+   it must be written to the file first, and those after it are read once
+   the blob reader reached the end of the data.
+
+   \code
+    yabe_blob_writer_t writer;
+    if( !yabe_blob_writer_begin( &writer, fd, "video/mp4", 9, YABE_BLOB_UNKNOWN_SIZE ) ||
+        yabe_blob_write_fd( &writer, srcFd, YABE_BLOB_UNKNOWN_SIZE ) == YABE_BLOB_ERROR ||
+        !yabe_blob_writer_end( &writer ) ) { ... }
+
+    yabe_blob_reader_t reader;
+    if( !yabe_blob_reader_begin( &reader, fd ) ||
+        yabe_blob_read_fd( &reader, socketFd, reader.left ) != reader.size ) { ... }
+   \endcode
+*/
+
+/// Data size of a blob not known before its data is written
+#define YABE_BLOB_UNKNOWN_SIZE UINT64_MAX
+
+/// Number of bytes returned by the transfer functions on error
+#define YABE_BLOB_ERROR UINT64_MAX
+
+/// Maximum number of bytes of a mime type read by the blob reader
+#define YABE_BLOB_MIME_MAX 256
+
+
+/**
+ * \brief Blob being written to a file descriptor
+ */
+typedef struct yabe_blob_writer_t
+{
+    int fd;                         ///< File descriptor where the blob is written
+    uint64_t sizeOffset;            ///< File offset of the data size
+    uint64_t size;                  ///< Data size given to yabe_blob_writer_begin()
+    uint64_t written;               ///< Number of data bytes written
+} yabe_blob_writer_t;
+
+
+/**
+ * \brief Blob being read from a file descriptor
+ */
+typedef struct yabe_blob_reader_t
+{
+    int fd;                         ///< File descriptor where the blob is read
+    uint64_t size;                  ///< Number of data bytes
+    uint64_t left;                  ///< Number of data bytes not read yet
+    size_t mimeLen;                 ///< Number of bytes of the mime type
+    char mime[YABE_BLOB_MIME_MAX];  ///< Mime type, not null terminated
+} yabe_blob_reader_t;
+
+
+/**
+ * \brief Write the blob header at the current offset of the file
+ *  descriptor
+ *
+ * \param[out] writer Pointer on the blob writer to initialize
+ * \param fd File descriptor where the blob is written. It must be a regular
+ *           file not opened with O_APPEND if size is YABE_BLOB_UNKNOWN_SIZE
+ * \param mime Pointer on the bytes of the mime type
+ * \param mimeLen Number of bytes of the mime type
+ * \param size Number of data bytes, or YABE_BLOB_UNKNOWN_SIZE
+ * \return true if the header was written, false on error
+ */
+bool yabe_blob_writer_begin( yabe_blob_writer_t* writer, int fd, const char* mime,
+                             size_t mimeLen, uint64_t size );
+
+
+/**
+ * \brief Write a chunk of data and return the number of bytes written
+ *
+ * \param[in,out] writer Pointer on the blob writer
+ * \param data Pointer on the bytes to write
+ * \param len Number of bytes to write
+ * \return len, \e fail : 0 on error or if the data would exceed the size
+ *         given to yabe_blob_writer_begin()
+ */
+size_t yabe_blob_write( yabe_blob_writer_t* writer, const void* data, size_t len );
+
+
+/**
+ * \brief Copy data from a file descriptor and return the number of bytes
+ *  copied
+ *
+ * The data is read from the current offset of src.
+ *
+ * \param[in,out] writer Pointer on the blob writer
+ * \param src File descriptor where the data is read
+ * \param len Number of bytes to copy, or YABE_BLOB_UNKNOWN_SIZE to copy up
+ *            to the end of src or of the size given to
+ *            yabe_blob_writer_begin()
+ * \return the number of bytes copied, fewer than len if src ended first,
+ *         \e fail : YABE_BLOB_ERROR on error or if the data would exceed the
+ *         size given to yabe_blob_writer_begin()
+ */
+uint64_t yabe_blob_write_fd( yabe_blob_writer_t* writer, int src, uint64_t len );
+
+
+/**
+ * \brief Complete the blob, setting its data size if it was unknown
+ *
+ * The file offset is left after the blob data.
+ *
+ * \param[in,out] writer Pointer on the blob writer
+ * \return true if the blob is complete, false on error or if fewer bytes
+ *         than the size given to yabe_blob_writer_begin() were written
+ */
+bool yabe_blob_writer_end( yabe_blob_writer_t* writer );
+
+
+/**
+ * \brief Read the blob header at the current offset of the file descriptor
+ *
+ * \e none values preceding the blob are skipped. The header is read byte
+ * ranges by byte ranges, so that no byte after it is read.
+ *
+ * \param[out] reader Pointer on the blob reader to initialize
+ * \param fd File descriptor where the blob is read
+ * \return true if a blob header was read, false on error, if the value is
+ *         not a blob or its mime type is longer than YABE_BLOB_MIME_MAX
+ */
+bool yabe_blob_reader_begin( yabe_blob_reader_t* reader, int fd );
+
+
+/**
+ * \brief Read a chunk of data and return the number of bytes read
+ *
+ * \param[in,out] reader Pointer on the blob reader
+ * \param[out] data Pointer where to store the bytes
+ * \param len Maximum number of bytes to read
+ * \return the number of bytes read, \e fail : 0 on error, at the end of the
+ *         data or if the file ends before it
+ */
+size_t yabe_blob_read( yabe_blob_reader_t* reader, void* data, size_t len );
+
+
+/**
+ * \brief Transfer data to a file descriptor and return the number of bytes
+ *  transferred
+ *
+ * \param[in,out] reader Pointer on the blob reader
+ * \param dst File descriptor where the data is written
+ * \param len Maximum number of bytes to transfer
+ * \return the number of bytes transferred, fewer than len at the end of the
+ *         data or if the file ends before it, \e fail : YABE_BLOB_ERROR on
+ *         error
+ */
+uint64_t yabe_blob_read_fd( yabe_blob_reader_t* reader, int dst, uint64_t len );
+
+#endif // YABE_BLOB_H
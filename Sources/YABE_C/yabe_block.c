@@ -0,0 +1,291 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "yabe_block.h"
+#include "yabe_lz.h"
+#include "yabe_endian.h"
+
+
+#define YABE_BLOCK_HEADER_SIZE  8    // 'YABZ' and block size
+#define YABE_BLOCK_TRAILER_SIZE 24   // footer without the offsets
+
+
+/* Write exactly size bytes to the file, return false on error */
+static bool yabe_block_write_all( yabe_block_writer_t* writer, const void* data, size_t size )
+{
+    const char* p = data;
+    while( size )
+    {
+        ssize_t res = write( writer->fd, p, size );
+        if( res < 0 && errno == EINTR )
+            continue;
+        if( res <= 0 )
+            return false;
+        p += res; size -= res; writer->fileSize += res;
+    }
+    return true;
+}
+
+
+/* Compress and write the current block */
+static bool yabe_block_flush( yabe_block_writer_t* writer )
+{
+    if( writer->blockLen == 0 )
+        return true;
+    if( writer->nBlocks == writer->capacity )
+    {
+        size_t capacity = writer->capacity ? writer->capacity * 2 : 256;
+        uint64_t* offsets = realloc( writer->offsets, capacity * sizeof(uint64_t) );
+        if( !offsets )
+            return false;
+        writer->offsets = offsets;
+        writer->capacity = capacity;
+    }
+
+    // store the block uncompressed if compression doesn't reduce its size
+    char* packed = writer->packed;
+    size_t packedLen = yabe_lz_compress( writer->block, writer->blockLen, packed,
+                                         yabe_lz_bound( writer->blockSize ) );
+    if( packedLen == 0 || packedLen >= writer->blockLen )
+    {
+        packed = writer->block;
+        packedLen = writer->blockLen;
+    }
+    char len[4];
+    yabe_store_le32( len, (uint32_t)packedLen );
+    writer->offsets[writer->nBlocks] = writer->fileSize;
+    if( !yabe_block_write_all( writer, len, 4 ) ||
+        !yabe_block_write_all( writer, packed, packedLen ) )
+        return false;
+    ++writer->nBlocks;
+    writer->blockLen = 0;
+    return true;
+}
+
+
+/* Create a block compressed file */
+bool yabe_block_writer_open( yabe_block_writer_t* writer, const char* path,
+                             uint32_t blockSize )
+{
+    memset( writer, 0, sizeof(*writer) );
+    writer->blockSize = blockSize ? blockSize : YABE_BLOCK_SIZE;
+    writer->block = malloc( writer->blockSize );
+    writer->packed = malloc( yabe_lz_bound( writer->blockSize ) );
+    writer->fd = open( path, O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+
+    char header[YABE_BLOCK_HEADER_SIZE];
+    memcpy( header, "YABZ", 4 );
+    yabe_store_le32( header + 4, writer->blockSize );
+    if( !writer->block || !writer->packed || writer->fd < 0 ||
+        !yabe_block_write_all( writer, header, sizeof(header) ) )
+    {
+        if( writer->fd >= 0 )
+            close( writer->fd );
+        free( writer->block );
+        free( writer->packed );
+        return false;
+    }
+    return true;
+}
+
+
+/* Append YABE encoded bytes to the file */
+size_t yabe_block_write( yabe_block_writer_t* writer, const void* data, size_t size )
+{
+    const char* p = data;
+    size_t written = 0;
+    while( written < size )
+    {
+        if( writer->blockLen == writer->blockSize && !yabe_block_flush( writer ) )
+            break;
+        size_t len = writer->blockSize - writer->blockLen;
+        if( len > size - written )
+            len = size - written;
+        memcpy( writer->block + writer->blockLen, p + written, len );
+        writer->blockLen += len;
+        writer->rawSize += len;
+        written += len;
+    }
+    return written;
+}
+
+
+/* Write the last block and the footer, then close the file */
+bool yabe_block_writer_close( yabe_block_writer_t* writer )
+{
+    bool ok = yabe_block_flush( writer );
+    for( size_t i = 0; ok && i < writer->nBlocks; ++i )
+    {
+        char offset[8];
+        yabe_store_le64( offset, writer->offsets[i] );
+        ok = yabe_block_write_all( writer, offset, 8 );
+    }
+    if( ok )
+    {
+        char trailer[YABE_BLOCK_TRAILER_SIZE];
+        yabe_store_le64( trailer, writer->rawSize );
+        yabe_store_le32( trailer + 8, (uint32_t)writer->nBlocks );
+        yabe_store_le32( trailer + 12, writer->blockSize );
+        memcpy( trailer + 16, "YABZEND", 8 );
+        ok = yabe_block_write_all( writer, trailer, sizeof(trailer) );
+    }
+    ok = !close( writer->fd ) && ok;
+    free( writer->block );
+    free( writer->packed );
+    free( writer->offsets );
+    memset( writer, 0, sizeof(*writer) );
+    writer->fd = -1;
+    return ok;
+}
+
+
+/* Open a block compressed file for reading */
+bool yabe_block_reader_open( yabe_block_reader_t* reader, const char* path )
+{
+    memset( reader, 0, sizeof(*reader) );
+    reader->cachedBlock = SIZE_MAX;
+
+    int fd = open( path, O_RDONLY );
+    if( fd < 0 )
+        return false;
+    struct stat st;
+    if( fstat( fd, &st ) ||
+        (uint64_t)st.st_size < YABE_BLOCK_HEADER_SIZE + YABE_BLOCK_TRAILER_SIZE )
+    {
+        close( fd );
+        return false;
+    }
+    void* map = mmap( NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+    close( fd );
+    if( map == MAP_FAILED )
+        return false;
+    if( !yabe_block_reader_init( reader, map, (size_t)st.st_size ) )
+    {
+        munmap( map, (size_t)st.st_size );
+        return false;
+    }
+    reader->mapped = true;
+    return true;
+}
+
+
+/* Check the header and the footer of a block compressed file in memory */
+bool yabe_block_reader_init( yabe_block_reader_t* reader, const char* data, size_t size )
+{
+    memset( reader, 0, sizeof(*reader) );
+    reader->cachedBlock = SIZE_MAX;
+    if( size < YABE_BLOCK_HEADER_SIZE + YABE_BLOCK_TRAILER_SIZE )
+        return false;
+
+    // the footer is not covered by a checksum, its fields are checked
+    // without overflow
+    const char* trailer = data + size - YABE_BLOCK_TRAILER_SIZE;
+    const uint64_t rawSize = yabe_load_le64( trailer );
+    const uint32_t nBlocks = yabe_load_le32( trailer + 8 );
+    const uint32_t blockSize = yabe_load_le32( trailer + 12 );
+    const uint64_t indexSize = (uint64_t)nBlocks * sizeof(uint64_t);
+    if( memcmp( data, "YABZ", 4 ) || memcmp( trailer + 16, "YABZEND", 8 ) ||
+        blockSize == 0 || yabe_load_le32( data + 4 ) != blockSize ||
+        size - YABE_BLOCK_HEADER_SIZE - YABE_BLOCK_TRAILER_SIZE < indexSize ||
+        nBlocks != rawSize / blockSize + (rawSize % blockSize != 0) ||
+        !(reader->cache = malloc( blockSize )) )
+        return false;
+    reader->map = data;
+    reader->mapSize = size;
+    reader->offsets = trailer - indexSize;
+    reader->nBlocks = nBlocks;
+    reader->blockSize = blockSize;
+    reader->rawSize = rawSize;
+    return true;
+}
+
+
+/* Decompress the block i into the cache if it is not already there */
+static bool yabe_block_load( yabe_block_reader_t* reader, size_t i )
+{
+    if( reader->cachedBlock == i )
+        return true;
+    if( i >= reader->nBlocks )
+        return false;
+    const size_t indexOffset = reader->offsets - reader->map;
+    const uint64_t offset = yabe_load_le64( reader->offsets + i * 8 );
+    if( offset < YABE_BLOCK_HEADER_SIZE || offset > indexOffset || indexOffset - offset < 4 )
+        return false;
+    const uint32_t packedLen = yabe_load_le32( reader->map + offset );
+    if( indexOffset - offset - 4 < packedLen )
+        return false;
+
+    const char* packed = reader->map + offset + 4;
+    const size_t rawLen = i + 1 < reader->nBlocks ? reader->blockSize :
+        reader->rawSize - (uint64_t)i * reader->blockSize;
+    reader->cachedBlock = SIZE_MAX;
+    if( packedLen == rawLen )
+        memcpy( reader->cache, packed, rawLen );
+    else if( yabe_lz_decompress( packed, packedLen, reader->cache, rawLen ) != rawLen )
+        return false;
+    reader->cachedBlock = i;
+    return true;
+}
+
+
+/* Give access to size encoded bytes starting at offset */
+size_t yabe_block_map( yabe_block_reader_t* reader, uint64_t offset, size_t size,
+                       yabe_cursor_t* cursor )
+{
+    if( offset >= reader->rawSize || size == 0 )
+        return 0;
+    if( size > reader->rawSize - offset )
+        size = reader->rawSize - offset;
+
+    size_t i = offset / reader->blockSize;
+    size_t start = offset % reader->blockSize;
+    if( !yabe_block_load( reader, i ) )
+        return 0;
+    if( start + size <= reader->blockSize )
+    {
+        cursor->ptr = reader->cache + start;
+        cursor->len = size;
+        return size;
+    }
+
+    // the bytes span several blocks, copy them in the scratch buffer
+    if( size > reader->scratchSize )
+    {
+        char* scratch = realloc( reader->scratch, size );
+        if( !scratch )
+            return 0;
+        reader->scratch = scratch;
+        reader->scratchSize = size;
+    }
+    for( size_t copied = 0; copied < size; start = 0 )
+    {
+        if( !yabe_block_load( reader, i++ ) )
+            return 0;
+        size_t len = reader->blockSize - start;
+        if( len > size - copied )
+            len = size - copied;
+        memcpy( reader->scratch + copied, reader->cache + start, len );
+        copied += len;
+    }
+    cursor->ptr = reader->scratch;
+    cursor->len = size;
+    return size;
+}
+
+
+/* Unmap the file if it was mapped by the reader and release its resources */
+void yabe_block_reader_close( yabe_block_reader_t* reader )
+{
+    if( reader->mapped )
+        munmap( (void*)reader->map, reader->mapSize );
+    free( reader->cache );
+    free( reader->scratch );
+    memset( reader, 0, sizeof(*reader) );
+    reader->cachedBlock = SIZE_MAX;
+}
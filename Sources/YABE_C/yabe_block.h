@@ -0,0 +1,165 @@
+#ifndef YABE_BLOCK_H
+#define YABE_BLOCK_H
+
+#include "yabe.h"
+
+/**
+   \page block_page Block compressed files
+
+   Compressing a whole file of YABE encoded data prevents reading a value
+   without decompressing everything before it. A block compressed file
+   instead splits the encoded stream into blocks of a fixed number of bytes
+   that are compressed independently with the codec of \ref lz_page.
+
+   \verbatim
+    'Y' 'A' 'B' 'Z' [blockSize32]
+    ([packedLen32] [byte]*)*
+    [offset64]* [rawSize64] [blocks32] [blockSize32] 'Y' 'A' 'B' 'Z' 'E' 'N' 'D' 0
+   \endverbatim
+
+   Each block holds blockSize bytes of the encoded stream, except the last
+   one which may be shorter. A block whose \e packedLen is the number of
+   bytes it holds is stored uncompressed. The footer holds the file offset of
+   each block, so a reader locates the block holding any byte of the encoded
+   stream without reading the other ones.
+
+   The reader maps the file in memory and decompresses only the blocks
+   holding the bytes requested with yabe_block_map(). Values may span block
+   boundaries, they are then copied into a contiguous buffer.
+
+   \code
+    yabe_block_reader_t reader;
+    yabe_cursor_t cursor;
+    if( !yabe_block_reader_open( &reader, "data.yabz" ) ) { ... }
+    if( yabe_block_map( &reader, offset, 64, &cursor ) ) { ... read values ... }
+    yabe_block_reader_close( &reader );
+   \endcode
+*/
+
+/// Default number of encoded bytes per block
+#define YABE_BLOCK_SIZE 65536
+
+/**
+ * \brief Block compressed file opened for writing
+ */
+typedef struct yabe_block_writer_t
+{
+    int fd;               ///< File descriptor of the file
+    uint32_t blockSize;   ///< Number of encoded bytes per block
+    char* block;          ///< Encoded bytes of the current block
+    size_t blockLen;      ///< Number of bytes in the current block
+    char* packed;         ///< Buffer receiving the compressed block
+    uint64_t fileSize;    ///< Number of bytes written to the file
+    uint64_t rawSize;     ///< Number of encoded bytes written
+    uint64_t* offsets;    ///< File offset of each block
+    size_t nBlocks;       ///< Number of blocks written
+    size_t capacity;      ///< Number of allocated offsets
+} yabe_block_writer_t;
+
+
+/**
+ * \brief Block compressed file opened for reading
+ */
+typedef struct yabe_block_reader_t
+{
+    const char* map;      ///< Memory mapping of the file
+    size_t mapSize;       ///< Number of bytes of the file
+    const char* offsets;  ///< Little endian block offsets in the footer
+    size_t nBlocks;       ///< Number of blocks
+    uint32_t blockSize;   ///< Number of encoded bytes per block
+    uint64_t rawSize;     ///< Number of encoded bytes in the file
+    char* cache;          ///< Decompressed bytes of the cached block
+    size_t cachedBlock;   ///< Index of the cached block, or SIZE_MAX
+    char* scratch;        ///< Buffer holding values spanning blocks
+    size_t scratchSize;   ///< Number of allocated bytes for scratch
+    bool mapped;          ///< True if the file is mapped by the reader
+} yabe_block_reader_t;
+
+
+/**
+ * \brief Create a block compressed file
+ *
+ * \param[out] writer Writer to initialize
+ * \param path Path of the file to create or truncate
+ * \param blockSize Number of encoded bytes per block, 0 selects
+ *                  YABE_BLOCK_SIZE
+ * \return true if the file could be created, false otherwise
+ */
+bool yabe_block_writer_open( yabe_block_writer_t* writer, const char* path,
+                             uint32_t blockSize );
+
+
+/**
+ * \brief Append YABE encoded bytes to the file and returns the number of
+ *  bytes appended
+ *
+ * The bytes are accumulated into the current block which is compressed and
+ * written to the file when full.
+ *
+ * \param[in,out] writer Writer opened by yabe_block_writer_open()
+ * \param data Pointer on the encoded bytes
+ * \param size Number of bytes to append
+ * \return the number of bytes appended, \e fail : < size on write error
+ */
+size_t yabe_block_write( yabe_block_writer_t* writer, const void* data, size_t size );
+
+
+/**
+ * \brief Write the last block and the footer, then close the file
+ *
+ * \param[in,out] writer Writer opened by yabe_block_writer_open()
+ * \return true if the file could be completed, false otherwise
+ */
+bool yabe_block_writer_close( yabe_block_writer_t* writer );
+
+
+/**
+ * \brief Open a block compressed file for reading
+ *
+ * \param[out] reader Reader to initialize
+ * \param path Path of the file
+ * \return true if the file could be mapped and has a valid footer
+ */
+bool yabe_block_reader_open( yabe_block_reader_t* reader, const char* path );
+
+
+/**
+ * \brief Check the header and the footer of a block compressed file in
+ *  memory
+ *
+ * \param[out] reader Reader to initialize
+ * \param data Pointer on the file bytes, they must outlive the reader
+ * \param size Number of bytes of the file
+ * \return true if the file has a valid footer, false otherwise
+ */
+bool yabe_block_reader_init( yabe_block_reader_t* reader, const char* data, size_t size );
+
+
+/**
+ * \brief Give access to size encoded bytes starting at offset and returns
+ *  the number of bytes accessible
+ *
+ * Only the blocks holding the requested bytes are decompressed. The cursor
+ * is valid until the next call to yabe_block_map() or
+ * yabe_block_reader_close().
+ *
+ * \param[in,out] reader Reader opened by yabe_block_reader_open()
+ * \param offset Offset of the first byte in the encoded stream
+ * \param size Number of bytes requested
+ * \param[out] cursor Reading cursor on the requested bytes
+ * \return the number of bytes accessible, smaller than size if the end of
+ *         stream is reached, \e fail : 0
+ */
+size_t yabe_block_map( yabe_block_reader_t* reader, uint64_t offset, size_t size,
+                       yabe_cursor_t* cursor );
+
+
+/**
+ * \brief Unmap the file if it was mapped by yabe_block_reader_open() and
+ *  release the reader resources
+ *
+ * \param[in,out] reader Reader opened by yabe_block_reader_open()
+ */
+void yabe_block_reader_close( yabe_block_reader_t* reader );
+
+#endif // YABE_BLOCK_H
@@ -0,0 +1,750 @@
+#include <stdlib.h>
+#include <limits.h>
+
+#include "yabe_canonical.h"
+#include "yabe_vector.h"
+#include "yabe_packed.h"
+#include "yabe_endian.h"
+
+
+/* Compare member identifiers as bytes, a prefix is before the longer keys */
+int yabe_compare_keys( const yabe_string_view_t* a, const yabe_string_view_t* b )
+{
+    const int cmp = memcmp( a->ptr, b->ptr, a->len < b->len ? a->len : b->len );
+    if( cmp )
+        return cmp;
+    return (a->len > b->len) - (a->len < b->len);
+}
+
+int yabe_compare_members( const void* a, const void* b )
+{
+    return yabe_compare_keys( &((const yabe_member_t*)a)->key,
+                              &((const yabe_member_t*)b)->key );
+}
+
+
+/* Sort members by identifier, return false if identifiers are duplicated */
+bool yabe_sort_members( yabe_member_t* members, long n )
+{
+    qsort( members, n, sizeof(yabe_member_t), yabe_compare_members );
+    for( long i = 1; i < n; ++i )
+        if( !yabe_compare_keys( &members[i-1].key, &members[i].key ) )
+            return false;
+    return true;
+}
+
+
+/* Read a string if its size is encoded in the smallest header */
+static bool yabe_canonical_string( yabe_cursor_t* c, yabe_string_view_t* view )
+{
+    const char* const start = c->ptr;
+    return yabe_read_string_view( c, view ) &&
+           (size_t)(c->ptr - start) == yabe_sizeof_string( view->len ) + view->len;
+}
+
+
+/* Read the mime type and the data of a blob */
+static bool yabe_read_blob_views( yabe_cursor_t* r, yabe_string_view_t* mime,
+                                  yabe_string_view_t* data )
+{
+    yabe_cursor_t c = *r;
+    if( !yabe_read_blob( &c ) )
+        return false;
+    yabe_read_none( &c );
+    if( yabe_end_of_buffer( &c ) || !yabe_read_string_view( &c, mime ) )
+        return false;
+    yabe_read_none( &c );
+    if( yabe_end_of_buffer( &c ) || !yabe_read_string_view( &c, data ) )
+        return false;
+    *r = c;
+    return true;
+}
+
+
+/* Return the number of items of the stream at cursor position, or -1 if it
+   is invalid */
+static long yabe_count_stream( yabe_cursor_t c )
+{
+    long n = 0;
+    for( ;; )
+    {
+        yabe_read_none( &c );
+        if( yabe_end_of_buffer( &c ) )
+            return -1;
+        if( yabe_read_end_stream( &c ) )
+            return n;
+        if( !yabe_skip_value( &c ) )
+            return -1;
+        ++n;
+    }
+}
+
+
+/* Check the value at cursor position is canonical and move the cursor after
+   it, return false otherwise */
+static bool yabe_check_value( yabe_cursor_t* c, unsigned depth )
+{
+    if( depth > YABE_MAX_DEPTH || yabe_end_of_buffer( c ) )
+        return false;
+    const char* const start = c->ptr;
+    int64_t code;
+    double flt;
+    bool flag;
+    int8_t nbr;
+    yabe_string_view_t view;
+
+    if( yabe_read_integer( c, &code ) )
+        return (size_t)(c->ptr - start) == yabe_sizeof_integer( code );
+    if( yabe_read_float( c, &flt ) )
+    {
+        // the float and its NaN payload must be the ones written
+        char bytes[9];
+        yabe_cursor_t tmp = { bytes, sizeof(bytes) };
+        const size_t len = yabe_put_float( &tmp, flt );
+        return (size_t)(c->ptr - start) == len && !memcmp( start, bytes, len );
+    }
+    if( yabe_read_bool( c, &flag ) || yabe_read_null( c ) )
+        return true;
+    if( yabe_peek_tag( c ) == yabe_none_tag )
+        return false;
+    if( yabe_read_blob( c ) )
+        return !yabe_end_of_buffer( c ) && yabe_canonical_string( c, &view ) &&
+               !yabe_end_of_buffer( c ) && yabe_canonical_string( c, &view );
+    if( yabe_canonical_string( c, &view ) )
+        return true;
+
+    // streams are checked up to their end tag, then must have 7 items or more
+    bool object = false, stream = false;
+    long n = LONG_MAX;
+    if( yabe_read_small_array( c, &nbr ) || (object = yabe_read_small_object( c, &nbr )) )
+        n = nbr;
+    else if( !(stream = yabe_read_array_stream( c ) || (object = yabe_read_object_stream( c ))) )
+        return false;
+
+    yabe_string_view_t prev = { NULL, 0 };
+    long i = 0;
+    for( ; i < n; ++i )
+    {
+        if( yabe_end_of_buffer( c ) )
+            return false;
+        if( stream && yabe_read_end_stream( c ) )
+            return i >= 7;
+        if( object )
+        {
+            if( !yabe_canonical_string( c, &view ) ||
+                (i > 0 && yabe_compare_keys( &prev, &view ) >= 0) )
+                return false;
+            prev = view;
+        }
+        if( !yabe_check_value( c, depth + 1 ) )
+            return false;
+    }
+    return true;
+}
+
+
+/* Return the number of bytes of the value if it is in canonical form */
+size_t yabe_is_canonical( const yabe_cursor_t* cursor )
+{
+    yabe_cursor_t c = *cursor;
+    return yabe_check_value( &c, 0 ) ? (size_t)(c.ptr - cursor->ptr) : 0;
+}
+
+
+/* Write the header of an array or object of n items */
+static size_t yabe_write_container( yabe_cursor_t* w, bool object, size_t n )
+{
+    if( n < 7 )
+        return object ? yabe_write_small_object( w, n ) : yabe_write_small_array( w, n );
+    return object ? yabe_write_object_stream( w ) : yabe_write_array_stream( w );
+}
+
+
+/* Read the header of a packed integer array and take its values from the
+   number of values left to expand, return false if it is invalid or there
+   are not enough left */
+static bool yabe_read_packed_bounded( yabe_cursor_t* r, yabe_packed_iter_t* iter,
+                                      uint64_t* budget )
+{
+    if( !yabe_read_packed( r, iter ) || iter->count > *budget )
+        return false;
+    *budget -= iter->count;
+    return true;
+}
+
+
+/* Number of packed values which may be expanded for an input of len bytes */
+static uint64_t yabe_expansion_budget( size_t len )
+{
+    return (len > UINT64_MAX / YABE_CANONICAL_MAX_EXPANSION) ? UINT64_MAX :
+           (uint64_t)len * YABE_CANONICAL_MAX_EXPANSION;
+}
+
+
+/* Write a packed integer array as a plain array */
+static bool yabe_canonical_packed( yabe_cursor_t* r, yabe_cursor_t* w, uint64_t* budget )
+{
+    yabe_packed_iter_t iter;
+    int64_t value;
+    if( !yabe_read_packed_bounded( r, &iter, budget ) ||
+        !yabe_write_container( w, false, iter.count ) )
+        return false;
+    while( yabe_packed_next( &iter, &value ) )
+        if( !yabe_write_integer( w, value ) )
+            return false;
+    return iter.count < 7 || yabe_write_end_stream( w );
+}
+
+
+/* Read the header and locate the members of an object, return the number of
+   members or -1 if it is invalid. Up to YABE_SMALL_MEMBERS members are stored
+   in small, more in an array allocated with malloc() */
+long yabe_read_members( yabe_cursor_t* r, yabe_member_t* small, yabe_member_t** members )
+{
+    int8_t nbr;
+    long n;
+    const bool stream = !yabe_read_small_object( r, &nbr );
+    if( !stream )
+        n = nbr;
+    else if( !yabe_read_object_stream( r ) || (n = yabe_count_stream( *r )) < 0 || (n & 1) )
+        return -1;
+    else
+        n /= 2;
+
+    *members = (n <= YABE_SMALL_MEMBERS) ? small : malloc( n * sizeof(yabe_member_t) );
+    if( !*members )
+        return -1;
+    bool res = true;
+    for( long i = 0; i < n && res; ++i )
+    {
+        yabe_member_t* const m = &(*members)[i];
+        yabe_read_none( r );
+        res = !yabe_end_of_buffer( r ) && yabe_read_string_view( r, &m->key );
+        yabe_read_none( r );
+        m->value.ptr = r->ptr;
+        m->used = false;
+        res = res && !yabe_end_of_buffer( r ) && (m->value.len = yabe_skip_value( r )) != 0;
+    }
+    if( res && stream )
+    {
+        yabe_read_none( r );
+        res = !yabe_end_of_buffer( r ) && yabe_read_end_stream( r );
+    }
+    if( res )
+        return n;
+    if( *members != small )
+        free( *members );
+    return -1;
+}
+
+
+static bool yabe_canonical_value( yabe_cursor_t* r, yabe_cursor_t* w, unsigned depth,
+                                  uint64_t* budget );
+
+/* Write the object members sorted by identifier */
+static bool yabe_canonical_members( yabe_member_t* members, long n, yabe_cursor_t* w,
+                                    unsigned depth, uint64_t* budget )
+{
+    if( !yabe_sort_members( members, n ) || !yabe_write_container( w, true, n ) )
+        return false;
+    for( long i = 0; i < n; ++i )
+        if( !yabe_write_string( w, members[i].key.len ) ||
+            yabe_write_data( w, members[i].key.ptr, members[i].key.len ) != members[i].key.len ||
+            !yabe_canonical_value( &members[i].value, w, depth + 1, budget ) )
+            return false;
+    return n < 7 || yabe_write_end_stream( w );
+}
+
+
+/* Write the canonical encoding of the value at r position, return false if
+   it is invalid, expands too many packed values or w is full */
+static bool yabe_canonical_value( yabe_cursor_t* r, yabe_cursor_t* w, unsigned depth,
+                                  uint64_t* budget )
+{
+    if( depth > YABE_MAX_DEPTH )
+        return false;
+    yabe_read_none( r );
+    if( yabe_end_of_buffer( r ) )
+        return false;
+
+    int64_t code;
+    double flt;
+    bool flag;
+    int8_t nbr;
+    yabe_string_view_t view, mime;
+    if( yabe_read_integer( r, &code ) )
+        return yabe_write_integer( w, code );
+    if( yabe_read_float( r, &flt ) )
+        return yabe_write_float( w, flt );
+    if( yabe_read_bool( r, &flag ) )
+        return yabe_write_bool( w, flag );
+    if( yabe_read_null( r ) )
+        return yabe_write_null( w );
+    if( yabe_read_string_view( r, &view ) )
+        return yabe_write_string( w, view.len ) &&
+               yabe_write_data( w, view.ptr, view.len ) == view.len;
+
+    yabe_cursor_t c = *r;
+    if( yabe_read_blob( &c ) )
+    {
+        yabe_read_none( &c );
+        if( yabe_end_of_buffer( &c ) )
+            return false;
+        if( yabe_read_integer( &c, &code ) )
+            return yabe_canonical_packed( r, w, budget );
+        return yabe_read_blob_views( r, &mime, &view ) &&
+               yabe_write_blob( w ) &&
+               yabe_write_string( w, mime.len ) &&
+               yabe_write_data( w, mime.ptr, mime.len ) == mime.len &&
+               yabe_write_string( w, view.len ) &&
+               yabe_write_data( w, view.ptr, view.len ) == view.len;
+    }
+
+    const int8_t tag = yabe_peek_tag( r );
+    if( tag >= yabe_sobject_tag && tag <= yabe_objects_tag )
+    {
+        // locate the members, then write them in identifier order
+        yabe_member_t small[YABE_SMALL_MEMBERS], *members;
+        const long n = yabe_read_members( r, small, &members );
+        if( n < 0 )
+            return false;
+        const bool res = yabe_canonical_members( members, n, w, depth, budget );
+        if( members != small )
+            free( members );
+        return res;
+    }
+
+    bool stream = false;
+    long n;
+    if( yabe_read_small_array( r, &nbr ) )
+        n = nbr;
+    else if( (stream = yabe_read_array_stream( r )) )
+    {
+        if( (n = yabe_count_stream( *r )) < 0 )
+            return false;
+    }
+    else
+        return false;
+
+    if( !yabe_write_container( w, false, n ) )
+        return false;
+    for( long i = 0; i < n; ++i )
+        if( !yabe_canonical_value( r, w, depth + 1, budget ) )
+            return false;
+    if( n >= 7 && !yabe_write_end_stream( w ) )
+        return false;
+    if( stream )
+    {
+        yabe_read_none( r );
+        if( yabe_end_of_buffer( r ) || !yabe_read_end_stream( r ) )
+            return false;
+    }
+    return true;
+}
+
+
+/* Write the canonical encoding of the value, copied if already canonical */
+size_t yabe_canonicalize( yabe_cursor_t* in, yabe_cursor_t* out )
+{
+    yabe_cursor_t r = *in, w = *out;
+    yabe_read_none( &r );
+    uint64_t budget = yabe_expansion_budget( r.len );
+    const size_t size = yabe_is_canonical( &r );
+    if( size )
+    {
+        if( yabe_write_data( &w, r.ptr, size ) != size )
+            return 0;
+        r.ptr += size;
+        r.len -= size;
+    }
+    else if( !yabe_canonical_value( &r, &w, 0, &budget ) )
+        return 0;
+    *in = r;
+    const size_t len = w.ptr - out->ptr;
+    *out = w;
+    return len;
+}
+
+
+/* Kinds of values, the encoding variants of a value have the same kind */
+enum
+{
+    yabe_kind_invalid, yabe_kind_null, yabe_kind_false, yabe_kind_true,
+    yabe_kind_integer, yabe_kind_float, yabe_kind_string, yabe_kind_blob,
+    yabe_kind_array, yabe_kind_object
+};
+
+
+/* Return the kind of the value at cursor position, packed integer arrays
+   are arrays */
+static int yabe_value_kind( const yabe_cursor_t* c, bool* packed )
+{
+    if( yabe_end_of_buffer( c ) )
+        return yabe_kind_invalid;
+    const uint8_t tag = (uint8_t)c->ptr[0];
+    *packed = false;
+    if( tag < 0x80 || tag >= 0xE0 || (tag >= 0xC1 && tag <= 0xC3) )
+        return yabe_kind_integer;
+    if( tag < 0xC0 || tag >= 0xCD )
+        return (tag < 0xD0) ? yabe_kind_string : (tag < 0xD8) ? yabe_kind_array : yabe_kind_object;
+    switch( tag )
+    {
+    case 0xC0: return yabe_kind_null;
+    case 0xC8: return yabe_kind_false;
+    case 0xC9: return yabe_kind_true;
+    case 0xCA:
+    {
+        // a packed array has an integer where a blob has its mime type
+        const uint8_t next = (c->len > 1) ? (uint8_t)c->ptr[1] : 0xCC;
+        *packed = next < 0x80 || next >= 0xE0 || (next >= 0xC1 && next <= 0xC3);
+        return *packed ? yabe_kind_array : yabe_kind_blob;
+    }
+    case 0xCB: case 0xCC: return yabe_kind_invalid;
+    }
+    return yabe_kind_float;
+}
+
+
+/* Read a float, NaN and the 0 of both signs have a single value */
+static bool yabe_read_float_value( yabe_cursor_t* c, uint64_t* bits )
+{
+    double flt;
+    if( !yabe_read_float( c, &flt ) )
+        return false;
+    *bits = (flt != flt) ? 0x7FF8000000000000ULL : (flt == 0) ? 0 : yabe_double_bits( flt );
+    return true;
+}
+
+
+/* Items of an array, plain or packed */
+typedef struct yabe_items_t
+{
+    yabe_cursor_t* cursor;      // cursor on the plain items
+    yabe_packed_iter_t iter;    // values of a packed array
+    bool packed;                // true if the array is packed
+    bool stream;                // true if the plain items end with an end tag
+    long left;                  // number of items left in a small array
+} yabe_items_t;
+
+
+/* Read the header of an array, the values of a packed array are taken from
+   budget */
+static bool yabe_items_open( yabe_items_t* items, yabe_cursor_t* r, bool packed,
+                             uint64_t* budget )
+{
+    int8_t nbr;
+    items->cursor = r;
+    items->packed = packed;
+    items->stream = false;
+    items->left = 0;
+    if( packed )
+        return yabe_read_packed_bounded( r, &items->iter, budget );
+    if( yabe_read_small_array( r, &nbr ) )
+        items->left = nbr;
+    else if( !(items->stream = yabe_read_array_stream( r )) )
+        return false;
+    return true;
+}
+
+
+/* Return 1 and read the end tag at the end of the items, 0 if there are
+   more items, -1 if the array is invalid */
+static int yabe_items_end( yabe_items_t* items )
+{
+    if( items->packed )
+        return items->iter.index == items->iter.count;
+    if( !items->stream )
+        return items->left-- == 0;
+    yabe_read_none( items->cursor );
+    if( yabe_end_of_buffer( items->cursor ) )
+        return -1;
+    return yabe_read_end_stream( items->cursor ) ? 1 : 0;
+}
+
+
+/* Read an integer item, return false if the item is not an integer */
+static bool yabe_items_integer( yabe_items_t* items, int64_t* value )
+{
+    if( items->packed )
+        return yabe_packed_next( &items->iter, value );
+    yabe_read_none( items->cursor );
+    return !yabe_end_of_buffer( items->cursor ) && yabe_read_integer( items->cursor, value );
+}
+
+
+/// @cond DEV
+#define YABE_HASH_P1 0x9E3779B185EBCA87ULL
+#define YABE_HASH_P2 0xC2B2AE3D27D4EB4FULL
+#define YABE_HASH_P3 0x165667B19E3779F9ULL
+#define YABE_HASH_P4 0x85EBCA77C2B2AE63ULL
+#define YABE_HASH_P5 0x27D4EB2F165667C5ULL
+/// @endcond
+
+static inline uint64_t yabe_rotl( uint64_t x, int r )
+    { return (x << r) | (x >> (64 - r)); }
+
+static inline uint64_t yabe_hash_round( uint64_t acc, uint64_t input )
+    { return yabe_rotl( acc + input * YABE_HASH_P2, 31 ) * YABE_HASH_P1; }
+
+static inline uint64_t yabe_hash_merge( uint64_t acc, uint64_t lane )
+    { return (acc ^ yabe_hash_round( 0, lane )) * YABE_HASH_P1 + YABE_HASH_P4; }
+
+/* Final avalanche of a hash */
+static inline uint64_t yabe_hash_mix( uint64_t h )
+{
+    h ^= h >> 33;
+    h *= YABE_HASH_P2;
+    h ^= h >> 29;
+    h *= YABE_HASH_P3;
+    return h ^ (h >> 32);
+}
+
+/* Hash of a scalar of the given kind */
+static inline uint64_t yabe_hash_scalar( int kind, uint64_t value )
+    { return yabe_hash_mix( value * YABE_HASH_P1 + (uint64_t)kind * YABE_HASH_P5 ); }
+
+
+/* Hash the bytes of a string or blob. Four independent lanes consume 32
+   bytes per iteration, their multiplications overlap in the pipeline. This
+   is the xxHash64 algorithm */
+static uint64_t yabe_hash_bytes( const char* p, size_t len, uint64_t seed )
+{
+    const char* const end = p + len;
+    uint64_t h;
+    if( len >= 32 )
+    {
+        uint64_t v1 = seed + YABE_HASH_P1 + YABE_HASH_P2, v2 = seed + YABE_HASH_P2;
+        uint64_t v3 = seed, v4 = seed - YABE_HASH_P1;
+        for( ; end - p >= 32; p += 32 )
+        {
+            v1 = yabe_hash_round( v1, yabe_load_le64( p ) );
+            v2 = yabe_hash_round( v2, yabe_load_le64( p + 8 ) );
+            v3 = yabe_hash_round( v3, yabe_load_le64( p + 16 ) );
+            v4 = yabe_hash_round( v4, yabe_load_le64( p + 24 ) );
+        }
+        h = yabe_rotl( v1, 1 ) + yabe_rotl( v2, 7 ) + yabe_rotl( v3, 12 ) + yabe_rotl( v4, 18 );
+        h = yabe_hash_merge( h, v1 );
+        h = yabe_hash_merge( h, v2 );
+        h = yabe_hash_merge( h, v3 );
+        h = yabe_hash_merge( h, v4 );
+    }
+    else
+        h = seed + YABE_HASH_P5;
+    h += len;
+    for( ; end - p >= 8; p += 8 )
+        h = yabe_rotl( h ^ yabe_hash_round( 0, yabe_load_le64( p ) ), 27 ) * YABE_HASH_P1 +
+            YABE_HASH_P4;
+    if( end - p >= 4 )
+    {
+        h = yabe_rotl( h ^ (yabe_load_le32( p ) * YABE_HASH_P1), 23 ) * YABE_HASH_P2 +
+            YABE_HASH_P3;
+        p += 4;
+    }
+    for( ; p < end; ++p )
+        h = yabe_rotl( h ^ ((uint8_t)*p * YABE_HASH_P5), 11 ) * YABE_HASH_P1;
+    return yabe_hash_mix( h );
+}
+
+
+/* Hash the value at r position and move r after it */
+static bool yabe_hash( yabe_cursor_t* r, uint64_t* hash, unsigned depth, uint64_t* budget )
+{
+    if( depth > YABE_MAX_DEPTH )
+        return false;
+    yabe_read_none( r );
+    bool packed;
+    const int kind = yabe_value_kind( r, &packed );
+    int64_t code;
+    uint64_t bits;
+    yabe_string_view_t view, mime;
+    switch( kind )
+    {
+    case yabe_kind_null: case yabe_kind_false: case yabe_kind_true:
+        *hash = yabe_hash_scalar( kind, 0 );
+        return yabe_skip_tag( r );
+    case yabe_kind_integer:
+        if( !yabe_read_integer( r, &code ) )
+            return false;
+        *hash = yabe_hash_scalar( kind, (uint64_t)code );
+        return true;
+    case yabe_kind_float:
+        if( !yabe_read_float_value( r, &bits ) )
+            return false;
+        *hash = yabe_hash_scalar( kind, bits );
+        return true;
+    case yabe_kind_string:
+        if( !yabe_read_string_view( r, &view ) )
+            return false;
+        *hash = yabe_hash_bytes( view.ptr, view.len, kind );
+        return true;
+    case yabe_kind_blob:
+        if( !yabe_read_blob_views( r, &mime, &view ) )
+            return false;
+        *hash = yabe_hash_bytes( view.ptr, view.len, yabe_hash_bytes( mime.ptr, mime.len, kind ) );
+        return true;
+    case yabe_kind_array:
+    {
+        // ordered combination of the item hashes
+        yabe_items_t items;
+        if( !yabe_items_open( &items, r, packed, budget ) )
+            return false;
+        uint64_t h = yabe_hash_scalar( kind, 0 ), item, n = 0;
+        for( int end; !(end = yabe_items_end( &items )); ++n )
+        {
+            if( end < 0 )
+                return false;
+            if( packed )
+            {
+                yabe_packed_next( &items.iter, &code );
+                item = yabe_hash_scalar( yabe_kind_integer, (uint64_t)code );
+            }
+            else if( !yabe_hash( r, &item, depth + 1, budget ) )
+                return false;
+            h = yabe_hash_round( h, item );
+        }
+        *hash = yabe_hash_mix( h + n );
+        return true;
+    }
+    case yabe_kind_object:
+    {
+        // the sum of the member hashes doesn't depend on their order
+        int8_t nbr = -1;
+        uint64_t h = 0, key, value, n = 0;
+        if( !yabe_read_small_object( r, &nbr ) && !yabe_read_object_stream( r ) )
+            return false;
+        for( ;; ++n )
+        {
+            if( nbr >= 0 && nbr-- == 0 )
+                break;
+            yabe_read_none( r );
+            if( yabe_end_of_buffer( r ) )
+                return false;
+            if( nbr < 0 && yabe_read_end_stream( r ) )
+                break;
+            if( !yabe_read_string_view( r, &view ) || !yabe_hash( r, &value, depth + 1, budget ) )
+                return false;
+            key = yabe_hash_bytes( view.ptr, view.len, yabe_kind_string );
+            h += yabe_hash_mix( yabe_hash_round( key, value ) );
+        }
+        *hash = yabe_hash_mix( h + yabe_hash_scalar( kind, n ) );
+        return true;
+    }
+    }
+    return false;
+}
+
+
+/* Hash the value at cursor position */
+size_t yabe_hash_value( yabe_cursor_t* cursor, uint64_t* hash )
+{
+    yabe_cursor_t c = *cursor;
+    uint64_t budget = yabe_expansion_budget( cursor->len );
+    if( !yabe_hash( &c, hash, 0, &budget ) )
+        return 0;
+    const size_t len = c.ptr - cursor->ptr;
+    *cursor = c;
+    return len;
+}
+
+
+static bool yabe_equal( yabe_cursor_t* a, yabe_cursor_t* b, unsigned depth, uint64_t* budget );
+
+/* Compare two arrays item by item, a packed array equals a plain array of
+   the same integers */
+static bool yabe_equal_arrays( yabe_cursor_t* a, bool aPacked, yabe_cursor_t* b, bool bPacked,
+                               unsigned depth, uint64_t* budget )
+{
+    yabe_items_t ia, ib;
+    if( !yabe_items_open( &ia, a, aPacked, budget ) || !yabe_items_open( &ib, b, bPacked, budget ) )
+        return false;
+    for( ;; )
+    {
+        const int endA = yabe_items_end( &ia ), endB = yabe_items_end( &ib );
+        if( endA < 0 || endB < 0 || endA != endB )
+            return false;
+        if( endA )
+            return true;
+        if( aPacked || bPacked )
+        {
+            int64_t va, vb;
+            if( !yabe_items_integer( &ia, &va ) || !yabe_items_integer( &ib, &vb ) || va != vb )
+                return false;
+        }
+        else if( !yabe_equal( a, b, depth + 1, budget ) )
+            return false;
+    }
+}
+
+
+/* Compare two objects, their members are sorted by identifier */
+static bool yabe_equal_objects( yabe_cursor_t* a, yabe_cursor_t* b, unsigned depth,
+                                uint64_t* budget )
+{
+    yabe_member_t smallA[YABE_SMALL_MEMBERS], smallB[YABE_SMALL_MEMBERS], *ma, *mb;
+    const long na = yabe_read_members( a, smallA, &ma );
+    if( na < 0 )
+        return false;
+    const long nb = yabe_read_members( b, smallB, &mb );
+    bool res = na == nb;
+    if( res )
+    {
+        qsort( ma, na, sizeof(yabe_member_t), yabe_compare_members );
+        qsort( mb, nb, sizeof(yabe_member_t), yabe_compare_members );
+        for( long i = 0; i < na && res; ++i )
+            res = !yabe_compare_keys( &ma[i].key, &mb[i].key ) &&
+                  yabe_equal( &ma[i].value, &mb[i].value, depth + 1, budget );
+    }
+    if( ma != smallA )
+        free( ma );
+    if( nb >= 0 && mb != smallB )
+        free( mb );
+    return res;
+}
+
+
+/* Compare the values at a and b positions and move the cursors after them */
+static bool yabe_equal( yabe_cursor_t* a, yabe_cursor_t* b, unsigned depth, uint64_t* budget )
+{
+    if( depth > YABE_MAX_DEPTH )
+        return false;
+    yabe_read_none( a );
+    yabe_read_none( b );
+    bool aPacked, bPacked;
+    const int kind = yabe_value_kind( a, &aPacked );
+    if( kind != yabe_value_kind( b, &bPacked ) )
+        return false;
+    int64_t ia, ib;
+    uint64_t fa, fb;
+    yabe_string_view_t va, vb, ma, mb;
+    switch( kind )
+    {
+    case yabe_kind_null: case yabe_kind_false: case yabe_kind_true:
+        return yabe_skip_tag( a ) && yabe_skip_tag( b );
+    case yabe_kind_integer:
+        return yabe_read_integer( a, &ia ) && yabe_read_integer( b, &ib ) && ia == ib;
+    case yabe_kind_float:
+        return yabe_read_float_value( a, &fa ) && yabe_read_float_value( b, &fb ) && fa == fb;
+    case yabe_kind_string:
+        return yabe_read_string_view( a, &va ) && yabe_read_string_view( b, &vb ) &&
+               va.len == vb.len && !memcmp( va.ptr, vb.ptr, va.len );
+    case yabe_kind_blob:
+        return yabe_read_blob_views( a, &ma, &va ) && yabe_read_blob_views( b, &mb, &vb ) &&
+               ma.len == mb.len && !memcmp( ma.ptr, mb.ptr, ma.len ) &&
+               va.len == vb.len && !memcmp( va.ptr, vb.ptr, va.len );
+    case yabe_kind_array:
+        return yabe_equal_arrays( a, aPacked, b, bPacked, depth, budget );
+    case yabe_kind_object:
+        return yabe_equal_objects( a, b, depth, budget );
+    }
+    return false;
+}
+
+
+/* Compare the values at cursor positions */
+bool yabe_equal_values( const yabe_cursor_t* a, const yabe_cursor_t* b )
+{
+    yabe_cursor_t ca = *a, cb = *b;
+    uint64_t budget = yabe_expansion_budget( a->len > SIZE_MAX - b->len ? SIZE_MAX :
+                                             a->len + b->len );
+    return yabe_equal( &ca, &cb, 0, &budget );
+}
@@ -0,0 +1,179 @@
+#ifndef YABE_CANONICAL_H
+#define YABE_CANONICAL_H
+
+#include "yabe.h"
+
+/**
+   \page canonical_page Canonical encoding
+
+   The same value may be encoded in different ways : an array of 3 items as a
+   small array or as an array stream, object members in any order, with or
+   without \e none padding, and packed integer arrays as plain arrays. To
+   hash or deduplicate encoded documents, each value has one canonical
+   encoding :
+
+    <ul>
+    <li> integers, floating point values and string sizes use the smallest
+         encoding, the one written by yabe_write_integer(), yabe_write_float()
+         and yabe_write_string() ; NaN is the flt16 value 0x7D00 and 0. of
+         any sign is \e flt0 ;
+    <li> arrays and objects of up to 6 items are small arrays and objects,
+         larger ones are streams ;
+    <li> object members are sorted by increasing identifier, compared as
+         bytes, a shorter identifier before the longer ones it starts ;
+         identifiers are unique ;
+    <li> packed integer arrays are plain arrays of integers ;
+    <li> there is no \e none value.
+    </ul>
+
+   The scalar writers always produce the canonical encoding. An application
+   writing its objects with sorted members, small containers when possible
+   and no \e none writes canonical data directly. Otherwise,
+   yabe_canonicalize() transforms any encoded value into its canonical form
+   without decoding it into objects. When its input is already canonical, it
+   is only checked and copied.
+
+   Two values are equal when their canonical encodings are identical.
+   yabe_equal_values() compares two encoded values and yabe_hash_value()
+   hashes one, both by reading the encoded bytes directly : integers are
+   compared by value, arrays item by item whatever their encoding and
+   objects member by member whatever their order. Strings and blobs are
+   hashed with four independent 64 bit lanes consuming 32 bytes per step.
+   Equal values have the same hash.
+
+   A packed integer array of a few bytes may hold billions of values. To
+   bound their work, yabe_canonicalize(), yabe_hash_value() and
+   yabe_equal_values() fail when the packed arrays of their input hold more
+   than #YABE_CANONICAL_MAX_EXPANSION values per byte of the input buffers.
+
+   \code
+    if( !yabe_read_signature( &rCur ) ) { ... }
+    if( !yabe_canonicalize( &rCur, &wCur ) ) { ... invalid or out too small ... }
+    hash( wCurInit.ptr, wCur.ptr - wCurInit.ptr );
+   \endcode
+*/
+
+
+/// Maximum number of packed integer values expanded per input byte
+#define YABE_CANONICAL_MAX_EXPANSION 64
+
+
+/**
+ * \brief Return the number of bytes of the value at cursor position if it
+ *  is in canonical form
+ *
+ * \param cursor Pointer on buffer where to read the value, left unchanged
+ * \return the number of bytes of the value, \e fail : 0 if the value is
+ *         invalid or not in canonical form
+ */
+size_t yabe_is_canonical( const yabe_cursor_t* cursor );
+
+
+/**
+ * \brief Tries writing the canonical encoding of the value at in position
+ *  and returns the number of bytes written
+ *
+ * \e none values preceding the value are skipped. The value must not contain
+ * an object with duplicate member identifiers.
+ *
+ * \param[in,out] in Pointer on buffer where to read the value, the cursor is
+ *                   updated if the value could be written
+ * \param[in,out] out Pointer on buffer info where to write the canonical
+ *                    value, updated if the value could be written
+ * \return the number of bytes written, \e fail : 0 if the value is invalid,
+ *         has duplicate member identifiers, its packed arrays hold more than
+ *         #YABE_CANONICAL_MAX_EXPANSION values per byte of in or out is too
+ *         small
+ */
+size_t yabe_canonicalize( yabe_cursor_t* in, yabe_cursor_t* out );
+
+
+/**
+ * \brief Hash the value at cursor position and returns the number of bytes
+ *  read
+ *
+ * The hash is the same for all the encodings of equal values, as defined by
+ * yabe_equal_values().
+ *
+ * \param[in,out] cursor Pointer on buffer where to read the value, the
+ *                       cursor is updated if the value could be read
+ * \param[out] hash 64 bit hash of the value
+ * \return the number of bytes read, \e fail : 0 if the value is invalid or
+ *         its packed arrays hold more than #YABE_CANONICAL_MAX_EXPANSION
+ *         values per byte of cursor
+ */
+size_t yabe_hash_value( yabe_cursor_t* cursor, uint64_t* hash );
+
+
+/**
+ * \brief Return true if the values at cursor positions are equal
+ *
+ * The values are equal if they have the same canonical encoding. Object
+ * members are located and sorted by identifier, in memory allocated with
+ * malloc() for objects of more than 6 members.
+ *
+ * \param a Pointer on buffer where to read the first value, left unchanged
+ * \param b Pointer on buffer where to read the second value, left unchanged
+ * \return true if the values are equal, false if they differ, one of them
+ *         is invalid or their packed arrays hold more than
+ *         #YABE_CANONICAL_MAX_EXPANSION values per byte of a and b
+ */
+bool yabe_equal_values( const yabe_cursor_t* a, const yabe_cursor_t* b );
+
+
+/// @cond DEV
+/// Number of object members located without allocation by yabe_read_members()
+#define YABE_SMALL_MEMBERS 6
+
+/* Member of an object, the value cursor covers exactly its bytes */
+typedef struct yabe_member_t
+{
+    yabe_string_view_t key;   // member identifier
+    yabe_cursor_t value;      // cursor on the member value
+    bool used;                // free for the callers, false once read
+} yabe_member_t;
+
+
+/**
+ * \brief Compare member identifiers as bytes, a prefix is before the longer
+ *  identifiers it starts
+ *
+ * \return a negative value, 0 or a positive value if a is before, equal to
+ *         or after b
+ */
+int yabe_compare_keys( const yabe_string_view_t* a, const yabe_string_view_t* b );
+
+
+/**
+ * \brief Compare the identifiers of two yabe_member_t, for qsort() and
+ *  bsearch()
+ */
+int yabe_compare_members( const void* a, const void* b );
+
+
+/**
+ * \brief Sort members by identifier
+ *
+ * \return false if two members have the same identifier
+ */
+bool yabe_sort_members( yabe_member_t* members, long n );
+
+
+/**
+ * \brief Read the header and locate the members of the object at cursor
+ *  position
+ *
+ * Up to YABE_SMALL_MEMBERS members are stored in small, more in an array
+ * allocated with malloc() to be freed by the caller when it isn't small.
+ *
+ * \param[in,out] r Pointer on buffer where to read the object, the cursor is
+ *                  moved after it if it is valid
+ * \param small Array of YABE_SMALL_MEMBERS members
+ * \param[out] members small or the allocated array of members
+ * \return the number of members, \e fail : -1 if the object is invalid or
+ *         the allocation failed, nothing is left to free
+ */
+long yabe_read_members( yabe_cursor_t* r, yabe_member_t* small, yabe_member_t** members );
+/// @endcond
+
+#endif // YABE_CANONICAL_H
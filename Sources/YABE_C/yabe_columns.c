@@ -0,0 +1,182 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "yabe_columns.h"
+
+
+/* Clear the value of the row and set or clear its null bit */
+static void yabe_column_set_null( yabe_column_t* column, size_t row, bool isNull )
+{
+    const uint8_t bit = (uint8_t)(1 << (row & 7));
+    if( isNull )
+        column->nulls[row >> 3] |= bit;
+    else
+        column->nulls[row >> 3] &= (uint8_t)~bit;
+}
+
+
+/* Store the value at cursor position in the row if it has the column type,
+   the cursor is left unchanged */
+static void yabe_column_store( yabe_column_t* column, size_t row, const yabe_cursor_t* cursor )
+{
+    yabe_cursor_t c = *cursor;
+    int64_t intValue;
+    bool stored = false;
+    switch( column->type )
+    {
+    case yabe_column_int64:
+        stored = yabe_read_integer( &c, &((int64_t*)column->values)[row] );
+        break;
+    case yabe_column_double:
+        if( yabe_read_integer( &c, &intValue ) )
+        {
+            ((double*)column->values)[row] = (double)intValue;
+            stored = true;
+        }
+        else
+            stored = yabe_read_float( &c, &((double*)column->values)[row] );
+        break;
+    case yabe_column_string:
+        stored = yabe_read_string_view( &c, &((yabe_string_view_t*)column->values)[row] );
+        break;
+    }
+    if( stored )
+        yabe_column_set_null( column, row, false );
+}
+
+
+/* Return the length of the key if the first component of path is key, or 0 */
+static size_t yabe_path_match( const char* path, const yabe_string_view_t* key )
+{
+    // a key holding a nul byte can't match, path ends before its length
+    if( key->len == 0 || strnlen( path, key->len ) < key->len || memcmp( path, key->ptr, key->len ) ||
+        (path[key->len] != '.' && path[key->len] != '\0') )
+        return 0;
+    return key->len;
+}
+
+
+/* Store the members of the object at cursor position matching the remaining
+   key paths of the active columns, and return the number of bytes read */
+static size_t yabe_shred_object( yabe_cursor_t* cursor, yabe_column_t* columns,
+                                 size_t nColumns, const char** paths,
+                                 uint64_t active, size_t row )
+{
+    yabe_cursor_t c = *cursor;
+    yabe_read_none( &c );
+    if( yabe_end_of_buffer( &c ) )
+        return 0;
+
+    int8_t nbr = -1;
+    if( !yabe_read_small_object( &c, &nbr ) && !yabe_read_object_stream( &c ) )
+    {
+        // not an object, leave the columns null
+        if( !yabe_skip_value( &c ) )
+            return 0;
+        const size_t len = c.ptr - cursor->ptr;
+        *cursor = c;
+        return len;
+    }
+
+    const char* subPaths[YABE_MAX_COLUMNS];
+    while( nbr != 0 )
+    {
+        yabe_read_none( &c );
+        if( yabe_end_of_buffer( &c ) )
+            return 0;
+        if( nbr < 0 && yabe_read_end_stream( &c ) )
+            break;
+
+        yabe_string_view_t key;
+        if( !yabe_read_string_view( &c, &key ) )
+            return 0;
+        yabe_read_none( &c );
+        if( yabe_end_of_buffer( &c ) )
+            return 0;
+
+        // select the columns whose path continues with this key
+        uint64_t inner = 0;
+        for( size_t i = 0; i < nColumns; ++i )
+        {
+            size_t len;
+            if( !(active & (1ULL << i)) || !(len = yabe_path_match( paths[i], &key )) )
+                continue;
+            if( paths[i][len] == '\0' )
+                yabe_column_store( &columns[i], row, &c );
+            else
+            {
+                subPaths[i] = paths[i] + len + 1;
+                inner |= 1ULL << i;
+            }
+        }
+
+        if( inner ? !yabe_shred_object( &c, columns, nColumns, subPaths, inner, row )
+                  : !yabe_skip_value( &c ) )
+            return 0;
+        if( nbr > 0 )
+            --nbr;
+    }
+    const size_t len = c.ptr - cursor->ptr;
+    *cursor = c;
+    return len;
+}
+
+
+/* Extract the members of one object into the row of the columns */
+size_t yabe_shred_item( yabe_cursor_t* cursor, yabe_column_t* columns, size_t nColumns,
+                        size_t row )
+{
+    assert( nColumns <= YABE_MAX_COLUMNS );
+    const char* paths[YABE_MAX_COLUMNS];
+    for( size_t i = 0; i < nColumns; ++i )
+    {
+        paths[i] = columns[i].path;
+        switch( columns[i].type )
+        {
+        case yabe_column_int64: ((int64_t*)columns[i].values)[row] = 0; break;
+        case yabe_column_double: ((double*)columns[i].values)[row] = 0.; break;
+        case yabe_column_string:
+        {
+            yabe_string_view_t empty = { NULL, 0 };
+            ((yabe_string_view_t*)columns[i].values)[row] = empty;
+            break;
+        }
+        }
+        yabe_column_set_null( &columns[i], row, true );
+    }
+    const uint64_t all = nColumns == 64 ? ~0ULL : (1ULL << nColumns) - 1;
+    return yabe_shred_object( cursor, columns, nColumns, paths, all, row );
+}
+
+
+/* Extract the members of an array of objects into columns */
+size_t yabe_shred( yabe_cursor_t* cursor, yabe_column_t* columns, size_t nColumns,
+                   size_t maxRows, size_t* nRows )
+{
+    yabe_cursor_t c = *cursor;
+    yabe_read_none( &c );
+    if( yabe_end_of_buffer( &c ) )
+        return 0;
+
+    int8_t nbr = -1;
+    if( !yabe_read_small_array( &c, &nbr ) && !yabe_read_array_stream( &c ) )
+        return 0;
+
+    size_t row = 0;
+    while( nbr != 0 )
+    {
+        yabe_read_none( &c );
+        if( yabe_end_of_buffer( &c ) )
+            return 0;
+        if( nbr < 0 && yabe_read_end_stream( &c ) )
+            break;
+        if( row == maxRows || !yabe_shred_item( &c, columns, nColumns, row ) )
+            return 0;
+        ++row;
+        if( nbr > 0 )
+            --nbr;
+    }
+    *nRows = row;
+    const size_t len = c.ptr - cursor->ptr;
+    *cursor = c;
+    return len;
+}
@@ -0,0 +1,105 @@
+#ifndef YABE_COLUMNS_H
+#define YABE_COLUMNS_H
+
+#include "yabe.h"
+
+/**
+   \page columns_page Columnar extraction of arrays of objects
+
+   Analytic processing of an array of objects with the same members usually
+   needs only a few of these members, and would rather get them as contiguous
+   arrays of values (columns) than as individual objects.
+
+   yabe_shred() reads an array of objects in a single pass and stores the
+   values of the requested members into typed columns provided by the user.
+   The members that are not requested are skipped using only their tag and
+   length. Members of nested objects are requested with a dot separated key
+   path like "user.id".
+
+   A value that is missing, null or of an incompatible type is flagged in the
+   \e nulls bitmap of the column and its slot in the values array is zeroed.
+
+   \code
+    int64_t ids[1024];
+    double prices[1024];
+    uint8_t idNulls[128], priceNulls[128];
+    yabe_column_t columns[2] = {
+        { "user.id", yabe_column_int64, ids, idNulls },
+        { "price", yabe_column_double, prices, priceNulls } };
+    size_t nRows;
+    if( !yabe_shred( &rCur, columns, 2, 1024, &nRows ) ) { ... }
+   \endcode
+*/
+
+/// Maximum number of columns yabe_shred() can fill in one pass
+#define YABE_MAX_COLUMNS 64
+
+/**
+ * \brief Type of the values stored in a column
+ */
+typedef enum yabe_column_type_t
+{
+    yabe_column_int64,   ///< int64_t values, accepts integers
+    yabe_column_double,  ///< double values, accepts floats and integers
+    yabe_column_string   ///< yabe_string_view_t values, accepts strings
+} yabe_column_type_t;
+
+
+/**
+ * \brief Column where to store the values of an object member
+ *
+ * The values and nulls arrays are provided by the user. They must be big
+ * enough to hold the maximum number of rows to extract, with one bit per row
+ * in the nulls bitmap. Row i is null if bit (i&7) of nulls[i>>3] is set.
+ */
+typedef struct yabe_column_t
+{
+    const char* path;         ///< Dot separated key path of the member
+    yabe_column_type_t type;  ///< Type of the values in the column
+    void* values;             ///< Array of values, one per row
+    uint8_t* nulls;           ///< Bitmap with the bit of null rows set
+} yabe_column_t;
+
+
+/**
+ * \brief Extract the members of an array of objects into columns and returns
+ *  the number of bytes read
+ *
+ * The array may be a small array or an array stream. Items that are not
+ * objects yield a row with all columns null. String values are views into
+ * the read buffer.
+ *
+ * \param[in,out] cursor Pointer on buffer where to read the array, the
+ *                       cursor is updated if the read operation succeeds
+ * \param[in,out] columns Columns to fill
+ * \param nColumns Number of columns, at most YABE_MAX_COLUMNS
+ * \param maxRows Capacity of the columns in rows
+ * \param[out] nRows Number of rows stored in the columns
+ * \return the number of bytes read, \e fail : 0 if the value is not an array,
+ *         is invalid, or has more than maxRows items
+ */
+size_t yabe_shred( yabe_cursor_t* cursor, yabe_column_t* columns, size_t nColumns,
+                   size_t maxRows, size_t* nRows );
+
+
+/**
+ * \brief Extract the members of one object into row \e row of the columns and
+ *  returns the number of bytes read
+ *
+ * This is the function called by yabe_shred() for each item of the array. It
+ * may be called by the function given to yabe_parallel_for_each() to fill the
+ * columns in parallel. The rows of a batch of items are then filled by the
+ * same thread and, since the batch size is a multiple of 8, different threads
+ * never update the same byte of the nulls bitmaps.
+ *
+ * \param[in,out] cursor Pointer on buffer where to read the object, the
+ *                       cursor is updated if the read operation succeeds
+ * \param[in,out] columns Columns to fill
+ * \param nColumns Number of columns, at most YABE_MAX_COLUMNS
+ * \param row Index of the row to fill
+ * \return the number of bytes read, \e fail : 0 if the value is invalid
+ */
+size_t yabe_shred_item( yabe_cursor_t* cursor, yabe_column_t* columns, size_t nColumns,
+                        size_t row );
+
+#endif // YABE_COLUMNS_H
@@ -0,0 +1,254 @@
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "yabe_context.h"
+
+
+#define YABE_ARENA_ALIGN 16   // alignment of the arena allocations
+
+
+/* Header at the start of each arena chunk */
+typedef struct yabe_arena_chunk_t
+{
+    struct yabe_arena_chunk_t* next;
+    size_t capacity;
+} yabe_arena_chunk_t;
+
+#define YABE_ARENA_HEADER_SIZE \
+    ((sizeof(yabe_arena_chunk_t) + YABE_ARENA_ALIGN - 1) & ~(size_t)(YABE_ARENA_ALIGN - 1))
+
+
+/* Return the size class of a buffer size, YABE_POOL_CLASSES if too large */
+static unsigned yabe_pool_class( size_t size )
+{
+    unsigned k = 0;
+    while( k < YABE_POOL_CLASSES && ((size_t)1 << (k + YABE_POOL_MIN_SHIFT)) < size )
+        ++k;
+    return k;
+}
+
+
+/* Initialize an empty pool */
+void yabe_pool_init( yabe_pool_t* pool, size_t maxRetained )
+{
+    memset( pool, 0, sizeof(*pool) );
+    pool->maxRetained = maxRetained;
+}
+
+
+/* Free all the buffers of the pool */
+void yabe_pool_free( yabe_pool_t* pool )
+{
+    for( unsigned k = 0; k < YABE_POOL_CLASSES; ++k )
+        while( pool->free[k] )
+        {
+            void* next = *(void**)pool->free[k];
+            free( pool->free[k] );
+            pool->free[k] = next;
+        }
+    pool->retained = 0;
+}
+
+
+/* Get a buffer of at least size bytes, recycled if one is available */
+void* yabe_pool_get( yabe_pool_t* pool, size_t size, size_t* capacity )
+{
+    const unsigned k = yabe_pool_class( size );
+    if( k == YABE_POOL_CLASSES )
+    {
+        // too large for a size class, never retained
+        ++pool->nMallocs;
+        *capacity = size;
+        return malloc( size );
+    }
+    *capacity = (size_t)1 << (k + YABE_POOL_MIN_SHIFT);
+    void* buffer = pool->free[k];
+    if( buffer )
+    {
+        pool->free[k] = *(void**)buffer;
+        pool->retained -= *capacity;
+        return buffer;
+    }
+    ++pool->nMallocs;
+    return malloc( *capacity );
+}
+
+
+/* Give back a buffer, keep it for reuse unless the retained cap is reached */
+void yabe_pool_put( yabe_pool_t* pool, void* buffer, size_t capacity )
+{
+    if( !buffer )
+        return;
+    const unsigned k = yabe_pool_class( capacity );
+    if( k == YABE_POOL_CLASSES || pool->retained + capacity > pool->maxRetained )
+    {
+        free( buffer );
+        return;
+    }
+    *(void**)buffer = pool->free[k];
+    pool->free[k] = buffer;
+    pool->retained += capacity;
+}
+
+
+/* Allocate size bytes in the arena */
+void* yabe_arena_alloc( yabe_arena_t* arena, size_t size )
+{
+    size = (size + YABE_ARENA_ALIGN - 1) & ~(size_t)(YABE_ARENA_ALIGN - 1);
+    if( arena->len < size )
+    {
+        size_t capacity;
+        const size_t need = YABE_ARENA_HEADER_SIZE + size;
+        yabe_arena_chunk_t* chunk = yabe_pool_get( arena->pool,
+            need > YABE_ARENA_CHUNK ? need : YABE_ARENA_CHUNK, &capacity );
+        if( !chunk )
+            return NULL;
+        chunk->next = arena->chunks;
+        chunk->capacity = capacity;
+        arena->chunks = chunk;
+        arena->ptr = (char*)chunk + YABE_ARENA_HEADER_SIZE;
+        arena->len = capacity - YABE_ARENA_HEADER_SIZE;
+    }
+    void* data = arena->ptr;
+    arena->ptr += size;
+    arena->len -= size;
+    return data;
+}
+
+
+/* Release all allocations, keep the current chunk */
+void yabe_arena_reset( yabe_arena_t* arena )
+{
+    yabe_arena_chunk_t* chunk = arena->chunks;
+    if( !chunk )
+        return;
+    while( chunk->next )
+    {
+        yabe_arena_chunk_t* next = chunk->next->next;
+        yabe_pool_put( arena->pool, chunk->next, chunk->next->capacity );
+        chunk->next = next;
+    }
+    arena->ptr = (char*)chunk + YABE_ARENA_HEADER_SIZE;
+    arena->len = chunk->capacity - YABE_ARENA_HEADER_SIZE;
+}
+
+
+/* Initialize a context */
+void yabe_context_init( yabe_context_t* ctx, size_t maxRetained )
+{
+    memset( ctx, 0, sizeof(*ctx) );
+    yabe_pool_init( &ctx->pool, maxRetained );
+    ctx->arena.pool = &ctx->pool;
+}
+
+
+/* Free all the buffers of a context */
+void yabe_context_free( yabe_context_t* ctx )
+{
+    yabe_arena_reset( &ctx->arena );
+    if( ctx->arena.chunks )
+        free( ctx->arena.chunks );
+    if( ctx->out )
+        free( ctx->out );
+    yabe_pool_free( &ctx->pool );
+    yabe_context_init( ctx, ctx->pool.maxRetained );
+}
+
+
+static pthread_key_t yabe_context_key;
+static pthread_once_t yabe_context_once = PTHREAD_ONCE_INIT;
+
+/* Free the context of an exiting thread */
+static void yabe_context_destroy( void* ctx )
+{
+    yabe_context_free( ctx );
+    free( ctx );
+}
+
+static void yabe_context_create_key( void )
+    { pthread_key_create( &yabe_context_key, yabe_context_destroy ); }
+
+
+/* Return the context of the calling thread */
+yabe_context_t* yabe_context_thread( void )
+{
+    pthread_once( &yabe_context_once, yabe_context_create_key );
+    yabe_context_t* ctx = pthread_getspecific( yabe_context_key );
+    if( !ctx )
+    {
+        if( !(ctx = malloc( sizeof(yabe_context_t) )) )
+            return NULL;
+        yabe_context_init( ctx, YABE_CONTEXT_RETAINED );
+        if( pthread_setspecific( yabe_context_key, ctx ) )
+        {
+            free( ctx );
+            return NULL;
+        }
+    }
+    return ctx;
+}
+
+
+/* Start writing a message, make sure the output buffer has sizeHint bytes */
+yabe_cursor_t* yabe_context_begin( yabe_context_t* ctx, size_t sizeHint )
+{
+    if( !ctx->out || ctx->outCapacity < sizeHint )
+    {
+        size_t capacity;
+        char* out = yabe_pool_get( &ctx->pool, sizeHint, &capacity );
+        if( !out )
+            return NULL;
+        yabe_pool_put( &ctx->pool, ctx->out, ctx->outCapacity );
+        ctx->out = out;
+        ctx->outCapacity = capacity;
+    }
+    ctx->cursor.ptr = ctx->out;
+    ctx->cursor.len = ctx->outCapacity;
+    return &ctx->cursor;
+}
+
+
+/* Replace the output buffer by one twice as large, keep the written bytes */
+bool yabe_context_grow( yabe_context_t* ctx )
+{
+    const size_t written = yabe_context_size( ctx );
+    size_t capacity;
+    char* out = yabe_pool_get( &ctx->pool, 2*ctx->outCapacity, &capacity );
+    if( !out )
+        return false;
+    memcpy( out, ctx->out, written );
+    yabe_pool_put( &ctx->pool, ctx->out, ctx->outCapacity );
+    ctx->out = out;
+    ctx->outCapacity = capacity;
+    ctx->cursor.ptr = out + written;
+    ctx->cursor.len = capacity - written;
+    return true;
+}
+
+
+/* Read a string value into a nul terminated copy in the arena */
+char* yabe_context_read_string( yabe_context_t* ctx, yabe_cursor_t* cursor, size_t* length )
+{
+    yabe_cursor_t c = *cursor;
+    size_t len;
+    if( !c.len || !yabe_read_string( &c, &len ) || len > c.len )
+        return NULL;
+    char* str = yabe_arena_alloc( &ctx->arena, len + 1 );
+    if( !str )
+        return NULL;
+    memcpy( str, c.ptr, len );
+    str[len] = '\0';
+    cursor->ptr = c.ptr + len;
+    cursor->len = c.len - len;
+    *length = len;
+    return str;
+}
+
+
+/* Release the decoded data and the output buffer content */
+void yabe_context_reset( yabe_context_t* ctx )
+{
+    yabe_arena_reset( &ctx->arena );
+    ctx->cursor.ptr = ctx->out;
+    ctx->cursor.len = ctx->outCapacity;
+}
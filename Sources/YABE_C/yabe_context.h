@@ -0,0 +1,230 @@
+#ifndef YABE_CONTEXT_H
+#define YABE_CONTEXT_H
+
+#include "yabe.h"
+
+/**
+   \page context_page Reusable encoding and decoding contexts
+
+   A service handling many small messages would allocate for each of them an
+   output buffer and a storage for each decoded string. A context owns these
+   buffers and keeps them from one message to the next :
+
+   - the output buffer is kept by yabe_context_reset() and only replaced by a
+     larger one when a message doesn't fit in it ;
+   - strings and other decoded data are allocated in an arena, a list of
+     chunks where allocation is a pointer increment. yabe_context_reset()
+     releases them all at once ;
+   - buffers are recycled by size classes (powers of two) in a pool. Released
+     buffers are kept for reuse until the pool holds \e maxRetained bytes,
+     beyond which they are freed.
+
+   After the first messages, handling a message thus doesn't call malloc()
+   anymore. yabe_context_thread() returns a context private to the calling
+   thread, created on first use and freed when the thread exits.
+
+   \code
+    yabe_context_t* ctx = yabe_context_thread();
+    yabe_cursor_t* out = yabe_context_begin( ctx, 512 );
+    ... write values with out ...
+    ... read a string with yabe_context_read_string( ctx, &rCur, &len ) ...
+    send( fd, ctx->out, yabe_context_size( ctx ), 0 );
+    yabe_context_reset( ctx );
+   \endcode
+*/
+
+/// Number of buffer size classes, from 256 bytes to 2 GB
+#define YABE_POOL_CLASSES    24
+
+/// Size of the smallest size class as a power of two
+#define YABE_POOL_MIN_SHIFT  8
+
+/// Default size of the arena chunks
+#define YABE_ARENA_CHUNK     65536
+
+/// Default number of bytes retained by the pool of yabe_context_thread()
+#define YABE_CONTEXT_RETAINED (16*1024*1024)
+
+
+/**
+ * \brief Free lists of buffers by size class
+ */
+typedef struct yabe_pool_t
+{
+    void* free[YABE_POOL_CLASSES];  ///< Free list of each size class
+    size_t retained;                ///< Number of bytes in the free lists
+    size_t maxRetained;             ///< Maximum number of bytes in the free lists
+    size_t nMallocs;                ///< Number of buffers allocated with malloc
+} yabe_pool_t;
+
+
+/**
+ * \brief Chunk list where data is allocated by incrementing a pointer
+ */
+typedef struct yabe_arena_t
+{
+    yabe_pool_t* pool;              ///< Pool providing the chunks
+    void* chunks;                   ///< List of chunks, the current one first
+    char* ptr;                      ///< Next free byte in the current chunk
+    size_t len;                     ///< Number of free bytes in the current chunk
+} yabe_arena_t;
+
+
+/**
+ * \brief Encoding and decoding context, owns an output buffer and an arena
+ */
+typedef struct yabe_context_t
+{
+    yabe_pool_t pool;               ///< Pool of the output buffers and chunks
+    yabe_arena_t arena;             ///< Storage of decoded data
+    char* out;                      ///< Output buffer
+    size_t outCapacity;             ///< Size of the output buffer
+    yabe_cursor_t cursor;           ///< Writing cursor in the output buffer
+} yabe_context_t;
+
+
+/**
+ * \brief Initialize an empty pool
+ *
+ * \param[out] pool Pointer on the pool to initialize
+ * \param maxRetained Maximum number of bytes kept in the free lists
+ */
+void yabe_pool_init( yabe_pool_t* pool, size_t maxRetained );
+
+
+/**
+ * \brief Free all the buffers of the pool
+ *
+ * \param[in,out] pool Pointer on the pool
+ */
+void yabe_pool_free( yabe_pool_t* pool );
+
+
+/**
+ * \brief Get a buffer of at least size bytes from the pool
+ *
+ * \param[in,out] pool Pointer on the pool
+ * \param size Minimum size of the buffer
+ * \param[out] capacity Size of the buffer, the size of its class
+ * \return a pointer on the buffer, NULL if it could not be allocated
+ */
+void* yabe_pool_get( yabe_pool_t* pool, size_t size, size_t* capacity );
+
+
+/**
+ * \brief Give back a buffer to the pool
+ *
+ * The buffer is freed if keeping it would exceed the retained memory cap.
+ *
+ * \param[in,out] pool Pointer on the pool
+ * \param buffer Pointer on a buffer returned by yabe_pool_get(), may be NULL
+ * \param capacity Size of the buffer returned by yabe_pool_get()
+ */
+void yabe_pool_put( yabe_pool_t* pool, void* buffer, size_t capacity );
+
+
+/**
+ * \brief Allocate size bytes in the arena, aligned for any type
+ *
+ * \param[in,out] arena Pointer on the arena
+ * \param size Number of bytes to allocate
+ * \return a pointer on the bytes, NULL if they could not be allocated
+ */
+void* yabe_arena_alloc( yabe_arena_t* arena, size_t size );
+
+
+/**
+ * \brief Release all the allocations of the arena
+ *
+ * The current chunk is kept, the others are given back to the pool.
+ *
+ * \param[in,out] arena Pointer on the arena
+ */
+void yabe_arena_reset( yabe_arena_t* arena );
+
+
+/**
+ * \brief Initialize a context
+ *
+ * \param[out] ctx Pointer on the context to initialize
+ * \param maxRetained Maximum number of bytes kept in the pool of the context
+ */
+void yabe_context_init( yabe_context_t* ctx, size_t maxRetained );
+
+
+/**
+ * \brief Free all the buffers of a context
+ *
+ * \param[in,out] ctx Pointer on the context
+ */
+void yabe_context_free( yabe_context_t* ctx );
+
+
+/**
+ * \brief Return the context of the calling thread
+ *
+ * The context is created with YABE_CONTEXT_RETAINED as retained memory cap
+ * on first call and freed when the thread exits.
+ *
+ * \return a pointer on the context, NULL if it could not be allocated
+ */
+yabe_context_t* yabe_context_thread( void );
+
+
+/**
+ * \brief Start writing a message in the output buffer
+ *
+ * \param[in,out] ctx Pointer on the context
+ * \param sizeHint Expected size of the message, the output buffer is
+ *                 replaced by a larger one if it is smaller
+ * \return a pointer on the writing cursor in the output buffer, NULL if a
+ *         larger output buffer could not be allocated
+ */
+yabe_cursor_t* yabe_context_begin( yabe_context_t* ctx, size_t sizeHint );
+
+
+/**
+ * \brief Replace the output buffer by one of at least twice its size
+ *
+ * The bytes written are copied and the writing cursor is updated. This is
+ * used when a write fails because the output buffer is full.
+ *
+ * \param[in,out] ctx Pointer on the context
+ * \return true if the output buffer is larger, false if it could not be
+ *         allocated
+ */
+bool yabe_context_grow( yabe_context_t* ctx );
+
+
+/**
+ * \brief Return the number of bytes written in the output buffer
+ *
+ * \param ctx Pointer on the context
+ * \return the number of bytes written since yabe_context_begin()
+ */
+static inline size_t yabe_context_size( const yabe_context_t* ctx )
+    { return ctx->cursor.ptr - ctx->out; }
+
+
+/**
+ * \brief Try reading a string value into the arena
+ *
+ * \param[in,out] ctx Pointer on the context
+ * \param[in,out] cursor Pointer on buffer where to try reading, the cursor
+ *                       is updated if the read operation succeeds
+ * \param[out] length Byte length of the string
+ * \return a pointer on the nul terminated string in the arena, NULL if the
+ *         value is not a complete string or if it could not be allocated
+ */
+char* yabe_context_read_string( yabe_context_t* ctx, yabe_cursor_t* cursor, size_t* length );
+
+
+/**
+ * \brief Release the decoded data and the output buffer content to handle
+ *  the next message
+ *
+ * \param[in,out] ctx Pointer on the context
+ */
+void yabe_context_reset( yabe_context_t* ctx );
+
+#endif // YABE_CONTEXT_H
@@ -0,0 +1,21 @@
+#ifndef YABE_CRC32C_H
+#define YABE_CRC32C_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * \brief Update a CRC32C (Castagnoli) checksum with size bytes of data
+ *
+ * The CRC32 instruction is used when the processor provides it (SSE 4.2 on
+ * x86-64, CRC extension on AArch64), otherwise a table driven implementation
+ * is used. The initial crc value is 0.
+ *
+ * \param crc Checksum of the previous bytes, 0 for the first bytes
+ * \param data Pointer on the bytes to add to the checksum
+ * \param size Number of bytes to add to the checksum
+ * \return the updated checksum
+ */
+uint32_t yabe_crc32c( uint32_t crc, const void* data, size_t size );
+
+#endif // YABE_CRC32C_H
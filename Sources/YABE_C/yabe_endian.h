@@ -0,0 +1,96 @@
+#ifndef YABE_ENDIAN_H
+#define YABE_ENDIAN_H
+
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Alignment safe load and store of the little endian multi byte fields of
+ * the yabe encoding and of the file and message formats built on it.
+ *
+ * The fixed size memcpy() is compiled into a single unaligned move on x86-64
+ * and AArch64, and the byte swap into a bswap/rev instruction on big endian
+ * hosts. Pointers are never cast to wider types, which would be undefined
+ * behavior on unaligned addresses.
+ *
+ * The big endian functions are the byte swapped path of the little endian
+ * ones. They are used by the tests to run the big endian host code path on
+ * a little endian host with byte swapped fixtures.
+ */
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define YABE_BIG_ENDIAN_HOST 1
+#else
+#define YABE_BIG_ENDIAN_HOST 0
+#endif
+
+
+/// @cond DEV
+/* Load and store in host byte order */
+static inline uint16_t yabe_load16( const void* p )
+    { uint16_t v; memcpy( &v, p, sizeof(v) ); return v; }
+
+static inline uint32_t yabe_load32( const void* p )
+    { uint32_t v; memcpy( &v, p, sizeof(v) ); return v; }
+
+static inline uint64_t yabe_load64( const void* p )
+    { uint64_t v; memcpy( &v, p, sizeof(v) ); return v; }
+
+static inline void yabe_store16( void* p, uint16_t v )
+    { memcpy( p, &v, sizeof(v) ); }
+
+static inline void yabe_store32( void* p, uint32_t v )
+    { memcpy( p, &v, sizeof(v) ); }
+
+static inline void yabe_store64( void* p, uint64_t v )
+    { memcpy( p, &v, sizeof(v) ); }
+/// @endcond
+
+
+/* Convert between little endian and host byte order */
+#if YABE_BIG_ENDIAN_HOST
+static inline uint16_t yabe_le16( uint16_t v ) { return __builtin_bswap16( v ); }
+static inline uint32_t yabe_le32( uint32_t v ) { return __builtin_bswap32( v ); }
+static inline uint64_t yabe_le64( uint64_t v ) { return __builtin_bswap64( v ); }
+static inline uint16_t yabe_be16( uint16_t v ) { return v; }
+static inline uint32_t yabe_be32( uint32_t v ) { return v; }
+static inline uint64_t yabe_be64( uint64_t v ) { return v; }
+#else
+static inline uint16_t yabe_le16( uint16_t v ) { return v; }
+static inline uint32_t yabe_le32( uint32_t v ) { return v; }
+static inline uint64_t yabe_le64( uint64_t v ) { return v; }
+static inline uint16_t yabe_be16( uint16_t v ) { return __builtin_bswap16( v ); }
+static inline uint32_t yabe_be32( uint32_t v ) { return __builtin_bswap32( v ); }
+static inline uint64_t yabe_be64( uint64_t v ) { return __builtin_bswap64( v ); }
+#endif
+
+
+/* Little endian fields */
+static inline uint16_t yabe_load_le16( const void* p ) { return yabe_le16( yabe_load16( p ) ); }
+static inline uint32_t yabe_load_le32( const void* p ) { return yabe_le32( yabe_load32( p ) ); }
+static inline uint64_t yabe_load_le64( const void* p ) { return yabe_le64( yabe_load64( p ) ); }
+static inline void yabe_store_le16( void* p, uint16_t v ) { yabe_store16( p, yabe_le16( v ) ); }
+static inline void yabe_store_le32( void* p, uint32_t v ) { yabe_store32( p, yabe_le32( v ) ); }
+static inline void yabe_store_le64( void* p, uint64_t v ) { yabe_store64( p, yabe_le64( v ) ); }
+
+
+/* Big endian fields */
+static inline uint16_t yabe_load_be16( const void* p ) { return yabe_be16( yabe_load16( p ) ); }
+static inline uint32_t yabe_load_be32( const void* p ) { return yabe_be32( yabe_load32( p ) ); }
+static inline uint64_t yabe_load_be64( const void* p ) { return yabe_be64( yabe_load64( p ) ); }
+static inline void yabe_store_be16( void* p, uint16_t v ) { yabe_store16( p, yabe_be16( v ) ); }
+static inline void yabe_store_be32( void* p, uint32_t v ) { yabe_store32( p, yabe_be32( v ) ); }
+static inline void yabe_store_be64( void* p, uint64_t v ) { yabe_store64( p, yabe_be64( v ) ); }
+
+
+/* Bit casts between floating point values and their bits */
+static inline float yabe_float_from_bits( uint32_t bits )
+    { float v; memcpy( &v, &bits, sizeof(v) ); return v; }
+
+static inline double yabe_double_from_bits( uint64_t bits )
+    { double v; memcpy( &v, &bits, sizeof(v) ); return v; }
+
+static inline uint64_t yabe_double_bits( double v )
+    { uint64_t bits; memcpy( &bits, &v, sizeof(bits) ); return bits; }
+
+#endif // YABE_ENDIAN_H
@@ -0,0 +1,137 @@
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "yabe_index.h"
+
+
+/* Number of items claimed at once by a thread of yabe_parallel_for_each */
+#define YABE_INDEX_BATCH 64
+
+
+/* Append an offset to the index, growing the offsets array as needed */
+static bool yabe_index_push( yabe_index_t* index, size_t offset )
+{
+    if( index->count + 1 > index->capacity )
+    {
+        size_t capacity = index->capacity ? index->capacity * 2 : 256;
+        size_t* offsets = realloc( index->offsets, capacity * sizeof(size_t) );
+        if( !offsets )
+            return false;
+        index->offsets = offsets;
+        index->capacity = capacity;
+    }
+    index->offsets[index->count++] = offset;
+    return true;
+}
+
+
+/* Build the index of the items of the array encoded in data */
+size_t yabe_index_build( yabe_index_t* index, const char* data, size_t size )
+{
+    yabe_cursor_t cursor = { (char*)data, size };
+    index->data = data;
+    index->offsets = NULL;
+    index->count = index->capacity = 0;
+
+    yabe_read_none( &cursor );
+    if( yabe_end_of_buffer( &cursor ) )
+        return 0;
+
+    int8_t nbr = -1;
+    if( !yabe_read_small_array( &cursor, &nbr ) && !yabe_read_array_stream( &cursor ) )
+        return 0;
+
+    while( nbr != 0 )
+    {
+        yabe_read_none( &cursor );
+        if( nbr < 0 && !yabe_end_of_buffer( &cursor ) &&
+            yabe_peek_tag( &cursor ) == yabe_ends_tag )
+            break;
+        if( !yabe_index_push( index, cursor.ptr - data ) ||
+            !yabe_skip_value( &cursor ) )
+        {
+            yabe_index_free( index );
+            return 0;
+        }
+        if( nbr > 0 )
+            --nbr;
+    }
+    if( !yabe_index_push( index, cursor.ptr - data ) )
+    {
+        yabe_index_free( index );
+        return 0;
+    }
+    if( nbr < 0 )
+        yabe_skip_tag( &cursor );
+    // the last offset is the end of the last item, not an item
+    --index->count;
+    return cursor.ptr - data;
+}
+
+
+/* Release the memory allocated by yabe_index_build */
+void yabe_index_free( yabe_index_t* index )
+{
+    free( index->offsets );
+    index->offsets = NULL;
+    index->count = index->capacity = 0;
+}
+
+
+/* Work shared by the threads of yabe_parallel_for_each */
+typedef struct yabe_parallel_t
+{
+    const yabe_index_t* index;
+    yabe_item_fn fn;
+    void* ctx;
+    size_t next;        // next item to hand out, updated atomically
+} yabe_parallel_t;
+
+
+/* Thread function processing batches of items until none are left */
+static void* yabe_parallel_worker( void* arg )
+{
+    yabe_parallel_t* work = arg;
+    const size_t count = work->index->count;
+    for(;;)
+    {
+        size_t i = __sync_fetch_and_add( &work->next, YABE_INDEX_BATCH );
+        if( i >= count )
+            break;
+        size_t last = i + YABE_INDEX_BATCH < count ? i + YABE_INDEX_BATCH : count;
+        for( ; i < last; ++i )
+        {
+            yabe_cursor_t item = yabe_index_item( work->index, i );
+            work->fn( work->ctx, i, &item );
+        }
+    }
+    return NULL;
+}
+
+
+/* Call fn on every item of the indexed array using nThreads threads */
+unsigned yabe_parallel_for_each( const yabe_index_t* index, unsigned nThreads,
+                                 yabe_item_fn fn, void* ctx )
+{
+    yabe_parallel_t work = { index, fn, ctx, 0 };
+    if( nThreads < 2 || index->count <= YABE_INDEX_BATCH )
+    {
+        yabe_parallel_worker( &work );
+        return 1;
+    }
+
+    pthread_t* threads = malloc( (nThreads - 1) * sizeof(pthread_t) );
+    unsigned started = 0;
+    if( threads )
+        while( started < nThreads - 1 &&
+               !pthread_create( &threads[started], NULL, yabe_parallel_worker, &work ) )
+            ++started;
+
+    // the calling thread is a worker too
+    yabe_parallel_worker( &work );
+
+    for( unsigned i = 0; i < started; ++i )
+        pthread_join( threads[i], NULL );
+    free( threads );
+    return started + 1;
+}
@@ -0,0 +1,113 @@
+#ifndef YABE_INDEX_H
+#define YABE_INDEX_H
+
+#include "yabe.h"
+
+/**
+   \page index_page Structural index and parallel decoding
+
+   Large documents are usually a big array of independent items. Once the
+   offsets of these items are known, they can be decoded independently and
+   thus in parallel.
+
+   The structural pass yabe_index_build() walks the top level array with
+   yabe_skip_value() and records the offset of each of its items. No value is
+   decoded during this pass, only tags and lengths are used. The items are
+   then handed out to a pool of threads by yabe_parallel_for_each() which calls
+   a user function with a reading cursor on each item. The user function may
+   decode the item into its own data structure, pass it to a callback or
+   extract some columns out of it.
+
+   \code
+    yabe_index_t index;
+    if( !yabe_index_build( &index, data, size ) ) { ... not an array ... }
+    yabe_parallel_for_each( &index, 8, decodeItem, ctx );
+    yabe_index_free( &index );
+   \endcode
+*/
+
+/**
+ * \brief Offsets of the items of a top level array
+ *
+ * Item \e i spans the bytes from offsets[i] to offsets[i+1], there are thus
+ * count+1 offsets. The offsets are relative to \e data.
+ */
+typedef struct yabe_index_t
+{
+    const char* data;  ///< Pointer on the first byte of the indexed array
+    size_t* offsets;   ///< count+1 item offsets relative to data
+    size_t count;      ///< Number of items in the array
+    size_t capacity;   ///< Number of allocated offsets
+} yabe_index_t;
+
+
+/**
+ * \brief User function called for each item of an indexed array
+ *
+ * \param ctx User context pointer given to yabe_parallel_for_each()
+ * \param index Index of the item in the array
+ * \param item Reading cursor on the item bytes, the function may move it
+ */
+typedef void (*yabe_item_fn)( void* ctx, size_t index, yabe_cursor_t* item );
+
+
+/**
+ * \brief Build the index of the items of the array encoded in data
+ *
+ * The array may be a small array or an array stream, optionally preceded by
+ * \e none values. The offsets array is allocated with malloc() and must be
+ * released with yabe_index_free().
+ *
+ * \param[out] index Index to initialize
+ * \param data Pointer on the YABE encoded array, without signature
+ * \param size Number of bytes available at data
+ * \return the number of bytes of the array, \e fail : 0 if data is not a valid
+ *         array or memory could not be allocated
+ */
+size_t yabe_index_build( yabe_index_t* index, const char* data, size_t size );
+
+
+/**
+ * \brief Release the memory allocated by yabe_index_build()
+ *
+ * \param[in,out] index Index to release, it is left empty
+ */
+void yabe_index_free( yabe_index_t* index );
+
+
+/**
+ * \brief Return a reading cursor on the item i of the indexed array
+ *
+ * \param index Index built by yabe_index_build()
+ * \param i Item index, must be smaller than index->count
+ * \return a cursor on the bytes of item i
+ */
+static inline yabe_cursor_t yabe_index_item( const yabe_index_t* index, size_t i )
+{
+    assert( index && i < index->count );
+    yabe_cursor_t item = { (char*)index->data + index->offsets[i],
+                           index->offsets[i+1] - index->offsets[i] };
+    return item;
+}
+
+
+/**
+ * \brief Call fn on every item of the indexed array using nThreads threads
+ *
+ * Items are handed out to the threads in batches in increasing index order,
+ * so the calls for different items occur concurrently and in any order. The
+ * function returns when all items have been processed. The calling thread is
+ * one of the nThreads threads. With nThreads equal to 0 or 1, the items are
+ * processed in sequence by the calling thread.
+ *
+ * \param index Index built by yabe_index_build()
+ * \param nThreads Number of threads to use
+ * \param fn Function to call for each item
+ * \param ctx User context pointer passed to fn
+ * \return the number of threads effectively used, which is smaller than
+ *         nThreads if some threads could not be created
+ */
+unsigned yabe_parallel_for_each( const yabe_index_t* index, unsigned nThreads,
+                             yabe_item_fn fn, void* ctx );
+
+#endif // YABE_INDEX_H
@@ -0,0 +1,291 @@
+#include "yabe_lazy.h"
+
+
+/* Key of the slot storing the walk state of a container */
+#define YABE_LAZY_WALK UINT64_MAX
+
+/* Number of slots where an item may be stored */
+#define YABE_LAZY_WAYS 4
+
+
+/* Initialize the handle of the value at cursor position */
+bool yabe_lazy_init( yabe_lazy_t* value, const yabe_cursor_t* cursor )
+{
+    yabe_cursor_t c = *cursor;
+    yabe_read_none( &c );
+    if( yabe_end_of_buffer( &c ) )
+        return false;
+    value->ptr = c.ptr;
+    value->len = c.len;
+    return true;
+}
+
+
+/* Initialize a cache with caller allocated slots */
+void yabe_lazy_cache_init( yabe_lazy_cache_t* cache, yabe_lazy_slot_t* slots, size_t nSlots )
+{
+    assert( nSlots >= YABE_LAZY_WAYS && !(nSlots & (nSlots - 1)) );
+    cache->slots = slots;
+    cache->mask = nSlots - 1;
+    yabe_lazy_cache_reset( cache );
+}
+
+
+/* Forget all the positions stored in the cache */
+void yabe_lazy_cache_reset( yabe_lazy_cache_t* cache )
+{
+    memset( cache->slots, 0, (cache->mask + 1) * sizeof(yabe_lazy_slot_t) );
+    cache->evictions = 0;
+}
+
+
+/* Return the first of the YABE_LAZY_WAYS slots where the container item
+   may be */
+static yabe_lazy_slot_t* yabe_lazy_set( yabe_lazy_cache_t* cache, const char* container,
+                                        uint64_t key )
+{
+    uint64_t h = ((uint64_t)(uintptr_t)container ^ key) * 0x9E3779B97F4A7C15ULL;
+    h ^= h >> 32;
+    return &cache->slots[h & cache->mask & ~(size_t)(YABE_LAZY_WAYS - 1)];
+}
+
+
+/* Return the slot of the container item if it is in the cache, or NULL */
+static const yabe_lazy_slot_t* yabe_lazy_lookup( yabe_lazy_cache_t* cache,
+                                                 const char* container, uint64_t key )
+{
+    const yabe_lazy_slot_t* s = yabe_lazy_set( cache, container, key );
+    for( int way = 0; way < YABE_LAZY_WAYS; ++way )
+        if( s[way].container == container && s[way].key == key )
+            return s + way;
+    return NULL;
+}
+
+
+/* Store the container item in the first slot of its set, the items stored
+   before are moved to the next slots and the oldest one is evicted */
+static void yabe_lazy_store( yabe_lazy_cache_t* cache, const char* container, uint64_t key,
+                             const char* item, size_t count, size_t stamp )
+{
+    yabe_lazy_slot_t* s = yabe_lazy_set( cache, container, key );
+    int way = 0;
+    while( way < YABE_LAZY_WAYS - 1 && !(s[way].container == container && s[way].key == key) )
+        ++way;
+    if( s[way].container && !(s[way].container == container && s[way].key == key) )
+        ++cache->evictions;
+    memmove( s + 1, s, way * sizeof(yabe_lazy_slot_t) );
+    s->container = container;
+    s->key = key;
+    s->item = item;
+    s->count = count;
+    s->stamp = stamp;
+}
+
+
+/* Set the handle of the value at p inside the container value */
+static void yabe_lazy_handle( const yabe_lazy_t* container, const char* p, yabe_lazy_t* value )
+{
+    value->len = container->len - (p - container->ptr);
+    value->ptr = container->ptr + (p - container->ptr);
+}
+
+
+/* Hash of a member identifier, never YABE_LAZY_WALK */
+static uint64_t yabe_lazy_hash_key( const char* key, size_t len )
+{
+    uint64_t h = 0xCBF29CE484222325ULL;
+    for( size_t i = 0; i < len; ++i )
+        h = (h ^ (uint8_t)key[i]) * 0x100000001B3ULL;
+    return h >> 1;
+}
+
+
+/* Set the handle of the member value at p if its identifier is key */
+static bool yabe_lazy_member( const yabe_lazy_t* object, const char* p, const char* key,
+                              size_t keyLen, yabe_lazy_t* member )
+{
+    yabe_lazy_t m;
+    yabe_lazy_handle( object, p, &m );
+    yabe_cursor_t c = { m.ptr, m.len };
+    yabe_string_view_t view;
+    if( !yabe_read_string_view( &c, &view ) || view.len != keyLen ||
+        memcmp( view.ptr, key, keyLen ) )
+        return false;
+    yabe_read_none( &c );
+    if( yabe_end_of_buffer( &c ) )
+        return false;
+    member->ptr = c.ptr;
+    member->len = c.len;
+    return true;
+}
+
+
+/* Return the handle of the object member with the given identifier */
+bool yabe_lazy_get( const yabe_lazy_t* object, yabe_lazy_cache_t* cache,
+                    const char* key, size_t keyLen, yabe_lazy_t* member )
+{
+    yabe_cursor_t c = { object->ptr, object->len };
+    int8_t nbr = -1;
+    if( yabe_end_of_buffer( &c ) ||
+        (!yabe_read_small_object( &c, &nbr ) && !yabe_read_object_stream( &c )) )
+        return false;
+    const yabe_cursor_t members = c;
+    const uint64_t h = yabe_lazy_hash_key( key, keyLen );
+
+    // a member walked before, or the end of a walk without eviction since
+    // it started, or where the last walk stopped
+    size_t i = 0, resumed = 0, stamp = 0, start = 0;
+    if( cache )
+    {
+        const yabe_lazy_slot_t* s = yabe_lazy_lookup( cache, object->ptr, h );
+        if( s && yabe_lazy_member( object, s->item, key, keyLen, member ) )
+            return true;
+        stamp = start = cache->evictions;
+        if( (s = yabe_lazy_lookup( cache, object->ptr, YABE_LAZY_WALK )) )
+        {
+            if( !s->item && s->stamp == cache->evictions )
+                return false;
+            if( s->item )
+            {
+                c.len -= s->item - c.ptr;
+                c.ptr += s->item - c.ptr;
+                i = resumed = s->count;
+                stamp = s->stamp;
+            }
+        }
+    }
+
+    bool wrapped = false;
+    for( ;; )
+    {
+        yabe_read_none( &c );
+        if( yabe_end_of_buffer( &c ) )
+            return false;
+        if( (wrapped && i == resumed) ||
+            (nbr >= 0 && i == (size_t)nbr) || (nbr < 0 && yabe_read_end_stream( &c )) )
+        {
+            // the members before a resumed walk may have been evicted
+            if( resumed && !wrapped && stamp != cache->evictions )
+            {
+                c = members;
+                i = 0;
+                stamp = start;
+                wrapped = true;
+                continue;
+            }
+            if( cache )
+                yabe_lazy_store( cache, object->ptr, YABE_LAZY_WALK, NULL, 0, stamp );
+            return false;
+        }
+        const char* const p = c.ptr;
+        yabe_string_view_t view;
+        if( !yabe_read_string_view( &c, &view ) )
+            return false;
+        if( cache )
+            yabe_lazy_store( cache, object->ptr, yabe_lazy_hash_key( view.ptr, view.len ), p, i, 0 );
+        if( view.len == keyLen && !memcmp( view.ptr, key, keyLen ) )
+        {
+            if( cache )
+                yabe_lazy_store( cache, object->ptr, YABE_LAZY_WALK, p, i, stamp );
+            return yabe_lazy_member( object, p, key, keyLen, member );
+        }
+        yabe_read_none( &c );
+        if( yabe_end_of_buffer( &c ) || !yabe_skip_value( &c ) )
+            return false;
+        ++i;
+    }
+}
+
+
+/* Return the handle of the array item at the given index */
+bool yabe_lazy_at( const yabe_lazy_t* array, yabe_lazy_cache_t* cache,
+                   size_t index, yabe_lazy_t* item )
+{
+    yabe_cursor_t c = { array->ptr, array->len };
+    int8_t nbr = -1;
+    if( yabe_end_of_buffer( &c ) ||
+        (!yabe_read_small_array( &c, &nbr ) && !yabe_read_array_stream( &c )) ||
+        (nbr >= 0 && index >= (size_t)nbr) )
+        return false;
+    size_t i = 0;
+
+    // an item walked before, the number of items or where the last walk
+    // stopped if it is before the item
+    if( cache )
+    {
+        const yabe_lazy_slot_t* s = yabe_lazy_lookup( cache, array->ptr, index );
+        if( s )
+        {
+            yabe_lazy_handle( array, s->item, item );
+            return true;
+        }
+        if( (s = yabe_lazy_lookup( cache, array->ptr, YABE_LAZY_WALK )) )
+        {
+            if( !s->item && index >= s->count )
+                return false;
+            if( s->item && s->count <= index )
+            {
+                c.len -= s->item - c.ptr;
+                c.ptr += s->item - c.ptr;
+                i = s->count;
+            }
+        }
+    }
+
+    for( ;; ++i )
+    {
+        yabe_read_none( &c );
+        if( yabe_end_of_buffer( &c ) )
+            return false;
+        if( nbr < 0 && yabe_read_end_stream( &c ) )
+        {
+            if( cache )
+                yabe_lazy_store( cache, array->ptr, YABE_LAZY_WALK, NULL, i, 0 );
+            return false;
+        }
+        if( cache )
+            yabe_lazy_store( cache, array->ptr, i, c.ptr, i, 0 );
+        if( i == index )
+        {
+            if( cache )
+                yabe_lazy_store( cache, array->ptr, YABE_LAZY_WALK, c.ptr, i, 0 );
+            item->ptr = c.ptr;
+            item->len = c.len;
+            return true;
+        }
+        if( !yabe_skip_value( &c ) )
+            return false;
+    }
+}
+
+
+/* Decode an integer value */
+bool yabe_lazy_as_int( const yabe_lazy_t* value, int64_t* out )
+{
+    yabe_cursor_t c = { value->ptr, value->len };
+    return !yabe_end_of_buffer( &c ) && yabe_read_integer( &c, out );
+}
+
+
+/* Decode a floating point or integer value */
+bool yabe_lazy_as_double( const yabe_lazy_t* value, double* out )
+{
+    yabe_cursor_t c = { value->ptr, value->len };
+    int64_t code;
+    if( yabe_end_of_buffer( &c ) )
+        return false;
+    if( yabe_read_float( &c, out ) )
+        return true;
+    if( !yabe_read_integer( &c, &code ) )
+        return false;
+    *out = (double)code;
+    return true;
+}
+
+
+/* Decode a string value without copying it */
+bool yabe_lazy_as_string_view( const yabe_lazy_t* value, yabe_string_view_t* out )
+{
+    yabe_cursor_t c = { value->ptr, value->len };
+    return !yabe_end_of_buffer( &c ) && yabe_read_string_view( &c, out );
+}
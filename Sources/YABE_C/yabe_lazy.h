@@ -0,0 +1,175 @@
+#ifndef YABE_LAZY_H
+#define YABE_LAZY_H
+
+#include "yabe.h"
+
+/**
+   \page lazy_page Lazy access to encoded values
+
+   A lazy handle designates an encoded value by a pointer on its first byte
+   and the number of bytes left in the buffer. Nothing is decoded when it is
+   created : yabe_lazy_get() and yabe_lazy_at() return the handle of an
+   object member or array item by skipping the values preceding it, and the
+   yabe_lazy_as_ functions decode a scalar value.
+
+   Finding a member or an item walks its container from its start. With a
+   cache, the position of every item and member walked is remembered, as
+   well as where the walk of each container stopped :
+
+    <ul>
+    <li> a value already walked over is found with a single lookup ;
+    <li> another walk of the same container resumes where the last one
+         stopped, so reading the items of an array in order skips each item
+         once ;
+    <li> a member identifier missing in an object walked to its end is
+         known to be missing.
+    </ul>
+
+   The cache is a table of slots allocated by the caller. Each container
+   item is stored in one of 4 slots chosen by hashing its container position
+   and its index or identifier, replacing the oldest item of these slots.
+   The cache can thus be smaller than the data and only contains the items
+   walked recently. It holds positions in the buffer and must be reset
+   with yabe_lazy_cache_reset() when the buffer changes.
+
+   \code
+    yabe_lazy_slot_t slots[1024];
+    yabe_lazy_cache_t cache;
+    yabe_lazy_cache_init( &cache, slots, 1024 );
+
+    yabe_lazy_t root, user, id;
+    int64_t value;
+    if( !yabe_lazy_init( &root, &rCur ) ||
+        !yabe_lazy_get( &root, &cache, "user", 4, &user ) ||
+        !yabe_lazy_get( &user, &cache, "id", 2, &id ) ||
+        !yabe_lazy_as_int( &id, &value ) ) { ... }
+   \endcode
+*/
+
+/**
+ * \brief Handle of an encoded value
+ */
+typedef struct yabe_lazy_t
+{
+    char* ptr;                  ///< Pointer on the first byte of the value
+    size_t len;                 ///< Number of bytes from ptr to the end of the buffer
+} yabe_lazy_t;
+
+
+/**
+ * \brief Slot of a lazy access cache
+ */
+typedef struct yabe_lazy_slot_t
+{
+    const char* container;      ///< Position of the container, NULL if free
+    uint64_t key;               ///< Item index or hash of the member identifier
+    const char* item;           ///< Position of the item or member
+    size_t count;               ///< Index of the item, or of the next item to walk
+    size_t stamp;               ///< Evictions of the cache when the walk started
+} yabe_lazy_slot_t;
+
+
+/**
+ * \brief Cache of the positions of the items and members walked
+ */
+typedef struct yabe_lazy_cache_t
+{
+    yabe_lazy_slot_t* slots;    ///< Slots of the cache
+    size_t mask;                ///< Number of slots minus one
+    size_t evictions;           ///< Number of slots replaced by another item
+} yabe_lazy_cache_t;
+
+
+/**
+ * \brief Initialize the handle of the value at cursor position
+ *
+ * \e none values preceding the value are skipped. The value is not read.
+ *
+ * \param[out] value Handle of the value
+ * \param cursor Pointer on buffer where to read the value, left unchanged
+ * \return true if the handle is initialized, false if the buffer is empty
+ */
+bool yabe_lazy_init( yabe_lazy_t* value, const yabe_cursor_t* cursor );
+
+
+/**
+ * \brief Initialize a cache with caller allocated slots
+ *
+ * \param[out] cache Pointer on the cache to initialize
+ * \param slots Array of slots, must remain valid while the cache is used
+ * \param nSlots Number of slots, a power of 2 and at least 4
+ */
+void yabe_lazy_cache_init( yabe_lazy_cache_t* cache, yabe_lazy_slot_t* slots, size_t nSlots );
+
+
+/**
+ * \brief Forget all the positions stored in the cache
+ *
+ * \param[in,out] cache Pointer on the cache
+ */
+void yabe_lazy_cache_reset( yabe_lazy_cache_t* cache );
+
+
+/**
+ * \brief Return the handle of the object member with the given identifier
+ *
+ * \param object Handle of an object
+ * \param[in,out] cache Cache of the positions walked, may be NULL
+ * \param key Pointer on the bytes of the member identifier
+ * \param keyLen Number of bytes of the member identifier
+ * \param[out] member Handle of the member value
+ * \return true if the member was found, false if the value is not an
+ *         object, it has no such member or it is invalid
+ */
+bool yabe_lazy_get( const yabe_lazy_t* object, yabe_lazy_cache_t* cache,
+                    const char* key, size_t keyLen, yabe_lazy_t* member );
+
+
+/**
+ * \brief Return the handle of the array item at the given index
+ *
+ * The items of packed integer arrays can't be accessed by handles, they are
+ * read with yabe_read_packed().
+ *
+ * \param array Handle of an array
+ * \param[in,out] cache Cache of the positions walked, may be NULL
+ * \param index Index of the item, starting with 0
+ * \param[out] item Handle of the item
+ * \return true if the item was found, false if the value is not a plain
+ *         array, it has no such item or it is invalid
+ */
+bool yabe_lazy_at( const yabe_lazy_t* array, yabe_lazy_cache_t* cache,
+                   size_t index, yabe_lazy_t* item );
+
+
+/**
+ * \brief Decode an integer value
+ *
+ * \param value Handle of the value
+ * \param[out] out Decoded integer
+ * \return true if the value is an integer, false otherwise
+ */
+bool yabe_lazy_as_int( const yabe_lazy_t* value, int64_t* out );
+
+
+/**
+ * \brief Decode a floating point or integer value
+ *
+ * \param value Handle of the value
+ * \param[out] out Decoded value, integers are converted to double
+ * \return true if the value is a floating point value or an integer, false
+ *         otherwise
+ */
+bool yabe_lazy_as_double( const yabe_lazy_t* value, double* out );
+
+
+/**
+ * \brief Decode a string value without copying it
+ *
+ * \param value Handle of the value
+ * \param[out] out View on the bytes of the string in the buffer
+ * \return true if the value is a string, false otherwise
+ */
+bool yabe_lazy_as_string_view( const yabe_lazy_t* value, yabe_string_view_t* out );
+
+#endif // YABE_LAZY_H
@@ -0,0 +1,540 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "yabe_log.h"
+#include "yabe_crc32c.h"
+#include "yabe_endian.h"
+
+
+/* Frame layout constants */
+#define YABE_LOG_HEADER_SIZE  8            // len32 and crc32c
+#define YABE_LOG_SYNC_SIZE    24           // sync frame payload size
+#define YABE_LOG_SYNC_FLAG    0x80000000U  // set in len32 of sync frames
+#define YABE_LOG_TRAILER_SIZE 24           // footer without the offsets
+#define YABE_LOG_NO_SYNC      UINT64_MAX   // back link of the first sync
+#define YABE_LOG_SCAN_CHUNK   65536        // backward scan read size
+
+
+/* Read exactly size bytes at offset, return false on error or end of file */
+static bool yabe_log_pread( int fd, void* data, size_t size, uint64_t offset )
+{
+    char* p = data;
+    while( size )
+    {
+        ssize_t res = pread( fd, p, size, (off_t)offset );
+        if( res < 0 && errno == EINTR )
+            continue;
+        if( res <= 0 )
+            return false;
+        p += res; size -= res; offset += res;
+    }
+    return true;
+}
+
+
+/* Write exactly size bytes at offset, return false on error */
+static bool yabe_log_pwrite( int fd, const void* data, size_t size, uint64_t offset )
+{
+    const char* p = data;
+    while( size )
+    {
+        ssize_t res = pwrite( fd, p, size, (off_t)offset );
+        if( res < 0 && errno == EINTR )
+            continue;
+        if( res <= 0 )
+            return false;
+        p += res; size -= res; offset += res;
+    }
+    return true;
+}
+
+
+/* Content of a sync frame */
+typedef struct yabe_log_sync_t
+{
+    uint32_t interval;
+    uint64_t record;
+    uint64_t prev;
+} yabe_log_sync_t;
+
+
+/* Encode a sync frame in the 32 bytes at p */
+static void yabe_log_make_sync( char* p, const yabe_log_sync_t* sync )
+{
+    char* payload = p + YABE_LOG_HEADER_SIZE;
+    memcpy( payload, "YSYN", 4 );
+    yabe_store_le32( payload + 4, sync->interval );
+    yabe_store_le64( payload + 8, sync->record );
+    yabe_store_le64( payload + 16, sync->prev );
+    yabe_store_le32( p, YABE_LOG_SYNC_FLAG | YABE_LOG_SYNC_SIZE );
+    yabe_store_le32( p + 4, yabe_crc32c( 0, payload, YABE_LOG_SYNC_SIZE ) );
+}
+
+
+/* Read and check the sync frame at offset */
+static bool yabe_log_read_sync( int fd, uint64_t offset, yabe_log_sync_t* sync )
+{
+    char frame[YABE_LOG_HEADER_SIZE + YABE_LOG_SYNC_SIZE];
+    const char* payload = frame + YABE_LOG_HEADER_SIZE;
+    if( !yabe_log_pread( fd, frame, sizeof(frame), offset ) ||
+        yabe_load_le32( frame ) != (YABE_LOG_SYNC_FLAG | YABE_LOG_SYNC_SIZE) ||
+        memcmp( payload, "YSYN", 4 ) ||
+        yabe_load_le32( frame + 4 ) != yabe_crc32c( 0, payload, YABE_LOG_SYNC_SIZE ) )
+        return false;
+    sync->interval = yabe_load_le32( payload + 4 );
+    sync->record = yabe_load_le64( payload + 8 );
+    sync->prev = yabe_load_le64( payload + 16 );
+    return sync->interval != 0;
+}
+
+
+/* Layout of an existing log */
+typedef struct yabe_log_info_t
+{
+    uint32_t interval;
+    uint64_t nRecords;
+    uint64_t end;
+    uint64_t* syncs;
+    size_t nSyncs;
+} yabe_log_info_t;
+
+
+/* Load the sync offsets from the footer if it is valid */
+static bool yabe_log_load_footer( int fd, uint64_t size, yabe_log_info_t* info )
+{
+    char trailer[YABE_LOG_TRAILER_SIZE];
+    if( size < 5 + YABE_LOG_TRAILER_SIZE ||
+        !yabe_log_pread( fd, trailer, sizeof(trailer), size - sizeof(trailer) ) ||
+        memcmp( trailer + 16, "YLOGEND", 8 ) )
+        return false;
+
+    const uint64_t nRecords = yabe_load_le64( trailer );
+    const uint32_t nSyncs = yabe_load_le32( trailer + 8 );
+    const uint64_t indexSize = (uint64_t)nSyncs * sizeof(uint64_t);
+    if( size - 5 - YABE_LOG_TRAILER_SIZE < indexSize )
+        return false;
+
+    const uint64_t end = size - YABE_LOG_TRAILER_SIZE - indexSize;
+    uint64_t* syncs = malloc( indexSize ? indexSize : 1 );
+    if( !syncs || !yabe_log_pread( fd, syncs, indexSize, end ) ||
+        yabe_crc32c( yabe_crc32c( 0, syncs, indexSize ), trailer, 12 ) !=
+        yabe_load_le32( trailer + 12 ) )
+    {
+        free( syncs );
+        return false;
+    }
+    for( uint32_t i = 0; i < nSyncs; ++i )
+        syncs[i] = yabe_load_le64( syncs + i );
+
+    yabe_log_sync_t sync = { YABE_LOG_INTERVAL, 0, 0 };
+    if( nSyncs && !yabe_log_read_sync( fd, syncs[0], &sync ) )
+    {
+        free( syncs );
+        return false;
+    }
+    info->interval = sync.interval;
+    info->nRecords = nRecords;
+    info->end = end;
+    info->syncs = syncs;
+    info->nSyncs = nSyncs;
+    return true;
+}
+
+
+/* Return the offset of the last valid sync frame, searched backward from the
+   end of file, or YABE_LOG_NO_SYNC if there is none */
+static uint64_t yabe_log_find_last_sync( int fd, uint64_t size, yabe_log_sync_t* sync )
+{
+    char* chunk = malloc( YABE_LOG_SCAN_CHUNK );
+    if( !chunk )
+        return YABE_LOG_NO_SYNC;
+
+    // chunks overlap by 3 bytes so that a marker is never split
+    uint64_t chunkEnd = size;
+    while( chunkEnd > 5 + YABE_LOG_HEADER_SIZE )
+    {
+        uint64_t chunkStart = chunkEnd > YABE_LOG_SCAN_CHUNK ? chunkEnd - YABE_LOG_SCAN_CHUNK : 0;
+        if( chunkStart < 5 + YABE_LOG_HEADER_SIZE )
+            chunkStart = 5 + YABE_LOG_HEADER_SIZE;
+        const size_t len = chunkEnd - chunkStart;
+        if( !yabe_log_pread( fd, chunk, len, chunkStart ) )
+            break;
+        for( size_t i = len >= 4 ? len - 4 + 1 : 0; i-- > 0; )
+        {
+            const uint64_t offset = chunkStart + i - YABE_LOG_HEADER_SIZE;
+            if( !memcmp( chunk + i, "YSYN", 4 ) && yabe_log_read_sync( fd, offset, sync ) )
+            {
+                free( chunk );
+                return offset;
+            }
+        }
+        if( chunkStart == 5 + YABE_LOG_HEADER_SIZE )
+            break;
+        chunkEnd = chunkStart + 3;
+    }
+    free( chunk );
+    return YABE_LOG_NO_SYNC;
+}
+
+
+/* Rebuild the log layout from its sync frames when the footer is missing */
+static bool yabe_log_recover( int fd, uint64_t size, yabe_log_info_t* info )
+{
+    yabe_log_sync_t sync;
+    const uint64_t last = yabe_log_find_last_sync( fd, size, &sync );
+    info->interval = YABE_LOG_INTERVAL;
+    info->nRecords = 0;
+    info->end = 5;
+    info->syncs = NULL;
+    info->nSyncs = 0;
+    if( last == YABE_LOG_NO_SYNC )
+        return true;
+
+    // follow the back links to collect the offsets of all sync frames
+    const size_t nSyncs = sync.record / sync.interval + 1;
+    if( sync.record % sync.interval || nSyncs > size / (YABE_LOG_HEADER_SIZE + YABE_LOG_SYNC_SIZE) )
+        return false;
+    uint64_t* syncs = malloc( nSyncs * sizeof(uint64_t) );
+    if( !syncs )
+        return false;
+    syncs[nSyncs - 1] = last;
+    yabe_log_sync_t prev = sync;
+    for( size_t i = nSyncs - 1; i > 0; --i )
+    {
+        const uint64_t offset = prev.prev;
+        if( offset >= syncs[i] || !yabe_log_read_sync( fd, offset, &prev ) ||
+            prev.record != (uint64_t)(i - 1) * sync.interval )
+        {
+            free( syncs );
+            return false;
+        }
+        syncs[i - 1] = offset;
+    }
+
+    // check the frames following the last sync frame
+    uint64_t pos = last + YABE_LOG_HEADER_SIZE + YABE_LOG_SYNC_SIZE;
+    uint64_t nRecords = sync.record;
+    char header[YABE_LOG_HEADER_SIZE];
+    char* payload = NULL;
+    size_t payloadSize = 0;
+    while( size - pos >= YABE_LOG_HEADER_SIZE &&
+           yabe_log_pread( fd, header, YABE_LOG_HEADER_SIZE, pos ) )
+    {
+        const uint32_t len = yabe_load_le32( header );
+        if( (len & YABE_LOG_SYNC_FLAG) || len == 0 || size - pos - YABE_LOG_HEADER_SIZE < len )
+            break;
+        if( len > payloadSize )
+        {
+            char* p = realloc( payload, len );
+            if( !p )
+                break;
+            payload = p;
+            payloadSize = len;
+        }
+        if( !yabe_log_pread( fd, payload, len, pos + YABE_LOG_HEADER_SIZE ) ||
+            yabe_crc32c( 0, payload, len ) != yabe_load_le32( header + 4 ) )
+            break;
+        pos += YABE_LOG_HEADER_SIZE + len;
+        ++nRecords;
+    }
+    free( payload );
+
+    info->interval = sync.interval;
+    info->nRecords = nRecords;
+    info->end = pos;
+    info->syncs = syncs;
+    info->nSyncs = nSyncs;
+    return true;
+}
+
+
+/* Load the layout of the log, from its footer or by recovering it */
+static bool yabe_log_load( int fd, yabe_log_info_t* info )
+{
+    struct stat st;
+    char signature[5];
+    if( fstat( fd, &st ) || st.st_size < 5 ||
+        !yabe_log_pread( fd, signature, 5, 0 ) )
+        return false;
+    yabe_cursor_t cursor = { signature, 5 };
+    if( yabe_read_signature( &cursor ) != 5 )
+        return false;
+    return yabe_log_load_footer( fd, (uint64_t)st.st_size, info ) ||
+           yabe_log_recover( fd, (uint64_t)st.st_size, info );
+}
+
+
+/* Make room for size more bytes in the batch */
+static bool yabe_log_reserve( yabe_log_writer_t* writer, size_t size )
+{
+    if( writer->batchLen + size <= writer->batchCapacity )
+        return true;
+    size_t capacity = writer->batchCapacity ? writer->batchCapacity : 4096;
+    while( capacity < writer->batchLen + size )
+        capacity *= 2;
+    char* batch = realloc( writer->batch, capacity );
+    if( !batch )
+        return false;
+    writer->batch = batch;
+    writer->batchCapacity = capacity;
+    return true;
+}
+
+
+/* Open or create a record log for appending records */
+bool yabe_log_writer_open( yabe_log_writer_t* writer, const char* path,
+                           uint32_t interval, size_t batchSize, bool durable )
+{
+    memset( writer, 0, sizeof(*writer) );
+    writer->durable = durable;
+    writer->interval = interval ? interval : YABE_LOG_INTERVAL;
+    writer->batchSize = batchSize ? batchSize : YABE_LOG_BATCH_SIZE;
+    writer->fd = open( path, O_RDWR | O_CREAT, 0644 );
+    if( writer->fd < 0 )
+        return false;
+
+    struct stat st;
+    if( fstat( writer->fd, &st ) )
+    {
+        close( writer->fd );
+        return false;
+    }
+    if( st.st_size == 0 )
+    {
+        char signature[5];
+        yabe_cursor_t cursor = { signature, 5 };
+        yabe_write_signature( &cursor );
+        if( !yabe_log_pwrite( writer->fd, signature, 5, 0 ) )
+        {
+            close( writer->fd );
+            return false;
+        }
+        writer->committed = 5;
+        return true;
+    }
+
+    // drop the footer and the torn frames, if any, and append after them
+    yabe_log_info_t info;
+    if( !yabe_log_load( writer->fd, &info ) )
+    {
+        close( writer->fd );
+        return false;
+    }
+    if( ftruncate( writer->fd, (off_t)info.end ) )
+    {
+        free( info.syncs );
+        close( writer->fd );
+        return false;
+    }
+    writer->interval = info.interval;
+    writer->nRecords = info.nRecords;
+    writer->committed = info.end;
+    writer->syncs = info.syncs;
+    writer->nSyncs = writer->syncCapacity = info.nSyncs;
+    return true;
+}
+
+
+/* Append a YABE encoded record to the log */
+size_t yabe_log_append( yabe_log_writer_t* writer, const void* data, size_t size )
+{
+    if( size == 0 || size >= YABE_LOG_SYNC_FLAG )
+        return 0;
+
+    size_t frameSize = YABE_LOG_HEADER_SIZE + size;
+    const bool needSync = writer->nRecords % writer->interval == 0;
+    if( needSync )
+    {
+        frameSize += YABE_LOG_HEADER_SIZE + YABE_LOG_SYNC_SIZE;
+        if( writer->nSyncs == writer->syncCapacity )
+        {
+            size_t capacity = writer->syncCapacity ? writer->syncCapacity * 2 : 64;
+            uint64_t* syncs = realloc( writer->syncs, capacity * sizeof(uint64_t) );
+            if( !syncs )
+                return 0;
+            writer->syncs = syncs;
+            writer->syncCapacity = capacity;
+        }
+    }
+    if( !yabe_log_reserve( writer, frameSize ) )
+        return 0;
+
+    char* p = writer->batch + writer->batchLen;
+    if( needSync )
+    {
+        yabe_log_sync_t sync = { writer->interval, writer->nRecords,
+            writer->nSyncs ? writer->syncs[writer->nSyncs - 1] : YABE_LOG_NO_SYNC };
+        writer->syncs[writer->nSyncs++] = writer->committed + writer->batchLen;
+        yabe_log_make_sync( p, &sync );
+        p += YABE_LOG_HEADER_SIZE + YABE_LOG_SYNC_SIZE;
+    }
+    yabe_store_le32( p, (uint32_t)size );
+    yabe_store_le32( p + 4, yabe_crc32c( 0, data, size ) );
+    memcpy( p + YABE_LOG_HEADER_SIZE, data, size );
+    writer->batchLen += frameSize;
+    ++writer->nRecords;
+
+    if( writer->batchLen >= writer->batchSize && !yabe_log_commit( writer ) )
+        return 0;
+    return frameSize;
+}
+
+
+/* Write the current batch to the file and make it durable if required */
+bool yabe_log_commit( yabe_log_writer_t* writer )
+{
+    if( writer->batchLen )
+    {
+        if( !yabe_log_pwrite( writer->fd, writer->batch, writer->batchLen, writer->committed ) )
+            return false;
+        writer->committed += writer->batchLen;
+        writer->batchLen = 0;
+    }
+    return !writer->durable || !fdatasync( writer->fd );
+}
+
+
+/* Commit the current batch, append the footer and close the log */
+bool yabe_log_writer_close( yabe_log_writer_t* writer )
+{
+    bool ok = yabe_log_commit( writer );
+    if( ok )
+    {
+        // the offsets are little endian, the index is freed after
+        const size_t indexSize = writer->nSyncs * sizeof(uint64_t);
+        for( size_t i = 0; i < writer->nSyncs; ++i )
+            yabe_store_le64( writer->syncs + i, writer->syncs[i] );
+        char trailer[YABE_LOG_TRAILER_SIZE];
+        yabe_store_le64( trailer, writer->nRecords );
+        yabe_store_le32( trailer + 8, (uint32_t)writer->nSyncs );
+        yabe_store_le32( trailer + 12, yabe_crc32c( yabe_crc32c( 0, writer->syncs, indexSize ), trailer, 12 ) );
+        memcpy( trailer + 16, "YLOGEND", 8 );
+        ok = yabe_log_pwrite( writer->fd, writer->syncs, indexSize, writer->committed ) &&
+             yabe_log_pwrite( writer->fd, trailer, sizeof(trailer), writer->committed + indexSize ) &&
+             (!writer->durable || !fdatasync( writer->fd ));
+    }
+    ok = !close( writer->fd ) && ok;
+    free( writer->syncs );
+    free( writer->batch );
+    memset( writer, 0, sizeof(*writer) );
+    writer->fd = -1;
+    return ok;
+}
+
+
+/* Open a record log for reading */
+bool yabe_log_reader_open( yabe_log_reader_t* reader, const char* path )
+{
+    memset( reader, 0, sizeof(*reader) );
+    reader->fd = open( path, O_RDONLY );
+    if( reader->fd < 0 )
+        return false;
+
+    yabe_log_info_t info;
+    if( !yabe_log_load( reader->fd, &info ) )
+    {
+        close( reader->fd );
+        reader->fd = -1;
+        return false;
+    }
+    reader->interval = info.interval;
+    reader->nRecords = info.nRecords;
+    reader->end = info.end;
+    reader->syncs = info.syncs;
+    reader->nSyncs = info.nSyncs;
+    reader->pos = 5;
+    return true;
+}
+
+
+/* Read the header of the frame at reader position, skipping sync frames,
+   and return the record length or 0 if a frame doesn't end before the
+   footer */
+static uint32_t yabe_log_header( yabe_log_reader_t* reader, uint32_t* crc )
+{
+    char header[YABE_LOG_HEADER_SIZE];
+    while( reader->pos <= reader->end && reader->end - reader->pos >= YABE_LOG_HEADER_SIZE &&
+           yabe_log_pread( reader->fd, header, YABE_LOG_HEADER_SIZE, reader->pos ) )
+    {
+        const uint32_t len = yabe_load_le32( header );
+        if( (len & ~YABE_LOG_SYNC_FLAG) > reader->end - reader->pos - YABE_LOG_HEADER_SIZE )
+            return 0;
+        if( !(len & YABE_LOG_SYNC_FLAG) )
+        {
+            *crc = yabe_load_le32( header + 4 );
+            return len;
+        }
+        reader->pos += YABE_LOG_HEADER_SIZE + (len & ~YABE_LOG_SYNC_FLAG);
+    }
+    return 0;
+}
+
+
+/* Position the reader on record number record */
+bool yabe_log_seek( yabe_log_reader_t* reader, uint64_t record )
+{
+    if( record > reader->nRecords )
+        return false;
+    const uint64_t i = record / reader->interval;
+    if( i >= reader->nSyncs )
+    {
+        reader->pos = reader->end;
+        reader->next = reader->nRecords;
+        return true;
+    }
+    reader->pos = reader->syncs[i];
+    reader->next = i * reader->interval;
+    while( reader->next < record )
+    {
+        uint32_t crc, len = yabe_log_header( reader, &crc );
+        if( !len )
+            return false;
+        reader->pos += YABE_LOG_HEADER_SIZE + len;
+        ++reader->next;
+    }
+    return true;
+}
+
+
+/* Read the next record and returns its number of bytes */
+size_t yabe_log_next( yabe_log_reader_t* reader, yabe_cursor_t* cursor )
+{
+    if( reader->next >= reader->nRecords )
+        return 0;
+    uint32_t crc, len = yabe_log_header( reader, &crc );
+    if( !len )
+        return 0;
+    if( len > reader->bufferSize )
+    {
+        char* buffer = realloc( reader->buffer, len );
+        if( !buffer )
+            return 0;
+        reader->buffer = buffer;
+        reader->bufferSize = len;
+    }
+    if( !yabe_log_pread( reader->fd, reader->buffer, len, reader->pos + YABE_LOG_HEADER_SIZE ) ||
+        yabe_crc32c( 0, reader->buffer, len ) != crc )
+        return 0;
+    reader->pos += YABE_LOG_HEADER_SIZE + len;
+    ++reader->next;
+    cursor->ptr = reader->buffer;
+    cursor->len = len;
+    return len;
+}
+
+
+/* Close the log and release the reader resources */
+void yabe_log_reader_close( yabe_log_reader_t* reader )
+{
+    if( reader->fd >= 0 )
+        close( reader->fd );
+    free( reader->syncs );
+    free( reader->buffer );
+    memset( reader, 0, sizeof(*reader) );
+    reader->fd = -1;
+}
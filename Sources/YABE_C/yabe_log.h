@@ -0,0 +1,181 @@
+#ifndef YABE_LOG_H
+#define YABE_LOG_H
+
+#include "yabe.h"
+
+/**
+   \page log_page Framed record log files
+
+   A YABE record log is a file of independent YABE encoded records, appended
+   one after the other. The file starts with a single YABE signature and each
+   record is stored in a frame :
+
+   \verbatim
+    [len32] [crc32c] [byte]*
+   \endverbatim
+
+   where \e len32 is the little endian number of bytes of the record and
+   \e crc32c the CRC32C checksum of these bytes.
+
+   Before every \e interval records the writer inserts a sync frame whose
+   \e len32 has its most significant bit set. Its 24 bytes contain the 'Y',
+   'S', 'Y', 'N' marker, the interval, the number of the next record and the
+   offset of the previous sync frame. When the log is closed, a footer with
+   the little endian offsets of all sync frames is appended :
+
+   \verbatim
+    [offset64]* [records64] [entries32] [crc32c] 'Y' 'L' 'O' 'G' 'E' 'N' 'D' 0
+   \endverbatim
+
+   A reader thus seeks to record N by reading the offset of its sync frame in
+   the footer and skipping at most \e interval frames. If the footer is
+   missing, because the writer didn't close the log or a write was torn, the
+   last valid sync frame is searched backward from the end of file, the
+   previous sync frames are found by following their back links and only the
+   frames after the last sync frame are checked. The log then ends at the
+   last frame with a valid checksum.
+
+   The writer accumulates frames in memory and writes them with a single
+   write() followed by a single fdatasync() when the batch is full or
+   yabe_log_commit() is called, so that the cost of making records durable is
+   shared by all the records of the batch (group commit).
+*/
+
+/// Default number of records between two sync frames
+#define YABE_LOG_INTERVAL 1024
+
+/// Default number of bytes accumulated before a group commit
+#define YABE_LOG_BATCH_SIZE (1024*1024)
+
+/**
+ * \brief Record log opened for appending records
+ */
+typedef struct yabe_log_writer_t
+{
+    int fd;              ///< File descriptor of the log file
+    bool durable;        ///< If true, commits call fdatasync()
+    uint32_t interval;   ///< Number of records between sync frames
+    uint64_t nRecords;   ///< Number of records in the log
+    uint64_t committed;  ///< Number of bytes written to the file
+    uint64_t* syncs;     ///< Offsets of the sync frames
+    size_t nSyncs;       ///< Number of sync frames
+    size_t syncCapacity; ///< Number of allocated sync offsets
+    char* batch;         ///< Frames not yet written to the file
+    size_t batchLen;     ///< Number of bytes in batch
+    size_t batchCapacity;///< Number of allocated bytes for batch
+    size_t batchSize;    ///< Number of bytes triggering a group commit
+} yabe_log_writer_t;
+
+
+/**
+ * \brief Record log opened for reading records
+ */
+typedef struct yabe_log_reader_t
+{
+    int fd;              ///< File descriptor of the log file
+    uint32_t interval;   ///< Number of records between sync frames
+    uint64_t nRecords;   ///< Number of valid records in the log
+    uint64_t end;        ///< Offset of the end of the last valid frame
+    uint64_t* syncs;     ///< Offsets of the sync frames
+    size_t nSyncs;       ///< Number of sync frames
+    uint64_t pos;        ///< Offset of the next frame to read
+    uint64_t next;       ///< Number of the next record to read
+    char* buffer;        ///< Buffer holding the last record read
+    size_t bufferSize;   ///< Number of allocated bytes for buffer
+} yabe_log_reader_t;
+
+
+/**
+ * \brief Open or create a record log for appending records
+ *
+ * If the log exists, its footer or torn frames are truncated and the new
+ * records are appended after the last valid record. Its interval is kept.
+ *
+ * \param[out] writer Writer to initialize
+ * \param path Path of the log file
+ * \param interval Number of records between sync frames for a new log, 0
+ *                 selects YABE_LOG_INTERVAL
+ * \param batchSize Number of bytes triggering a group commit, 0 selects
+ *                  YABE_LOG_BATCH_SIZE
+ * \param durable If true, each group commit calls fdatasync()
+ * \return true if the log could be opened, false otherwise
+ */
+bool yabe_log_writer_open( yabe_log_writer_t* writer, const char* path,
+                           uint32_t interval, size_t batchSize, bool durable );
+
+
+/**
+ * \brief Append a YABE encoded record to the log and returns the number of
+ *  bytes appended
+ *
+ * The record is added to the current batch, which is committed if it holds
+ * at least batchSize bytes.
+ *
+ * \param[in,out] writer Writer opened by yabe_log_writer_open()
+ * \param data Pointer on the encoded record
+ * \param size Number of bytes of the record, smaller than 2^31
+ * \return the number of bytes of the frame, \e fail : 0
+ */
+size_t yabe_log_append( yabe_log_writer_t* writer, const void* data, size_t size );
+
+
+/**
+ * \brief Write the current batch to the file and make it durable if required
+ *
+ * \param[in,out] writer Writer opened by yabe_log_writer_open()
+ * \return true if the batch could be written, false otherwise
+ */
+bool yabe_log_commit( yabe_log_writer_t* writer );
+
+
+/**
+ * \brief Commit the current batch, append the footer and close the log
+ *
+ * \param[in,out] writer Writer opened by yabe_log_writer_open()
+ * \return true if the log could be closed cleanly, false otherwise
+ */
+bool yabe_log_writer_close( yabe_log_writer_t* writer );
+
+
+/**
+ * \brief Open a record log for reading
+ *
+ * \param[out] reader Reader to initialize, positioned on the first record
+ * \param path Path of the log file
+ * \return true if the file is a record log, false otherwise
+ */
+bool yabe_log_reader_open( yabe_log_reader_t* reader, const char* path );
+
+
+/**
+ * \brief Position the reader on record number record
+ *
+ * \param[in,out] reader Reader opened by yabe_log_reader_open()
+ * \param record Number of the record to read next, starting with 0
+ * \return true if the record exists, false otherwise
+ */
+bool yabe_log_seek( yabe_log_reader_t* reader, uint64_t record );
+
+
+/**
+ * \brief Read the next record and returns its number of bytes
+ *
+ * The cursor points into a buffer owned by the reader, valid until the next
+ * call to yabe_log_next() or yabe_log_reader_close().
+ *
+ * \param[in,out] reader Reader opened by yabe_log_reader_open()
+ * \param[out] cursor Reading cursor on the record bytes
+ * \return the number of bytes of the record, \e fail : 0 at the end of log
+ *         or if the record could not be read
+ */
+size_t yabe_log_next( yabe_log_reader_t* reader, yabe_cursor_t* cursor );
+
+
+/**
+ * \brief Close the log and release the reader resources
+ *
+ * \param[in,out] reader Reader opened by yabe_log_reader_open()
+ */
+void yabe_log_reader_close( yabe_log_reader_t* reader );
+
+#endif // YABE_LOG_H
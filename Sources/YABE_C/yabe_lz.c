@@ -0,0 +1,164 @@
+#include <string.h>
+#include <stdbool.h>
+
+#include "yabe_lz.h"
+
+
+#define YABE_LZ_HASH_LOG   12      // number of bits of the hash table index
+#define YABE_LZ_MIN_MATCH  4       // minimum match length
+#define YABE_LZ_MAX_OFFSET 65535   // maximum match distance
+#define YABE_LZ_LAST_LITERALS 5    // the last bytes are always literals
+#define YABE_LZ_MF_LIMIT   12      // no match may start in the last bytes
+
+
+static uint32_t yabe_lz_read32( const uint8_t* p )
+    { uint32_t v; memcpy( &v, p, 4 ); return v; }
+
+static uint32_t yabe_lz_hash( uint32_t sequence )
+    { return (sequence * 2654435761U) >> (32 - YABE_LZ_HASH_LOG); }
+
+
+/* Write a length extension : bytes of 255 followed by the remainder */
+static uint8_t* yabe_lz_put_length( uint8_t* op, size_t len )
+{
+    for( ; len >= 255; len -= 255 )
+        *op++ = 255;
+    *op++ = (uint8_t)len;
+    return op;
+}
+
+
+/* Write a sequence of literals followed by a match if matchLen is not 0,
+   return NULL if it doesn't fit in the destination */
+static uint8_t* yabe_lz_put_sequence( uint8_t* op, const uint8_t* oend,
+                                      const uint8_t* literals, size_t litLen,
+                                      size_t offset, size_t matchLen )
+{
+    if( (size_t)(oend - op) < 1 + litLen / 255 + 1 + litLen + 2 + matchLen / 255 + 1 )
+        return NULL;
+    uint8_t* token = op++;
+    *token = (uint8_t)((litLen < 15 ? litLen : 15) << 4);
+    if( litLen >= 15 )
+        op = yabe_lz_put_length( op, litLen - 15 );
+    memcpy( op, literals, litLen );
+    op += litLen;
+    if( matchLen == 0 )
+        return op;
+
+    *op++ = (uint8_t)offset;
+    *op++ = (uint8_t)(offset >> 8);
+    matchLen -= YABE_LZ_MIN_MATCH;
+    *token |= (uint8_t)(matchLen < 15 ? matchLen : 15);
+    if( matchLen >= 15 )
+        op = yabe_lz_put_length( op, matchLen - 15 );
+    return op;
+}
+
+
+/* Compress srcSize bytes into dst and returns the compressed size */
+size_t yabe_lz_compress( const void* src, size_t srcSize, void* dst, size_t dstCapacity )
+{
+    const uint8_t* const base = src;
+    const uint8_t* const iend = base + srcSize;
+    const uint8_t* ip = base;
+    const uint8_t* anchor = base;
+    uint8_t* op = dst;
+    const uint8_t* const oend = op + dstCapacity;
+
+    if( srcSize > YABE_LZ_MF_LIMIT )
+    {
+        const uint8_t* const mfLimit = iend - YABE_LZ_MF_LIMIT;
+        const uint8_t* const matchLimit = iend - YABE_LZ_LAST_LITERALS;
+        uint32_t table[1 << YABE_LZ_HASH_LOG];
+        memset( table, 0, sizeof(table) );
+
+        while( ip < mfLimit )
+        {
+            const uint32_t sequence = yabe_lz_read32( ip );
+            const uint32_t h = yabe_lz_hash( sequence );
+            const uint8_t* ref = base + table[h];
+            table[h] = (uint32_t)(ip - base);
+            if( ref >= ip || ip - ref > YABE_LZ_MAX_OFFSET || yabe_lz_read32( ref ) != sequence )
+            {
+                ++ip;
+                continue;
+            }
+
+            // extend the match backward over the pending literals, then forward
+            while( ip > anchor && ref > base && ip[-1] == ref[-1] )
+                --ip, --ref;
+            size_t matchLen = YABE_LZ_MIN_MATCH;
+            while( ip + matchLen < matchLimit && ip[matchLen] == ref[matchLen] )
+                ++matchLen;
+
+            op = yabe_lz_put_sequence( op, oend, anchor, ip - anchor, ip - ref, matchLen );
+            if( !op )
+                return 0;
+            ip += matchLen;
+            anchor = ip;
+        }
+    }
+    op = yabe_lz_put_sequence( op, oend, anchor, iend - anchor, 0, 0 );
+    return op ? (size_t)(op - (uint8_t*)dst) : 0;
+}
+
+
+/* Read a length extension, return false if it is truncated */
+static bool yabe_lz_get_length( const uint8_t** ip, const uint8_t* iend, size_t* len )
+{
+    uint8_t byte;
+    do
+    {
+        if( *ip == iend )
+            return false;
+        byte = *(*ip)++;
+        *len += byte;
+    } while( byte == 255 );
+    return true;
+}
+
+
+/* Decompress srcSize bytes into dst and returns the decompressed size */
+size_t yabe_lz_decompress( const void* src, size_t srcSize, void* dst, size_t dstCapacity )
+{
+    const uint8_t* ip = src;
+    const uint8_t* const iend = ip + srcSize;
+    uint8_t* op = dst;
+    uint8_t* const oend = op + dstCapacity;
+
+    while( ip < iend )
+    {
+        const uint8_t token = *ip++;
+        size_t litLen = token >> 4;
+        if( litLen == 15 && !yabe_lz_get_length( &ip, iend, &litLen ) )
+            return 0;
+        if( (size_t)(iend - ip) < litLen || (size_t)(oend - op) < litLen )
+            return 0;
+        memcpy( op, ip, litLen );
+        ip += litLen;
+        op += litLen;
+        if( ip == iend )
+            break;  // the last sequence has no match
+
+        if( iend - ip < 2 )
+            return 0;
+        const size_t offset = ip[0] | ((size_t)ip[1] << 8);
+        ip += 2;
+        size_t matchLen = token & 15;
+        if( matchLen == 15 && !yabe_lz_get_length( &ip, iend, &matchLen ) )
+            return 0;
+        matchLen += YABE_LZ_MIN_MATCH;
+        if( offset == 0 || offset > (size_t)(op - (uint8_t*)dst) ||
+            (size_t)(oend - op) < matchLen )
+            return 0;
+
+        // a match overlapping the output must be copied byte per byte
+        const uint8_t* ref = op - offset;
+        if( offset >= matchLen )
+            memcpy( op, ref, matchLen ), op += matchLen;
+        else
+            while( matchLen-- )
+                *op++ = *ref++;
+    }
+    return op - (uint8_t*)dst;
+}
@@ -0,0 +1,52 @@
+#ifndef YABE_LZ_H
+#define YABE_LZ_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+   \page lz_page LZ block codec
+
+   A small LZ77 codec producing the LZ4 block format, used to compress the
+   blocks of YABE encoded data. It favors speed over compression ratio : the
+   matches are found with a single hash table of 4 byte sequences and the
+   decoder is a simple loop copying literals and matches. Decoding checks all
+   bounds so that corrupted data can't make it read or write out of its
+   buffers.
+*/
+
+/**
+ * \brief Return the maximum compressed size of size bytes
+ *
+ * \param size Number of bytes to compress
+ * \return the size of a destination buffer large enough for any data
+ */
+static inline size_t yabe_lz_bound( size_t size )
+    { return size + size / 255 + 16; }
+
+
+/**
+ * \brief Compress srcSize bytes into dst and returns the compressed size
+ *
+ * \param src Pointer on the bytes to compress
+ * \param srcSize Number of bytes to compress
+ * \param dst Pointer on the buffer where to write the compressed bytes
+ * \param dstCapacity Number of bytes available at dst
+ * \return the number of compressed bytes, \e fail : 0 if dst is too small
+ */
+size_t yabe_lz_compress( const void* src, size_t srcSize, void* dst, size_t dstCapacity );
+
+
+/**
+ * \brief Decompress srcSize bytes into dst and returns the decompressed size
+ *
+ * \param src Pointer on the compressed bytes
+ * \param srcSize Number of compressed bytes
+ * \param dst Pointer on the buffer where to write the decompressed bytes
+ * \param dstCapacity Number of bytes available at dst
+ * \return the number of decompressed bytes, \e fail : 0 if the data is
+ *         invalid or dst is too small
+ */
+size_t yabe_lz_decompress( const void* src, size_t srcSize, void* dst, size_t dstCapacity );
+
+#endif // YABE_LZ_H
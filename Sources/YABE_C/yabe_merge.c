@@ -0,0 +1,335 @@
+#include <stdlib.h>
+
+#include "yabe_merge.h"
+#include "yabe_canonical.h"
+
+
+/* Set v on the bytes of the value at cursor position and move the cursor
+   after it, return false if it is invalid */
+static bool yabe_merge_value( yabe_cursor_t* c, yabe_cursor_t* v )
+{
+    yabe_read_none( c );
+    if( yabe_end_of_buffer( c ) )
+        return false;
+    v->ptr = c->ptr;
+    return (v->len = yabe_skip_value( c )) != 0;
+}
+
+
+/* Return true if the value at cursor position is an object */
+static bool yabe_merge_is_object( const yabe_cursor_t* v )
+{
+    const int8_t tag = yabe_peek_tag( v );
+    return tag >= yabe_sobject_tag && tag <= yabe_objects_tag;
+}
+
+
+/* Return true if the value at cursor position is null */
+static bool yabe_merge_is_null( const yabe_cursor_t* v )
+{
+    return yabe_peek_tag( v ) == yabe_null_tag;
+}
+
+
+/* Read the member at cursor position, return 1 if one was read, 0 at the
+   end of the object and -1 if it is invalid. left is the number of members
+   left in a small object, -1 in a stream */
+static int yabe_merge_next( yabe_cursor_t* c, int8_t* left, yabe_member_t* m )
+{
+    if( *left == 0 )
+        return 0;
+    yabe_read_none( c );
+    if( yabe_end_of_buffer( c ) )
+        return -1;
+    if( *left < 0 && yabe_read_end_stream( c ) )
+    {
+        *left = 0;
+        return 0;
+    }
+    if( !yabe_read_string_view( c, &m->key ) || !yabe_merge_value( c, &m->value ) )
+        return -1;
+    m->used = false;
+    if( *left > 0 )
+        --*left;
+    return 1;
+}
+
+
+/* Read the header of the object at cursor position, set left as for
+   yabe_merge_next() */
+static bool yabe_merge_open( yabe_cursor_t* c, int8_t* left )
+{
+    if( yabe_read_small_object( c, left ) )
+        return true;
+    *left = -1;
+    return yabe_read_object_stream( c );
+}
+
+
+/* Locate the members of the object v and sort them by identifier, return
+   the number of members or -1 if it is invalid or has duplicate members */
+static long yabe_merge_members( const yabe_cursor_t* v, yabe_member_t* small,
+                                yabe_member_t** members )
+{
+    yabe_cursor_t c = *v;
+    const long n = yabe_read_members( &c, small, members );
+    if( n < 0 || yabe_sort_members( *members, n ) )
+        return n;
+    if( *members != small )
+        free( *members );
+    return -1;
+}
+
+
+/* Write an object header to be completed by yabe_merge_end() */
+static bool yabe_merge_begin( yabe_cursor_t* w, char** tag )
+{
+    *tag = w->ptr;
+    return yabe_write_small_object( w, 0 );
+}
+
+
+/* Complete an object of n members written after its header */
+static bool yabe_merge_end( yabe_cursor_t* w, char* tag, long n )
+{
+    yabe_cursor_t header = { tag, 1 };
+    if( n < 7 )
+        return yabe_write_small_object( &header, n );
+    return yabe_write_object_stream( &header ) && yabe_write_end_stream( w );
+}
+
+
+/* Write the member identifier */
+static bool yabe_merge_key( yabe_cursor_t* w, const yabe_string_view_t* key )
+{
+    return yabe_write_string( w, key->len ) &&
+           yabe_write_data( w, key->ptr, key->len ) == key->len;
+}
+
+
+/* Return false if an object of the value v has a null member, which a
+   patch can't set */
+static bool yabe_merge_settable( const yabe_cursor_t* v, unsigned depth )
+{
+    if( depth > YABE_MAX_DEPTH )
+        return false;
+    if( !yabe_merge_is_object( v ) )
+        return true;
+    yabe_member_t small[YABE_SMALL_MEMBERS], *members;
+    const long n = yabe_merge_members( v, small, &members );
+    bool res = n >= 0;
+    for( long i = 0; i < n && res; ++i )
+        res = !yabe_merge_is_null( &members[i].value ) &&
+              yabe_merge_settable( &members[i].value, depth + 1 );
+    if( n >= 0 && members != small )
+        free( members );
+    return res;
+}
+
+
+/* Write the value v as a patch replacing the original value */
+static bool yabe_merge_set( yabe_cursor_t* w, const yabe_cursor_t* v )
+{
+    return yabe_merge_settable( v, 0 ) && yabe_write_data( w, v->ptr, v->len ) == v->len;
+}
+
+
+/* Write a patch member replacing the original member by the value v */
+static bool yabe_merge_set_member( yabe_cursor_t* w, const yabe_string_view_t* key,
+                                   const yabe_cursor_t* v )
+{
+    return !yabe_merge_is_null( v ) && yabe_merge_key( w, key ) && yabe_merge_set( w, v );
+}
+
+
+/* Write the patch transforming the value a into the value b */
+static bool yabe_diff( const yabe_cursor_t* a, const yabe_cursor_t* b, yabe_cursor_t* w,
+                       unsigned depth )
+{
+    if( depth > YABE_MAX_DEPTH )
+        return false;
+    if( !yabe_merge_is_object( a ) || !yabe_merge_is_object( b ) )
+        return yabe_merge_set( w, b );
+
+    yabe_member_t smallA[YABE_SMALL_MEMBERS], smallB[YABE_SMALL_MEMBERS], *ma, *mb;
+    const long na = yabe_merge_members( a, smallA, &ma );
+    if( na < 0 )
+        return false;
+    const long nb = yabe_merge_members( b, smallB, &mb );
+    char* tag;
+    long i = 0, j = 0, n = 0;
+    bool res = nb >= 0 && yabe_merge_begin( w, &tag );
+
+    // walk both sorted member lists, writing the members that differ
+    while( res && (i < na || j < nb) )
+    {
+        const int cmp = (i == na) ? 1 : (j == nb) ? -1 : yabe_compare_keys( &ma[i].key, &mb[j].key );
+        if( cmp < 0 )
+        {
+            res = yabe_merge_key( w, &ma[i++].key ) && yabe_write_null( w );
+            ++n;
+            continue;
+        }
+        if( cmp > 0 )
+        {
+            res = yabe_merge_set_member( w, &mb[j].key, &mb[j].value );
+            ++j;
+            ++n;
+            continue;
+        }
+
+        const yabe_cursor_t* va = &ma[i++].value;
+        const yabe_cursor_t* vb = &mb[j].value;
+        if( va->len == vb->len && !memcmp( va->ptr, vb->ptr, va->len ) )
+        {
+            ++j;
+            continue;
+        }
+        const yabe_cursor_t mark = *w;
+        if( yabe_merge_is_object( va ) && yabe_merge_is_object( vb ) )
+        {
+            // objects are patched, unless their difference is empty
+            res = yabe_merge_key( w, &mb[j].key );
+            const char* const sub = w->ptr;
+            res = res && yabe_diff( va, vb, w, depth + 1 );
+            if( res && w->ptr - sub == 1 && *(const int8_t*)sub == yabe_sobject_tag )
+                *w = mark;
+            else
+                ++n;
+        }
+        else if( !yabe_equal_values( va, vb ) )
+        {
+            res = yabe_merge_set_member( w, &mb[j].key, vb );
+            ++n;
+        }
+        ++j;
+    }
+    res = res && yabe_merge_end( w, tag, n );
+    if( ma != smallA )
+        free( ma );
+    if( nb >= 0 && mb != smallB )
+        free( mb );
+    return res;
+}
+
+
+/* Write the merge patch transforming from into to */
+size_t yabe_merge_diff( const yabe_cursor_t* from, const yabe_cursor_t* to,
+                        yabe_cursor_t* patch )
+{
+    // objects are only read through their members, they are not skipped first
+    yabe_cursor_t a = *from, b = *to, va, vb, w = *patch;
+    yabe_read_none( &a );
+    yabe_read_none( &b );
+    if( yabe_end_of_buffer( &a ) || yabe_end_of_buffer( &b ) )
+        return 0;
+    if( yabe_merge_is_object( &a ) && yabe_merge_is_object( &b ) )
+    {
+        va = a;
+        vb = b;
+    }
+    else if( !yabe_merge_value( &a, &va ) || !yabe_merge_value( &b, &vb ) )
+        return 0;
+    if( !yabe_diff( &va, &vb, &w, 0 ) )
+        return 0;
+    const size_t len = w.ptr - patch->ptr;
+    *patch = w;
+    return len;
+}
+
+
+/* Write the bytes of the base members left unchanged, from run to end */
+static bool yabe_merge_flush( yabe_cursor_t* w, const char* run, const char* end )
+{
+    const size_t len = end - run;
+    return yabe_write_data( w, run, len ) == len;
+}
+
+
+/* Write the value base changed by the patch p, base is NULL if the value
+   is missing */
+static bool yabe_apply( const yabe_cursor_t* base, const yabe_cursor_t* p, yabe_cursor_t* w,
+                        unsigned depth )
+{
+    if( depth > YABE_MAX_DEPTH )
+        return false;
+    if( !yabe_merge_is_object( p ) )
+        return yabe_write_data( w, p->ptr, p->len ) == p->len;
+
+    yabe_member_t small[YABE_SMALL_MEMBERS], *members;
+    const long np = yabe_merge_members( p, small, &members );
+    if( np < 0 )
+        return false;
+    char* tag;
+    long n = 0;
+    bool res = yabe_merge_begin( w, &tag );
+
+    if( res && base && yabe_merge_is_object( base ) )
+    {
+        // stream the base members, the unchanged ones are copied by runs
+        yabe_cursor_t c = *base;
+        int8_t left;
+        yabe_member_t m;
+        const char* run = NULL;
+        const char* runEnd = NULL;
+        int next = yabe_merge_open( &c, &left ) ? 1 : -1;
+        while( res && next > 0 )
+        {
+            const char* const start = c.ptr;
+            if( (next = yabe_merge_next( &c, &left, &m )) <= 0 )
+                break;
+            yabe_member_t* found = bsearch( &m, members, np, sizeof(yabe_member_t),
+                                            yabe_compare_members );
+            if( !found )
+            {
+                if( !run )
+                    run = start;
+                runEnd = c.ptr;
+                ++n;
+                continue;
+            }
+            found->used = true;
+            if( run )
+                res = yabe_merge_flush( w, run, runEnd );
+            run = NULL;
+            if( res && !yabe_merge_is_null( &found->value ) )
+            {
+                res = yabe_merge_key( w, &m.key ) &&
+                      yabe_apply( &m.value, &found->value, w, depth + 1 );
+                ++n;
+            }
+        }
+        if( run && res )
+            res = yabe_merge_flush( w, run, runEnd );
+        res = res && next == 0;
+    }
+
+    // the members missing in the base are added
+    for( long i = 0; i < np && res; ++i )
+        if( !members[i].used && !yabe_merge_is_null( &members[i].value ) )
+        {
+            res = yabe_merge_key( w, &members[i].key ) &&
+                  yabe_apply( NULL, &members[i].value, w, depth + 1 );
+            ++n;
+        }
+    res = res && yabe_merge_end( w, tag, n );
+    if( members != small )
+        free( members );
+    return res;
+}
+
+
+/* Write the value base changed by the merge patch */
+size_t yabe_merge_apply( const yabe_cursor_t* base, const yabe_cursor_t* patch,
+                         yabe_cursor_t* out )
+{
+    // the base is only read through its members, it is not skipped first
+    yabe_cursor_t b = *base, p = *patch, vp, w = *out;
+    yabe_read_none( &b );
+    if( yabe_end_of_buffer( &b ) || !yabe_merge_value( &p, &vp ) ||
+        !yabe_apply( &b, &vp, &w, 0 ) )
+        return 0;
+    const size_t len = w.ptr - out->ptr;
+    *out = w;
+    return len;
+}
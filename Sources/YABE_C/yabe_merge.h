@@ -0,0 +1,82 @@
+#ifndef YABE_MERGE_H
+#define YABE_MERGE_H
+
+#include "yabe.h"
+
+/**
+   \page merge_page Differences and merge patches
+
+   A merge patch describes the changes from one value to another with the
+   semantics of the JSON merge patch (RFC 7386), the patch being itself a
+   YABE encoded value :
+
+    <ul>
+    <li> a patch that is not an object replaces the value ;
+    <li> a patch object changes the members of an object : a \e null member
+         removes the member, any other member is merged into the member of
+         the same identifier, which is added if missing. A value that is not
+         an object is first replaced by an empty object.
+    </ul>
+
+   Arrays are always replaced as a whole. An object member can't be set to
+   \e null by a patch, since \e null removes it.
+
+   yabe_merge_diff() walks the two values in lockstep : members with the
+   same encoded bytes are skipped with a single comparison, only the
+   members that differ are inspected. The patch members are sorted by
+   identifier.
+
+   yabe_merge_apply() reads the base document once and writes the patched
+   document : members not in the patch are copied as byte ranges, and an
+   object header is written before its members are counted and updated
+   once they are all written.
+
+   \code
+    // sender
+    if( !yabe_merge_diff( &previous, &current, &wCur ) ) { ... }
+    ... send the patch ...
+    // receiver
+    if( !yabe_merge_apply( &document, &patch, &wCur ) ) { ... }
+   \endcode
+*/
+
+
+/**
+ * \brief Tries writing the merge patch transforming the value from into the
+ *  value to and returns the number of bytes written
+ *
+ * When the values are equal, the patch is an empty object if they are
+ * objects, the value to otherwise.
+ *
+ * \param from Pointer on buffer where to read the original value, left
+ *             unchanged
+ * \param to Pointer on buffer where to read the changed value, left
+ *           unchanged
+ * \param[in,out] patch Pointer on buffer info where to write the patch,
+ *                      updated if the patch could be written
+ * \return the number of bytes written, \e fail : 0 if a value is invalid,
+ *         an object has duplicate member identifiers, the change sets an
+ *         object member to \e null or patch is too small
+ */
+size_t yabe_merge_diff( const yabe_cursor_t* from, const yabe_cursor_t* to,
+                        yabe_cursor_t* patch );
+
+
+/**
+ * \brief Tries writing the value at base position changed by the merge
+ *  patch and returns the number of bytes written
+ *
+ * \param base Pointer on buffer where to read the value to change, left
+ *             unchanged
+ * \param patch Pointer on buffer where to read the merge patch, left
+ *              unchanged
+ * \param[in,out] out Pointer on buffer info where to write the changed
+ *                    value, updated if the value could be written
+ * \return the number of bytes written, \e fail : 0 if a value is invalid,
+ *         a patch object has duplicate member identifiers or out is too
+ *         small
+ */
+size_t yabe_merge_apply( const yabe_cursor_t* base, const yabe_cursor_t* patch,
+                         yabe_cursor_t* out );
+
+#endif // YABE_MERGE_H
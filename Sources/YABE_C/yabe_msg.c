@@ -0,0 +1,179 @@
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+
+#include "yabe_msg.h"
+#include "yabe_endian.h"
+
+
+/* Map a ring buffer of capacity bytes twice in a row, return NULL on error */
+static char* yabe_msg_map_ring( size_t capacity )
+{
+    int fd = memfd_create( "yabe_msg", MFD_CLOEXEC );
+    if( fd < 0 )
+        return NULL;
+    char* ring = NULL;
+    if( !ftruncate( fd, (off_t)capacity ) )
+    {
+        // reserve the address range, then map the file in both halves
+        void* area = mmap( NULL, 2 * capacity, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+        if( area != MAP_FAILED )
+        {
+            if( mmap( area, capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0 ) != MAP_FAILED &&
+                mmap( (char*)area + capacity, capacity, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_FIXED, fd, 0 ) != MAP_FAILED )
+                ring = area;
+            else
+                munmap( area, 2 * capacity );
+        }
+    }
+    close( fd );
+    return ring;
+}
+
+
+/* Initialize a connection on a socket */
+bool yabe_msg_conn_init( yabe_msg_conn_t* conn, int fd, size_t capacity )
+{
+    memset( conn, 0, sizeof(*conn) );
+    conn->fd = fd;
+    const size_t page = (size_t)sysconf( _SC_PAGESIZE );
+    capacity = capacity ? capacity : YABE_MSG_CAPACITY;
+    conn->capacity = (capacity + page - 1) / page * page;
+    conn->ring = yabe_msg_map_ring( conn->capacity );
+    return conn->ring != NULL;
+}
+
+
+/* Release the connection resources */
+void yabe_msg_conn_free( yabe_msg_conn_t* conn )
+{
+    if( conn->ring )
+        munmap( conn->ring, 2 * conn->capacity );
+    free( conn->queue );
+    memset( conn, 0, sizeof(*conn) );
+    conn->fd = -1;
+}
+
+
+/* Receive the available bytes into the ring buffer */
+long yabe_msg_recv( yabe_msg_conn_t* conn )
+{
+    const size_t room = conn->capacity - (size_t)(conn->tail - conn->head);
+    if( room == 0 )
+    {
+        errno = EAGAIN;
+        return -1;
+    }
+    ssize_t res;
+    do
+        res = read( conn->fd, conn->ring + conn->tail % conn->capacity, room );
+    while( res < 0 && errno == EINTR );
+    if( res > 0 )
+        conn->tail += res;
+    return res;
+}
+
+
+/* Return a cursor on the next complete received message */
+size_t yabe_msg_next( yabe_msg_conn_t* conn, yabe_cursor_t* msg )
+{
+    const uint64_t available = conn->tail - conn->head;
+    if( conn->error || available < 4 )
+        return 0;
+
+    // the ring is mapped twice, so the message is contiguous even if it wraps
+    char* p = conn->ring + conn->head % conn->capacity;
+    const uint32_t len = yabe_load_le32( p );
+    if( len == 0 || len > conn->capacity - 4 )
+    {
+        conn->error = true;
+        return 0;
+    }
+    if( available - 4 < len )
+        return 0;
+    msg->ptr = p + 4;
+    msg->len = len;
+    conn->head += 4 + len;
+    return len;
+}
+
+
+/* Queue a message to send */
+bool yabe_msg_send( yabe_msg_conn_t* conn, const void* data, size_t size )
+{
+    if( size == 0 || size > UINT32_MAX )
+        return false;
+    if( conn->queueLen == conn->queueCapacity )
+    {
+        size_t capacity = conn->queueCapacity ? conn->queueCapacity * 2 : YABE_MSG_BATCH;
+        yabe_msg_out_t* queue = realloc( conn->queue, capacity * sizeof(yabe_msg_out_t) );
+        if( !queue )
+            return false;
+        conn->queue = queue;
+        conn->queueCapacity = capacity;
+    }
+    yabe_msg_out_t* out = &conn->queue[conn->queueLen++];
+    yabe_store_le32( out->header, (uint32_t)size );
+    out->data = data;
+    out->len = size;
+    return true;
+}
+
+
+/* Send queued messages with writev until the socket would block */
+long yabe_msg_flush( yabe_msg_conn_t* conn )
+{
+    long nSent = 0;
+    size_t first = 0;
+    bool failed = false;
+    while( first < conn->queueLen )
+    {
+        // gather the header and bytes of a batch of messages
+        struct iovec iov[2 * YABE_MSG_BATCH];
+        int nIov = 0;
+        size_t skip = conn->sentBytes;
+        for( size_t i = first; i < conn->queueLen && nIov < 2 * YABE_MSG_BATCH; ++i )
+        {
+            yabe_msg_out_t* out = &conn->queue[i];
+            if( skip < 4 )
+            {
+                iov[nIov].iov_base = out->header + skip;
+                iov[nIov++].iov_len = 4 - skip;
+                skip = 0;
+            }
+            else
+                skip -= 4;
+            iov[nIov].iov_base = (char*)out->data + skip;
+            iov[nIov++].iov_len = out->len - skip;
+            skip = 0;
+        }
+
+        ssize_t res;
+        do
+            res = writev( conn->fd, iov, nIov );
+        while( res < 0 && errno == EINTR );
+        if( res <= 0 )
+        {
+            failed = res < 0 && errno != EAGAIN && errno != EWOULDBLOCK;
+            break;
+        }
+
+        // drop the messages completely sent
+        size_t sent = (size_t)res + conn->sentBytes;
+        while( first < conn->queueLen && sent >= 4 + conn->queue[first].len )
+        {
+            sent -= 4 + conn->queue[first].len;
+            ++first;
+            ++nSent;
+        }
+        conn->sentBytes = sent;
+    }
+    memmove( conn->queue, conn->queue + first, (conn->queueLen - first) * sizeof(yabe_msg_out_t) );
+    conn->queueLen -= first;
+    return failed ? -1 : nSent;
+}
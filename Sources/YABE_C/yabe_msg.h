@@ -0,0 +1,154 @@
+#ifndef YABE_MSG_H
+#define YABE_MSG_H
+
+#include "yabe.h"
+
+/**
+   \page msg_page Message framing on non-blocking sockets
+
+   YABE encoded messages exchanged on a stream socket are framed by a 32 bit
+   little endian length followed by the message bytes. A connection object
+   wraps a non-blocking socket to be driven by an event loop such as epoll :
+
+    <ul>
+    <li> when the socket is readable, yabe_msg_recv() appends the received
+         bytes to the receive ring buffer, then yabe_msg_next() returns a
+         cursor on each complete message, in place in the ring buffer ;
+    <li> yabe_msg_send() queues a message without copying it and
+         yabe_msg_flush() sends as many queued messages as possible with a
+         single writev() ; while yabe_msg_pending() is true, the event loop
+         should wait for the socket to be writable and flush again.
+    </ul>
+
+   The receive ring buffer is mapped twice in a row in memory, so the bytes
+   of a message wrapping around its end are still contiguous and can be
+   decoded in place.
+
+   \code
+    yabe_msg_conn_t conn;
+    yabe_cursor_t msg;
+    if( !yabe_msg_conn_init( &conn, fd, 0 ) ) { ... }
+    // on EPOLLIN
+    while( yabe_msg_recv( &conn ) > 0 )
+        while( yabe_msg_next( &conn, &msg ) )
+            { ... decode msg ... }
+   \endcode
+*/
+
+/// Default capacity of the receive ring buffer
+#define YABE_MSG_CAPACITY (256*1024)
+
+/// Maximum number of queued messages sent by one writev()
+#define YABE_MSG_BATCH 64
+
+/**
+ * \brief Outgoing message queued on a connection
+ */
+typedef struct yabe_msg_out_t
+{
+    char header[4];       ///< Little endian message length
+    const char* data;     ///< Pointer on the message bytes, owned by the user
+    size_t len;           ///< Number of bytes of the message
+} yabe_msg_out_t;
+
+
+/**
+ * \brief Framed message connection on a non-blocking stream socket
+ */
+typedef struct yabe_msg_conn_t
+{
+    int fd;               ///< Socket file descriptor
+    char* ring;           ///< Receive ring buffer, mapped twice in a row
+    size_t capacity;      ///< Number of bytes of the ring buffer
+    uint64_t head;        ///< Total number of bytes consumed
+    uint64_t tail;        ///< Total number of bytes received
+    yabe_msg_out_t* queue;///< Queued outgoing messages
+    size_t queueLen;      ///< Number of queued messages
+    size_t queueCapacity; ///< Number of allocated queue entries
+    size_t sentBytes;     ///< Bytes of the first queued message already sent
+    bool error;           ///< Set if a received message is invalid
+} yabe_msg_conn_t;
+
+
+/**
+ * \brief Initialize a connection on a socket
+ *
+ * The socket should be in non-blocking mode. The receive ring buffer
+ * capacity is rounded up to a multiple of the page size and bounds the size
+ * of the messages that can be received.
+ *
+ * \param[out] conn Connection to initialize
+ * \param fd Socket file descriptor, not closed by the connection
+ * \param capacity Receive buffer capacity, 0 selects YABE_MSG_CAPACITY
+ * \return true if the connection could be initialized, false otherwise
+ */
+bool yabe_msg_conn_init( yabe_msg_conn_t* conn, int fd, size_t capacity );
+
+
+/**
+ * \brief Release the connection resources
+ *
+ * \param[in,out] conn Connection initialized by yabe_msg_conn_init()
+ */
+void yabe_msg_conn_free( yabe_msg_conn_t* conn );
+
+
+/**
+ * \brief Receive the available bytes into the ring buffer
+ *
+ * \param[in,out] conn Connection initialized by yabe_msg_conn_init()
+ * \return the number of bytes received, 0 if the peer closed the connection,
+ *         -1 on error with errno set, EAGAIN if no bytes are available or the
+ *         ring buffer is full
+ */
+long yabe_msg_recv( yabe_msg_conn_t* conn );
+
+
+/**
+ * \brief Return a cursor on the next complete received message
+ *
+ * The message bytes stay in the ring buffer until the next call to
+ * yabe_msg_recv().
+ *
+ * \param[in,out] conn Connection initialized by yabe_msg_conn_init()
+ * \param[out] msg Reading cursor on the message bytes
+ * \return the number of bytes of the message, \e fail : 0 if no message is
+ *         complete or if it is too big, in which case conn->error is set
+ */
+size_t yabe_msg_next( yabe_msg_conn_t* conn, yabe_cursor_t* msg );
+
+
+/**
+ * \brief Queue a message to send
+ *
+ * The message bytes are not copied, they must remain valid until
+ * yabe_msg_flush() reports the message sent.
+ *
+ * \param[in,out] conn Connection initialized by yabe_msg_conn_init()
+ * \param data Pointer on the YABE encoded message
+ * \param size Number of bytes of the message, not 0 and smaller than 2^32
+ * \return true if the message could be queued, false otherwise
+ */
+bool yabe_msg_send( yabe_msg_conn_t* conn, const void* data, size_t size );
+
+
+/**
+ * \brief Send queued messages with writev() until the socket would block
+ *
+ * \param[in,out] conn Connection initialized by yabe_msg_conn_init()
+ * \return the number of messages completely sent, in queuing order, -1 on
+ *         error other than EAGAIN with errno set
+ */
+long yabe_msg_flush( yabe_msg_conn_t* conn );
+
+
+/**
+ * \brief Return true if some queued messages are not completely sent
+ *
+ * \param conn Connection initialized by yabe_msg_conn_init()
+ * \return true if messages are waiting to be sent
+ */
+static inline bool yabe_msg_pending( const yabe_msg_conn_t* conn )
+    { return conn->queueLen != 0; }
+
+#endif // YABE_MSG_H
@@ -0,0 +1,398 @@
+#include "yabe_packed.h"
+#include "yabe_vector.h"
+#include "yabe_endian.h"
+
+
+#define YABE_DELTA_HEADER_SIZE 17   // count64, first64 and width8
+#define YABE_RLE_HEADER_SIZE   8    // count64
+#define YABE_RLE_RUN_SIZE      12   // run32 and value64
+
+
+/* Zigzag encoding of the differences, small magnitudes give small values */
+static inline uint64_t yabe_zigzag( uint64_t delta )
+    { return (delta << 1) ^ (uint64_t)((int64_t)delta >> 63); }
+
+static inline uint64_t yabe_unzigzag( uint64_t z )
+    { return (z >> 1) ^ (0 - (z & 1)); }
+
+
+/* Return the number of bytes of a packed array with the given payload */
+static size_t yabe_sizeof_packed( size_t payloadSize )
+    { return 2 + yabe_sizeof_string( payloadSize ) + payloadSize; }
+
+
+/* Write the packed array tags and the payload size, return a pointer on the
+   payload or NULL if the packed array doesn't fit in the buffer */
+static char* yabe_put_packed( yabe_cursor_t* cursor, int8_t code, size_t payloadSize )
+{
+    if( cursor->len < yabe_sizeof_packed( payloadSize ) )
+        return NULL;
+    yabe_put_blob( cursor );
+    yabe_put_integer( cursor, code );
+    yabe_put_string( cursor, payloadSize );
+    char* payload = cursor->ptr;
+    cursor->ptr += payloadSize;
+    cursor->len -= payloadSize;
+    return payload;
+}
+
+
+/* Return the bit width of the zigzag encoded differences */
+static unsigned yabe_delta_width( const int64_t* values, size_t count )
+{
+    uint64_t bits = 0;
+    for( size_t i = 1; i < count; ++i )
+        bits |= yabe_zigzag( (uint64_t)values[i] - (uint64_t)values[i-1] );
+    return bits ? 64 - (unsigned)__builtin_clzll( bits ) : 0;
+}
+
+
+/* Return the payload size of the delta encoded array */
+static size_t yabe_delta_payload_size( size_t count, unsigned width )
+{
+    const size_t nDeltas = count ? count - 1 : 0;
+    return YABE_DELTA_HEADER_SIZE + (nDeltas * width + 7) / 8;
+}
+
+
+/* Return the number of bytes of the delta encoded array of the values */
+size_t yabe_sizeof_delta_array( const int64_t* values, size_t count )
+{
+    const unsigned width = yabe_delta_width( values, count );
+    return yabe_sizeof_packed( yabe_delta_payload_size( count, width ) );
+}
+
+
+/* Write the values as a delta encoded array */
+size_t yabe_write_delta_array( yabe_cursor_t* cursor, const int64_t* values, size_t count )
+{
+    const unsigned width = yabe_delta_width( values, count );
+    const size_t payloadSize = yabe_delta_payload_size( count, width );
+    char* const start = cursor->ptr;
+    char* p = (uint64_t)count <= YABE_PACKED_MAX_COUNT ?
+              yabe_put_packed( cursor, YABE_PACKED_DELTA, payloadSize ) : NULL;
+    if( !p )
+        return 0;
+    yabe_store_le64( p, count );
+    yabe_store_le64( p + 8, count ? (uint64_t)values[0] : 0 );
+    p[16] = (char)width;
+    p += YABE_DELTA_HEADER_SIZE;
+
+    // pack the differences in a 64 bit accumulator, flushed when full
+    uint64_t acc = 0;
+    unsigned nBits = 0;
+    for( size_t i = 1; i < count && width; ++i )
+    {
+        const uint64_t z = yabe_zigzag( (uint64_t)values[i] - (uint64_t)values[i-1] );
+        acc |= z << nBits;
+        if( nBits + width >= 64 )
+        {
+            yabe_store_le64( p, acc );
+            p += 8;
+            const unsigned used = 64 - nBits;
+            acc = (used < 64) ? z >> used : 0;
+            nBits = nBits + width - 64;
+        }
+        else
+            nBits += width;
+    }
+    for( ; nBits > 0; nBits = (nBits > 8) ? nBits - 8 : 0, acc >>= 8 )
+        *p++ = (char)acc;
+    return cursor->ptr - start;
+}
+
+
+/* Unpack count differences of width bits and rebuild the values from the
+   first one. The differences are unpacked with one unaligned load each, and
+   summed in a second pass */
+static void yabe_delta_decode( const char* bits, size_t nBytes, unsigned width,
+                               int64_t first, int64_t* values, size_t count )
+{
+    if( count == 0 )
+        return;
+    uint64_t* const z = (uint64_t*)values + 1;
+    const size_t nDeltas = count - 1;
+    if( width == 0 )
+        for( size_t i = 0; i < nDeltas; ++i )
+            z[i] = 0;
+    else
+    {
+        const uint64_t mask = (width == 64) ? ~(uint64_t)0 : ((uint64_t)1 << width) - 1;
+        size_t i = 0;
+        for( ; i < nDeltas; ++i )
+        {
+            const size_t bit = i * width, byte = bit >> 3, shift = bit & 7;
+            if( byte + 9 > nBytes )
+                break;
+            uint64_t v = yabe_load_le64( bits + byte ) >> shift;
+            if( shift + width > 64 )
+                v |= (uint64_t)(uint8_t)bits[byte + 8] << (64 - shift);
+            z[i] = v & mask;
+        }
+
+        // the last values are unpacked from a zero padded copy of the bytes
+        if( i < nDeltas )
+        {
+            const size_t base = (i * width) >> 3;
+            char tail[32] = { 0 };
+            memcpy( tail, bits + base, nBytes - base );
+            for( ; i < nDeltas; ++i )
+            {
+                const size_t bit = i * width - base * 8, byte = bit >> 3, shift = bit & 7;
+                uint64_t v = yabe_load_le64( tail + byte ) >> shift;
+                if( shift + width > 64 )
+                    v |= (uint64_t)(uint8_t)tail[byte + 8] << (64 - shift);
+                z[i] = v & mask;
+            }
+        }
+    }
+
+    uint64_t value = (uint64_t)first;
+    values[0] = first;
+    for( size_t i = 1; i < count; ++i )
+    {
+        value += yabe_unzigzag( (uint64_t)values[i] );
+        values[i] = (int64_t)value;
+    }
+}
+
+
+/* Return the number of runs of equal values */
+static size_t yabe_rle_runs( const int64_t* values, size_t count )
+{
+    size_t nRuns = 0, run = 0;
+    for( size_t i = 0; i < count; ++i )
+    {
+        if( run == 0 || values[i] != values[i-1] || run == UINT32_MAX )
+        {
+            ++nRuns;
+            run = 0;
+        }
+        ++run;
+    }
+    return nRuns;
+}
+
+
+/* Return the number of bytes of the run length encoded array of the values */
+size_t yabe_sizeof_rle_array( const int64_t* values, size_t count )
+{
+    return yabe_sizeof_packed( YABE_RLE_HEADER_SIZE +
+                               yabe_rle_runs( values, count ) * YABE_RLE_RUN_SIZE );
+}
+
+
+/* Write the values as a run length encoded array */
+size_t yabe_write_rle_array( yabe_cursor_t* cursor, const int64_t* values, size_t count )
+{
+    const size_t payloadSize = YABE_RLE_HEADER_SIZE +
+                               yabe_rle_runs( values, count ) * YABE_RLE_RUN_SIZE;
+    char* const start = cursor->ptr;
+    char* p = (uint64_t)count <= YABE_PACKED_MAX_COUNT ?
+              yabe_put_packed( cursor, YABE_PACKED_RLE, payloadSize ) : NULL;
+    if( !p )
+        return 0;
+    yabe_store_le64( p, count );
+    p += YABE_RLE_HEADER_SIZE;
+    for( size_t i = 0; i < count; )
+    {
+        size_t run = 1;
+        while( i + run < count && values[i + run] == values[i] && run < UINT32_MAX )
+            ++run;
+        yabe_store_le32( p, (uint32_t)run );
+        yabe_store_le64( p + 4, (uint64_t)values[i] );
+        p += YABE_RLE_RUN_SIZE;
+        i += run;
+    }
+    return cursor->ptr - start;
+}
+
+
+/* Decode the payload of a packed array, return false if it is invalid or has
+   more than capacity values */
+static bool yabe_packed_decode( int64_t code, const char* payload, size_t size,
+                                int64_t* values, size_t capacity, size_t* count )
+{
+    if( size < YABE_RLE_HEADER_SIZE )
+        return false;
+    const uint64_t n = yabe_load_le64( payload );
+    if( n > capacity || n > YABE_PACKED_MAX_COUNT )
+        return false;
+
+    if( code == YABE_PACKED_DELTA )
+    {
+        if( size < YABE_DELTA_HEADER_SIZE )
+            return false;
+        const unsigned width = (uint8_t)payload[16];
+        if( width > 64 || size != yabe_delta_payload_size( n, width ) )
+            return false;
+        yabe_delta_decode( payload + YABE_DELTA_HEADER_SIZE, size - YABE_DELTA_HEADER_SIZE,
+                           width, (int64_t)yabe_load_le64( payload + 8 ), values, n );
+    }
+    else if( code == YABE_PACKED_RLE )
+    {
+        if( (size - YABE_RLE_HEADER_SIZE) % YABE_RLE_RUN_SIZE )
+            return false;
+        const char* p = payload + YABE_RLE_HEADER_SIZE;
+        const char* const end = payload + size;
+        size_t i = 0;
+        for( ; p < end; p += YABE_RLE_RUN_SIZE )
+        {
+            const uint32_t run = yabe_load_le32( p );
+            const int64_t value = (int64_t)yabe_load_le64( p + 4 );
+            if( run > n - i )
+                return false;
+            for( size_t j = 0; j < run; ++j )
+                values[i + j] = value;
+            i += run;
+        }
+        if( i != n )
+            return false;
+    }
+    else
+        return false;
+    *count = n;
+    return true;
+}
+
+
+/* Try reading a packed array to iterate over its values */
+size_t yabe_read_packed( yabe_cursor_t* cursor, yabe_packed_iter_t* iter )
+{
+    yabe_cursor_t c = *cursor;
+    int64_t code;
+    size_t size;
+    if( !yabe_read_blob( &c ) || !c.len || !yabe_read_integer( &c, &code ) ||
+        !c.len || !yabe_read_string( &c, &size ) || size > c.len || size < YABE_RLE_HEADER_SIZE )
+        return 0;
+    const char* const payload = c.ptr;
+    iter->code = code;
+    iter->count = yabe_load_le64( payload );
+    iter->index = 0;
+    iter->run = 0;
+    if( iter->count > YABE_PACKED_MAX_COUNT )
+        return 0;
+    if( code == YABE_PACKED_DELTA )
+    {
+        if( size < YABE_DELTA_HEADER_SIZE )
+            return 0;
+        iter->width = (uint8_t)payload[16];
+        iter->data = payload + YABE_DELTA_HEADER_SIZE;
+        iter->size = size - YABE_DELTA_HEADER_SIZE;
+        // the count must match the bits, the size computation can't overflow
+        if( iter->width > 64 || (iter->count > 1 && iter->width &&
+            iter->count - 1 > iter->size * 8 / iter->width) ||
+            size != yabe_delta_payload_size( iter->count, iter->width ) )
+            return 0;
+        iter->value = yabe_load_le64( payload + 8 );
+    }
+    else if( code == YABE_PACKED_RLE )
+    {
+        if( (size - YABE_RLE_HEADER_SIZE) % YABE_RLE_RUN_SIZE )
+            return 0;
+        iter->data = payload + YABE_RLE_HEADER_SIZE;
+        uint64_t total = 0;
+        for( const char* p = iter->data; p < payload + size; p += YABE_RLE_RUN_SIZE )
+            total += yabe_load_le32( p );
+        if( total != iter->count )
+            return 0;
+    }
+    else
+        return 0;
+
+    c.ptr += size;
+    c.len -= size;
+    const size_t len = c.ptr - cursor->ptr;
+    *cursor = c;
+    return len;
+}
+
+
+/* Get the next value of a packed array */
+bool yabe_packed_next( yabe_packed_iter_t* iter, int64_t* value )
+{
+    if( iter->index == iter->count )
+        return false;
+    if( iter->code == YABE_PACKED_RLE )
+    {
+        // runs of 0 values are allowed
+        while( iter->run == 0 )
+        {
+            iter->run = yabe_load_le32( iter->data );
+            iter->value = yabe_load_le64( iter->data + 4 );
+            iter->data += YABE_RLE_RUN_SIZE;
+        }
+        --iter->run;
+    }
+    else if( iter->index > 0 && iter->width )
+    {
+        const size_t bit = (iter->index - 1) * iter->width, byte = bit >> 3, shift = bit & 7;
+        char tail[9] = { 0 };
+        const char* p = iter->data + byte;
+        if( byte + 9 > iter->size )
+        {
+            memcpy( tail, p, iter->size - byte );
+            p = tail;
+        }
+        uint64_t z = yabe_load_le64( p ) >> shift;
+        if( shift + iter->width > 64 )
+            z |= (uint64_t)(uint8_t)p[8] << (64 - shift);
+        if( iter->width < 64 )
+            z &= ((uint64_t)1 << iter->width) - 1;
+        iter->value += yabe_unzigzag( z );
+    }
+    ++iter->index;
+    *value = (int64_t)iter->value;
+    return true;
+}
+
+
+/* Try reading an array of integers in any of its encodings */
+size_t yabe_read_integer_array( yabe_cursor_t* cursor, int64_t* values,
+                                size_t capacity, size_t* count )
+{
+    yabe_cursor_t c = *cursor;
+    yabe_read_none( &c );
+    if( c.len == 0 )
+        return 0;
+
+    int8_t nbr;
+    if( yabe_read_blob( &c ) )
+    {
+        int64_t code;
+        size_t size;
+        if( !c.len || !yabe_read_integer( &c, &code ) ||
+            !c.len || !yabe_read_string( &c, &size ) || size > c.len ||
+            !yabe_packed_decode( code, c.ptr, size, values, capacity, count ) )
+            return 0;
+        c.ptr += size;
+        c.len -= size;
+    }
+    else if( yabe_read_small_array( &c, &nbr ) )
+    {
+        if( (size_t)nbr > capacity || yabe_read_integers( &c, values, nbr ) != (size_t)nbr )
+            return 0;
+        *count = nbr;
+    }
+    else if( yabe_read_array_stream( &c ) )
+    {
+        size_t n = 0;
+        for( ;; )
+        {
+            // integers are read until the capacity, a none or another value
+            n += yabe_read_integers( &c, values + n, capacity - n );
+            if( yabe_read_none( &c ) )
+                continue;
+            if( !c.len || !yabe_read_end_stream( &c ) )
+                return 0;
+            break;
+        }
+        *count = n;
+    }
+    else
+        return 0;
+
+    const size_t len = c.ptr - cursor->ptr;
+    *cursor = c;
+    return len;
+}
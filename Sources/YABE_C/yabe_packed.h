@@ -0,0 +1,173 @@
+#ifndef YABE_PACKED_H
+#define YABE_PACKED_H
+
+#include "yabe.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+   \page packed_page Packed integer arrays (version 1 extension)
+
+   Arrays of time stamps, counters or sensor samples are long sequences of
+   close or repeated integers. Encoded as plain arrays, each value of a time
+   stamp array costs 9 bytes. The version 1 extension encodes such arrays in
+   packed form :
+
+   \verbatim
+      packed : [blob] [code] [string]  : packed integer array
+      delta  : code 1, string bytes [count64] [first64] [width8] [bits]*
+      rle    : code 2, string bytes [count64] ([run32] [value64])*
+    \endverbatim
+
+   In a \e delta array, the differences between consecutive values are zigzag
+   encoded (0, -1, 1, -2 ... become 0, 1, 2, 3 ...) and bit packed with the
+   smallest width holding all of them, the first difference in the least
+   significant bits of the first bytes. In a \e rle array, each run of equal
+   values is encoded once with its length. All fields are little endian.
+
+   The extension code is an integer where a version 0 blob has its mime type
+   string, so the packed array is skipped as a blob by yabe_skip_value(). Data
+   containing packed arrays must start with a version 1 signature. The
+   readers below don't know the version, a reader of version 0 data gets it
+   with yabe_read_signature_version() and must reject the packed arrays.
+
+   The packed arrays are read as ordinary arrays of integers by
+   yabe_read_integer_array(), which also accepts small arrays and array
+   streams of integers.
+
+   A few bytes of a delta array of width 0 or of a rle array stand for any
+   number of values, the readers thus reject the arrays of more than
+   YABE_PACKED_MAX_COUNT values and the writers don't write them.
+
+   \code
+    yabe_write_signature_version( &wCur, 1 );
+    yabe_write_delta_array( &wCur, timeStamps, count );
+    ...
+    if( !yabe_read_integer_array( &rCur, values, capacity, &count ) ) { ... }
+   \endcode
+*/
+
+/// Extension code of the delta encoded integer arrays
+#define YABE_PACKED_DELTA 1
+
+/// Extension code of the run length encoded integer arrays
+#define YABE_PACKED_RLE   2
+
+/// Maximum number of values of a packed integer array
+#define YABE_PACKED_MAX_COUNT ((uint64_t)1 << 32)
+
+
+/**
+ * \brief Iterator on the values of a packed integer array
+ */
+typedef struct yabe_packed_iter_t
+{
+    int64_t code;         ///< Extension code of the packed array
+    uint64_t count;       ///< Number of values of the array
+    uint64_t index;       ///< Number of values already returned
+    uint64_t value;       ///< Last value returned, or value of the current run
+    const char* data;     ///< Packed differences, or next run
+    size_t size;          ///< Number of bytes of the packed differences
+    unsigned width;       ///< Bit width of the packed differences
+    uint32_t run;         ///< Number of values left in the current run
+} yabe_packed_iter_t;
+
+
+/**
+ * \brief Return the number of bytes of the delta encoded array of the values
+ *
+ * \param values Pointer on the integer values
+ * \param count Number of integer values
+ * \return the number of bytes written by yabe_write_delta_array()
+ */
+size_t yabe_sizeof_delta_array( const int64_t* values, size_t count );
+
+
+/**
+ * \brief Tries writing the values as a delta encoded array and returns the
+ *  number of bytes written
+ *
+ * \param[in,out] cursor Pointer on buffer info where to write the array,
+ *                       update it if the array could be written
+ * \param values Pointer on the integer values
+ * \param count Number of integer values
+ * \return the number of bytes written, \e fail : 0 if the array doesn't fit
+ *         in the buffer or has more than YABE_PACKED_MAX_COUNT values
+ */
+size_t yabe_write_delta_array( yabe_cursor_t* cursor, const int64_t* values, size_t count );
+
+
+/**
+ * \brief Return the number of bytes of the run length encoded array of the
+ *  values
+ *
+ * \param values Pointer on the integer values
+ * \param count Number of integer values
+ * \return the number of bytes written by yabe_write_rle_array()
+ */
+size_t yabe_sizeof_rle_array( const int64_t* values, size_t count );
+
+
+/**
+ * \brief Tries writing the values as a run length encoded array and returns
+ *  the number of bytes written
+ *
+ * \param[in,out] cursor Pointer on buffer info where to write the array,
+ *                       update it if the array could be written
+ * \param values Pointer on the integer values
+ * \param count Number of integer values
+ * \return the number of bytes written, \e fail : 0 if the array doesn't fit
+ *         in the buffer or has more than YABE_PACKED_MAX_COUNT values
+ */
+size_t yabe_write_rle_array( yabe_cursor_t* cursor, const int64_t* values, size_t count );
+
+
+/**
+ * \brief Try reading an array of integers and returns the number of bytes read
+ *
+ * The array may be a packed array, a small array or an array stream whose
+ * items are all integers. Leading \e none values are skipped.
+ *
+ * \param[in,out] cursor Pointer on buffer where to try reading, the cursor
+ *                       is updated if the read operation succeeds
+ * \param[out] values Pointer on the array receiving the values
+ * \param capacity Maximum number of values that can be stored in values
+ * \param[out] count Number of values of the array
+ * \return the number of bytes read, \e fail : 0 if the value is not an array
+ *         of integers, is invalid or has more than \e capacity values
+ */
+size_t yabe_read_integer_array( yabe_cursor_t* cursor, int64_t* values,
+                                size_t capacity, size_t* count );
+
+/**
+ * \brief Try reading a packed integer array to iterate over its values and
+ *  returns the number of bytes read
+ *
+ * The array is validated, then yabe_packed_next() returns its values one by
+ * one without storing them. The iterator refers to the bytes of the buffer.
+ *
+ * \param[in,out] cursor Pointer on buffer where to try reading, the cursor
+ *                       is updated if the read operation succeeds
+ * \param[out] iter Iterator on the values of the array
+ * \return the number of bytes read, \e fail : 0 if the value is not a valid
+ *         packed array or has more than YABE_PACKED_MAX_COUNT values
+ */
+size_t yabe_read_packed( yabe_cursor_t* cursor, yabe_packed_iter_t* iter );
+
+
+/**
+ * \brief Get the next value of a packed integer array
+ *
+ * \param[in,out] iter Iterator initialized by yabe_read_packed()
+ * \param[out] value Next value of the array
+ * \return true if a value is returned, false at the end of the array
+ */
+bool yabe_packed_next( yabe_packed_iter_t* iter, int64_t* value );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // YABE_PACKED_H
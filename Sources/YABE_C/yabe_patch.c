@@ -0,0 +1,240 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#include "yabe_patch.h"
+
+
+/* Initial number of segments of a rope */
+#define YABE_ROPE_SEGMENTS 16
+
+/* Number of segments written by one writev call */
+#define YABE_ROPE_IOV      64
+
+
+/* Return true if the cursor holds exactly one valid value */
+static bool yabe_patch_valid( const yabe_cursor_t* value )
+{
+    yabe_cursor_t c = *value;
+    return value->len && yabe_skip_value( &c ) == value->len;
+}
+
+
+/* Write the value at the end of the len bytes at p, preceded by none */
+static void yabe_patch_fill( char* p, size_t len, const yabe_cursor_t* value )
+{
+    memset( p, (uint8_t)yabe_none_tag, len - value->len );
+    memcpy( p + len - value->len, value->ptr, value->len );
+}
+
+
+/* Overwrite the first value matching path and its padding */
+size_t yabe_patch_in_place( const yabe_cursor_t* doc, const yabe_query_t* path,
+                            const yabe_cursor_t* value )
+{
+    yabe_cursor_t match;
+    size_t padding;
+    if( !yabe_patch_valid( value ) || !yabe_query_locate( path, doc, &match, &padding ) )
+        return 0;
+    const size_t len = padding + match.len;
+    if( value->len > len )
+        return 0;
+    yabe_patch_fill( match.ptr - padding, len, value );
+    return len;
+}
+
+
+/* Initialize a rope with the whole document as single segment */
+bool yabe_rope_init( yabe_rope_t* rope, const yabe_cursor_t* doc )
+{
+    rope->doc = *doc;
+    rope->segments = malloc( YABE_ROPE_SEGMENTS * sizeof(yabe_rope_segment_t) );
+    if( !rope->segments )
+        return false;
+    rope->capacity = YABE_ROPE_SEGMENTS;
+    rope->count = 0;
+    rope->len = doc->len;
+    if( doc->len )
+    {
+        yabe_rope_segment_t all = { doc->ptr, doc->len, 0, doc->len, false };
+        rope->segments[rope->count++] = all;
+    }
+    return true;
+}
+
+
+/* Free the segments and the copies of new values of a rope */
+void yabe_rope_free( yabe_rope_t* rope )
+{
+    for( size_t i = 0; i < rope->count; ++i )
+        if( rope->segments[i].copy )
+            free( rope->segments[i].ptr );
+    free( rope->segments );
+    rope->segments = NULL;
+    rope->count = rope->capacity = rope->len = 0;
+}
+
+
+/* Return the index of the first segment ending after offset */
+static size_t yabe_rope_find( const yabe_rope_t* rope, size_t offset )
+{
+    size_t lo = 0, hi = rope->count;
+    while( lo < hi )
+    {
+        const size_t mid = lo + (hi - lo) / 2;
+        const yabe_rope_segment_t* s = &rope->segments[mid];
+        if( s->offset + s->docLen <= offset )
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+
+/* Replace the first value matching path by a copy of the new value */
+size_t yabe_rope_patch( yabe_rope_t* rope, const yabe_query_t* path,
+                        const yabe_cursor_t* value )
+{
+    yabe_cursor_t match;
+    size_t padding;
+    if( !yabe_patch_valid( value ) || !yabe_query_locate( path, &rope->doc, &match, &padding ) )
+        return 0;
+    const size_t start = match.ptr - padding - rope->doc.ptr;
+    const size_t end = match.ptr + match.len - rope->doc.ptr;
+
+    // segments first to last hold the document bytes of the old value
+    const size_t first = yabe_rope_find( rope, start );
+    size_t last = first;
+    while( last + 1 < rope->count && rope->segments[last + 1].offset < end )
+        ++last;
+    yabe_rope_segment_t* s = &rope->segments[first];
+
+    // overwrite in place the document or a value spliced at the same path
+    if( first == last &&
+        ((!s->copy && value->len <= end - start && end <= s->offset + s->docLen) ||
+         (s->copy && s->offset == start && s->docLen == end - start && value->len <= s->len)) )
+    {
+        if( s->copy )
+            yabe_patch_fill( s->ptr, s->len, value );
+        else
+            yabe_patch_fill( rope->doc.ptr + start, end - start, value );
+        return value->len;
+    }
+
+    // a spliced value must be inside the old value
+    for( size_t i = first; i <= last; ++i )
+        if( rope->segments[i].copy && (rope->segments[i].offset < start ||
+            rope->segments[i].offset + rope->segments[i].docLen > end) )
+            return 0;
+
+    // the document bytes before and after the old value, and the new value
+    yabe_rope_segment_t repl[3];
+    size_t nRepl = 0;
+    const yabe_rope_segment_t* f = &rope->segments[first];
+    const yabe_rope_segment_t* l = &rope->segments[last];
+    if( f->offset < start )
+    {
+        yabe_rope_segment_t before = { f->ptr, start - f->offset, f->offset, start - f->offset, false };
+        repl[nRepl++] = before;
+    }
+    yabe_rope_segment_t inserted = { malloc( value->len ), value->len, start, end - start, true };
+    if( !inserted.ptr )
+        return 0;
+    memcpy( inserted.ptr, value->ptr, value->len );
+    repl[nRepl++] = inserted;
+    if( l->offset + l->docLen > end )
+    {
+        const size_t skip = end - l->offset;
+        yabe_rope_segment_t after = { l->ptr + skip, l->docLen - skip, end, l->docLen - skip, false };
+        repl[nRepl++] = after;
+    }
+
+    const size_t nOld = last - first + 1;
+    if( rope->count - nOld + nRepl > rope->capacity )
+    {
+        const size_t capacity = 2 * rope->capacity;
+        yabe_rope_segment_t* segments = realloc( rope->segments, capacity * sizeof(yabe_rope_segment_t) );
+        if( !segments )
+        {
+            free( inserted.ptr );
+            return 0;
+        }
+        rope->segments = segments;
+        rope->capacity = capacity;
+    }
+
+    for( size_t i = first; i <= last; ++i )
+    {
+        rope->len -= rope->segments[i].len;
+        if( rope->segments[i].copy )
+            free( rope->segments[i].ptr );
+    }
+    memmove( rope->segments + first + nRepl, rope->segments + last + 1,
+             (rope->count - last - 1) * sizeof(yabe_rope_segment_t) );
+    for( size_t i = 0; i < nRepl; ++i )
+    {
+        rope->segments[first + i] = repl[i];
+        rope->len += repl[i].len;
+    }
+    rope->count = rope->count - nOld + nRepl;
+    return value->len;
+}
+
+
+/* Tries writing the patched document */
+size_t yabe_rope_write( const yabe_rope_t* rope, yabe_cursor_t* cursor )
+{
+    if( cursor->len < rope->len )
+        return 0;
+    for( size_t i = 0; i < rope->count; ++i )
+    {
+        memcpy( cursor->ptr, rope->segments[i].ptr, rope->segments[i].len );
+        cursor->ptr += rope->segments[i].len;
+    }
+    cursor->len -= rope->len;
+    return rope->len;
+}
+
+
+/* Write the patched document to a file descriptor with writev */
+bool yabe_rope_writev( const yabe_rope_t* rope, int fd )
+{
+    size_t first = 0, skip = 0;
+    while( first < rope->count )
+    {
+        struct iovec iov[YABE_ROPE_IOV];
+        int nIov = 0;
+        for( size_t i = first; i < rope->count && nIov < YABE_ROPE_IOV; ++i )
+        {
+            const size_t offset = (i == first) ? skip : 0;
+            iov[nIov].iov_base = rope->segments[i].ptr + offset;
+            iov[nIov++].iov_len = rope->segments[i].len - offset;
+        }
+
+        ssize_t res;
+        do
+            res = writev( fd, iov, nIov );
+        while( res < 0 && errno == EINTR );
+        if( res <= 0 )
+            return false;
+
+        // skip the segments completely written
+        size_t written = (size_t)res;
+        for( int i = 0; i < nIov; ++i )
+        {
+            if( written < iov[i].iov_len )
+            {
+                skip = (i ? 0 : skip) + written;
+                break;
+            }
+            written -= iov[i].iov_len;
+            skip = 0;
+            ++first;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,154 @@
+#ifndef YABE_PATCH_H
+#define YABE_PATCH_H
+
+#include "yabe.h"
+#include "yabe_query.h"
+
+/**
+   \page patch_page Patching encoded documents
+
+   Changing a value deep inside a large encoded document doesn't require
+   decoding and encoding it again. The value is located with a path query,
+   see \ref query_page, and replaced by another encoded value :
+
+    <ul>
+    <li> when the new value is not larger than the old one and the \e none
+         bytes preceding it, yabe_patch_in_place() overwrites them. The
+         remaining bytes are filled with \e none values before the new
+         value, so the following values don't move ;
+    <li> otherwise the document is seen as a rope, a sequence of segments
+         which are either views on the document or copies of new values.
+         yabe_rope_patch() splits the segment holding the old value and
+         inserts the new one, then yabe_rope_write() or yabe_rope_writev()
+         output the patched document.
+    </ul>
+
+   Containers don't encode their size in bytes, so replacing a value by a
+   value of another size doesn't change the encoding of its parents. The
+   cost of a patch is the query, which skips the values preceding the path,
+   and the size of the new value ; the rest of the document is not copied
+   before it is written.
+
+   Paths are always located in the document given to yabe_rope_init(). Its
+   values overwritten in place may be patched again, but the values inside
+   a spliced value can't : patch the spliced value itself instead.
+
+   \code
+    yabe_query_t query;
+    if( !yabe_query_compile( &query, "$.users[3].name" ) ) { ... }
+    yabe_rope_t rope;
+    if( !yabe_rope_init( &rope, &doc ) ) { ... }
+    if( !yabe_rope_patch( &rope, &query, &value ) ) { ... }
+    if( !yabe_rope_writev( &rope, fd ) ) { ... }
+    yabe_rope_free( &rope );
+   \endcode
+*/
+
+/**
+ * \brief Segment of a patched document
+ */
+typedef struct yabe_rope_segment_t
+{
+    char* ptr;                      ///< Bytes of the segment
+    size_t len;                     ///< Number of bytes of the segment
+    size_t offset;                  ///< Offset of the document bytes it stands for
+    size_t docLen;                  ///< Number of document bytes it stands for
+    bool copy;                      ///< True if the bytes are a copy of a new value
+} yabe_rope_segment_t;
+
+
+/**
+ * \brief Document patched by splicing new values
+ */
+typedef struct yabe_rope_t
+{
+    yabe_cursor_t doc;              ///< Document, patched in place when possible
+    yabe_rope_segment_t* segments;  ///< Segments in document order
+    size_t count;                   ///< Number of segments
+    size_t capacity;                ///< Number of allocated segments
+    size_t len;                     ///< Number of bytes of the patched document
+} yabe_rope_t;
+
+
+/**
+ * \brief Overwrite the first value matching path in the document and
+ *  returns the number of bytes overwritten
+ *
+ * The new value replaces the old one and the \e none bytes preceding it, the
+ * remaining bytes are filled with \e none values. The document is left
+ * unchanged if the new value doesn't fit.
+ *
+ * \param doc Pointer on buffer of the encoded document, left unchanged
+ * \param path Query compiled by yabe_query_compile()
+ * \param value Pointer on buffer of the new encoded value, left unchanged
+ * \return the number of bytes overwritten, \e fail : 0 if no value matches
+ *         path, the new value is invalid or larger than the old one
+ */
+size_t yabe_patch_in_place( const yabe_cursor_t* doc, const yabe_query_t* path,
+                            const yabe_cursor_t* value );
+
+
+/**
+ * \brief Initialize a rope with the whole document as single segment
+ *
+ * The document must remain valid until the rope is freed. It is modified
+ * by the patches made in place.
+ *
+ * \param[out] rope Pointer on the rope to initialize
+ * \param doc Pointer on buffer of the encoded document
+ * \return true if the rope is initialized, false if it could not be
+ *         allocated
+ */
+bool yabe_rope_init( yabe_rope_t* rope, const yabe_cursor_t* doc );
+
+
+/**
+ * \brief Free the segments and the copies of new values of a rope
+ *
+ * \param[in,out] rope Pointer on the rope
+ */
+void yabe_rope_free( yabe_rope_t* rope );
+
+
+/**
+ * \brief Replace the first value matching path in the document and returns
+ *  the number of bytes of the new value
+ *
+ * The value is overwritten in place if it fits, otherwise a copy of the new
+ * value is spliced in the rope. A value spliced before is replaced by the
+ * new one, as well as all the values spliced inside the old value.
+ *
+ * \param[in,out] rope Pointer on the rope
+ * \param path Query compiled by yabe_query_compile()
+ * \param value Pointer on buffer of the new encoded value, left unchanged
+ * \return the number of bytes of the new value, \e fail : 0 if no value
+ *         matches path, the match is inside a spliced value, the new value
+ *         is invalid or could not be allocated
+ */
+size_t yabe_rope_patch( yabe_rope_t* rope, const yabe_query_t* path,
+                        const yabe_cursor_t* value );
+
+
+/**
+ * \brief Tries writing the patched document and returns the number of
+ *  bytes written
+ *
+ * \param rope Pointer on the rope
+ * \param[in,out] cursor Pointer on buffer info where to write the document,
+ *                       updated if the document could be written
+ * \return the number of bytes written, \e fail : 0 if the buffer is too
+ *         small
+ */
+size_t yabe_rope_write( const yabe_rope_t* rope, yabe_cursor_t* cursor );
+
+
+/**
+ * \brief Write the patched document to a file descriptor with writev
+ *
+ * \param rope Pointer on the rope
+ * \param fd File descriptor of a file, pipe or socket in blocking mode
+ * \return true if the document was written, false on error
+ */
+bool yabe_rope_writev( const yabe_rope_t* rope, int fd );
+
+#endif // YABE_PATCH_H
@@ -0,0 +1,208 @@
+#include "yabe_query.h"
+
+
+/* Compile the path query */
+bool yabe_query_compile( yabe_query_t* query, const char* path )
+{
+    const size_t pathLen = strlen( path );
+    if( pathLen >= YABE_QUERY_MAX_LENGTH || path[0] != '$' )
+        return false;
+    memcpy( query->text, path, pathLen + 1 );
+    query->nSteps = 0;
+
+    const char* p = query->text + 1;
+    while( *p )
+    {
+        if( query->nSteps == YABE_QUERY_MAX_STEPS )
+            return false;
+        yabe_query_step_t* step = &query->steps[query->nSteps++];
+        if( p[0] == '.' && p[1] == '*' )
+        {
+            step->type = yabe_query_wildcard;
+            p += 2;
+        }
+        else if( p[0] == '.' )
+        {
+            const char* key = ++p;
+            while( *p && *p != '.' && *p != '[' )
+                ++p;
+            if( p == key )
+                return false;
+            step->type = yabe_query_key;
+            step->key.ptr = key;
+            step->key.len = p - key;
+        }
+        else if( p[0] == '[' && p[1] == '*' && p[2] == ']' )
+        {
+            step->type = yabe_query_wildcard;
+            p += 3;
+        }
+        else if( p[0] == '[' && (p[1] == '\'' || p[1] == '"') )
+        {
+            const char quote = p[1];
+            const char* key = p += 2;
+            while( *p && *p != quote )
+                ++p;
+            if( p == key || p[0] != quote || p[1] != ']' )
+                return false;
+            step->type = yabe_query_key;
+            step->key.ptr = key;
+            step->key.len = p - key;
+            p += 2;
+        }
+        else if( p[0] == '[' && isdigit( (unsigned char)p[1] ) )
+        {
+            size_t index = 0;
+            for( ++p; isdigit( (unsigned char)*p ); ++p )
+            {
+                if( index > (SIZE_MAX - 9) / 10 )
+                    return false;
+                index = index * 10 + (*p - '0');
+            }
+            if( *p++ != ']' )
+                return false;
+            step->type = yabe_query_index;
+            step->index = index;
+        }
+        else
+            return false;
+    }
+    return true;
+}
+
+
+/* State of a query evaluation */
+typedef struct yabe_query_state_t
+{
+    const yabe_query_t* query;
+    yabe_match_fn fn;
+    void* ctx;
+    size_t nMatches;
+    bool stop;
+    size_t padding;   // none bytes preceding the last match
+    bool partial;     // stop reading at the first match
+} yabe_query_state_t;
+
+
+/* Evaluate the query steps from step on the value at cursor position, and
+   return the number of bytes read */
+static size_t yabe_query_eval( yabe_query_state_t* state, size_t step,
+                               yabe_cursor_t* cursor )
+{
+    yabe_cursor_t c = *cursor;
+    yabe_read_none( &c );
+    if( state->stop || yabe_end_of_buffer( &c ) )
+        return yabe_skip_value( cursor );
+
+    if( step == state->query->nSteps )
+    {
+        yabe_cursor_t match = { c.ptr, 0 };
+        const size_t padding = c.ptr - cursor->ptr;
+        if( !(match.len = yabe_skip_value( &c )) )
+            return 0;
+        ++state->nMatches;
+        state->padding = padding;
+        if( state->fn && !state->fn( state->ctx, &match ) )
+            state->stop = true;
+    }
+    else
+    {
+        const yabe_query_step_t* s = &state->query->steps[step];
+        int8_t nbr = -1;
+        bool isObject = false;
+        if( s->type != yabe_query_key &&
+            (yabe_read_small_array( &c, &nbr ) || yabe_read_array_stream( &c )) )
+            isObject = false;
+        else if( s->type != yabe_query_index &&
+                 (yabe_read_small_object( &c, &nbr ) || yabe_read_object_stream( &c )) )
+            isObject = true;
+        else
+            return yabe_skip_value( cursor );
+
+        // visit the items, descending only in those matching the step
+        for( size_t i = 0; nbr != 0; ++i )
+        {
+            // none values preceding an item are left to yabe_query_eval()
+            yabe_cursor_t item = c;
+            yabe_read_none( &item );
+            if( yabe_end_of_buffer( &item ) )
+                return 0;
+            if( nbr < 0 && yabe_read_end_stream( &item ) )
+            {
+                c = item;
+                break;
+            }
+
+            bool matches = s->type == yabe_query_wildcard ||
+                           (s->type == yabe_query_index && i == s->index);
+            if( isObject )
+            {
+                c = item;
+                yabe_string_view_t key;
+                if( !yabe_read_string_view( &c, &key ) )
+                    return 0;
+                if( s->type == yabe_query_key )
+                    matches = key.len == s->key.len &&
+                              !memcmp( key.ptr, s->key.ptr, key.len );
+            }
+            if( matches ? !yabe_query_eval( state, step + 1, &c )
+                        : !yabe_skip_value( &c ) )
+                return 0;
+            if( state->stop && state->partial )
+                return c.ptr - cursor->ptr;
+            if( nbr > 0 )
+                --nbr;
+        }
+    }
+    const size_t len = c.ptr - cursor->ptr;
+    *cursor = c;
+    return len;
+}
+
+
+/* Evaluate the query on the value at cursor position */
+size_t yabe_query_run( const yabe_query_t* query, yabe_cursor_t* cursor,
+                       yabe_match_fn fn, void* ctx, size_t* nMatches )
+{
+    yabe_query_state_t state = { query, fn, ctx, 0, false, 0, false };
+    yabe_cursor_t c = *cursor;
+    const size_t len = yabe_query_eval( &state, 0, &c );
+    if( !len )
+        return 0;
+    if( nMatches )
+        *nMatches = state.nMatches;
+    *cursor = c;
+    return len;
+}
+
+
+/* Store the first match and stop the query */
+static bool yabe_query_first_match( void* ctx, yabe_cursor_t* match )
+{
+    *((yabe_cursor_t*)ctx) = *match;
+    return false;
+}
+
+
+/* Return a cursor on the first value matching the query */
+bool yabe_query_first( const yabe_query_t* query, const yabe_cursor_t* cursor,
+                       yabe_cursor_t* match )
+{
+    return yabe_query_locate( query, cursor, match, NULL );
+}
+
+
+/* Return a cursor on the first value matching the query and the number of
+   none bytes preceding it */
+bool yabe_query_locate( const yabe_query_t* query, const yabe_cursor_t* cursor,
+                        yabe_cursor_t* match, size_t* padding )
+{
+    // the values following the match are not read
+    yabe_query_state_t state = { query, yabe_query_first_match, match, 0, false, 0, true };
+    yabe_cursor_t c = *cursor;
+    if( !yabe_query_eval( &state, 0, &c ) || !state.nMatches )
+        return false;
+    if( padding )
+        *padding = state.padding;
+    return true;
+}
@@ -0,0 +1,143 @@
+#ifndef YABE_QUERY_H
+#define YABE_QUERY_H
+
+#include "yabe.h"
+
+/**
+   \page query_page Path queries on encoded data
+
+   A path query selects values inside a YABE encoded value without decoding
+   it. The query is compiled once by yabe_query_compile() and may then be
+   evaluated by yabe_query_run() on any number of encoded values.
+
+   The path syntax is a subset of JSONPath :
+    <ul>
+    <li> \b $ : the root value, it must start the path ;
+    <li> \b .name or \b ['name'] : the member \e name of an object ;
+    <li> \b [n] : the item \e n of an array, starting with 0 ;
+    <li> \b .* or \b [*] : all the items of an array or members of an object.
+    </ul>
+
+   The compiled query is a sequence of steps, each step being a state of the
+   matching automaton. Values that can't match the step of their state are
+   skipped with yabe_skip_value(), using only their tag and length. A value
+   reaching the final state is a match and is handed to the user function as
+   a cursor on its encoded bytes.
+
+   \code
+    yabe_query_t query;
+    if( !yabe_query_compile( &query, "$.events[*].user.id" ) ) { ... }
+    size_t nMatches;
+    if( !yabe_query_run( &query, &rCur, onMatch, ctx, &nMatches ) ) { ... }
+   \endcode
+*/
+
+/// Maximum number of steps in a compiled query
+#define YABE_QUERY_MAX_STEPS 32
+
+/// Maximum number of bytes of a query path
+#define YABE_QUERY_MAX_LENGTH 256
+
+/// @cond DEV
+/* Step types */
+typedef enum yabe_query_step_type_t
+{
+    yabe_query_key,       // member of an object with the given key
+    yabe_query_index,     // item of an array with the given index
+    yabe_query_wildcard   // all items of an array or members of an object
+} yabe_query_step_type_t;
+
+/* One step of a compiled query */
+typedef struct yabe_query_step_t
+{
+    yabe_query_step_type_t type;
+    yabe_string_view_t key;  // key of yabe_query_key steps, in query text
+    size_t index;            // index of yabe_query_index steps
+} yabe_query_step_t;
+/// @endcond
+
+/**
+ * \brief Compiled path query
+ */
+typedef struct yabe_query_t
+{
+    yabe_query_step_t steps[YABE_QUERY_MAX_STEPS];  ///< Steps of the query
+    size_t nSteps;                                  ///< Number of steps
+    char text[YABE_QUERY_MAX_LENGTH];               ///< Copy of the path
+} yabe_query_t;
+
+
+/**
+ * \brief User function called for each value matching a query
+ *
+ * \param ctx User context pointer given to yabe_query_run()
+ * \param match Reading cursor on the bytes of the matching value
+ * \return true to continue the query, false to stop reporting matches
+ */
+typedef bool (*yabe_match_fn)( void* ctx, yabe_cursor_t* match );
+
+
+/**
+ * \brief Compile the path query
+ *
+ * \param[out] query Compiled query
+ * \param path Path of the values to select, see \ref query_page
+ * \return true if the path could be compiled, false if its syntax is invalid
+ *         or it is too long
+ */
+bool yabe_query_compile( yabe_query_t* query, const char* path );
+
+
+/**
+ * \brief Evaluate the query on the value at cursor position and returns the
+ *  number of bytes read
+ *
+ * The matches are reported in the order they appear in the encoded data.
+ * The whole value is read even if fn asked to stop.
+ *
+ * \param query Query compiled by yabe_query_compile()
+ * \param[in,out] cursor Pointer on buffer where to read the value, the
+ *                       cursor is updated if the value could be read
+ * \param fn Function called for each matching value, may be NULL
+ * \param ctx User context pointer passed to fn
+ * \param[out] nMatches Number of matches reported to fn, may be NULL
+ * \return the number of bytes read, \e fail : 0 if the value is invalid
+ */
+size_t yabe_query_run( const yabe_query_t* query, yabe_cursor_t* cursor,
+                       yabe_match_fn fn, void* ctx, size_t* nMatches );
+
+
+/**
+ * \brief Return a cursor on the first value matching the query
+ *
+ * The values following the match are not read.
+ *
+ * \param query Query compiled by yabe_query_compile()
+ * \param cursor Pointer on buffer where to read the value, left unchanged
+ * \param[out] match Cursor on the bytes of the first matching value
+ * \return true if a value matched, false otherwise
+ */
+bool yabe_query_first( const yabe_query_t* query, const yabe_cursor_t* cursor,
+                       yabe_cursor_t* match );
+
+
+/**
+ * \brief Return a cursor on the first value matching the query and the
+ *  number of \e none bytes preceding it
+ *
+ * The \e none bytes are those between the matching value and the previous
+ * value, member identifier or container tag. They may be overwritten along
+ * with the value, see yabe_patch_in_place(). The values following the
+ * match are not read.
+ *
+ * \param query Query compiled by yabe_query_compile()
+ * \param cursor Pointer on buffer where to read the value, left unchanged
+ * \param[out] match Cursor on the bytes of the first matching value
+ * \param[out] padding Number of \e none bytes preceding the match, may be
+ *                     NULL
+ * \return true if a value matched, false otherwise
+ */
+bool yabe_query_locate( const yabe_query_t* query, const yabe_cursor_t* cursor,
+                        yabe_cursor_t* match, size_t* padding );
+
+#endif // YABE_QUERY_H
@@ -0,0 +1,254 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#include "yabe_ring.h"
+
+
+/* Version of the shared memory layout */
+#define YABE_RING_VERSION 1
+
+/* Cache line size, the positions and the slots are aligned on it */
+#define YABE_RING_LINE 64
+
+
+/* Start of the shared memory, each position on its own cache line so that
+   the producers and the consumer don't share lines */
+typedef struct yabe_ring_shared_t
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t multiProducer;
+    uint32_t reserved;
+    uint64_t slotSize;
+    uint64_t slotCount;
+    char pad0[YABE_RING_LINE - 32];
+    uint64_t tail;
+    char pad1[YABE_RING_LINE - 8];
+    uint64_t head;
+    char pad2[YABE_RING_LINE - 8];
+} yabe_ring_shared_t;
+
+/* Magic bytes starting a ring */
+static const char yabe_ring_magic[4] = { 'Y', 'R', 'N', 'G' };
+
+
+/* Sequence number at the start of a slot : its position while free, its
+   position plus one once committed */
+static inline uint64_t* yabe_ring_seq( const yabe_ring_t* ring, uint64_t pos )
+{
+    return (uint64_t*)(ring->slots + (pos & ring->mask) * ring->slotSize);
+}
+
+
+/* Create an anonymous shared memory file */
+static int yabe_ring_memfd( void )
+{
+#ifdef __NR_memfd_create
+    int fd = (int)syscall( __NR_memfd_create, "yabe_ring", 0 );
+    if( fd >= 0 || errno != ENOSYS )
+        return fd;
+#endif
+    static unsigned counter;
+    char name[64];
+    for( int i = 0; i < 16; ++i )
+    {
+        snprintf( name, sizeof(name), "/yabe_ring_%ld_%u", (long)getpid(),
+                  __atomic_fetch_add( &counter, 1, __ATOMIC_RELAXED ) );
+        int fd = shm_open( name, O_RDWR | O_CREAT | O_EXCL, 0600 );
+        if( fd >= 0 )
+        {
+            shm_unlink( name );
+            return fd;
+        }
+        if( errno != EEXIST )
+            break;
+    }
+    return -1;
+}
+
+
+/* Set the process side of the ring from its mapping */
+static void yabe_ring_map( yabe_ring_t* ring, int fd, void* map, size_t mapSize )
+{
+    yabe_ring_shared_t* shared = map;
+    ring->fd = fd;
+    ring->map = map;
+    ring->mapSize = mapSize;
+    ring->slots = (char*)map + sizeof(yabe_ring_shared_t);
+    ring->slotSize = (size_t)shared->slotSize;
+    ring->mask = shared->slotCount - 1;
+    ring->multiProducer = shared->multiProducer != 0;
+    ring->tail = &shared->tail;
+    ring->head = &shared->head;
+}
+
+
+/* Create a ring in a new shared memory file and map it */
+bool yabe_ring_create( yabe_ring_t* ring, size_t slotCount, size_t messageSize,
+                       bool multiProducer )
+{
+    // a single slot couldn't tell a committed slot from a free one
+    size_t count = 2;
+    while( count < slotCount && count <= SIZE_MAX / 4 )
+        count *= 2;
+    if( count < slotCount || messageSize > UINT32_MAX ||
+        messageSize > SIZE_MAX - YABE_RING_SLOT_HEADER - YABE_RING_LINE )
+        return false;
+    const size_t slotSize = (messageSize + YABE_RING_SLOT_HEADER + YABE_RING_LINE - 1) &
+                            ~(size_t)(YABE_RING_LINE - 1);
+    if( slotSize > (SIZE_MAX - sizeof(yabe_ring_shared_t)) / count )
+        return false;
+    const size_t mapSize = sizeof(yabe_ring_shared_t) + count * slotSize;
+
+    int fd = yabe_ring_memfd();
+    if( fd < 0 )
+        return false;
+    void* map;
+    if( ftruncate( fd, (off_t)mapSize ) ||
+        (map = mmap( NULL, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 )) == MAP_FAILED )
+    {
+        close( fd );
+        return false;
+    }
+
+    // the file is zero filled, each free slot holds its position
+    yabe_ring_shared_t* shared = map;
+    shared->version = YABE_RING_VERSION;
+    shared->multiProducer = multiProducer;
+    shared->slotSize = slotSize;
+    shared->slotCount = count;
+    memcpy( shared->magic, yabe_ring_magic, sizeof(yabe_ring_magic) );
+    yabe_ring_map( ring, fd, map, mapSize );
+    for( size_t i = 0; i < count; ++i )
+        *yabe_ring_seq( ring, i ) = i;
+    return true;
+}
+
+
+/* Map a ring created by another thread or process */
+bool yabe_ring_attach( yabe_ring_t* ring, int fd )
+{
+    struct stat st;
+    if( fstat( fd, &st ) || st.st_size < (off_t)sizeof(yabe_ring_shared_t) )
+        return false;
+    const size_t mapSize = (size_t)st.st_size;
+    void* map = mmap( NULL, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+    if( map == MAP_FAILED )
+        return false;
+
+    const yabe_ring_shared_t* shared = map;
+    const uint64_t count = shared->slotCount, slotSize = shared->slotSize;
+    if( memcmp( shared->magic, yabe_ring_magic, sizeof(yabe_ring_magic) ) ||
+        shared->version != YABE_RING_VERSION || count < 2 || (count & (count - 1)) ||
+        slotSize <= YABE_RING_SLOT_HEADER || slotSize % YABE_RING_LINE ||
+        slotSize > (mapSize - sizeof(yabe_ring_shared_t)) / count ||
+        sizeof(yabe_ring_shared_t) + count * slotSize != mapSize )
+    {
+        munmap( map, mapSize );
+        return false;
+    }
+    yabe_ring_map( ring, fd, map, mapSize );
+    return true;
+}
+
+
+/* Unmap the ring and close its file descriptor */
+void yabe_ring_close( yabe_ring_t* ring )
+{
+    if( ring->map )
+        munmap( ring->map, ring->mapSize );
+    if( ring->fd >= 0 )
+        close( ring->fd );
+    ring->map = NULL;
+    ring->fd = -1;
+}
+
+
+/* Reserve a slot where to write a message */
+bool yabe_ring_reserve( yabe_ring_t* ring, yabe_ring_slot_t* slot )
+{
+    uint64_t pos = __atomic_load_n( ring->tail, __ATOMIC_RELAXED );
+    uint64_t* seq;
+    for(;;)
+    {
+        seq = yabe_ring_seq( ring, pos );
+        const int64_t dif = (int64_t)(__atomic_load_n( seq, __ATOMIC_ACQUIRE ) - pos);
+        if( dif == 0 )
+        {
+            // the slot is free, claim it, a failed exchange reloads pos
+            if( !ring->multiProducer )
+            {
+                __atomic_store_n( ring->tail, pos + 1, __ATOMIC_RELAXED );
+                break;
+            }
+            if( __atomic_compare_exchange_n( ring->tail, &pos, pos + 1, true,
+                                             __ATOMIC_RELAXED, __ATOMIC_RELAXED ) )
+                break;
+        }
+        else if( dif < 0 )
+            return false;   // not released yet by the consumer, a lap behind
+        else
+            pos = __atomic_load_n( ring->tail, __ATOMIC_RELAXED );
+    }
+    slot->pos = pos;
+    slot->data = (char*)seq + YABE_RING_SLOT_HEADER;
+    slot->cursor.ptr = slot->data;
+    slot->cursor.len = ring->slotSize - YABE_RING_SLOT_HEADER;
+    return true;
+}
+
+
+/* Publish the message written in a reserved slot */
+void yabe_ring_commit( yabe_ring_t* ring, const yabe_ring_slot_t* slot )
+{
+    (void)ring;
+    uint64_t* seq = (uint64_t*)(slot->data - YABE_RING_SLOT_HEADER);
+    const uint32_t len = (uint32_t)(slot->cursor.ptr - slot->data);
+    memcpy( seq + 1, &len, sizeof(len) );
+    __atomic_store_n( seq, slot->pos + 1, __ATOMIC_RELEASE );
+}
+
+
+/* Return the oldest message of the ring without consuming it */
+bool yabe_ring_peek( yabe_ring_t* ring, yabe_ring_slot_t* slot )
+{
+    uint64_t pos = __atomic_load_n( ring->head, __ATOMIC_RELAXED );
+    for(;;)
+    {
+        uint64_t* seq = yabe_ring_seq( ring, pos );
+        if( __atomic_load_n( seq, __ATOMIC_ACQUIRE ) != pos + 1 )
+            return false;
+        // the length is written by another process, it is checked against
+        // the slot size
+        uint32_t len;
+        memcpy( &len, seq + 1, sizeof(len) );
+        if( len && len <= ring->slotSize - YABE_RING_SLOT_HEADER )
+        {
+            slot->pos = pos;
+            slot->data = (char*)seq + YABE_RING_SLOT_HEADER;
+            slot->cursor.ptr = slot->data;
+            slot->cursor.len = len;
+            return true;
+        }
+
+        // cancelled reservation or invalid length
+        __atomic_store_n( seq, pos + ring->mask + 1, __ATOMIC_RELEASE );
+        __atomic_store_n( ring->head, ++pos, __ATOMIC_RELAXED );
+    }
+}
+
+
+/* Give back to the producers the slot of a consumed message */
+void yabe_ring_release( yabe_ring_t* ring, const yabe_ring_slot_t* slot )
+{
+    uint64_t* seq = (uint64_t*)(slot->data - YABE_RING_SLOT_HEADER);
+    __atomic_store_n( seq, slot->pos + ring->mask + 1, __ATOMIC_RELEASE );
+    __atomic_store_n( ring->head, slot->pos + 1, __ATOMIC_RELAXED );
+}
@@ -0,0 +1,167 @@
+#ifndef YABE_RING_H
+#define YABE_RING_H
+
+#include "yabe.h"
+
+/**
+   \page ring_page Ring buffer of messages in shared memory
+
+   The ring passes encoded messages from producer threads or processes to a
+   single consumer without lock and without copy. It is an array of fixed
+   size slots in a shared memory mapping : a producer reserves a slot,
+   encodes its message directly in it with a writing cursor and commits it,
+   the consumer decodes the message in place and releases the slot.
+
+   Each slot starts with a sequence number telling whether it is free for
+   the producers or committed for the consumer, as in the bounded queue of
+   D. Vyukov. With several producers a slot is reserved by a compare and
+   swap of the reserve position, with a single producer by a plain store.
+   A producer may thus not wait for another one, except for the consumer
+   waiting on the slot reserved first when a later one is committed before
+   it.
+
+   The ring lives in a memfd file, or in an unlinked POSIX shared memory
+   object when memfd_create() is not available. Another process attaches to
+   the ring with the file descriptor, inherited through fork() or received
+   through a unix socket. The mapping only holds offsets and 64 bit
+   positions, it can be mapped at any address.
+
+   The functions don't block : reserving fails when the ring is full and
+   peeking when it is empty, the caller then spins, yields or sleeps.
+
+   \code
+    // producer
+    yabe_ring_slot_t slot;
+    while( !yabe_ring_reserve( &ring, &slot ) )
+        sched_yield();
+    yabe_write_small_object( &slot.cursor, 1 );
+    ...
+    yabe_ring_commit( &ring, &slot );
+
+    // consumer
+    while( yabe_ring_peek( &ring, &slot ) )
+    {
+        ... decode slot.cursor ...
+        yabe_ring_release( &ring, &slot );
+    }
+   \endcode
+*/
+
+/// Number of bytes of a slot used by the ring
+#define YABE_RING_SLOT_HEADER 16
+
+
+/**
+ * \brief Ring mapped in the process
+ */
+typedef struct yabe_ring_t
+{
+    int fd;                 ///< File descriptor of the shared memory
+    void* map;              ///< Mapping of the shared memory
+    size_t mapSize;         ///< Number of bytes of the mapping
+    char* slots;            ///< First slot
+    size_t slotSize;        ///< Number of bytes of a slot, header included
+    uint64_t mask;          ///< Number of slots minus one
+    bool multiProducer;     ///< True if slots are reserved by compare and swap
+    uint64_t* tail;         ///< Position of the next slot to reserve
+    uint64_t* head;         ///< Position of the next slot to consume
+} yabe_ring_t;
+
+
+/**
+ * \brief Slot reserved by a producer or peeked by the consumer
+ */
+typedef struct yabe_ring_slot_t
+{
+    yabe_cursor_t cursor;   ///< Writing cursor of a reserved slot, reading
+                            ///< cursor on the message of a peeked slot
+    char* data;             ///< First message byte of the slot
+    uint64_t pos;           ///< Position of the slot
+} yabe_ring_slot_t;
+
+
+/**
+ * \brief Create a ring in a new shared memory file and map it
+ *
+ * \param[out] ring Ring to initialize
+ * \param slotCount Number of slots, rounded up to a power of two
+ * \param messageSize Maximum number of bytes of a message
+ * \param multiProducer True if several threads or processes may reserve
+ *                      slots concurrently
+ * \return true if the ring could be created, false otherwise
+ */
+bool yabe_ring_create( yabe_ring_t* ring, size_t slotCount, size_t messageSize,
+                       bool multiProducer );
+
+
+/**
+ * \brief Map a ring created by another thread or process
+ *
+ * \param[out] ring Ring to initialize
+ * \param fd File descriptor of the ring shared memory, closed by
+ *           yabe_ring_close()
+ * \return true if the ring could be mapped, false if the file is not a ring
+ */
+bool yabe_ring_attach( yabe_ring_t* ring, int fd );
+
+
+/**
+ * \brief Unmap the ring and close its file descriptor
+ *
+ * \param[in,out] ring Ring created or attached
+ */
+void yabe_ring_close( yabe_ring_t* ring );
+
+
+/**
+ * \brief Reserve a slot where to write a message
+ *
+ * The slot must be committed with yabe_ring_commit(), the consumer waits
+ * for it.
+ *
+ * \param[in] ring Ring created or attached
+ * \param[out] slot Reserved slot, its cursor covers the slot message bytes
+ * \return true if a slot is reserved, false if the ring is full
+ */
+bool yabe_ring_reserve( yabe_ring_t* ring, yabe_ring_slot_t* slot );
+
+
+/**
+ * \brief Publish the message written in a reserved slot
+ *
+ * The message is made of the bytes written with the slot cursor. A slot
+ * committed with no byte written is skipped by the consumer, which cancels
+ * the reservation.
+ *
+ * \param[in] ring Ring created or attached
+ * \param[in] slot Slot returned by yabe_ring_reserve()
+ */
+void yabe_ring_commit( yabe_ring_t* ring, const yabe_ring_slot_t* slot );
+
+
+/**
+ * \brief Return the oldest message of the ring without consuming it
+ *
+ * Only one thread or process may consume the messages of a ring. A slot
+ * whose message length is larger than the slot is skipped and released like
+ * a cancelled reservation.
+ *
+ * \param[in] ring Ring created or attached
+ * \param[out] slot Slot of the message, its cursor covers the message
+ * \return true if a message is available, false if the ring is empty or
+ *         its oldest reserved slot is not committed yet
+ */
+bool yabe_ring_peek( yabe_ring_t* ring, yabe_ring_slot_t* slot );
+
+
+/**
+ * \brief Give back to the producers the slot of a consumed message
+ *
+ * The message bytes can't be accessed after.
+ *
+ * \param[in] ring Ring created or attached
+ * \param[in] slot Slot returned by yabe_ring_peek()
+ */
+void yabe_ring_release( yabe_ring_t* ring, const yabe_ring_slot_t* slot );
+
+#endif // YABE_RING_H
@@ -0,0 +1,82 @@
+#ifndef YABE_STATS_H
+#define YABE_STATS_H
+
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+   \page stats_page Encoding and decoding statistics
+
+   When yabe is compiled with the YABE_STATS macro defined, the writing and
+   reading functions count the encodings they produce and consume in
+   counters private to each thread. yabe_stats() returns the counters of the
+   calling thread. Without YABE_STATS, the counting macros expand to nothing
+   and the counters don't exist.
+
+   The width counters are indexed by the encoding size : 0 for the 1 byte
+   encodings, 1 for the 16 bit, 2 for the 32 bit and 3 for the 64 bit
+   encodings. For floating point values, index 0 counts the \e flt0 value.
+   For strings, the width is the one of the byte size in the string header.
+
+   The yabe_stats command line tool of Sources/YABE_STATS computes the same
+   kind of histograms for an existing .yabe file.
+*/
+
+#ifdef YABE_STATS
+
+/**
+ * \brief Per thread encoding and decoding counters
+ */
+typedef struct yabe_stats_t
+{
+    uint64_t writeInteger[4];  ///< Integers written by encoding width
+    uint64_t writeFloat[4];    ///< Floating point values written by encoding width
+    uint64_t writeString[4];   ///< String headers written by size width
+    uint64_t readInteger[4];   ///< Integers read by encoding width
+    uint64_t readFloat[4];     ///< Floating point values read by encoding width
+    uint64_t readString[4];    ///< String headers read by size width
+    uint64_t noneSkipped;      ///< None bytes skipped when reading or skipping
+    uint64_t containers;       ///< Arrays and objects skipped by yabe_skip_value()
+    uint64_t containerDepth;   ///< Sum of the nesting depth of these containers
+} yabe_stats_t;
+
+/// @cond DEV
+extern __thread yabe_stats_t yabe_thread_stats;
+
+/* Index of a 1, 3, 5 or 9 bytes encoding in the width counters */
+#define YABE_STATS_WIDTH( size ) ((size) < 9 ? (size) >> 1 : 3)
+
+#define YABE_STATS_ADD( counter, n ) (yabe_thread_stats.counter += (n))
+/// @endcond
+
+
+/**
+ * \brief Return the counters of the calling thread
+ *
+ * \return a pointer on the counters of the calling thread
+ */
+yabe_stats_t* yabe_stats( void );
+
+
+/**
+ * \brief Clear the counters of the calling thread
+ */
+static inline void yabe_stats_reset( void )
+    { memset( &yabe_thread_stats, 0, sizeof(yabe_stats_t) ); }
+
+#else
+
+/* n is not evaluated, only referenced to avoid unused variable warnings */
+#define YABE_STATS_ADD( counter, n ) ((void)sizeof( n ))
+
+#endif // YABE_STATS
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // YABE_STATS_H
@@ -0,0 +1,215 @@
+#include <stdbool.h>
+
+#include "yabe_vector.h"
+#include "yabe_endian.h"
+
+#if defined(__GNUC__) && defined(__x86_64__) && !defined(YABE_VECTOR_NO_SIMD)
+#  include <immintrin.h>
+#  define YABE_VECTOR_AVX2
+#endif
+
+
+#define YABE_VECTOR_BLOCK 4    // number of values classified at once
+#define YABE_VECTOR_SLACK 8    // bytes stored past the end of the last value
+#define YABE_VECTOR_RUN   32   // bytes tested at once for a run of small integers
+
+
+/* Tag of the encoding of each size, the 1 byte encoding is the value itself */
+static const int8_t yabe_vector_tags[10] =
+    { 0, 0, 0, yabe_int16_tag, 0, yabe_int32_tag, 0, 0, 0, yabe_int64_tag };
+
+
+/* Return the encoding size of an integer value without branches */
+static inline size_t yabe_vector_size( int64_t v )
+{
+    return 9 - 4*(v >= INT32_MIN && v <= INT32_MAX)
+             - 2*(v >= INT16_MIN && v <= INT16_MAX)
+             - 2*(v >= -32 && v <= 127);
+}
+
+
+/* Store the tag and the 8 value bytes, only the first size bytes are kept
+   as the next value overwrites the following ones */
+static inline char* yabe_vector_store( char* p, int64_t v, size_t size )
+{
+    *p = (size == 1) ? (char)v : (char)yabe_vector_tags[size];
+    yabe_store_le64( p + 1, (uint64_t)v );
+    YABE_STATS_ADD( writeInteger[YABE_STATS_WIDTH( size )], 1 );
+    return p + size;
+}
+
+
+/* Encode nBlocks blocks of values, requires room for their largest encoding
+   plus YABE_VECTOR_SLACK bytes */
+static char* yabe_pack_scalar( char* p, const int64_t* values, size_t nBlocks )
+{
+    for( size_t n = nBlocks*YABE_VECTOR_BLOCK; n; --n, ++values )
+        p = yabe_vector_store( p, *values, yabe_vector_size( *values ) );
+    return p;
+}
+
+
+/* Decode one integer value, requires 9 readable bytes, return NULL if the
+   value is not an integer. The payload is sign extended from its width with
+   shifts instead of branching on the tag. */
+static inline const char* yabe_unpack_one( const char* p, int64_t* value )
+{
+    const int8_t tag = (int8_t)*p;
+    const bool small = tag >= -32;
+    if( !small && (uint8_t)(tag - yabe_int16_tag) > 2 )
+        return NULL;
+    const unsigned width = small ? 0 : 2u << (tag - yabe_int16_tag);
+    const unsigned shift = (64 - 8*width) & 63;
+    const int64_t payload = (int64_t)(yabe_load_le64( p + 1 ) << shift) >> shift;
+    *value = small ? tag : payload;
+    YABE_STATS_ADD( readInteger[YABE_STATS_WIDTH( 1 + width )], 1 );
+    return p + 1 + width;
+}
+
+
+#if defined(YABE_VECTOR_AVX2)
+/* Classify four values at once, the prefix sum of their sizes gives the
+   offsets where the tags and payloads are stored */
+__attribute__((target("avx2")))
+static char* yabe_pack_avx2( char* p, const int64_t* values, size_t nBlocks )
+{
+    const __m256i lo8 = _mm256_set1_epi64x( -33 ), hi8 = _mm256_set1_epi64x( 128 );
+    const __m256i lo16 = _mm256_set1_epi64x( INT16_MIN - 1 ), hi16 = _mm256_set1_epi64x( INT16_MAX + 1 );
+    const __m256i lo32 = _mm256_set1_epi64x( INT32_MIN - 1LL ), hi32 = _mm256_set1_epi64x( INT32_MAX + 1LL );
+    const __m256i nine = _mm256_set1_epi64x( 9 );
+    for( ; nBlocks; --nBlocks, values += YABE_VECTOR_BLOCK )
+    {
+        const __m256i v = _mm256_loadu_si256( (const __m256i*)values );
+        const __m256i m8 = _mm256_and_si256( _mm256_cmpgt_epi64( v, lo8 ), _mm256_cmpgt_epi64( hi8, v ) );
+        const __m256i m16 = _mm256_and_si256( _mm256_cmpgt_epi64( v, lo16 ), _mm256_cmpgt_epi64( hi16, v ) );
+        const __m256i m32 = _mm256_and_si256( _mm256_cmpgt_epi64( v, lo32 ), _mm256_cmpgt_epi64( hi32, v ) );
+
+        // masks are -1 when true : size = 9 + 2*m8 + 2*m16 + 4*m32
+        const __m256i size = _mm256_add_epi64( nine,
+            _mm256_add_epi64( _mm256_slli_epi64( _mm256_add_epi64( m8, m16 ), 1 ),
+                              _mm256_slli_epi64( m32, 2 ) ) );
+        int64_t sizes[YABE_VECTOR_BLOCK];
+        _mm256_storeu_si256( (__m256i*)sizes, size );
+
+        char* const p1 = p + sizes[0];
+        char* const p2 = p1 + sizes[1];
+        char* const p3 = p2 + sizes[2];
+        yabe_vector_store( p, values[0], sizes[0] );
+        yabe_vector_store( p1, values[1], sizes[1] );
+        yabe_vector_store( p2, values[2], sizes[2] );
+        p = yabe_vector_store( p3, values[3], sizes[3] );
+    }
+    return p;
+}
+
+
+/* Convert the run of small integers at p, requires YABE_VECTOR_RUN readable
+   bytes and as many values, return the number of values converted which is
+   a multiple of 4 */
+__attribute__((target("avx2")))
+static size_t yabe_unpack_small_avx2( const char* p, int64_t* values )
+{
+    const __m256i bytes = _mm256_loadu_si256( (const __m256i*)p );
+    const uint32_t small = (uint32_t)_mm256_movemask_epi8(
+        _mm256_cmpgt_epi8( bytes, _mm256_set1_epi8( -33 ) ) );
+    const size_t n = (~small ? (size_t)__builtin_ctz( ~small ) : YABE_VECTOR_RUN) & ~(size_t)3;
+    for( size_t i = 0; i < n; i += 4 )
+    {
+        const __m128i four = _mm_cvtsi32_si128( (int)yabe_load32( p + i ) );
+        _mm256_storeu_si256( (__m256i*)(values + i), _mm256_cvtepi8_epi64( four ) );
+    }
+    YABE_STATS_ADD( readInteger[0], n );
+    return n;
+}
+
+
+static bool yabe_vector_has_avx2( void )
+{
+    static int hasAvx2 = -1;
+    if( hasAvx2 < 0 )
+        hasAvx2 = __builtin_cpu_supports( "avx2" ) ? 1 : 0;
+    return hasAvx2;
+}
+#else
+static char* yabe_pack_avx2( char* p, const int64_t* values, size_t nBlocks )
+    { return yabe_pack_scalar( p, values, nBlocks ); }
+
+static size_t yabe_unpack_small_avx2( const char* p, int64_t* values )
+    { (void)p; (void)values; return 0; }
+
+static bool yabe_vector_has_avx2( void ) { return false; }
+#endif
+
+
+/* Return the number of bytes of the encoding of the integer values */
+size_t yabe_sizeof_integers( const int64_t* values, size_t count )
+{
+    size_t size = 0;
+    while( count-- )
+        size += yabe_vector_size( *values++ );
+    return size;
+}
+
+
+/* Write as many integer values as possible, return the number written */
+size_t yabe_write_integers( yabe_cursor_t* cursor, const int64_t* values, size_t count )
+{
+    const size_t blockMax = YABE_VECTOR_BLOCK*9;
+    const bool avx2 = yabe_vector_has_avx2();
+    size_t i = 0;
+
+    // encode whole blocks while their largest encoding fits in the buffer
+    while( count - i >= YABE_VECTOR_BLOCK && cursor->len >= blockMax + YABE_VECTOR_SLACK )
+    {
+        size_t nBlocks = (count - i)/YABE_VECTOR_BLOCK;
+        if( nBlocks > (cursor->len - YABE_VECTOR_SLACK)/blockMax )
+            nBlocks = (cursor->len - YABE_VECTOR_SLACK)/blockMax;
+        char* p = avx2 ? yabe_pack_avx2( cursor->ptr, values + i, nBlocks )
+                       : yabe_pack_scalar( cursor->ptr, values + i, nBlocks );
+        cursor->len -= p - cursor->ptr;
+        cursor->ptr = p;
+        i += nBlocks*YABE_VECTOR_BLOCK;
+    }
+
+    // write the remaining values one by one
+    for( ; i < count; ++i )
+        if( !yabe_write_integer( cursor, values[i] ) )
+            break;
+    return i;
+}
+
+
+/* Read up to count consecutive integer values, return the number read */
+size_t yabe_read_integers( yabe_cursor_t* cursor, int64_t* values, size_t count )
+{
+    const bool avx2 = yabe_vector_has_avx2();
+    const char* p = cursor->ptr;
+    const char* const end = cursor->ptr + cursor->len;
+    size_t i = 0;
+
+    // decode without testing the buffer size while the largest value fits
+    while( i < count && end - p >= 9 )
+    {
+        if( avx2 && (int8_t)*p >= -32 && count - i >= YABE_VECTOR_RUN && end - p >= YABE_VECTOR_RUN )
+        {
+            const size_t n = yabe_unpack_small_avx2( p, values + i );
+            p += n;
+            i += n;
+            if( n )
+                continue;
+        }
+        const char* next = yabe_unpack_one( p, values + i );
+        if( !next )
+            break;
+        p = next;
+        ++i;
+    }
+    cursor->len -= p - cursor->ptr;
+    cursor->ptr = (char*)p;
+
+    // read the values at the end of the buffer one by one
+    for( ; i < count && cursor->len; ++i )
+        if( !yabe_read_integer( cursor, values + i ) )
+            break;
+    return i;
+}
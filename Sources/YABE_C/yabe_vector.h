@@ -0,0 +1,77 @@
+#ifndef YABE_VECTOR_H
+#define YABE_VECTOR_H
+
+#include "yabe.h"
+
+/**
+   \page vector_page Bulk integer encoding and decoding
+
+   Large arrays of integers, like identifiers or time stamps, are encoded and
+   decoded in bulk by yabe_write_integers() and yabe_read_integers(). The
+   values are encoded exactly as by yabe_write_integer(), with the smallest
+   of the 1, 3, 5 or 9 bytes encodings, so that the bytes produced are the
+   same and can be read back value by value.
+
+   The encoder classifies blocks of values into their encoding sizes, computes
+   their output offsets by a prefix sum of the sizes and then stores the tags
+   and payloads without any further test on the value. The decoder converts
+   runs of small integers with vector instructions and decodes the other
+   values without testing the remaining buffer size for each of them.
+
+   The AVX2 kernels are selected at run time when the processor supports
+   them. A portable scalar implementation is used otherwise, or when the
+   YABE_VECTOR_NO_SIMD macro is defined at compile time.
+
+   \code
+    yabe_write_array_stream( &cursor );
+    if( yabe_write_integers( &cursor, values, count ) != count ) { ... full ... }
+    yabe_write_end_stream( &cursor );
+   \endcode
+*/
+
+
+/**
+ * \brief Return the number of bytes of the encoding of the integer values
+ *
+ * \param values Pointer on the integer values
+ * \param count Number of integer values
+ * \return the sum of yabe_sizeof_integer() for all values
+ */
+size_t yabe_sizeof_integers( const int64_t* values, size_t count );
+
+
+/**
+ * \brief Writes as many integer values as possible at cursor position and
+ *  returns the number of values written
+ *
+ * Only complete values are written. A returned value smaller than \e count
+ * means the buffer is full, the remaining values must be written with one or
+ * more additionnal calls. Bytes past the written values may be modified as
+ * long as they are in the buffer.
+ *
+ * \param[in,out] cursor Pointer on buffer info where to write values,
+ *                       updated by the number of bytes written
+ * \param values Pointer on the integer values to write
+ * \param count Number of integer values to write
+ * \return the number of values written, \e incomplete : < \e count,
+ *         \e complete : \e count
+ */
+size_t yabe_write_integers( yabe_cursor_t* cursor, const int64_t* values, size_t count );
+
+
+/**
+ * \brief Reads up to count consecutive integer values at cursor position and
+ *  returns the number of values read
+ *
+ * Reading stops at the first value that is not an integer, for instance the
+ * end of an array stream, at the end of the buffer or after count values.
+ *
+ * \param[in,out] cursor Pointer on buffer where to read values, updated by
+ *                       the number of bytes read
+ * \param values Pointer on the array receiving the values
+ * \param count Maximum number of values to read
+ * \return the number of values read
+ */
+size_t yabe_read_integers( yabe_cursor_t* cursor, int64_t* values, size_t count );
+
+#endif // YABE_VECTOR_H
@@ -0,0 +1,24 @@
+TEMPLATE = app
+CONFIG += console c++17
+CONFIG -= qt
+
+TARGET = yabe_cpp
+QMAKE_CFLAGS += -std=c99
+INCLUDEPATH += ../YABE_C
+
+SOURCES += main.cpp \
+    yabe_value.cpp \
+    ../YABE_C/yabe.c \
+    ../YABE_C/yabe_vector.c \
+    ../YABE_C/yabe_packed.c
+
+HEADERS += \
+    yabe_value.hpp \
+    yabe_reflect.hpp \
+    ../YABE_C/yabe.h \
+    ../YABE_C/yabe_vector.h \
+    ../YABE_C/yabe_packed.h \
+    ../YABE_C/yabe_stats.h \
+    ../YABE_C/yabe_endian.h
+
+OTHER_FILES +=
@@ -0,0 +1,245 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#include "yabe_value.hpp"
+#include "yabe_reflect.hpp"
+#include "yabe_packed.h"
+#include "yabe_endian.h"
+
+/* Structs serialized by the reflection macros */
+struct sample
+{
+    int8_t level;
+    uint16_t port;
+    double ratio;
+    bool enabled;
+};
+YABE_REFLECT( sample, YABE_FIELD( level ), YABE_FIELD( port ), YABE_FIELD( ratio ), YABE_FIELD( enabled ) )
+
+struct record
+{
+    int64_t id;
+    std::string name;
+    sample last;
+    std::vector<sample> history;
+    std::vector<int32_t> counts;
+    float scale;
+    uint64_t mask;
+};
+YABE_REFLECT( record, YABE_FIELD( id ), YABE_FIELD( name ), YABE_FIELD( last ), YABE_FIELD( history ),
+              YABE_FIELD( counts ), YABE_FIELD( scale ), YABE_FIELD( mask ) )
+
+static_assert( yabe::codec<sample>::fixed && !yabe::codec<record>::fixed,
+               "structs of fixed size fields have a constant size bound" );
+
+/* Sequence of some rough decoding tests of the C++ documents. */
+
+int main()
+{
+    static char buffer[4096];
+    yabe_cursor_t wCurInit = { buffer, sizeof(buffer) }, wCur = wCurInit;
+    size_t len = 0;
+
+    // Object with unsorted members of all kinds
+    const int64_t packed[] = { 1000, 1001, 1003, 1006 };
+    len += yabe_write_none( &wCur );
+    len += yabe_write_object_stream( &wCur );
+    len += yabe_write_string( &wCur, 4 ) + yabe_write_data( &wCur, "name", 4 );
+    len += yabe_write_string( &wCur, 4 ) + yabe_write_data( &wCur, "yabe", 4 );
+    len += yabe_write_string( &wCur, 2 ) + yabe_write_data( &wCur, "id", 2 );
+    len += yabe_write_none( &wCur );
+    len += yabe_write_integer( &wCur, 42 );
+    len += yabe_write_string( &wCur, 4 ) + yabe_write_data( &wCur, "tags", 4 );
+    len += yabe_write_array_stream( &wCur );
+    len += yabe_write_integer( &wCur, 1 );
+    len += yabe_write_float( &wCur, 2.5 );
+    len += yabe_write_bool( &wCur, true );
+    len += yabe_write_null( &wCur );
+    len += yabe_write_string( &wCur, 1 ) + yabe_write_data( &wCur, "x", 1 );
+    len += yabe_write_end_stream( &wCur );
+    len += yabe_write_string( &wCur, 4 ) + yabe_write_data( &wCur, "blob", 4 );
+    len += yabe_write_blob( &wCur );
+    len += yabe_write_string( &wCur, 10 ) + yabe_write_data( &wCur, "text/plain", 10 );
+    len += yabe_write_string( &wCur, 2 ) + yabe_write_data( &wCur, "hi", 2 );
+    len += yabe_write_string( &wCur, 6 ) + yabe_write_data( &wCur, "nested", 6 );
+    len += yabe_write_small_object( &wCur, 2 );
+    len += yabe_write_string( &wCur, 1 ) + yabe_write_data( &wCur, "b", 1 );
+    len += yabe_write_integer( &wCur, 1 );
+    len += yabe_write_string( &wCur, 1 ) + yabe_write_data( &wCur, "a", 1 );
+    len += yabe_write_small_array( &wCur, 0 );
+    len += yabe_write_string( &wCur, 6 ) + yabe_write_data( &wCur, "packed", 6 );
+    len += yabe_write_delta_array( &wCur, packed, 4 );
+    len += yabe_write_end_stream( &wCur );
+
+    yabe::document doc;
+    if( !doc.parse( buffer, len ) || !doc.root().is_object() || doc.root().size() != 6 )
+    {
+        printf( "Failed parsing a document\n" );
+        exit(1);
+    }
+    const yabe::value& root = doc.root();
+    const yabe::value* v;
+    bool ok = (v = root.find( "name" )) && v->is_string() && v->as_string() == "yabe" &&
+        (v = root.find( "id" )) && v->is_integer() && v->as_integer() == 42 &&
+        (v = root.find( "blob" )) && v->is_blob() && v->blob_mime() == "text/plain" &&
+        v->blob_data() == "hi" && v->blob_data().data() > buffer && v->blob_data().data() < buffer + len &&
+        !root.find( "missing" ) && !root.find( "nam" ) && !root.find( "names" ) &&
+        std::is_sorted( root.members_begin(), root.members_end(),
+            []( const yabe::member& a, const yabe::member& b ) { return a.key < b.key; } );
+    const yabe::value* tags = root.find( "tags" );
+    ok = ok && tags && tags->is_array() && tags->size() == 5 && (*tags)[0].as_integer() == 1 &&
+        (*tags)[1].as_double() == 2.5 && (*tags)[2].as_bool() && (*tags)[3].is_null() &&
+        (*tags)[4].as_string() == "x" && (*tags)[0].as_double() == 1.0;
+    const yabe::value* nested = root.find( "nested" );
+    ok = ok && nested && nested->size() == 2 && nested->members_begin()->key == "a" &&
+        nested->find( "a" )->is_array() && nested->find( "a" )->size() == 0 &&
+        nested->find( "b" )->as_integer() == 1 && !(*tags)[0].find( "a" );
+    const yabe::value* p = root.find( "packed" );
+    int64_t sum = 0;
+    if( ok && p && p->is_array() && p->size() == 4 )
+        for( const yabe::value& item : *p )
+            sum += item.as_integer();
+    if( !ok || sum != 4010 )
+    {
+        printf( "Failed reading the values of a document\n" );
+        exit(1);
+    }
+
+    // Moving the document keeps the values in place
+    yabe::document moved( std::move( doc ) );
+    yabe::document other;
+    other = std::move( moved );
+    if( !doc.root().is_null() || !moved.root().is_null() || other.root().find( "tags" ) != tags ||
+        doc.memory().capacity() || !other.memory().capacity() )
+    {
+        printf( "Failed moving a document\n" );
+        exit(1);
+    }
+
+    // A copy of the buffer outlives it
+    static char copy[sizeof(buffer)];
+    memcpy( copy, buffer, len );
+    if( !other.parse_copy( copy, len ) )
+    {
+        printf( "Failed parsing a copy of a document\n" );
+        exit(1);
+    }
+    memset( copy, 0, len );
+    v = other.root().find( "name" );
+    if( !v || v->as_string() != "yabe" )
+    {
+        printf( "Failed reading a copy of a document\n" );
+        exit(1);
+    }
+
+    // Invalid documents
+    wCur = wCurInit;
+    size_t dupLen = yabe_write_small_object( &wCur, 2 );
+    for( int i = 0; i < 2; ++i )
+        dupLen += yabe_write_string( &wCur, 1 ) + yabe_write_data( &wCur, "k", 1 ) +
+                  yabe_write_integer( &wCur, i );
+    if( other.parse( buffer, dupLen ) || !other.root().is_null() || other.memory().capacity() ||
+        other.parse( buffer, dupLen - 1 ) || !other.parse( buffer + dupLen - 1, 1 ) ||
+        other.root().as_integer() != 1 )
+    {
+        printf( "Failed rejecting invalid documents\n" );
+        exit(1);
+    }
+    wCur = wCurInit;
+    size_t deepLen = 0;
+    for( int i = 0; i <= YABE_MAX_DEPTH; ++i )
+        deepLen += yabe_write_small_array( &wCur, 1 );
+    deepLen += yabe_write_integer( &wCur, 0 );
+    if( other.parse( buffer, deepLen ) || !other.parse( buffer + 1, deepLen - 1 ) )
+    {
+        printf( "Failed limiting the depth of documents\n" );
+        exit(1);
+    }
+
+    // Rle arrays of 2^32 values in 35 bytes and of one value more than the
+    // limit are rejected before allocating their values
+    char rleMax[3 + 8 + 2 * 12] = { yabe_blob_tag, YABE_PACKED_RLE, (char)(yabe_str6_tag | 32) };
+    yabe_store_le64( rleMax + 3, 1ULL << 32 );
+    for( int i = 0; i < 2; ++i )
+        yabe_store_le32( rleMax + 11 + 12 * i, 1U << 31 );
+    char rle[3 + 8 + 12] = { yabe_blob_tag, YABE_PACKED_RLE, (char)(yabe_str6_tag | 20) };
+    const uint32_t maxCount = yabe::document::max_packed_per_byte * sizeof(rle);
+    yabe_store_le64( rle + 3, maxCount + 1 );
+    yabe_store_le32( rle + 11, maxCount + 1 );
+    bool limitOk = !other.parse( rleMax, sizeof(rleMax) ) && !other.memory().capacity() &&
+        !other.parse( rle, sizeof(rle) );
+    yabe_store_le64( rle + 3, maxCount );
+    yabe_store_le32( rle + 11, maxCount );
+    if( !limitOk || !other.parse( rle, sizeof(rle) ) || other.root().size() != maxCount )
+    {
+        printf( "Failed limiting the packed arrays of documents\n" );
+        exit(1);
+    }
+
+    // A copy filling its chunk but a few bytes, the values allocated after
+    static char large[4097];
+    yabe_cursor_t lCur = { large, sizeof(large) };
+    size_t largeLen = yabe_write_small_array( &lCur, 2 ) + yabe_write_string( &lCur, 4092 );
+    memset( lCur.ptr, 'x', 4092 );
+    lCur.ptr += 4092;
+    lCur.len -= 4092;
+    largeLen += 4092;
+    largeLen += yabe_write_integer( &lCur, 7 );
+    if( largeLen != sizeof(large) || !other.parse_copy( large, largeLen ) ||
+        other.root().size() != 2 || other.root()[0].as_string().size() != 4092 ||
+        other.root()[1].as_integer() != 7 )
+    {
+        printf( "Failed parsing a copy filling its chunk\n" );
+        exit(1);
+    }
+
+    // Structs are written and read back by their fields
+    record rec{ -7, "sensor", { -100, 8080, 0.25, true },
+                { { 1, 2, 3.5, false }, { -1, 65535, -0.5, true } }, { 1, -2, 100000 }, 1.5f, ~0ULL };
+    wCur = wCurInit;
+    len = yabe::write( &wCur, rec );
+    yabe_cursor_t rCur = { buffer, len };
+    record back{};
+    back.name = "unchanged";
+    yabe_cursor_t smallCur = { buffer, len - 1 };
+    ok = len && yabe::read( &rCur, back ) == len && rCur.len == 0 && back.id == -7 && back.name == "sensor" &&
+        back.last.level == -100 && back.last.port == 8080 && back.last.ratio == 0.25 && back.last.enabled &&
+        back.history.size() == 2 && back.history[1].port == 65535 && back.history[1].ratio == -0.5 &&
+        back.counts.size() == 3 && back.counts[2] == 100000 && back.scale == 1.5f && back.mask == ~0ULL &&
+        !yabe::write( &smallCur, rec ) && smallCur.ptr == buffer && doc.parse( buffer, len ) &&
+        doc.root().size() == 7 && doc.root().find( "history" )->size() == 2;
+
+    // The exact size is used when the buffer is smaller than the bound
+    char exact[64];
+    yabe_cursor_t exactCur = { exact, sizeof(exact) };
+    sample s{ 1, 2, 0.5, false }, t{};
+    ok = ok && (len = yabe::write( &exactCur, s )) && yabe::codec<sample>::bound() > len &&
+        (exactCur = { exact, len }, yabe::write( &exactCur, s ) == len) && exactCur.len == 0;
+
+    // Unknown members are skipped, missing ones left unchanged, integers must fit
+    wCur = wCurInit;
+    len = yabe_write_small_object( &wCur, 3 );
+    len += yabe_write_string( &wCur, 5 ) + yabe_write_data( &wCur, "other", 5 ) + yabe_write_small_array( &wCur, 1 ) +
+           yabe_write_integer( &wCur, 1 );
+    len += yabe_write_string( &wCur, 4 ) + yabe_write_data( &wCur, "port", 4 ) + yabe_write_none( &wCur ) +
+           yabe_write_integer( &wCur, 443 );
+    len += yabe_write_string( &wCur, 5 ) + yabe_write_data( &wCur, "ratio", 5 ) + yabe_write_integer( &wCur, 3 );
+    rCur = { buffer, len };
+    t.level = 9;
+    ok = ok && yabe::read( &rCur, t ) == len && t.level == 9 && t.port == 443 && t.ratio == 3.0 && !t.enabled;
+    wCur = wCurInit;
+    len = yabe_write_small_object( &wCur, 1 ) + yabe_write_string( &wCur, 5 ) + yabe_write_data( &wCur, "level", 5 ) +
+          yabe_write_integer( &wCur, 128 );
+    rCur = { buffer, len };
+    ok = ok && !yabe::read( &rCur, t ) && rCur.ptr == buffer;
+    if( !ok )
+    {
+        printf( "Failed serializing structs\n" );
+        exit(1);
+    }
+
+    printf( "Done!\n" );
+    return 0;
+}
@@ -0,0 +1,446 @@
+#ifndef YABE_REFLECT_HPP
+#define YABE_REFLECT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "yabe.h"
+
+/**
+   \page reflect_page C++ struct serialization
+
+   YABE_REFLECT() lists the fields of a struct to encode it as an object
+   whose member identifiers are the field names, and to decode it back :
+
+   \code
+    struct point { int32_t x, y; std::string label; };
+    YABE_REFLECT( point, YABE_FIELD( x ), YABE_FIELD( y ), YABE_FIELD( label ) )
+
+    point p{ 1, 2, "origin" };
+    if( !yabe::write( &wCur, p ) ) { ... }
+    if( !yabe::read( &rCur, p ) ) { ... }
+   \endcode
+
+   The macro is used at global scope, after the struct definition. The field
+   types may be bool, integers, float, double, std::string, std::vector of
+   these types and structs listed with YABE_REFLECT().
+
+   The encoded member identifiers, header included, are computed at compile
+   time with their length and hash. Writing a struct checks the buffer space
+   once with an upper bound of its encoded size, a constant for structs of
+   fixed size fields, then writes the members without checking the space.
+   The exact size is only computed when the buffer is smaller than the bound.
+
+   Reading a struct hashes each member identifier once and selects the field
+   by comparing its length and hash with the precomputed ones, the bytes of
+   the identifier being compared to the field name of the selected field
+   only. Unknown members are skipped and fields without member are left
+   unchanged. Integers that don't fit in the field type make the read fail.
+
+   Unsigned 64 bit fields are encoded as the signed integer of the same bits.
+*/
+
+namespace yabe {
+
+
+/**
+ * \brief Fields of a struct, specialized by YABE_REFLECT()
+ */
+template<class T>
+struct reflect
+{
+};
+
+
+/// Return the hash of a member identifier : its first 8 bytes and, for
+/// longer identifiers, its last 8 bytes rotated
+constexpr uint64_t key_hash( const char* key, size_t len )
+{
+    uint64_t head = 0, tail = 0;
+    for( size_t i = 0; i < len && i < 8; ++i )
+        head |= (uint64_t)(uint8_t)key[i] << (8 * i);
+    for( size_t i = len > 8 ? len - 8 : len; i < len; ++i )
+        tail |= (uint64_t)(uint8_t)key[i] << (8 * (i + 8 - len));
+    return head ^ ((tail << 29) | (tail >> 35));
+}
+
+
+/**
+ * \brief Field of a struct with its encoded member identifier
+ */
+template<class T, class M, size_t N>
+struct field
+{
+    using type = M;                 ///< Type of the field
+
+    M T::* ptr;                     ///< Pointer on the field
+    size_t len;                     ///< Number of bytes of the field name
+    uint64_t hash;                  ///< Hash of the field name
+    size_t keySize;                 ///< Number of bytes of the encoded name
+    char key[N + 3];                ///< Encoded name, string header included
+
+    constexpr field( const char (&name)[N + 1], M T::* ptr )
+        : ptr( ptr ), len( N ), hash( key_hash( name, N ) ), keySize( 0 ), key()
+    {
+        static_assert( N < 65536, "field names are limited to 65535 bytes" );
+        if( N < 64 )
+            key[keySize++] = (char)(0x80 | N);
+        else
+        {
+            key[keySize++] = (char)0xCD;
+            key[keySize++] = (char)(N & 0xFF);
+            key[keySize++] = (char)(N >> 8);
+        }
+        for( size_t i = 0; i < N; ++i )
+            key[keySize++] = name[i];
+    }
+};
+
+
+/// Return the field of a struct, used by YABE_FIELD()
+template<class T, class M, size_t L>
+constexpr field<T, M, L - 1> make_field( const char (&name)[L], M T::* ptr )
+{
+    return field<T, M, L - 1>( name, ptr );
+}
+
+
+/// @cond DEV
+template<class T, class = void>
+struct is_reflected : std::false_type {};
+
+template<class T>
+struct is_reflected<T, std::void_t<decltype(reflect<T>::fields)>> : std::true_type {};
+
+template<class F>
+using field_type = typename std::decay_t<F>::type;
+
+template<class T, class = void>
+struct codec;
+
+/* Booleans */
+template<>
+struct codec<bool>
+{
+    static constexpr bool fixed = true;
+    static constexpr size_t bound() { return 1; }
+    static size_t bound( bool ) { return 1; }
+    static size_t size( bool ) { return 1; }
+    static void put( yabe_cursor_t* c, bool v ) { yabe_put_bool( c, v ); }
+    static bool get( yabe_cursor_t* c, bool& v ) { return yabe_read_bool( c, &v ) != 0; }
+};
+
+/* Integers */
+template<class M>
+struct codec<M, std::enable_if_t<std::is_integral<M>::value>>
+{
+    static constexpr bool fixed = true;
+    static constexpr size_t bound()
+    {
+        // unsigned values may need the next signed width
+        constexpr size_t width = std::is_signed<M>::value ? sizeof(M) : 2 * sizeof(M);
+        return width <= 2 ? 3 : width <= 4 ? 5 : 9;
+    }
+    static size_t bound( M ) { return bound(); }
+    static size_t size( M v ) { return yabe_sizeof_integer( (int64_t)v ); }
+    static void put( yabe_cursor_t* c, M v ) { yabe_put_integer( c, (int64_t)v ); }
+    static bool get( yabe_cursor_t* c, M& v )
+    {
+        int64_t i;
+        if( !yabe_read_integer( c, &i ) )
+            return false;
+        if( sizeof(M) < sizeof(int64_t) &&
+            (i < (int64_t)std::numeric_limits<M>::min() || i > (int64_t)std::numeric_limits<M>::max()) )
+            return false;
+        v = (M)i;
+        return true;
+    }
+};
+
+/* Floating point values, integers are accepted when reading */
+template<class M>
+struct codec<M, std::enable_if_t<std::is_floating_point<M>::value>>
+{
+    static constexpr bool fixed = true;
+    static constexpr size_t bound() { return 1 + sizeof(double); }
+    static size_t bound( M ) { return bound(); }
+    static size_t size( M v ) { return yabe_sizeof_float( (double)v ); }
+    static void put( yabe_cursor_t* c, M v ) { yabe_put_float( c, (double)v ); }
+    static bool get( yabe_cursor_t* c, M& v )
+    {
+        double f;
+        int64_t i;
+        if( yabe_read_float( c, &f ) )
+            v = (M)f;
+        else if( yabe_read_integer( c, &i ) )
+            v = (M)i;
+        else
+            return false;
+        return true;
+    }
+};
+
+/* Strings */
+template<>
+struct codec<std::string>
+{
+    static constexpr bool fixed = false;
+    static size_t bound( const std::string& v ) { return 1 + sizeof(uint64_t) + v.size(); }
+    static size_t size( const std::string& v ) { return yabe_sizeof_string( v.size() ) + v.size(); }
+    static void put( yabe_cursor_t* c, const std::string& v )
+    {
+        yabe_put_string( c, v.size() );
+        yabe_put_data( c, v.data(), v.size() );
+    }
+    static bool get( yabe_cursor_t* c, std::string& v )
+    {
+        yabe_string_view_t view;
+        if( !yabe_read_string_view( c, &view ) )
+            return false;
+        v.assign( view.ptr, view.len );
+        return true;
+    }
+};
+
+/* Read the header of an array or object, nbr is -1 for a stream */
+inline bool read_header( yabe_cursor_t* c, bool object, int8_t* nbr )
+{
+    *nbr = -1;
+    return object ? (yabe_read_small_object( c, nbr ) || yabe_read_object_stream( c ))
+                  : (yabe_read_small_array( c, nbr ) || yabe_read_array_stream( c ));
+}
+
+/* Skip the none values before the next item, return false at the end of
+   the container or of the buffer */
+inline bool next_item( yabe_cursor_t* c, int8_t nbr, size_t i, bool* ok )
+{
+    if( nbr >= 0 && i == (size_t)nbr )
+        return false;
+    yabe_read_none( c );
+    if( yabe_end_of_buffer( c ) )
+        return *ok = false;
+    return nbr >= 0 || !yabe_read_end_stream( c );
+}
+
+/* Arrays */
+template<class E>
+struct codec<std::vector<E>>
+{
+    static constexpr bool fixed = false;
+    static size_t bound( const std::vector<E>& v )
+    {
+        if constexpr( codec<E>::fixed )
+            return 2 + v.size() * codec<E>::bound();
+        size_t n = 2;
+        for( const E& e : v )
+            n += codec<E>::bound( e );
+        return n;
+    }
+    static size_t size( const std::vector<E>& v )
+    {
+        size_t n = v.size() > 6 ? 2 : 1;
+        for( const E& e : v )
+            n += codec<E>::size( e );
+        return n;
+    }
+    static void put( yabe_cursor_t* c, const std::vector<E>& v )
+    {
+        if( v.size() > 6 )
+            yabe_put_array_stream( c );
+        else
+            yabe_put_small_array( c, v.size() );
+        for( const E& e : v )
+            codec<E>::put( c, e );
+        if( v.size() > 6 )
+            yabe_put_end_stream( c );
+    }
+    static bool get( yabe_cursor_t* c, std::vector<E>& v )
+    {
+        int8_t nbr;
+        bool ok = true;
+        if( !read_header( c, false, &nbr ) )
+            return false;
+        v.clear();
+        for( size_t i = 0; next_item( c, nbr, i, &ok ); ++i )
+        {
+            v.emplace_back();
+            if( !codec<E>::get( c, v.back() ) )
+                return false;
+        }
+        return ok;
+    }
+};
+
+/* Structs listed with YABE_REFLECT() */
+template<class T>
+struct codec<T, std::enable_if_t<is_reflected<T>::value>>
+{
+    static constexpr size_t count = std::tuple_size<decltype(reflect<T>::fields)>::value;
+
+    static constexpr bool all_fixed()
+    {
+        return std::apply( []( const auto&... f ) {
+            return (codec<field_type<decltype(f)>>::fixed && ...); }, reflect<T>::fields );
+    }
+    static constexpr bool fixed = all_fixed();
+
+    static constexpr size_t keys()
+    {
+        return std::apply( []( const auto&... f ) { return (f.keySize + ... + 0); }, reflect<T>::fields );
+    }
+    static constexpr size_t bound()
+    {
+        return std::apply( []( const auto&... f ) {
+            return (codec<field_type<decltype(f)>>::bound() + ... + 0); },
+            reflect<T>::fields ) + keys() + 2;
+    }
+    static size_t bound( const T& v )
+    {
+        if constexpr( fixed )
+            return bound();
+        return std::apply( [&v]( const auto&... f ) {
+            return (codec<field_type<decltype(f)>>::bound( v.*f.ptr ) + ... + 0); },
+            reflect<T>::fields ) + keys() + 2;
+    }
+    static size_t size( const T& v )
+    {
+        return std::apply( [&v]( const auto&... f ) {
+            return (codec<field_type<decltype(f)>>::size( v.*f.ptr ) + ... + 0); },
+            reflect<T>::fields ) + keys() + (count > 6 ? 2 : 1);
+    }
+    static void put( yabe_cursor_t* c, const T& v )
+    {
+        if( count > 6 )
+            yabe_put_object_stream( c );
+        else
+            yabe_put_small_object( c, count );
+        std::apply( [c, &v]( const auto&... f ) {
+            ((yabe_put_data( c, f.key, f.keySize ),
+              codec<field_type<decltype(f)>>::put( c, v.*f.ptr )), ...); },
+            reflect<T>::fields );
+        if( count > 6 )
+            yabe_put_end_stream( c );
+    }
+
+    /* Return the index of the field with the given name, or count */
+    template<size_t... I>
+    static size_t find( const yabe_string_view_t& key, std::index_sequence<I...> )
+    {
+        const uint64_t h = key_hash( key.ptr, key.len );
+        size_t index = count;
+        ((std::get<I>( reflect<T>::fields ).len == key.len && std::get<I>( reflect<T>::fields ).hash == h &&
+          !std::memcmp( std::get<I>( reflect<T>::fields ).key + std::get<I>( reflect<T>::fields ).keySize - key.len,
+                        key.ptr, key.len ) && (index = I, true)) || ...);
+        return index;
+    }
+
+    /* Read the value of the field of the given index */
+    template<size_t... I>
+    static bool get_field( yabe_cursor_t* c, T& v, size_t index, std::index_sequence<I...> )
+    {
+        bool ok = false;
+        ((index == I && (ok = codec<field_type<decltype(std::get<I>( reflect<T>::fields ))>>::get(
+            c, v.*std::get<I>( reflect<T>::fields ).ptr ), true)) || ...);
+        return ok;
+    }
+
+    static bool get( yabe_cursor_t* c, T& v )
+    {
+        int8_t nbr;
+        bool ok = true;
+        if( !read_header( c, true, &nbr ) )
+            return false;
+        for( size_t i = 0; next_item( c, nbr, i, &ok ); ++i )
+        {
+            yabe_string_view_t key;
+            if( !yabe_read_string_view( c, &key ) )
+                return false;
+            const size_t index = find( key, std::make_index_sequence<count>() );
+            yabe_read_none( c );
+            if( yabe_end_of_buffer( c ) ||
+                (index == count ? !yabe_skip_value( c )
+                                : !get_field( c, v, index, std::make_index_sequence<count>() )) )
+                return false;
+        }
+        return ok;
+    }
+};
+/// @endcond
+
+
+/**
+ * \brief Tries writing the struct as an object and returns the number of
+ *  bytes written
+ *
+ * \param[in,out] cursor Pointer on buffer info where to write the value,
+ *                       updated if the value could be written
+ * \param value Value to write, a type listed with YABE_REFLECT() or a field
+ *              type
+ * \return the number of bytes written, \e fail : 0 if cursor is too small
+ */
+template<class T>
+size_t write( yabe_cursor_t* cursor, const T& value )
+{
+    if( cursor->len < codec<T>::bound( value ) && cursor->len < codec<T>::size( value ) )
+        return 0;
+    const char* const start = cursor->ptr;
+    codec<T>::put( cursor, value );
+    return cursor->ptr - start;
+}
+
+
+/**
+ * \brief Tries reading an object into the struct and returns the number of
+ *  bytes read
+ *
+ * \e none values preceding the value are skipped.
+ *
+ * \param[in,out] cursor Pointer on buffer where to read the value, updated
+ *                       if the value could be read
+ * \param[out] value Value to read, a type listed with YABE_REFLECT() or a
+ *                   field type. It may be partially changed on failure.
+ * \return the number of bytes read, \e fail : 0 if the value is invalid or
+ *         doesn't match the type
+ */
+template<class T>
+size_t read( yabe_cursor_t* cursor, T& value )
+{
+    yabe_cursor_t c = *cursor;
+    yabe_read_none( &c );
+    if( yabe_end_of_buffer( &c ) || !codec<T>::get( &c, value ) )
+        return 0;
+    const size_t len = c.ptr - cursor->ptr;
+    *cursor = c;
+    return len;
+}
+
+} // namespace yabe
+
+
+/**
+ * \brief List the fields of a struct to encode and decode
+ *
+ * \param type Struct type
+ * \param ... Fields given with YABE_FIELD()
+ */
+#define YABE_REFLECT( type, ... ) \
+    template<> \
+    struct yabe::reflect<type> \
+    { \
+        using self = type; \
+        static constexpr auto fields = std::make_tuple( __VA_ARGS__ ); \
+    };
+
+/**
+ * \brief Field of a struct listed with YABE_REFLECT(), named as the member
+ *  identifier
+ */
+#define YABE_FIELD( name ) ::yabe::make_field( #name, &self::name )
+
+#endif // YABE_REFLECT_HPP
@@ -0,0 +1,351 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include "yabe_value.hpp"
+#include "yabe_packed.h"
+
+namespace yabe {
+
+
+/* Construct an empty arena */
+arena::arena( size_t chunkSize ) noexcept
+    : head( nullptr ), ptr( nullptr ), end( nullptr ), chunkSize( chunkSize ), total( 0 )
+{
+}
+
+
+arena::arena( arena&& other ) noexcept
+    : head( other.head ), ptr( other.ptr ), end( other.end ),
+      chunkSize( other.chunkSize ), total( other.total )
+{
+    other.head = nullptr;
+    other.ptr = other.end = nullptr;
+    other.total = 0;
+}
+
+
+arena& arena::operator=( arena&& other ) noexcept
+{
+    if( this != &other )
+    {
+        clear();
+        std::swap( head, other.head );
+        std::swap( ptr, other.ptr );
+        std::swap( end, other.end );
+        std::swap( total, other.total );
+        chunkSize = other.chunkSize;
+    }
+    return *this;
+}
+
+
+arena::~arena()
+{
+    clear();
+}
+
+
+/* Allocate bytes living as long as the arena */
+void* arena::allocate( size_t size, size_t align ) noexcept
+{
+    // the rounded pointer may be past the end of a chunk of odd size
+    uintptr_t p = ((uintptr_t)ptr + align - 1) & ~(uintptr_t)(align - 1);
+    if( !head || p > (uintptr_t)end || size > (size_t)((uintptr_t)end - p) )
+    {
+        // the chunks grow with the arena so that large documents make few
+        // allocations
+        size_t len = std::max( chunkSize, total );
+        if( len < sizeof(chunk) + align + size )
+            len = sizeof(chunk) + align + size;
+        chunk* c = (chunk*)std::malloc( len );
+        if( !c )
+            return nullptr;
+        c->next = head;
+        head = c;
+        ptr = (char*)(c + 1);
+        end = (char*)c + len;
+        total += len;
+        p = ((uintptr_t)ptr + align - 1) & ~(uintptr_t)(align - 1);
+    }
+    ptr = (char*)(p + size);
+    return (void*)p;
+}
+
+
+/* Free all the allocations */
+void arena::clear() noexcept
+{
+    while( head )
+    {
+        chunk* next = head->next;
+        std::free( head );
+        head = next;
+    }
+    ptr = end = nullptr;
+    total = 0;
+}
+
+
+/* Return the value of the object member with the given identifier */
+const value* value::find( std::string_view key ) const noexcept
+{
+    if( k != kind::object )
+        return nullptr;
+    const member* m = std::lower_bound( members_begin(), members_end(), key,
+        []( const member& a, std::string_view b ) { return a.key < b; } );
+    return (m != members_end() && m->key == key) ? &m->val : nullptr;
+}
+
+
+/* Stack of trivially copyable items, the first ones are stored inline */
+template<class T, size_t N>
+class scratch
+{
+public:
+    scratch() noexcept : items( reinterpret_cast<T*>( storage ) ), size( 0 ), capacity( N ) {}
+    scratch( const scratch& ) = delete;
+    scratch& operator=( const scratch& ) = delete;
+    ~scratch()
+    {
+        if( items != reinterpret_cast<T*>( storage ) )
+            std::free( items );
+    }
+
+    bool push( const T& item ) noexcept
+    {
+        if( size == capacity )
+        {
+            T* p = (T*)std::malloc( 2 * capacity * sizeof(T) );
+            if( !p )
+                return false;
+            std::memcpy( (void*)p, items, size * sizeof(T) );
+            if( items != reinterpret_cast<T*>( storage ) )
+                std::free( items );
+            items = p;
+            capacity *= 2;
+        }
+        new( items + size++ ) T( item );
+        return true;
+    }
+
+    T* items;                   // items of the stack
+    size_t size;                // number of items
+    size_t capacity;            // number of items that fit in items
+
+private:
+    alignas(T) unsigned char storage[N * sizeof(T)];
+};
+
+
+/* Decoder of the values of a document */
+class decoder
+{
+public:
+    decoder( arena& mem, uint64_t packedLeft ) noexcept : mem( mem ), packedLeft( packedLeft ) {}
+    bool decode( yabe_cursor_t* c, value& out, unsigned depth ) noexcept;
+
+private:
+    bool decode_array( yabe_cursor_t* c, value& out, int nbr, unsigned depth ) noexcept;
+    bool decode_object( yabe_cursor_t* c, value& out, int nbr, unsigned depth ) noexcept;
+    bool decode_packed( yabe_packed_iter_t* iter, value& out ) noexcept;
+
+    arena& mem;                         // arena holding the values
+    uint64_t packedLeft;                // number of packed values left to decode
+    scratch<value, 64> values;          // items of the arrays being decoded
+    scratch<member, 32> members;        // members of the objects being decoded
+};
+
+
+/* Decode the value at cursor position */
+bool decoder::decode( yabe_cursor_t* c, value& out, unsigned depth ) noexcept
+{
+    yabe_read_none( c );
+    if( depth > YABE_MAX_DEPTH || yabe_end_of_buffer( c ) )
+        return false;
+    int8_t nbr;
+    if( yabe_read_string_view( c, &out.u.view ) )
+        out.k = kind::string;
+    else if( yabe_read_integer( c, &out.u.i ) )
+        out.k = kind::integer;
+    else if( yabe_read_small_object( c, &nbr ) )
+        return decode_object( c, out, nbr, depth );
+    else if( yabe_read_object_stream( c ) )
+        return decode_object( c, out, -1, depth );
+    else if( yabe_read_small_array( c, &nbr ) )
+        return decode_array( c, out, nbr, depth );
+    else if( yabe_read_array_stream( c ) )
+        return decode_array( c, out, -1, depth );
+    else if( yabe_read_float( c, &out.u.f ) )
+        out.k = kind::floating;
+    else if( yabe_read_bool( c, &out.u.b ) )
+        out.k = kind::boolean;
+    else if( yabe_read_null( c ) )
+        out.k = kind::null;
+    else
+    {
+        // a packed array has an integer where a blob has its mime type
+        yabe_packed_iter_t iter;
+        if( yabe_read_packed( c, &iter ) )
+            return decode_packed( &iter, out );
+        yabe_cursor_t r = *c;
+        if( !yabe_read_blob( &r ) )
+            return false;
+        yabe_string_view_t* views = (yabe_string_view_t*)mem.allocate( 2 * sizeof(yabe_string_view_t),
+                                                                       alignof(yabe_string_view_t) );
+        if( !views )
+            return false;
+        for( int i = 0; i < 2; ++i )
+        {
+            yabe_read_none( &r );
+            if( yabe_end_of_buffer( &r ) || !yabe_read_string_view( &r, &views[i] ) )
+                return false;
+        }
+        *c = r;
+        out.k = kind::blob;
+        out.u.blob = views;
+    }
+    return true;
+}
+
+
+/* Decode the items of an array, nbr is -1 for a stream */
+bool decoder::decode_array( yabe_cursor_t* c, value& out, int nbr, unsigned depth ) noexcept
+{
+    const size_t base = values.size;
+    for( size_t i = 0; nbr < 0 || i < (size_t)nbr; ++i )
+    {
+        yabe_read_none( c );
+        if( yabe_end_of_buffer( c ) )
+            return false;
+        if( nbr < 0 && yabe_read_end_stream( c ) )
+            break;
+        value item;
+        if( !decode( c, item, depth + 1 ) || !values.push( item ) )
+            return false;
+    }
+    const size_t count = values.size - base;
+    value* items = (value*)mem.allocate( count * sizeof(value), alignof(value) );
+    if( !items )
+        return false;
+    std::memcpy( (void*)items, values.items + base, count * sizeof(value) );
+    values.size = base;
+    out.k = kind::array;
+    out.u.items.values = items;
+    out.u.items.count = count;
+    return true;
+}
+
+
+/* Decode the members of an object, nbr is -1 for a stream */
+bool decoder::decode_object( yabe_cursor_t* c, value& out, int nbr, unsigned depth ) noexcept
+{
+    const size_t base = members.size;
+    for( size_t i = 0; nbr < 0 || i < (size_t)nbr; ++i )
+    {
+        yabe_read_none( c );
+        if( yabe_end_of_buffer( c ) )
+            return false;
+        if( nbr < 0 && yabe_read_end_stream( c ) )
+            break;
+        yabe_string_view_t key;
+        member m;
+        if( !yabe_read_string_view( c, &key ) || !decode( c, m.val, depth + 1 ) )
+            return false;
+        m.key = std::string_view( key.ptr, key.len );
+        if( !members.push( m ) )
+            return false;
+    }
+
+    // encoders usually write the members in the same order, often sorted
+    member* first = members.items + base;
+    member* last = members.items + members.size;
+    auto less = []( const member& a, const member& b ) { return a.key < b.key; };
+    if( !std::is_sorted( first, last, less ) )
+        std::sort( first, last, less );
+    if( std::adjacent_find( first, last,
+            []( const member& a, const member& b ) { return a.key == b.key; } ) != last )
+        return false;
+
+    const size_t count = members.size - base;
+    member* items = (member*)mem.allocate( count * sizeof(member), alignof(member) );
+    if( !items )
+        return false;
+    std::memcpy( (void*)items, first, count * sizeof(member) );
+    members.size = base;
+    out.k = kind::object;
+    out.u.items.members = items;
+    out.u.items.count = count;
+    return true;
+}
+
+
+/* Decode the values of a packed integer array, a few bytes may claim up to
+   YABE_PACKED_MAX_COUNT values so their number is bounded by the input size */
+bool decoder::decode_packed( yabe_packed_iter_t* iter, value& out ) noexcept
+{
+    if( iter->count > packedLeft || iter->count > SIZE_MAX / sizeof(value) )
+        return false;
+    packedLeft -= iter->count;
+    const size_t count = (size_t)iter->count;
+    value* items = (value*)mem.allocate( count * sizeof(value), alignof(value) );
+    if( !items )
+        return false;
+    for( size_t i = 0; i < count; ++i )
+    {
+        new( items + i ) value();
+        items[i].k = kind::integer;
+        if( !yabe_packed_next( iter, &items[i].u.i ) )
+            return false;
+    }
+    out.k = kind::array;
+    out.u.items.values = items;
+    out.u.items.count = count;
+    return true;
+}
+
+
+/* Decode the value at the start of the buffer */
+bool document::parse( const char* data, size_t len ) noexcept
+{
+    mem.clear();
+    return parse_buffer( data, len );
+}
+
+
+/* Decode the value at the start of a copy of the buffer */
+bool document::parse_copy( const char* data, size_t len ) noexcept
+{
+    mem.clear();
+    char* copy = (char*)mem.allocate( len, 1 );
+    if( !copy )
+    {
+        top = value();
+        return false;
+    }
+    std::memcpy( copy, data, len );
+    return parse_buffer( copy, len );
+}
+
+
+/* Decode the value in a buffer, the arena is cleared on failure */
+bool document::parse_buffer( const char* data, size_t len ) noexcept
+{
+    yabe_cursor_t c = { const_cast<char*>( data ), len };
+    value v;
+    top = value();
+    {
+        const uint64_t maxPacked = document::max_packed_per_byte;
+        decoder d( mem, len > UINT64_MAX / maxPacked ? UINT64_MAX : len * maxPacked );
+        if( !d.decode( &c, v, 0 ) )
+        {
+            mem.clear();
+            return false;
+        }
+    }
+    top = v;
+    return true;
+}
+
+} // namespace yabe
@@ -0,0 +1,258 @@
+#ifndef YABE_VALUE_HPP
+#define YABE_VALUE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+
+#include "yabe.h"
+
+/**
+   \page value_page C++ documents
+
+   A yabe::document decodes a YABE encoded value into a tree of yabe::value
+   allocated in an arena owned by the document :
+
+    <ul>
+    <li> strings, blob mime types and blob data are views on the bytes of
+         the encoded buffer, which must outlive the document, or on a copy
+         of it in the arena made by document::parse_copy() ;
+    <li> arrays are contiguous vectors of values ;
+    <li> objects are contiguous vectors of members sorted by identifier,
+         members are found by binary search ;
+    <li> packed integer arrays are decoded as arrays of integers.
+    </ul>
+
+   Decoding a document makes a few large allocations instead of one per
+   string and container. While a container is decoded, its items are
+   collected on a stack shared by all containers, with inline storage for the
+   small ones, and copied once in the arena when their number is known.
+
+   Values are trivially destructible and freed with the arena. A document
+   can't be copied, it is moved as a whole : moving it moves the arena, the
+   values keep their address.
+
+   \code
+    yabe::document doc;
+    if( !doc.parse( buffer, size ) ) { ... }
+    const yabe::value* id = doc.root().find( "id" );
+    if( id && id->is_integer() )
+        use( id->as_integer() );
+   \endcode
+*/
+
+namespace yabe {
+
+
+/**
+ * \brief Bump allocator freeing all its allocations at once
+ */
+class arena
+{
+public:
+    /**
+     * \brief Construct an empty arena
+     *
+     * \param chunkSize Number of bytes of the chunks allocated with malloc()
+     */
+    explicit arena( size_t chunkSize = 4096 ) noexcept;
+    arena( arena&& other ) noexcept;
+    arena& operator=( arena&& other ) noexcept;
+    arena( const arena& ) = delete;
+    arena& operator=( const arena& ) = delete;
+    ~arena();
+
+    /**
+     * \brief Allocate bytes living as long as the arena
+     *
+     * \param size Number of bytes
+     * \param align Alignment of the bytes, a power of 2
+     * \return a pointer on the bytes, nullptr if malloc() failed
+     */
+    void* allocate( size_t size, size_t align = alignof(std::max_align_t) ) noexcept;
+
+    /**
+     * \brief Free all the allocations
+     */
+    void clear() noexcept;
+
+    /// Return the number of bytes allocated with malloc()
+    size_t capacity() const noexcept { return total; }
+
+private:
+    struct chunk { chunk* next; };
+    chunk* head;            ///< Last chunk allocated
+    char* ptr;              ///< Next free byte of the last chunk
+    char* end;              ///< End of the last chunk
+    size_t chunkSize;       ///< Minimum size of a chunk
+    size_t total;           ///< Bytes allocated with malloc()
+};
+
+
+/**
+ * \brief Kinds of values
+ */
+enum class kind : uint8_t
+{
+    null, boolean, integer, floating, string, blob, array, object
+};
+
+
+struct member;
+
+
+/**
+ * \brief Decoded value
+ *
+ * The accessors as_ assert that the value has the expected kind.
+ */
+class value
+{
+public:
+    value() noexcept : k( kind::null ) {}
+
+    kind type() const noexcept { return k; }
+    bool is_null() const noexcept { return k == kind::null; }
+    bool is_bool() const noexcept { return k == kind::boolean; }
+    bool is_integer() const noexcept { return k == kind::integer; }
+    bool is_float() const noexcept { return k == kind::floating; }
+    bool is_string() const noexcept { return k == kind::string; }
+    bool is_blob() const noexcept { return k == kind::blob; }
+    bool is_array() const noexcept { return k == kind::array; }
+    bool is_object() const noexcept { return k == kind::object; }
+
+    bool as_bool() const noexcept { assert( is_bool() ); return u.b; }
+    int64_t as_integer() const noexcept { assert( is_integer() ); return u.i; }
+    /// Return the value of a floating point value or of an integer
+    double as_double() const noexcept
+        { assert( is_float() || is_integer() ); return is_float() ? u.f : (double)u.i; }
+    std::string_view as_string() const noexcept
+        { assert( is_string() ); return std::string_view( u.view.ptr, u.view.len ); }
+    std::string_view blob_mime() const noexcept
+        { assert( is_blob() ); return std::string_view( u.blob[0].ptr, u.blob[0].len ); }
+    std::string_view blob_data() const noexcept
+        { assert( is_blob() ); return std::string_view( u.blob[1].ptr, u.blob[1].len ); }
+
+    /// Return the number of items of an array or members of an object, 0
+    /// for other values
+    size_t size() const noexcept
+        { return (k == kind::array || k == kind::object) ? u.items.count : 0; }
+
+    /// Return the array item at the given index
+    const value& operator[]( size_t index ) const noexcept
+        { assert( is_array() && index < u.items.count ); return u.items.values[index]; }
+    const value* begin() const noexcept { assert( is_array() ); return u.items.values; }
+    const value* end() const noexcept { assert( is_array() ); return u.items.values + u.items.count; }
+
+    /// Return the members of an object, sorted by identifier
+    const member* members_begin() const noexcept { assert( is_object() ); return u.items.members; }
+    const member* members_end() const noexcept;
+
+    /**
+     * \brief Return the value of the object member with the given identifier
+     *
+     * \param key Member identifier
+     * \return a pointer on the member value, nullptr if the value is not an
+     *         object or has no such member
+     */
+    const value* find( std::string_view key ) const noexcept;
+
+private:
+    friend class decoder;
+
+    kind k;                         ///< Kind of the value
+    union
+    {
+        bool b;
+        int64_t i;
+        double f;
+        yabe_string_view_t view;    ///< String bytes
+        const yabe_string_view_t* blob; ///< Mime type and data of a blob
+        struct
+        {
+            union
+            {
+                const value* values;
+                const member* members;
+            };
+            size_t count;           ///< Number of items or members
+        } items;
+    } u;
+};
+
+
+/**
+ * \brief Member of an object
+ */
+struct member
+{
+    std::string_view key;           ///< Member identifier
+    value val;                      ///< Member value
+};
+
+
+inline const member* value::members_end() const noexcept
+    { assert( is_object() ); return u.items.members + u.items.count; }
+
+
+/**
+ * \brief Decoded value with the arena holding it
+ */
+class document
+{
+public:
+    document() noexcept = default;
+    document( document&& other ) noexcept
+        : mem( std::move( other.mem ) ), top( other.top ) { other.top = value(); }
+    document& operator=( document&& other ) noexcept
+        { mem = std::move( other.mem ); top = other.top; other.top = value(); return *this; }
+    document( const document& ) = delete;
+    document& operator=( const document& ) = delete;
+
+    /// Maximum number of packed integer values decoded per encoded byte
+    static constexpr uint64_t max_packed_per_byte = 64;
+
+    /**
+     * \brief Decode the value at the start of the buffer, replacing the value
+     *  of the document
+     *
+     * \e none values preceding the value are skipped, the bytes following it
+     * are ignored. Strings and blobs are views on the buffer.
+     *
+     * \param data Pointer on the encoded bytes, must outlive the document
+     * \param len Number of encoded bytes
+     * \return true if the value was decoded, false if it is invalid, nested
+     *         deeper than YABE_MAX_DEPTH, an object has duplicate member
+     *         identifiers, its packed arrays hold more than
+     *         max_packed_per_byte values per byte of len or an allocation
+     *         failed. The document is then null.
+     */
+    bool parse( const char* data, size_t len ) noexcept;
+
+    /**
+     * \brief Decode the value at the start of the buffer, replacing the value
+     *  of the document, after copying the buffer in the arena
+     *
+     * \param data Pointer on the encoded bytes, may be freed after the call
+     * \param len Number of encoded bytes
+     * \return true if the value was decoded, false as parse()
+     */
+    bool parse_copy( const char* data, size_t len ) noexcept;
+
+    /// Return the decoded value, null if nothing was decoded
+    const value& root() const noexcept { return top; }
+
+    /// Return the arena holding the values
+    const arena& memory() const noexcept { return mem; }
+
+private:
+    bool parse_buffer( const char* data, size_t len ) noexcept;
+
+    arena mem;                      ///< Arena holding the values
+    value top;                      ///< Decoded value
+};
+
+} // namespace yabe
+
+#endif // YABE_VALUE_HPP
@@ -0,0 +1,364 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "yabe.h"
+#include "yabe_index.h"
+#include "yabe_columns.h"
+#include "yabe_query.h"
+#include "yabe_vector.h"
+#include "yabe_packed.h"
+#include "yabe_context.h"
+#include "yabe_lz.h"
+#include "yabe_msg.h"
+#include "yabe_canonical.h"
+#include "yabe_merge.h"
+#include "yabe_batch.h"
+#include "yabe_archive.h"
+#include "yabe_block.h"
+#include "yabe_endian.h"
+
+/* Fuzzing harness of the yabe reading functions.
+
+   Every input is handed to each reader entry point : the signature, the
+   scalar and container readers through a full typed walk, yabe_skip_value(),
+   the array index, the column shredder, path queries, the bulk and packed
+   integer array readers, the context string reader, canonicalization,
+   hashing and comparison, merge patches, the batch, archive and block
+   compressed file readers, the lz decompressor and the message framing. The
+   input is copied in a buffer of its exact size so that AddressSanitizer
+   reports any read beyond its end. The log reader is not covered, it checks
+   a crc32c on every record.
+
+   With the sources of fuzz_readers.pro :
+    SRC="fuzz_readers.c ../YABE_C/yabe.c ../YABE_C/yabe_index.c ../YABE_C/yabe_columns.c
+         ../YABE_C/yabe_query.c ../YABE_C/yabe_vector.c ../YABE_C/yabe_packed.c
+         ../YABE_C/yabe_context.c ../YABE_C/yabe_lz.c ../YABE_C/yabe_msg.c
+         ../YABE_C/yabe_canonical.c ../YABE_C/yabe_merge.c ../YABE_C/yabe_batch.c
+         ../YABE_C/yabe_archive.c ../YABE_C/yabe_block.c"
+
+   libFuzzer :
+    clang -std=c99 -g -O1 -fsanitize=fuzzer,address,undefined -I../YABE_C \
+        $SRC -lpthread -o fuzz_readers
+    ./fuzz_readers corpus/
+
+   AFL++ or replay of crash files, with a main reading files or stdin :
+    afl-clang-fast -std=c99 -g -DYABE_FUZZ_MAIN -I../YABE_C \
+        $SRC -lpthread -o fuzz_readers
+    afl-fuzz -i corpus -o findings -- ./fuzz_readers
+
+   A seed corpus is produced by "yabe_diff gen SEED N DIR".
+*/
+
+/* Sink of the decoded values so that the reads are not optimized out */
+static volatile uint64_t sink;
+
+/* A few bytes of a packed array stand for up to YABE_PACKED_MAX_COUNT
+   values, they are iterated at most this number of times per input byte */
+#define PACKED_VALUES_PER_BYTE 64
+
+
+/* Read the value at cursor position with the typed readers, return false
+   if it is invalid */
+static bool walkValue( yabe_cursor_t* cursor, unsigned depth )
+{
+    if( depth > YABE_MAX_DEPTH )
+        return false;
+    yabe_read_none( cursor );
+    if( yabe_end_of_buffer( cursor ) )
+        return false;
+
+    int64_t code;
+    double flt;
+    bool flag;
+    int8_t nbr;
+    yabe_string_view_t view;
+    if( yabe_read_integer( cursor, &code ) )
+        sink += (uint64_t)code;
+    else if( yabe_read_float( cursor, &flt ) )
+        sink += (uint64_t)(flt == flt);
+    else if( yabe_read_bool( cursor, &flag ) )
+        sink += flag;
+    else if( yabe_read_null( cursor ) )
+        sink += 1;
+    else if( yabe_read_string_view( cursor, &view ) )
+        sink += view.len;
+    else if( yabe_read_blob( cursor ) )
+    {
+        // mime type or packed array extension code, then the data
+        if( yabe_end_of_buffer( cursor ) )
+            return false;
+        if( !yabe_read_integer( cursor, &code ) &&
+            !yabe_read_string_view( cursor, &view ) )
+            return false;
+        if( yabe_end_of_buffer( cursor ) || !yabe_read_string_view( cursor, &view ) )
+            return false;
+    }
+    else if( yabe_read_small_array( cursor, &nbr ) )
+    {
+        while( nbr-- )
+            if( !walkValue( cursor, depth + 1 ) )
+                return false;
+    }
+    else if( yabe_read_small_object( cursor, &nbr ) )
+    {
+        while( nbr-- )
+            if( !walkValue( cursor, depth + 1 ) || !walkValue( cursor, depth + 1 ) )
+                return false;
+    }
+    else if( yabe_read_array_stream( cursor ) || yabe_read_object_stream( cursor ) )
+    {
+        for( ;; )
+        {
+            yabe_read_none( cursor );
+            if( yabe_end_of_buffer( cursor ) )
+                return false;
+            if( yabe_read_end_stream( cursor ) )
+                break;
+            if( !walkValue( cursor, depth + 1 ) )
+                return false;
+        }
+    }
+    else
+        return false;
+    return true;
+}
+
+
+static bool onMatch( void* ctx, yabe_cursor_t* match )
+{
+    (void)ctx;
+    sink += match->len;
+    return true;
+}
+
+
+/* Readers state kept from one input to the next */
+static struct
+{
+    bool init;
+    yabe_query_t queries[3];
+    yabe_context_t ctx;
+    int pipe[2];
+    yabe_msg_conn_t conn;
+    bool connValid;
+} state;
+
+static const char* const queryPaths[3] = { "$.a", "$[*].b.c", "$['s'][0].*" };
+
+
+static void initState( void )
+{
+    for( int i = 0; i < 3; ++i )
+        if( !yabe_query_compile( &state.queries[i], queryPaths[i] ) )
+            abort();
+    yabe_context_init( &state.ctx, YABE_CONTEXT_RETAINED );
+    if( pipe2( state.pipe, O_NONBLOCK ) )
+        abort();
+    state.init = true;
+}
+
+
+/* Feed the bytes to a message connection through a pipe */
+static void fuzzMsg( const char* data, size_t size )
+{
+    if( !state.connValid )
+    {
+        if( !yabe_msg_conn_init( &state.conn, state.pipe[0], 0 ) )
+            abort();
+        state.connValid = true;
+    }
+    while( size )
+    {
+        const ssize_t n = write( state.pipe[1], data, size );
+        if( n <= 0 )
+            break;
+        data += n;
+        size -= n;
+        yabe_cursor_t msg;
+        while( yabe_msg_recv( &state.conn ) > 0 )
+            while( yabe_msg_next( &state.conn, &msg ) )
+                sink += msg.len;
+        if( state.conn.error )
+            break;
+    }
+
+    // incomplete messages must not leak into the next input
+    char drain[4096];
+    while( read( state.pipe[0], drain, sizeof(drain) ) > 0 )
+        ;
+    if( state.conn.error || state.conn.head != state.conn.tail )
+    {
+        yabe_msg_conn_free( &state.conn );
+        state.connValid = false;
+    }
+}
+
+
+int LLVMFuzzerTestOneInput( const uint8_t* bytes, size_t size )
+{
+    if( !state.init )
+        initState();
+    char* data = malloc( size ? size : 1 );
+    if( !data )
+        return 0;
+    memcpy( data, bytes, size );
+    const yabe_cursor_t input = { data, size };
+    yabe_cursor_t c;
+
+    // signature, then a typed walk and a skip of all the top level values
+    c = input;
+    yabe_read_signature( &c );
+    const yabe_cursor_t body = c;
+    while( !yabe_end_of_buffer( &c ) && walkValue( &c, 0 ) )
+        ;
+    c = body;
+    while( !yabe_end_of_buffer( &c ) && yabe_skip_value( &c ) )
+        ;
+
+    yabe_index_t index;
+    if( yabe_index_build( &index, body.ptr, body.len ) )
+    {
+        sink += index.count;
+        yabe_index_free( &index );
+    }
+
+    int64_t ints[256];
+    double flts[256];
+    yabe_string_view_t strs[256];
+    uint8_t nulls[3][32];
+    yabe_column_t columns[3] =
+    {
+        { "a", yabe_column_int64, ints, nulls[0] },
+        { "b.c", yabe_column_double, flts, nulls[1] },
+        { "s", yabe_column_string, strs, nulls[2] }
+    };
+    size_t n;
+    c = body;
+    yabe_shred( &c, columns, 3, 256, &n );
+
+    for( int i = 0; i < 3; ++i )
+    {
+        c = body;
+        yabe_query_run( &state.queries[i], &c, onMatch, NULL, &n );
+    }
+
+    c = body;
+    sink += yabe_read_integers( &c, ints, 256 );
+    c = body;
+    yabe_read_integer_array( &c, ints, 256, &n );
+
+    // these readers require a value at cursor position, the packed values
+    // are iterated at most maxValues times
+    const uint64_t maxValues = PACKED_VALUES_PER_BYTE * (uint64_t)size;
+    if( !yabe_end_of_buffer( &body ) )
+    {
+        yabe_packed_iter_t iter;
+        c = body;
+        if( yabe_read_packed( &c, &iter ) )
+            for( uint64_t i = 0; i < maxValues && yabe_packed_next( &iter, ints ); ++i )
+                sink += ints[0];
+    }
+    if( !yabe_end_of_buffer( &body ) )
+    {
+        // the canonical form must be canonical and equal to the value
+        static char canonical[1 << 20];
+        yabe_cursor_t w = { canonical, sizeof(canonical) };
+        uint64_t h1, h2;
+        c = body;
+        if( yabe_canonicalize( &c, &w ) )
+        {
+            yabe_cursor_t value = body, canon = { canonical, w.ptr - canonical };
+            yabe_read_none( &value );
+            if( yabe_is_canonical( &canon ) != canon.len ||
+                !yabe_equal_values( &value, &canon ) ||
+                !yabe_hash_value( &value, &h1 ) || !yabe_hash_value( &canon, &h2 ) ||
+                h1 != h2 )
+                abort();
+        }
+        c = body;
+        if( yabe_hash_value( &c, &h1 ) )
+            sink += h1;
+
+        // the input as base and as patch, and its difference with itself
+        w.ptr = canonical;
+        w.len = sizeof(canonical);
+        sink += yabe_merge_apply( &body, &body, &w );
+        w.ptr = canonical;
+        w.len = sizeof(canonical);
+        sink += yabe_merge_diff( &body, &body, &w );
+    }
+
+    c = body;
+    while( yabe_context_read_string( &state.ctx, &c, &n ) )
+        sink += n;
+    yabe_context_reset( &state.ctx );
+
+    // the whole input as a batch, its messages walked when it is valid
+    yabe_batch_reader_t batch;
+    if( yabe_batch_open( &batch, data, size, true ) )
+        for( size_t i = 0; i < batch.count; ++i )
+        {
+            yabe_batch_message( &batch, i, &c );
+            walkValue( &c, 0 );
+        }
+    sink += yabe_batch_open( &batch, data, size, false );
+
+    // the whole input as an archive, each document looked up by name
+    yabe_archive_reader_t archive;
+    if( yabe_archive_reader_init( &archive, data, size ) )
+        for( size_t i = 0; i < archive.count; ++i )
+        {
+            yabe_string_view_t name;
+            yabe_archive_entry( &archive, i, &name, &c );
+            sink += yabe_archive_find( &archive, name.ptr, name.len, &c ) + c.len;
+        }
+
+    // the whole input as a block compressed file, the first, middle and
+    // last bytes mapped then a range spanning blocks. Its cache is a block,
+    // the block size is bounded first
+    yabe_block_reader_t blocks;
+    if( size >= 8 && yabe_load_le32( data + 4 ) <= (1 << 20) &&
+        yabe_block_reader_init( &blocks, data, size ) )
+    {
+        const uint64_t offsets[3] = { 0, blocks.rawSize / 2, blocks.rawSize - 1 };
+        for( int i = 0; i < 3; ++i )
+            if( yabe_block_map( &blocks, offsets[i], 64, &c ) )
+                sink += (uint8_t)c.ptr[c.len - 1];
+        if( yabe_block_map( &blocks, blocks.rawSize / 3, 65536, &c ) )
+            sink += (uint8_t)c.ptr[c.len - 1];
+        yabe_block_reader_close( &blocks );
+    }
+
+    static char lzOut[65536];
+    sink += yabe_lz_decompress( data, size, lzOut, sizeof(lzOut) );
+
+    fuzzMsg( data, size );
+    free( data );
+    return 0;
+}
+
+
+#ifdef YABE_FUZZ_MAIN
+/* Run the harness on each file given as argument, or on stdin */
+int main( int argc, char* argv[] )
+{
+    static uint8_t buf[1 << 20];
+    for( int i = 1; i < argc || i == 1; ++i )
+    {
+        FILE* file = (argc > 1) ? fopen( argv[i], "rb" ) : stdin;
+        if( !file )
+        {
+            perror( argv[i] );
+            return 1;
+        }
+        const size_t size = fread( buf, 1, sizeof(buf), file );
+        if( file != stdin )
+            fclose( file );
+        LLVMFuzzerTestOneInput( buf, size );
+    }
+    return 0;
+}
+#endif // YABE_FUZZ_MAIN
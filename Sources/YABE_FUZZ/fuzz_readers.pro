@@ -0,0 +1,45 @@
+TEMPLATE = app
+CONFIG += console
+CONFIG -= qt
+
+# Replay build of the fuzzing harness, runs the files given as arguments
+TARGET = fuzz_readers
+DEFINES += YABE_FUZZ_MAIN
+QMAKE_CFLAGS += -std=c99 -fsanitize=address,undefined
+QMAKE_LFLAGS += -fsanitize=address,undefined
+INCLUDEPATH += ../YABE_C
+LIBS += -lpthread
+
+SOURCES += fuzz_readers.c \
+    ../YABE_C/yabe.c \
+    ../YABE_C/yabe_index.c \
+    ../YABE_C/yabe_columns.c \
+    ../YABE_C/yabe_query.c \
+    ../YABE_C/yabe_vector.c \
+    ../YABE_C/yabe_packed.c \
+    ../YABE_C/yabe_context.c \
+    ../YABE_C/yabe_lz.c \
+    ../YABE_C/yabe_msg.c \
+    ../YABE_C/yabe_canonical.c \
+    ../YABE_C/yabe_merge.c \
+    ../YABE_C/yabe_batch.c \
+    ../YABE_C/yabe_archive.c \
+    ../YABE_C/yabe_block.c
+
+HEADERS += \
+    ../YABE_C/yabe.h \
+    ../YABE_C/yabe_stats.h \
+    ../YABE_C/yabe_endian.h \
+    ../YABE_C/yabe_index.h \
+    ../YABE_C/yabe_columns.h \
+    ../YABE_C/yabe_query.h \
+    ../YABE_C/yabe_vector.h \
+    ../YABE_C/yabe_packed.h \
+    ../YABE_C/yabe_context.h \
+    ../YABE_C/yabe_lz.h \
+    ../YABE_C/yabe_msg.h \
+    ../YABE_C/yabe_canonical.h \
+    ../YABE_C/yabe_merge.h \
+    ../YABE_C/yabe_batch.h \
+    ../YABE_C/yabe_archive.h \
+    ../YABE_C/yabe_block.h
@@ -0,0 +1,510 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include "yabe.h"
+#include "yabe_vector.h"
+#include "yabe_packed.h"
+#include "yabe_endian.h"
+
+/* C side of the differential test driven by yabe_diff.py.
+
+   The values are exchanged on stdin and stdout as frames : a little endian
+   32 bit byte size followed by a signature and one YABE encoded value.
+
+    yabe_diff reencode [REPEAT]
+        Reads the frames of stdin, decodes each value with the C readers and
+        encodes it back with the C writers in the same encoding choices as
+        the Python module : small arrays and objects up to 6 items, packed
+        integer arrays as plain arrays. The frames are written to stdout, an
+        invalid value gives an empty frame. With REPEAT, the re-encoding of
+        all the frames is timed REPEAT times and the best throughput is
+        reported on stderr.
+
+    yabe_diff gen SEED COUNT [DIR]
+        Writes COUNT random values encoded by the C writers as frames on
+        stdout, or as files in DIR to seed the fuzzing corpus.
+*/
+
+/* Growable output buffer */
+typedef struct buffer_t
+{
+    char* data;
+    size_t size;
+    size_t capacity;
+} buffer_t;
+
+
+static void reserve( buffer_t* buf, size_t size )
+{
+    if( buf->size + size <= buf->capacity )
+        return;
+    while( buf->size + size > buf->capacity )
+        buf->capacity = buf->capacity ? 2*buf->capacity : 65536;
+    if( !(buf->data = realloc( buf->data, buf->capacity )) )
+    {
+        fprintf( stderr, "yabe_diff: out of memory\n" );
+        exit( 1 );
+    }
+}
+
+
+/* Return the number of values of the stream at cursor position, up to the
+   end stream tag, or -1 if it is invalid */
+static long countStream( yabe_cursor_t cursor )
+{
+    long n = 0;
+    for( ;; )
+    {
+        yabe_read_none( &cursor );
+        if( yabe_end_of_buffer( &cursor ) )
+            return -1;
+        if( yabe_read_end_stream( &cursor ) )
+            return n;
+        if( !yabe_skip_value( &cursor ) )
+            return -1;
+        ++n;
+    }
+}
+
+
+/* Write the header of an array or object of n items */
+static size_t writeContainer( yabe_cursor_t* w, bool object, size_t n )
+{
+    if( n < 7 )
+        return object ? yabe_write_small_object( w, n ) : yabe_write_small_array( w, n );
+    return object ? yabe_write_object_stream( w ) : yabe_write_array_stream( w );
+}
+
+
+/* Re-encode a packed integer array as a plain array */
+static bool reencodePacked( yabe_cursor_t* r, yabe_cursor_t* w )
+{
+    size_t capacity = 1024, count;
+    int64_t* values = NULL;
+    for( ;; )
+    {
+        if( !(values = realloc( values, capacity * sizeof(int64_t) )) )
+            return false;
+        if( yabe_read_integer_array( r, values, capacity, &count ) )
+            break;
+        // invalid or larger than the capacity
+        if( (capacity *= 2) > ((size_t)1 << 26) )
+        {
+            free( values );
+            return false;
+        }
+    }
+    const bool res = writeContainer( w, false, count ) &&
+                     yabe_write_integers( w, values, count ) == count &&
+                     (count < 7 || yabe_write_end_stream( w ));
+    free( values );
+    return res;
+}
+
+
+/* Decode the value at r position and encode it at w position, return false
+   if it is invalid or w is full. Packed arrays are invalid unless packed is
+   set by a version 1 signature */
+static bool reencodeValue( yabe_cursor_t* r, yabe_cursor_t* w, unsigned depth, bool packed )
+{
+    if( depth > YABE_MAX_DEPTH )
+        return false;
+    yabe_read_none( r );
+    if( yabe_end_of_buffer( r ) )
+        return false;
+
+    int64_t code;
+    double flt;
+    bool flag;
+    int8_t nbr;
+    yabe_string_view_t view;
+    if( yabe_read_integer( r, &code ) )
+        return yabe_write_integer( w, code );
+    if( yabe_read_float( r, &flt ) )
+        return yabe_write_float( w, flt );
+    if( yabe_read_bool( r, &flag ) )
+        return yabe_write_bool( w, flag );
+    if( yabe_read_null( r ) )
+        return yabe_write_null( w );
+    if( yabe_read_string_view( r, &view ) )
+        return yabe_write_string( w, view.len ) &&
+               yabe_write_data( w, view.ptr, view.len ) == view.len;
+
+    yabe_cursor_t c = *r;
+    if( yabe_read_blob( &c ) )
+    {
+        if( yabe_end_of_buffer( &c ) )
+            return false;
+        if( yabe_read_integer( &c, &code ) )
+            return packed && reencodePacked( r, w );
+        *r = c;
+        yabe_string_view_t mime;
+        return yabe_read_string_view( r, &mime ) && !yabe_end_of_buffer( r ) &&
+               yabe_read_string_view( r, &view ) &&
+               yabe_write_blob( w ) &&
+               yabe_write_string( w, mime.len ) &&
+               yabe_write_data( w, mime.ptr, mime.len ) == mime.len &&
+               yabe_write_string( w, view.len ) &&
+               yabe_write_data( w, view.ptr, view.len ) == view.len;
+    }
+
+    bool object = false, stream = false;
+    long n;
+    if( yabe_read_small_array( r, &nbr ) )
+        n = nbr;
+    else if( (object = yabe_read_small_object( r, &nbr )) )
+        n = nbr;
+    else if( (stream = yabe_read_array_stream( r ) || (object = yabe_read_object_stream( r ))) )
+    {
+        if( (n = countStream( *r )) < 0 || (object && (n & 1)) )
+            return false;
+        if( object )
+            n /= 2;
+    }
+    else
+        return false;
+
+    if( !writeContainer( w, object, n ) )
+        return false;
+    for( long i = 0; i < n; ++i )
+    {
+        if( object )
+        {
+            // member identifiers must be strings
+            yabe_read_none( r );
+            if( yabe_end_of_buffer( r ) || !yabe_read_string_view( r, &view ) ||
+                !yabe_write_string( w, view.len ) ||
+                yabe_write_data( w, view.ptr, view.len ) != view.len )
+                return false;
+        }
+        if( !reencodeValue( r, w, depth + 1, packed ) )
+            return false;
+    }
+    if( stream )
+    {
+        yabe_read_none( r );
+        if( yabe_end_of_buffer( r ) || !yabe_read_end_stream( r ) )
+            return false;
+        // a stream of less than 7 items is re-encoded as a small container
+        if( n >= 7 && !yabe_write_end_stream( w ) )
+            return false;
+    }
+    return true;
+}
+
+
+/* Re-encode the signed value of a frame at the end of out, return false if
+   it is invalid */
+static bool reencodeFrame( const char* data, size_t size, buffer_t* out )
+{
+    for( size_t room = 2*size + 64;; room *= 2 )
+    {
+        reserve( out, room );
+        yabe_cursor_t r = { (char*)data, size };
+        yabe_cursor_t w = { out->data + out->size, room };
+        uint8_t version;
+        if( yabe_read_signature_version( &r, &version ) != 5 )
+            return false;
+        yabe_write_signature( &w );
+        if( reencodeValue( &r, &w, 0, version >= 1 ) )
+        {
+            yabe_read_none( &r );
+            if( !yabe_end_of_buffer( &r ) )
+                return false;
+            out->size = w.ptr - out->data;
+            return true;
+        }
+        // retry with a larger buffer only if the value is valid
+        yabe_cursor_t check = { (char*)data + 5, size - 5 };
+        if( !yabe_skip_value( &check ) || room > ((size_t)1 << 32) )
+            return false;
+    }
+}
+
+
+/* Read the frames of stdin */
+static bool readFrames( buffer_t* in )
+{
+    for( ;; )
+    {
+        reserve( in, 65536 );
+        const size_t n = fread( in->data + in->size, 1, in->capacity - in->size, stdin );
+        in->size += n;
+        if( n == 0 )
+            return !ferror( stdin );
+    }
+}
+
+
+static void putFrameSize( buffer_t* out, size_t pos, size_t size )
+{
+    yabe_cursor_t c = { out->data + pos, 4 };
+    uint32_t le = 0;
+    for( int i = 0; i < 4; ++i )
+        ((uint8_t*)&le)[i] = (uint8_t)(size >> 8*i);
+    yabe_write_data( &c, &le, 4 );
+}
+
+
+static double now( void )
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+
+static int reencode( unsigned repeat )
+{
+    buffer_t in = { NULL, 0, 0 }, out = { NULL, 0, 0 };
+    if( !readFrames( &in ) )
+    {
+        perror( "yabe_diff" );
+        return 1;
+    }
+    double best = 0;
+    size_t nFrames = 0;
+    for( unsigned k = 0; k < (repeat ? repeat : 1); ++k )
+    {
+        const double start = now();
+        out.size = nFrames = 0;
+        for( size_t pos = 0; pos + 4 <= in.size; ++nFrames )
+        {
+            const uint8_t* p = (const uint8_t*)in.data + pos;
+            const size_t size = p[0] | p[1] << 8 | p[2] << 16 | (size_t)p[3] << 24;
+            if( size > in.size - pos - 4 )
+            {
+                fprintf( stderr, "yabe_diff: truncated frame\n" );
+                return 1;
+            }
+            reserve( &out, 4 );
+            const size_t head = out.size;
+            out.size += 4;
+            if( !reencodeFrame( in.data + pos + 4, size, &out ) )
+                out.size = head + 4;
+            putFrameSize( &out, head, out.size - head - 4 );
+            pos += 4 + size;
+        }
+        const double elapsed = now() - start;
+        if( elapsed > 0 && (best == 0 || in.size / elapsed > best) )
+            best = in.size / elapsed;
+    }
+    if( repeat )
+        fprintf( stderr, "reencode: %zu values, %zu bytes, %.1f MB/s\n",
+                 nFrames, in.size, best / 1e6 );
+    fwrite( out.data, 1, out.size, stdout );
+    free( in.data );
+    free( out.data );
+    return 0;
+}
+
+
+/* xorshift64* random number generator */
+static uint64_t rngState;
+
+static uint64_t rng( void )
+{
+    rngState ^= rngState >> 12;
+    rngState ^= rngState << 25;
+    rngState ^= rngState >> 27;
+    return rngState * 0x2545F4914F6CDD1DULL;
+}
+
+static uint64_t rngBelow( uint64_t n )
+    { return rng() % n; }
+
+
+static int64_t randomInteger( void )
+{
+    // bias towards the boundaries of the integer encodings
+    static const int64_t edges[] = { 0, 127, 128, -32, -33, 32767, 32768, -32768, -32769,
+                                     2147483647, 2147483648LL, -2147483648LL, -2147483649LL,
+                                     INT64_MAX, INT64_MIN };
+    switch( rngBelow( 4 ) )
+    {
+    case 0: return edges[rngBelow( sizeof(edges)/sizeof(edges[0]) )];
+    case 1: return (int64_t)rngBelow( 160 ) - 32;
+    case 2: return (int64_t)(rng() >> rngBelow( 64 )) * (rngBelow( 2 ) ? 1 : -1);
+    }
+    return (int64_t)rng();
+}
+
+
+static double randomFloat( void )
+{
+    switch( rngBelow( 6 ) )
+    {
+    case 0: return (double)((int64_t)rngBelow( 4096 ) - 2048) / 64;     // flt16
+    case 1: return (float)((double)(int64_t)rng() / (double)(rng() | 1)); // flt32
+    case 2: return 1.0 / 0.0 * (rngBelow( 2 ) ? 1 : -1);
+    case 3: return rngBelow( 2 ) ? 0.0 : -0.0;
+    }
+    uint64_t bits = rng();
+    // NaN payloads are not preserved, keep finite values
+    if( ((bits >> 52) & 0x7FF) == 0x7FF )
+        bits &= ~((uint64_t)1 << 62);
+    return yabe_double_from_bits( bits );
+}
+
+
+/* Write a random utf8 string of len bytes */
+static bool randomString( yabe_cursor_t* w, size_t len )
+{
+    static const char chars[] = "abcdefghijklmnopqrstuvwxyz0123456789 _-.";
+    if( !yabe_write_string( w, len ) || w->len < len )
+        return false;
+    for( size_t i = 0; i < len; ++i )
+    {
+        if( i + 1 < len && rngBelow( 8 ) == 0 )
+        {
+            // two bytes character
+            w->ptr[i++] = (char)0xC3;
+            w->ptr[i] = (char)(0xA0 + rngBelow( 32 ));
+        }
+        else
+            w->ptr[i] = chars[rngBelow( sizeof(chars) - 1 )];
+    }
+    w->ptr += len;
+    w->len -= len;
+    return true;
+}
+
+
+static size_t randomLength( void )
+{
+    switch( rngBelow( 16 ) )
+    {
+    case 0: return 64 + rngBelow( 300 );
+    case 1: return rngBelow( 8 ) ? 63 : 65536 + rngBelow( 100 );
+    }
+    return rngBelow( 20 );
+}
+
+
+/* Write a random value, return false if w is full */
+static bool randomValue( yabe_cursor_t* w, unsigned depth, bool* packed )
+{
+    const unsigned kind = (unsigned)rngBelow( depth < 4 ? 10 : 7 );
+    if( rngBelow( 16 ) == 0 && !yabe_write_none( w ) )
+        return false;
+    switch( kind )
+    {
+    case 0: return yabe_write_null( w );
+    case 1: return yabe_write_bool( w, rngBelow( 2 ) );
+    case 2: case 3: return yabe_write_integer( w, randomInteger() );
+    case 4: return yabe_write_float( w, randomFloat() );
+    case 5: return randomString( w, randomLength() );
+    case 6:
+    {
+        const size_t len = randomLength();
+        if( !yabe_write_blob( w ) || !yabe_write_string( w, 24 ) ||
+            yabe_write_data( w, "application/octet-stream", 24 ) != 24 ||
+            !yabe_write_string( w, len ) || w->len < len )
+            return false;
+        for( size_t i = 0; i < len; ++i )
+            *w->ptr++ = (char)rng();
+        w->len -= len;
+        return true;
+    }
+    case 7:
+    {
+        int64_t values[200];
+        const size_t n = rngBelow( 200 );
+        // runs of equal values, small steps and a few random jumps
+        uint64_t v = (uint64_t)randomInteger();
+        for( size_t i = 0; i < n; ++i )
+        {
+            const unsigned step = (unsigned)rngBelow( 8 );
+            v += (step == 0) ? (uint64_t)randomInteger() : (step < 4) ? rngBelow( 100 ) : 0;
+            values[i] = (int64_t)v;
+        }
+        *packed = true;
+        return rngBelow( 2 ) ? yabe_write_delta_array( w, values, n ) :
+                               yabe_write_rle_array( w, values, n );
+    }
+    }
+
+    // arrays and objects, small or streams
+    const bool object = (kind == 9);
+    const size_t n = rngBelow( 4 ) ? rngBelow( 7 ) : rngBelow( 40 );
+    const bool stream = n >= 7 || rngBelow( 8 ) == 0;
+    if( !(stream ? (object ? yabe_write_object_stream( w ) : yabe_write_array_stream( w )) :
+                   writeContainer( w, object, n )) )
+        return false;
+    for( size_t i = 0; i < n; ++i )
+    {
+        char key[16];
+        const int len = snprintf( key, sizeof(key), "k%zu", i );
+        if( object && (!yabe_write_string( w, len ) || yabe_write_data( w, key, len ) != (size_t)len) )
+            return false;
+        if( !randomValue( w, depth + 1, packed ) )
+            return false;
+    }
+    return !stream || yabe_write_end_stream( w );
+}
+
+
+static int generate( uint64_t seed, unsigned long count, const char* dir )
+{
+    rngState = seed ? seed : 1;
+    buffer_t out = { NULL, 0, 0 };
+    for( unsigned long i = 0; i < count; ++i )
+    {
+        // regenerate the value from the same state until it fits
+        const uint64_t state = rngState;
+        size_t room = 65536;
+        bool packed;
+        yabe_cursor_t w;
+        for( ;; room *= 2 )
+        {
+            reserve( &out, 4 + room );
+            rngState = state;
+            packed = false;
+            w = (yabe_cursor_t){ out.data + out.size + 4, room };
+            yabe_write_signature( &w );
+            if( randomValue( &w, 0, &packed ) )
+                break;
+        }
+        // values with packed arrays need a version 1 signature
+        out.data[out.size + 8] = packed ? 1 : 0;
+        const size_t size = w.ptr - (out.data + out.size + 4);
+        if( dir )
+        {
+            char path[4096];
+            snprintf( path, sizeof(path), "%s/seed_%04lu.yabe", dir, i );
+            FILE* file = fopen( path, "wb" );
+            if( !file || fwrite( out.data + out.size + 4, 1, size, file ) != size )
+            {
+                perror( path );
+                return 1;
+            }
+            fclose( file );
+            continue;
+        }
+        putFrameSize( &out, out.size, size );
+        out.size += 4 + size;
+    }
+    fwrite( out.data, 1, out.size, stdout );
+    free( out.data );
+    return 0;
+}
+
+
+int main( int argc, char* argv[] )
+{
+    if( argc >= 2 && !strcmp( argv[1], "reencode" ) && argc <= 3 )
+        return reencode( argc == 3 ? (unsigned)atoi( argv[2] ) : 0 );
+    if( argc >= 4 && !strcmp( argv[1], "gen" ) && argc <= 5 )
+    {
+        if( argc == 5 )
+            mkdir( argv[4], 0777 );
+        return generate( strtoull( argv[2], NULL, 0 ), strtoul( argv[3], NULL, 0 ),
+                         argc == 5 ? argv[4] : NULL );
+    }
+    fprintf( stderr, "usage: yabe_diff reencode [REPEAT]\n"
+                     "       yabe_diff gen SEED COUNT [DIR]\n" );
+    return 2;
+}
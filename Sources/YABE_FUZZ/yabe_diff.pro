@@ -0,0 +1,21 @@
+TEMPLATE = app
+CONFIG += console
+CONFIG -= qt
+
+TARGET = yabe_diff
+QMAKE_CFLAGS += -std=c99
+INCLUDEPATH += ../YABE_C
+
+SOURCES += yabe_diff.c \
+    ../YABE_C/yabe.c \
+    ../YABE_C/yabe_vector.c \
+    ../YABE_C/yabe_packed.c
+
+HEADERS += \
+    ../YABE_C/yabe.h \
+    ../YABE_C/yabe_stats.h \
+    ../YABE_C/yabe_endian.h \
+    ../YABE_C/yabe_vector.h \
+    ../YABE_C/yabe_packed.h
+
+OTHER_FILES += yabe_diff.py
@@ -0,0 +1,229 @@
+'''
+NAME
+    yabe_diff - Differential test of the C and Python YABE implementations.
+
+DESCRIPTION
+    Random value trees are encoded by both implementations and the encodings
+    are compared byte for byte :
+
+     - values generated in Python are encoded with yabe.dumps(), re-encoded
+       by the C readers and writers with "yabe_diff reencode", the C output
+       must be identical and decode to the original values ;
+     - values generated in C with "yabe_diff gen" are decoded and encoded
+       again by the Python module, the result must be identical to the C
+       re-encoding of the same values.
+
+    With --min-mbps, the C re-encoding is timed and the run fails if its
+    throughput is lower, so the script can also gate performance regressions.
+
+    python3 yabe_diff.py --bin ./yabe_diff --seed 1 --count 2000 --min-mbps 100
+'''
+
+import argparse
+import math
+import os
+import random
+import struct
+import subprocess
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                '..', 'YABE_PYTHON3'))
+import yabe
+
+MIME = 'application/octet-stream'
+
+INT_EDGES = [0, 127, 128, -32, -33, 32767, 32768, -32768, -32769,
+             2**31 - 1, 2**31, -2**31, -2**31 - 1, 2**63 - 1, -2**63]
+
+
+def randomInteger(rng):
+    k = rng.randrange(4)
+    if k == 0:
+        return rng.choice(INT_EDGES)
+    if k == 1:
+        return rng.randrange(-32, 128)
+    if k == 2:
+        return rng.randrange(-2**rng.randrange(64), 2**rng.randrange(64))
+    return rng.randrange(-2**63, 2**63)
+
+
+def randomFloat(rng):
+    k = rng.randrange(6)
+    if k == 0:
+        return rng.randrange(-2048, 2048) / 64              # flt16
+    if k == 1:
+        return struct.unpack('<f', struct.pack('<f', rng.uniform(-1e30, 1e30)))[0]
+    if k == 2:
+        return rng.choice([math.inf, -math.inf, math.nan])
+    if k == 3:
+        return rng.choice([0.0, -0.0])
+    bits = rng.getrandbits(64)
+    if (bits >> 52) & 0x7FF == 0x7FF:
+        bits &= ~(1 << 62)
+    return struct.unpack('<d', struct.pack('<Q', bits))[0]
+
+
+def randomLength(rng):
+    k = rng.randrange(16)
+    if k == 0:
+        return rng.randrange(64, 364)
+    if k == 1:
+        return 63 if rng.randrange(8) else rng.randrange(65536, 65636)
+    return rng.randrange(20)
+
+
+def randomString(rng):
+    # mostly ascii, some 2, 3 and 4 bytes utf8 characters
+    chars = []
+    for i in range(randomLength(rng)):
+        k = rng.randrange(16)
+        if k == 0:
+            chars.append(chr(rng.randrange(0x80, 0x800)))
+        elif k == 1:
+            chars.append(chr(rng.choice([0x20AC, 0x4E2D, 0x1F600])))
+        else:
+            chars.append(chr(rng.randrange(0x20, 0x7F)))
+    return ''.join(chars)
+
+
+def randomValue(rng, depth=0):
+    k = rng.randrange(10 if depth < 4 else 7)
+    if k == 0:
+        return None
+    if k == 1:
+        return rng.random() < 0.5
+    if k in (2, 3):
+        return randomInteger(rng)
+    if k == 4:
+        return randomFloat(rng)
+    if k == 5:
+        return randomString(rng)
+    if k == 6:
+        return bytes(rng.getrandbits(8) for i in range(randomLength(rng)))
+    n = rng.randrange(7) if rng.randrange(4) else rng.randrange(40)
+    if k == 9:
+        return {'k%d' % i: randomValue(rng, depth + 1) for i in range(n)}
+    return [randomValue(rng, depth + 1) for i in range(n)]
+
+
+def normalize(value):
+    '''Converts decoded objects to dicts and octet-stream blobs to bytes.'''
+    if isinstance(value, list):
+        return [normalize(v) for v in value]
+    if isinstance(value, tuple) and len(value) == 2 and value[0] == MIME:
+        return value[1]
+    if type(value).__name__ == 'YabeObject':
+        return {k: normalize(v) for k, v in vars(value).items()}
+    return value
+
+
+def same(a, b):
+    '''Value equality where NaN equals NaN and the types must match. The
+    sign of zero is not compared since flt0 doesn't encode it.'''
+    if type(a) != type(b):
+        return False
+    if isinstance(a, float):
+        return a == b or (math.isnan(a) and math.isnan(b))
+    if isinstance(a, list):
+        return len(a) == len(b) and all(same(x, y) for x, y in zip(a, b))
+    if isinstance(a, dict):
+        return list(a) == list(b) and all(same(a[k], b[k]) for k in a)
+    return a == b
+
+
+def decode(data):
+    try:
+        return normalize(yabe.loads(data))
+    except Exception as e:
+        return e
+
+
+def frames(encodings):
+    return b''.join(struct.pack('<I', len(e)) + e for e in encodings)
+
+
+def unframe(data):
+    out, pos = [], 0
+    while pos < len(data):
+        size = struct.unpack_from('<I', data, pos)[0]
+        out.append(data[pos + 4:pos + 4 + size])
+        pos += 4 + size
+    return out
+
+
+def run(binary, args, data):
+    p = subprocess.run([binary] + args, input=data, capture_output=True)
+    if p.returncode:
+        raise RuntimeError('%s %s failed: %s' % (binary, ' '.join(args), p.stderr.decode()))
+    return p.stdout, p.stderr.decode()
+
+
+def report(what, i, expected, got):
+    print('%s: value %d differs' % (what, i))
+    for j in range(min(len(expected), len(got))):
+        if expected[j] != got[j]:
+            print('  first difference at byte %d' % j)
+            break
+    print('  expected %s' % expected[:128].hex())
+    print('  got      %s' % got[:128].hex())
+
+
+def main():
+    parser = argparse.ArgumentParser(description='C and Python YABE differential test')
+    parser.add_argument('--bin', default='./yabe_diff', help='yabe_diff executable')
+    parser.add_argument('--seed', type=int, default=1)
+    parser.add_argument('--count', type=int, default=2000)
+    parser.add_argument('--repeat', type=int, default=20,
+                        help='timed C re-encoding passes for --min-mbps')
+    parser.add_argument('--min-mbps', type=float, default=0,
+                        help='minimum C re-encoding throughput')
+    args = parser.parse_args()
+    failures = 0
+
+    # Python encodes, C re-encodes
+    rng = random.Random(args.seed)
+    values = [randomValue(rng) for i in range(args.count)]
+    encoded = [yabe.dumps(v) for v in values]
+    out, err = run(args.bin, ['reencode'] + ([str(args.repeat)] if args.min_mbps else []),
+                   frames(encoded))
+    out = unframe(out)
+    if len(out) != len(encoded):
+        raise RuntimeError('yabe_diff reencode returned %d values' % len(out))
+    for i, (py, c) in enumerate(zip(encoded, out)):
+        if py != c:
+            report('python -> c', i, py, c)
+            failures += 1
+        elif not same(decode(c), values[i]):
+            print('python -> c: value %d does not round trip' % i)
+            failures += 1
+
+    # C encodes, Python decodes and encodes again
+    generated, _ = run(args.bin, ['gen', str(args.seed), str(args.count)], b'')
+    reencoded, _ = run(args.bin, ['reencode'], generated)
+    generated, reencoded = unframe(generated), unframe(reencoded)
+    if len(generated) != args.count or len(reencoded) != args.count:
+        raise RuntimeError('yabe_diff gen or reencode returned too few values')
+    for i, (g, c) in enumerate(zip(generated, reencoded)):
+        try:
+            py = yabe.dumps(decode(g))
+        except Exception as e:
+            print('c -> python: value %d could not be decoded: %r' % (i, e))
+            failures += 1
+            continue
+        if py != c:
+            report('c -> python', i, c, py)
+            failures += 1
+
+    print('%d values, %d failures' % (2 * args.count, failures))
+    if args.min_mbps:
+        mbps = float(err.split()[-2])
+        print(err.strip())
+        if mbps < args.min_mbps:
+            print('re-encoding throughput below %.1f MB/s' % args.min_mbps)
+            failures += 1
+    return 1 if failures else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -10,8 +10,9 @@ DESCRIPTION
 '''
 
 import codecs
-import collections
+import collections.abc
 import io
+import mmap
 import random
 import struct
 import types
@@ -34,11 +35,29 @@ ENDS    = 0xCB
 STR16   = 0xCD
 STR32   = 0xCE
 STR64   = 0xCF
+NONE    = 0xCC
 SARRAY  = 0xD0
 ARRAY   = 0xD7
 SOBJECT = 0xD8
 OBJECT  = 0xDF
 
+# Returned by _decode() for the end stream tag
+_ENDS = object()
+
+# Version 1 packed integer array extension codes
+
+PACKED_DELTA = 1
+PACKED_RLE   = 2
+PACKED_MAX_COUNT = 2**32    # larger packed arrays are rejected
+
+# Archive constants, see yabe_archive.h
+
+ARCHIVE_ALIGN    = 64
+_ARCHIVE_MIME    = 'application/x-yabe-archive'
+_ARCHIVE_MAGIC   = bytes([STR6 + 4]) + b'YARC'
+_ARCHIVE_ENTRY   = struct.Struct('<QQQII')
+_ARCHIVE_TRAILER = 14
+
 def _encode(obj, dest):
     if obj is None:
         _encodeNone(dest)
@@ -50,7 +69,11 @@ def _encode(obj, dest):
         _encodeBoolean(obj, dest)
     elif type(obj) == str:
         _encodeString(obj, dest)
-    elif isinstance(obj, collections.Iterable):
+    elif type(obj) == bytes:
+        _encodeBytes(obj, 'application/octet-stream', dest)
+    elif isinstance(obj, dict):
+        _encodeDict(obj, dest)
+    elif isinstance(obj, collections.abc.Iterable):
         _encodeIterable(obj, dest)
     else:
         _encodeObject(obj, dest)
@@ -101,7 +124,7 @@ def _encodeFloat(obj: float, dest):
                 hr = 0xFC00 # -inf
             else:
                 hr = 0x7C00 # +inf
-            dest.write(struct.pack('<Bh', FLT16, hr))
+            dest.write(struct.pack('<BH', FLT16, hr))
             return
 
         # get exponent value
@@ -113,7 +136,7 @@ def _encodeFloat(obj: float, dest):
             if dr < 0:
                 hr |= 0x8000            # sign
             hr |= ((dr >> 42) & 0x3FF)  # mantissa
-            dest.write(struct.pack('<Bh', FLT16, hr))
+            dest.write(struct.pack('<BH', FLT16, hr))
 
         # if value fits in a flt32
         elif (-126 <= he <= 127) and ((dr & 0x1FFFFFFF) == 0):
@@ -121,7 +144,7 @@ def _encodeFloat(obj: float, dest):
             if dr < 0:
                 fr |= 0x80000000
             fr |= (dr >> 29) & 0x7FFFFF
-            dest.write(struct.pack('<Bi', FLT32, fr))
+            dest.write(struct.pack('<BI', FLT32, fr))
 
         else:
             dest.write(struct.pack('<Bd', FLT64, obj))
@@ -130,7 +153,8 @@ def _encodeFloat(obj: float, dest):
 def _encodeBytes(obj: bytes, mimetype: str, dest):
     assert type(mimetype) == str
     assert type(obj) == bytes
-    dest.write(struct.pack('B', BLOB) + _encodeString(mimetype))
+    dest.write(struct.pack('B', BLOB))
+    _encodeString(mimetype, dest)
     l = len(obj)
     if l <= 63:
         code = 128 + l
@@ -171,6 +195,21 @@ def _encodeIterable(obj, dest):
         dest.write(struct.pack('B', ENDS))
 
 
+def _encodeDict(obj: dict, dest):
+    l = len(obj)
+    if l < 7:
+        dest.write(struct.pack('B', SOBJECT + l))
+    else:
+        dest.write(struct.pack('B', OBJECT))
+    for key, value in obj.items():
+        if type(key) != str:
+            raise TypeError('Object member identifiers must be strings')
+        _encodeString(key, dest)
+        _encode(value, dest)
+    if l >= 7:
+        dest.write(struct.pack('B', ENDS))
+
+
 def _encodeNone(dest):
     dest.write(struct.pack('B', NULL))
 
@@ -186,8 +225,8 @@ def _encodeObject(obj, dest):
                 and field[:2] != '__'
     ]
     l = len(fields)
-    if l <= 5:
-        dest.write(struct.pack('B', 0xD8 + l))
+    if l < 7:
+        dest.write(struct.pack('B', SOBJECT + l))
         for field in fields:
             _encodeString(field, dest)
             try:
@@ -215,13 +254,13 @@ def _decodeInteger(tag, f) -> object:
     bytes = f.read(size)
     if len(bytes) < size:
         raise IOError('Incomplete YABE sequence')
-    return struct.unpack(fmt, b)[0]
+    return struct.unpack(fmt, bytes)[0]
 
 
 def _decodeFloat(tag, f) -> object:
     assert tag in (FLT16, FLT32, FLT64)
 
-    params = {FLT16: '<h', FLT32: '<f', FLT64: '<d'}
+    params = {FLT16: '<H', FLT32: '<f', FLT64: '<d'}
     fmt = params[tag]
     size = struct.calcsize(fmt)
     bytes = f.read(size)
@@ -244,7 +283,7 @@ def _decodeFloat(tag, f) -> object:
             if hr & 0x8000:
                 dr |= (1 << 63)
             dr |= (hr & 0x3FF) << 42 # set value mantissa
-        return struct.unpack('<d', struct.pack('<q', dr))[0]
+        return struct.unpack('<d', struct.pack('<Q', dr))[0]
     else:
         return struct.unpack(fmt, bytes)[0]
 
@@ -255,7 +294,7 @@ def _decodeString(tag, f):
     if (tag & 0xC0) == STR6:
         l = tag & 0x3F
     else:
-        params = {STR16: '<h', STR32: '<i', STR64: '<q'}
+        params = {STR16: '<H', STR32: '<I', STR64: '<Q'}
         fmt = params[tag]
         size = struct.calcsize(fmt)
         bytes = f.read(size)
@@ -268,31 +307,92 @@ def _decodeString(tag, f):
     return codecs.decode(u8s, 'utf-8')
 
 
-def _decodeArray(f):
+def _decodeArray(f, version):
     ls = list()
-    obj = _decode(f)
-    while obj != ENDS:
+    obj = _decode(f, version)
+    while obj is not _ENDS:
         ls.append(obj)
-        obj = _decode(f)
+        obj = _decode(f, version)
     return ls
 
 
-def _decodeShortArray(tag, f):
+def _decodeShortArray(tag, f, version):
     assert (tag & 0xF8) == 0xD0
 
     size = tag & 7
     ls = list()
     for i in range(size):
-        obj = _decode(f)
+        obj = _decode(f, version)
         ls.append(obj)
     return ls
 
 
-def _decodeBlob(f):
+def _decodePacked(code, f):
+    byte = f.read(1)
+    if not len(byte):
+        raise IOError('Incomplete YABE sequence')
+    tag = struct.unpack('B', byte)[0]
+    if (tag & 0xC0) == STR6:
+        l = tag & 0x3F
+    elif tag in (STR16, STR32, STR64):
+        fmt = {STR16: '<H', STR32: '<I', STR64: '<Q'}[tag]
+        size = struct.calcsize(fmt)
+        bytes = f.read(size)
+        if len(bytes) < size:
+            raise IOError('Incomplete YABE sequence')
+        l = struct.unpack(fmt, bytes)[0]
+    else:
+        raise ValueError('Invalid packed array')
+    payload = f.read(l)
+    if len(payload) < l:
+        raise IOError('Incomplete YABE sequence')
+
+    if l < 8:
+        raise ValueError('Invalid packed array')
+    count = struct.unpack_from('<Q', payload, 0)[0]
+    if count > PACKED_MAX_COUNT:
+        raise ValueError('Packed array of too many values')
+    ls = list()
+    if code == PACKED_DELTA:
+        if l < 17:
+            raise ValueError('Invalid packed array')
+        value, width = struct.unpack_from('<qB', payload, 8)
+        if width > 64 or l != 17 + (max(count - 1, 0) * width + 7) // 8:
+            raise ValueError('Invalid packed array')
+        mask = (1 << width) - 1
+        if count:
+            ls.append(value)
+        for i in range(count - 1):
+            bit = i * width
+            chunk = int.from_bytes(payload[17 + (bit >> 3):26 + (bit >> 3)], 'little')
+            z = (chunk >> (bit & 7)) & mask
+            value += (z >> 1) ^ -(z & 1)
+            value = (value + 2**63) % 2**64 - 2**63   # wrap as int64
+            ls.append(value)
+    elif code == PACKED_RLE:
+        runs = range(8, l, 12)
+        if (l - 8) % 12 or sum(struct.unpack_from('<I', payload, pos)[0] for pos in runs) != count:
+            raise ValueError('Invalid packed array')
+        for pos in runs:
+            run, value = struct.unpack_from('<Iq', payload, pos)
+            ls.extend([value] * run)
+    else:
+        raise ValueError('Unsupported packed array extension code')
+    if len(ls) != count:
+        raise ValueError('Invalid packed array')
+    return ls
+
+
+def _decodeBlob(f, version):
     byte = f.read(1)
     if not len(byte):
         raise IOError('Incomplete YABE sequence')
     tag = struct.unpack('B', byte)[0]
+    if tag <= 127:
+        # version 1 packed integer array
+        if version < 1:
+            raise ValueError('Packed array in a version 0 YABE stream')
+        return _decodePacked(tag, f)
     mime = _decodeString(tag, f)
     byte = f.read(1)
     if not len(byte):
@@ -300,54 +400,58 @@ def _decodeBlob(f):
     tag = struct.unpack('B', byte)[0]
     if (tag & 0xC0) == STR6:
         l = (tag & 0x3F)
-    else:
-        params = {STR16: ('<h', 2), STR32: ('<i', 4), STR64: ('<q', 8)}
+    elif tag in (STR16, STR32, STR64):
+        params = {STR16: ('<H', 2), STR32: ('<I', 4), STR64: ('<Q', 8)}
         fmt, size = params[tag]
         bytes = f.read(size)
         if len(bytes) < size: 
             raise IOError('Incomplete YABE sequence')
         l = struct.unpack(fmt, bytes)[0]
+    else:
+        raise ValueError('Was expecting the blob data as a string')
     bytes = f.read(l)
-    if len(u8s) < l:
+    if len(bytes) < l:
         raise IOError('Incomplete YABE sequence')
     return (mime, bytes)
 
 
-def _decodeObject(f):
+def _decodeObject(f, version):
     # We need an empty class and an instance of this class
     class YabeObject:
         pass
     obj = YabeObject()
 
-    fieldName = _decode(f)
-    while fieldName != ENDS:
-        field = _decode(f)
+    fieldName = _decode(f, version)
+    while fieldName is not _ENDS:
+        field = _decode(f, version)
         obj.__setattr__(fieldName, field)
-        fieldName = _decode(f)
+        fieldName = _decode(f, version)
     return obj
 
 
-def _decodeShortObject(f, tag):
+def _decodeShortObject(f, tag, version):
     class YabeObject:
         pass
     obj = YabeObject()
 
     nbFields = (tag & 7)
     for i in range(nbFields):
-        fieldName = _decode(f)
+        fieldName = _decode(f, version)
         if type(fieldName) != str:
             raise TypeError('Was expecting a field name as a string')
-        field = _decode(f)
+        field = _decode(f, version)
         obj.__setattr__(fieldName, field)
     return obj
 
 
-def _decode(f) -> object:
-    c = f.read(1)
-    if len(c) == 0:
-        raise IOrror('Incomplete YABE sequence')
+def _decode(f, version=1) -> object:
+    tag = NONE
+    while tag == NONE:
+        c = f.read(1)
+        if len(c) == 0:
+            raise IOError('Incomplete YABE sequence')
+        tag = struct.unpack('B', c)[0]
 
-    tag = struct.unpack('B', c)[0]
     if 0 <= tag <= 127: 
         return tag
     elif 224 <= tag <= 255:
@@ -365,19 +469,19 @@ def _decode(f) -> object:
     elif tag == FALSE:
         return False
     elif tag == ARRAY:
-        return _decodeArray(f)
+        return _decodeArray(f, version)
     elif (tag & 0xF8) == SARRAY:
-        return _decodeShortArray(tag, f)
+        return _decodeShortArray(tag, f, version)
     elif tag == BLOB:
-        return _decodeBlob(f)
+        return _decodeBlob(f, version)
     elif tag == OBJECT:
-        return _decodeObject(f)
+        return _decodeObject(f, version)
     elif (tag & 0xF8) == SOBJECT:
-        return _decodeShortObject(f, tag)
+        return _decodeShortObject(f, tag, version)
     elif tag == NULL:
         return None
     elif tag == ENDS:
-        return ENDS
+        return _ENDS
 
 
 def dump(obj, f, protocol=0):
@@ -419,9 +523,9 @@ def load(f) -> object:
     if len(signature) < 5 or signature[:4] != b'YABE':
         raise ValueError('Not a YABE stream (incorrect signature)')
     version = struct.unpack('B', signature[4:])[0]
-    if version > 0:
+    if version > 1:
         raise ValueError('Yabe version not supported')
-    return _decode(f)
+    return _decode(f, version)
 
 
 def loads(b) -> object:
@@ -435,6 +539,159 @@ def loads(b) -> object:
     with io.BytesIO(b) as f:
         return load(f)
 
+
+def _archiveHash(name: bytes) -> int:
+    # 64 bit FNV-1a hash of a document name
+    h = 0xcbf29ce484222325
+    for c in name:
+        h = ((h ^ c) * 0x100000001b3) & 0xFFFFFFFFFFFFFFFF
+    return h
+
+
+class ArchiveWriter:
+    '''
+    Writes named documents into an archive, see yabe_archive.h. The
+    documents start on ARCHIVE_ALIGN byte boundaries and the directory of
+    their names is written by close().
+    Parameters:
+     - f: a path or a binary file-like object opened for writing.
+    '''
+    def __init__(self, f):
+        self._owned = isinstance(f, str)
+        self._f = open(f, 'wb') if self._owned else f
+        self._entries = []
+        self._names = set()
+        self._offset = 0
+        self._write(b'YABE\x01')
+
+    def _write(self, b):
+        pad = -len(b) % ARCHIVE_ALIGN
+        self._f.write(b)
+        self._f.write(bytes([NONE]) * pad)
+        self._offset += len(b) + pad
+
+    def add(self, name: str, obj):
+        '''
+        Serializes an object as the document of the given name.
+        '''
+        with io.BytesIO() as f:
+            _encode(obj, f)
+            self.add_encoded(name, f.getvalue())
+
+    def add_encoded(self, name: str, data: bytes):
+        '''
+        Adds a YABE encoded value, without signature, as the document of the
+        given name.
+        '''
+        if name in self._names:
+            raise ValueError('Duplicate document name ' + repr(name))
+        self._names.add(name)
+        self._entries.append((name.encode('utf-8'), self._offset, len(data)))
+        self._write(data)
+
+    def close(self):
+        '''
+        Writes the directory, then closes the file if the writer opened it.
+        '''
+        entries = sorted(self._entries, key=lambda e: (_archiveHash(e[0]), e[0]))
+        table = [struct.pack('<Q', len(entries))]
+        nameOffset = 0
+        for name, offset, size in entries:
+            table.append(_ARCHIVE_ENTRY.pack(_archiveHash(name), offset, size, nameOffset, len(name)))
+            nameOffset += len(name)
+        table += [e[0] for e in entries]
+        _encodeBytes(b''.join(table), _ARCHIVE_MIME, self._f)
+        self._f.write(struct.pack('<Bq', INT64, self._offset) + _ARCHIVE_MAGIC)
+        if self._owned:
+            self._f.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.close()
+
+
+class ArchiveReader:
+    '''
+    Reads the documents of an archive by name. A file is mapped in memory so
+    that only the bytes of the documents read are loaded. The names are
+    looked up in a dict built from the directory, the name hashes of the
+    directory are not checked.
+    Parameters:
+     - source: a path or a bytes-like object holding the archive.
+    '''
+    def __init__(self, source):
+        self._map = None
+        if isinstance(source, str):
+            with open(source, 'rb') as f:
+                self._map = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+            source = self._map
+        data = self._data = memoryview(source)
+        size = len(data)
+        if (size < 5 + _ARCHIVE_TRAILER or data[:4] != b'YABE' or data[4] > 1 or
+                data[-5:] != _ARCHIVE_MAGIC or data[-_ARCHIVE_TRAILER] != INT64):
+            raise ValueError('Not a YABE archive')
+        dirOffset = struct.unpack_from('<q', data, size - _ARCHIVE_TRAILER + 1)[0]
+        if not 5 <= dirOffset < size - _ARCHIVE_TRAILER:
+            raise ValueError('Invalid YABE archive directory')
+        with io.BytesIO(data[dirOffset:size - _ARCHIVE_TRAILER]) as f:
+            directory = _decode(f)
+            if f.read(1) or type(directory) != tuple or directory[0] != _ARCHIVE_MIME:
+                raise ValueError('Invalid YABE archive directory')
+        table = directory[1]
+        count = struct.unpack_from('<Q', table)[0] if len(table) >= 8 else -1
+        if not 0 <= count <= (len(table) - 8) // _ARCHIVE_ENTRY.size:
+            raise ValueError('Invalid YABE archive directory')
+        names = table[8 + count * _ARCHIVE_ENTRY.size:]
+        self._index = {}
+        for i in range(count):
+            _, offset, length, nameOffset, nameLen = _ARCHIVE_ENTRY.unpack_from(table, 8 + i * _ARCHIVE_ENTRY.size)
+            if offset < 5 or offset + length > dirOffset or nameOffset + nameLen > len(names):
+                raise ValueError('Invalid YABE archive directory')
+            self._index[names[nameOffset:nameOffset + nameLen].decode('utf-8')] = (offset, length)
+        if len(self._index) != count:
+            raise ValueError('Duplicate YABE archive document names')
+
+    def __len__(self):
+        return len(self._index)
+
+    def __iter__(self):
+        return iter(self._index)
+
+    def __contains__(self, name):
+        return name in self._index
+
+    def encoded(self, name: str) -> memoryview:
+        '''
+        Returns the encoded bytes of the document of the given name.
+        '''
+        offset, length = self._index[name]
+        return self._data[offset:offset + length]
+
+    def __getitem__(self, name: str) -> object:
+        '''
+        Deserializes the document of the given name.
+        '''
+        with io.BytesIO(self.encoded(name)) as f:
+            return _decode(f, self._data[4])
+
+    def close(self):
+        '''
+        Unmaps the archive file. The views returned by encoded() must be
+        released first.
+        '''
+        self._data.release()
+        if self._map is not None:
+            self._map.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.close()
+
+
 def _unittests():
     print('Testing tiny integers')
     for i in range(0, 128, 1):
@@ -546,6 +803,67 @@ def _unittests():
     assert c2.c == c.c
     assert c2.d == c.d
 
+    print('Testing blobs, dicts and booleans')
+    b = dumps({'x': b'\x00\xff', 'y': [True, False, -1.5, 65535.0], 'z': None})
+    assert bytes([SARRAY + 4, TRUE, FALSE, FLT16, 0x00, 0xBE, FLT32]) in b
+    o = loads(b)
+    assert o.x == ('application/octet-stream', b'\x00\xff')
+    assert o.y == [True, False, -1.5, 65535.0] and o.z is None
+    assert loads(b'YABE\x00' + bytes([NONE, NONE, ARRAY, 5, NONE, ENDS])) == [5]
+    assert loads(b'YABE\x00' + struct.pack('<BH', STR16, 40000) + b'a' * 40000) == 'a' * 40000
+
+    print('Testing packed integer arrays')
+    stamps = [1700000000000 + 1000 * i + random.randint(-8, 7) for i in range(1000)]
+    deltas = [stamps[0]] + [stamps[i] - stamps[i - 1] for i in range(1, len(stamps))]
+    width = max(((d << 1) ^ (d >> 63)).bit_length() for d in deltas[1:])
+    bits = 0
+    for i, d in enumerate(deltas[1:]):
+        bits |= ((d << 1) ^ (d >> 63)) << (i * width)
+    packed = struct.pack('<QqB', len(stamps), stamps[0], width)
+    packed += bits.to_bytes(((len(stamps) - 1) * width + 7) // 8, 'little')
+    rle = struct.pack('<QIqIq', 5, 3, -7, 2, 2**40)
+    b = b'YABE\x01' + struct.pack('<BBBBH', SARRAY + 2, BLOB, PACKED_DELTA, STR16, len(packed))
+    b += packed + struct.pack('<BBB', BLOB, PACKED_RLE, STR6 + len(rle)) + rle
+    assert loads(b) == [stamps, [-7, -7, -7, 2**40, 2**40]]
+    try:
+        loads(b'YABE\x00' + b[5:])
+        assert False
+    except ValueError:
+        pass
+    bomb = struct.pack('<QqB', 2**40, 0, 0)
+    rle = struct.pack('<QIqIqIq', 3 * 2**31, 2**31, 0, 2**31, 0, 2**31, 0)
+    for b in (struct.pack('<BBB', BLOB, PACKED_DELTA, STR6 + len(bomb)) + bomb,
+              struct.pack('<BBB', BLOB, PACKED_RLE, STR6 + len(rle)) + rle,
+              struct.pack('<BBBH', BLOB, PACKED_DELTA, STR16, len(packed) - 1) + packed[:-1]):
+        try:
+            loads(b'YABE\x01' + b)
+            assert False
+        except ValueError:
+            pass
+
+    print('Testing archives')
+    with io.BytesIO() as f:
+        with ArchiveWriter(f) as w:
+            for i in range(100):
+                w.add('doc%d' % i, {'i': i, 's': 'x' * i})
+            w.add_encoded('', b'\x07')
+            try:
+                w.add('doc1', 1)
+                assert False
+            except ValueError:
+                pass
+        b = f.getvalue()
+    with ArchiveReader(b) as r:
+        assert len(r) == 101 and 'doc99' in r and 'doc100' not in r
+        assert r['doc42'].i == 42 and r['doc42'].s == 'x' * 42 and r[''] == 7
+        assert all(offset % ARCHIVE_ALIGN == 0 for offset, _ in r._index.values())
+    assert loads(b).i == 0
+    try:
+        ArchiveReader(b[:-1])
+        assert False
+    except ValueError:
+        pass
+
 
 if __name__ == '__main__':
     _unittests()
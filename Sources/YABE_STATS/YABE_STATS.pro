@@ -0,0 +1,17 @@
+TEMPLATE = app
+CONFIG += console
+CONFIG -= qt
+
+TARGET = yabe_stats
+QMAKE_CFLAGS += -std=c99
+INCLUDEPATH += ../YABE_C
+
+SOURCES += main.c \
+    ../YABE_C/yabe.c
+
+HEADERS += \
+    ../YABE_C/yabe.h \
+    ../YABE_C/yabe_stats.h \
+    ../YABE_C/yabe_endian.h
+
+OTHER_FILES +=
@@ -0,0 +1,271 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "yabe.h"
+
+/* Profile of the values of a yabe file : the tag and width histogram, the
+   bytes used by each kind of value and the nesting of arrays and objects. */
+
+/* Kinds of values reported */
+enum
+{
+    kind_null, kind_bool,
+    kind_int8, kind_int16, kind_int32, kind_int64,
+    kind_flt0, kind_flt16, kind_flt32, kind_flt64,
+    kind_str6, kind_str16, kind_str32, kind_str64,
+    kind_blob, kind_packed,
+    kind_sarray, kind_arrays, kind_sobject, kind_objects,
+    kind_count
+};
+
+static const char* kindNames[kind_count] =
+{
+    "null", "bool",
+    "int 1 byte", "int16", "int32", "int64",
+    "flt0", "flt16", "flt32", "flt64",
+    "str6", "str16", "str32", "str64",
+    "blob", "packed array",
+    "small array", "array stream", "small object", "object stream"
+};
+
+typedef struct profile_t
+{
+    uint64_t values[kind_count];    // number of values of each kind
+    uint64_t bytes[kind_count];     // bytes of these values, items excluded
+    uint64_t noneBytes;             // none padding bytes
+    uint64_t containers;            // number of arrays and objects
+    uint64_t depthSum;              // sum of the depth of the containers
+    unsigned maxDepth;              // deepest container
+} profile_t;
+
+
+/* Kind of the encoding of a scalar value from its tag */
+static int scalarKind( uint8_t tag )
+{
+    if( tag < 0x80 || tag >= 0xE0 )
+        return kind_int8;
+    if( tag < 0xC0 )
+        return kind_str6;
+    switch( tag )
+    {
+    case 0xC0: return kind_null;
+    case 0xC1: return kind_int16;
+    case 0xC2: return kind_int32;
+    case 0xC3: return kind_int64;
+    case 0xC4: return kind_flt0;
+    case 0xC5: return kind_flt16;
+    case 0xC6: return kind_flt32;
+    case 0xC7: return kind_flt64;
+    case 0xC8: case 0xC9: return kind_bool;
+    case 0xCD: return kind_str16;
+    case 0xCE: return kind_str32;
+    case 0xCF: return kind_str64;
+    }
+    return -1;
+}
+
+
+/* Read a string value and its bytes, return false if it is invalid */
+static bool skipString( yabe_cursor_t* cursor )
+{
+    size_t len;
+    if( !cursor->len || !yabe_read_string( cursor, &len ) || len > cursor->len )
+        return false;
+    cursor->ptr += len;
+    cursor->len -= len;
+    return true;
+}
+
+
+/* Profile the value at cursor position, return false if it is invalid */
+static bool profileValue( profile_t* profile, yabe_cursor_t* cursor, unsigned depth )
+{
+    if( depth > YABE_MAX_DEPTH )
+        return false;
+    profile->noneBytes += yabe_read_none( cursor );
+    if( !cursor->len )
+        return false;
+
+    const char* start = cursor->ptr;
+    const uint8_t tag = (uint8_t)yabe_peek_tag( cursor );
+    int kind = scalarKind( tag );
+    int8_t nbr = 0;
+    int64_t code;
+    double flt;
+    if( kind >= kind_int8 && kind <= kind_int64 )
+    {
+        if( !yabe_read_integer( cursor, &code ) )
+            return false;
+    }
+    else if( kind >= kind_flt0 && kind <= kind_flt64 )
+    {
+        if( !yabe_read_float( cursor, &flt ) )
+            return false;
+    }
+    else if( kind >= kind_str6 )
+    {
+        if( !skipString( cursor ) )
+            return false;
+    }
+    else if( kind >= 0 )
+        yabe_skip_tag( cursor );
+    else if( yabe_read_blob( cursor ) )
+    {
+        // a packed array has an extension code instead of the mime type
+        kind = kind_blob;
+        if( cursor->len && yabe_read_integer( cursor, &code ) )
+            kind = kind_packed;
+        else if( !skipString( cursor ) )
+            return false;
+        if( !skipString( cursor ) )
+            return false;
+    }
+    else
+    {
+        if( yabe_read_small_array( cursor, &nbr ) )
+            kind = kind_sarray;
+        else if( yabe_read_small_object( cursor, &nbr ) )
+        {
+            kind = kind_sobject;
+            nbr *= 2;
+        }
+        else if( yabe_read_array_stream( cursor ) )
+            kind = kind_arrays;
+        else if( yabe_read_object_stream( cursor ) )
+            kind = kind_objects;
+        else
+            return false;
+        ++profile->containers;
+        profile->depthSum += depth;
+        if( depth > profile->maxDepth )
+            profile->maxDepth = depth;
+        ++profile->values[kind];
+        profile->bytes[kind] += cursor->ptr - start;
+
+        if( kind == kind_arrays || kind == kind_objects )
+        {
+            for( ;; )
+            {
+                profile->noneBytes += yabe_read_none( cursor );
+                if( !cursor->len )
+                    return false;
+                if( yabe_read_end_stream( cursor ) )
+                {
+                    ++profile->bytes[kind];
+                    return true;
+                }
+                if( !profileValue( profile, cursor, depth + 1 ) )
+                    return false;
+            }
+        }
+        while( nbr-- )
+            if( !profileValue( profile, cursor, depth + 1 ) )
+                return false;
+        return true;
+    }
+    ++profile->values[kind];
+    profile->bytes[kind] += cursor->ptr - start;
+    return true;
+}
+
+
+/* Read the whole file, return NULL on error */
+static char* readFile( const char* path, size_t* size )
+{
+    FILE* file = fopen( path, "rb" );
+    if( !file )
+        return NULL;
+    char* data = NULL;
+    size_t capacity = 0;
+    *size = 0;
+    for( ;; )
+    {
+        if( *size == capacity )
+        {
+            capacity = capacity ? 2*capacity : 65536;
+            char* p = realloc( data, capacity );
+            if( !p )
+                break;
+            data = p;
+        }
+        const size_t n = fread( data + *size, 1, capacity - *size, file );
+        *size += n;
+        if( n == 0 )
+        {
+            if( ferror( file ) )
+                break;
+            fclose( file );
+            return data;
+        }
+    }
+    free( data );
+    fclose( file );
+    return NULL;
+}
+
+
+int main( int argc, char* argv[] )
+{
+    if( argc != 2 )
+    {
+        fprintf( stderr, "usage: yabe_stats file.yabe\n" );
+        return 2;
+    }
+    size_t size;
+    char* data = readFile( argv[1], &size );
+    if( !data )
+    {
+        perror( argv[1] );
+        return 1;
+    }
+
+    yabe_cursor_t cursor = { data, size };
+    size_t signature = yabe_read_signature( &cursor );
+    if( signature == 4 )
+    {
+        fprintf( stderr, "%s: unsupported yabe version %d\n", argv[1], (uint8_t)cursor.ptr[0] );
+        return 1;
+    }
+
+    profile_t profile = { { 0 }, { 0 }, 0, 0, 0, 0 };
+    uint64_t nTop = 0;
+    while( cursor.len )
+    {
+        profile.noneBytes += yabe_read_none( &cursor );
+        if( !cursor.len )
+            break;
+        if( !profileValue( &profile, &cursor, 0 ) )
+        {
+            fprintf( stderr, "%s: invalid value at offset %zu\n", argv[1],
+                     (size_t)(cursor.ptr - data) );
+            return 1;
+        }
+        ++nTop;
+    }
+
+    uint64_t nValues = 0;
+    for( int k = 0; k < kind_count; ++k )
+        nValues += profile.values[k];
+    printf( "%s: %zu bytes, signature %s, %llu top level values, %llu values\n\n",
+            argv[1], size, signature ? "yes" : "no",
+            (unsigned long long)nTop, (unsigned long long)nValues );
+    printf( "%-16s %12s %7s %14s %7s %9s\n",
+            "encoding", "values", "%", "bytes", "%", "bytes/val" );
+    for( int k = 0; k < kind_count; ++k )
+    {
+        if( !profile.values[k] )
+            continue;
+        printf( "%-16s %12llu %6.2f%% %14llu %6.2f%% %9.2f\n", kindNames[k],
+                (unsigned long long)profile.values[k], 100. * profile.values[k] / nValues,
+                (unsigned long long)profile.bytes[k], 100. * profile.bytes[k] / size,
+                (double)profile.bytes[k] / profile.values[k] );
+    }
+    printf( "%-16s %12s %7s %14llu %6.2f%%\n", "none padding", "", "",
+            (unsigned long long)profile.noneBytes, size ? 100. * profile.noneBytes / size : 0. );
+    printf( "\ncontainers %llu, average depth %.2f, maximum depth %u\n",
+            (unsigned long long)profile.containers,
+            profile.containers ? (double)profile.depthSum / profile.containers : 0.,
+            profile.maxDepth );
+    free( data );
+    return 0;
+}